@@ -26,7 +26,7 @@
  * \library       midicvt application portion of libmidifilex
  * \author        Chris Ahlstrom and many others; see documentation
  * \date          2014-04-09
- * \updates       2014-05-20
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  */
@@ -99,7 +99,7 @@ extern void midicvt_initfuncs_mf2t (void);
 extern FILE * efopen (const char * name, const char * mode);
 extern cbool_t midicvt_setup_compile (void);
 extern void midicvt_close_compile (void);
-extern void midicvt_compile (void);
+extern cbool_t midicvt_compile (void);
 extern cbool_t midicvt_setup_mfread (void);
 extern void midicvt_close_mfread (void);
 
@@ -0,0 +1,181 @@
+#ifndef LIBMIDIFILEX_MIDICVT_BIN_H
+#define LIBMIDIFILEX_MIDICVT_BIN_H
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version. This program is distributed in the hope that
+ * it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details. You should have received a
+ * copy of the GNU General Public License along with this program; if not,
+ * write to the...
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midicvt_bin.h
+ *
+ *    This module provides a compact binary event format that can be used
+ *    in place of the ASCII text format for MIDI-to-text-to-MIDI round
+ *    trips.
+ *
+ * \library       midicvt application portion of libmidifilex
+ * \author        Chris Ahlstrom and many others; see documentation
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    The file consists of three parts:  a fixed header, an array of
+ *    fixed-size event records, and a heap of payload bytes.  All
+ *    multi-byte values are unsigned and little-endian.  Since every record
+ *    has the same size, a tool can mmap() the file and index the events
+ *    directly.
+ *
+ *    Header (MIDICVT_BIN_HEADER_SIZE = 32 bytes):
+ *
+\verbatim
+      Offset  Size  Field
+       0      4     Magic "MCVB"
+       4      2     Version (MIDICVT_BIN_VERSION)
+       6      2     SMF format (0, 1, or 2)
+       8      2     Number of tracks
+      10      2     Division, exactly as in the MThd chunk
+      12      4     Number of event records
+      16      4     Number of bytes in the payload heap
+      20      4     File offset of the first record (32)
+      24      4     File offset of the payload heap
+      28      4     Reserved, 0
+\endverbatim
+ *
+ *    Event record (MIDICVT_BIN_RECORD_SIZE = 20 bytes):
+ *
+\verbatim
+      Offset  Size  Field
+       0      4     Absolute time in ticks, from the start of the track
+       4      4     Offset of the payload in the heap
+       8      4     Length of the payload, in bytes
+      12      2     Track number, starting at 0
+      14      1     Status byte:  80 to EF for channel events (with the
+                    channel), FF for meta events, F0 for SysEx, and F7
+                    for escaped events
+      15      1     Data byte 1, or the meta-event type for meta events
+      16      1     Data byte 2
+      17      3     Reserved, 0
+\endverbatim
+ *
+ *    The records are sorted by track, and by time within each track.
+ *    Channel events have no payload.  For SysEx and escaped events, the
+ *    payload does not include the F0 or F7 status byte.  The payload of a
+ *    meta event is exactly the data bytes that follow its length in the
+ *    MIDI file.  Each track normally ends with an End of Track meta event;
+ *    one is added when the track is written if it is missing.
+ */
+
+#include <midicvt_macros.h>            /* cbool_t and more                    */
+#include <midifilex.h>                 /* Mf_currtime and much more           */
+
+/**
+ *    Provides the four bytes that start every binary event file.
+ */
+
+#define MIDICVT_BIN_MAGIC           "MCVB"
+
+/**
+ *    Provides the version of the format written by this library.  A
+ *    file with a different version is rejected.
+ */
+
+#define MIDICVT_BIN_VERSION         1
+
+/**
+ *    Provides the size of the file header, in bytes.
+ */
+
+#define MIDICVT_BIN_HEADER_SIZE     32
+
+/**
+ *    Provides the size of an event record, in bytes.
+ */
+
+#define MIDICVT_BIN_RECORD_SIZE     20
+
+/**
+ *    Holds the decoded contents of the file header.
+ */
+
+typedef struct
+{
+   int format;                         /**< SMF format, 0, 1, or 2.        */
+   int ntracks;                        /**< Number of tracks.              */
+   int division;                       /**< Division, as in MThd.          */
+   unsigned long record_count;         /**< Number of event records.       */
+   unsigned long heap_size;            /**< Size of the payload heap.      */
+   unsigned long record_offset;        /**< File offset of the records.    */
+   unsigned long heap_offset;          /**< File offset of the heap.       */
+
+} midicvt_bin_header_t;
+
+/**
+ *    Holds the decoded contents of one event record.
+ */
+
+typedef struct
+{
+   unsigned long tick;                 /**< Absolute time, in ticks.       */
+   unsigned long payload_offset;       /**< Payload offset in the heap.    */
+   unsigned long payload_length;       /**< Payload length, in bytes.      */
+   int track;                          /**< Track number, from 0.          */
+   int status;                         /**< Status byte.                   */
+   int data1;                          /**< Data byte 1, or meta type.     */
+   int data2;                          /**< Data byte 2.                   */
+
+} midicvt_bin_event_t;
+
+EXTERN_C_DEC
+
+extern void midicvt_initfuncs_bin (void);
+extern cbool_t midicvt_close_bin (void);
+extern unsigned long midicvt_bin_record_count (void);
+extern void midicvt_bin_get_columns
+(
+   unsigned char * status,
+   unsigned char * data1,
+   unsigned char * data2
+);
+extern void midicvt_bin_put_columns
+(
+   const unsigned char * status,
+   const unsigned char * data1,
+   const unsigned char * data2,
+   const unsigned char * keep
+);
+extern cbool_t midicvt_compile_bin (void);
+extern cbool_t midicvt_bin_get_header
+(
+   const unsigned char * data,
+   unsigned long size,
+   midicvt_bin_header_t * header
+);
+extern void midicvt_bin_get_event
+(
+   const unsigned char * data,
+   const midicvt_bin_header_t * header,
+   unsigned long index,
+   midicvt_bin_event_t * ev
+);
+
+EXTERN_C_END
+
+#endif         /*  LIBMIDIFILEX_MIDICVT_BIN_H */
+
+/*
+ * midicvt_bin.h
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
@@ -0,0 +1,125 @@
+#ifndef LIBMIDIFILEX_MIDICVT_CACHE_H
+#define LIBMIDIFILEX_MIDICVT_CACHE_H
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version. This program is distributed in the hope that
+ * it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details. You should have received a
+ * copy of the GNU General Public License along with this program; if not,
+ * write to the...
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midicvt_cache.h
+ *
+ *    This module provides a directory of compiled tracks, so that
+ *    --compile can skip the tracks of an ASCII file that have not changed
+ *    since the last time it was compiled.
+ *
+ * \library       midicvt application portion of libmidifilex
+ * \author        Chris Ahlstrom and many others; see documentation
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    Each compiled track is stored in its own file, named by a 64-bit
+ *    hash (16 hexadecimal digits) of the text of the track plus the state
+ *    that the compiler had when it started the track, with an extension
+ *    of ".mtrk".  All values are little-endian, except in the MTrk chunk.
+ *
+ *    The hash only names the file.  The text and the starting state are
+ *    stored in the file as well, and compared with those of the track
+ *    being compiled, so that two tracks with the same hash can never be
+ *    mistaken for one another.
+ *
+\verbatim
+      Offset  Size  Field
+       0      4     Magic "MCVC"
+       4      4     Version (MIDICVT_CACHE_VERSION)
+       8      4     The number of lines from this MTrk to the next one,
+                    as counted by the scanner
+      12      16    The compiler state after the track, 4 values
+      28      4     The number of context values, c
+      32      4     The length of the text of the track, t
+      36      4c    The context values, the state before the track
+      36+4c   t     The text of the track
+      ...     n     The complete MTrk chunk, header and length included
+\endverbatim
+ */
+
+#include <midicvt_macros.h>            /* cbool_t and more                    */
+
+/**
+ *    Provides the size of a cache key, including the null terminator.
+ */
+
+#define MIDICVT_CACHE_KEY_SIZE      17
+
+/**
+ *    Provides the number of state values stored with each track.  These
+ *    are g_status_M0, g_status_T0, g_status_measure, and g_status_beat,
+ *    the meter state that a TimeSig event changes.
+ */
+
+#define MIDICVT_CACHE_STATE_COUNT   4
+
+/**
+ *    Provides the version of the cache files.  A file with a different
+ *    version is ignored, and replaced.
+ */
+
+#define MIDICVT_CACHE_VERSION       3
+
+EXTERN_C_DEC
+
+extern void midicvt_cache_key
+(
+   const char * text,
+   unsigned long length,
+   const long * context,
+   int count,
+   char * key
+);
+extern cbool_t midicvt_cache_load
+(
+   const char * key,
+   const char * text,
+   unsigned long length,
+   const long * context,
+   int count,
+   long * state,
+   int * lines,
+   unsigned char ** data,
+   unsigned long * size
+);
+extern cbool_t midicvt_cache_store
+(
+   const char * key,
+   const char * text,
+   unsigned long length,
+   const long * context,
+   int count,
+   const long * state,
+   int lines,
+   const unsigned char * data,
+   unsigned long size
+);
+
+EXTERN_C_END
+
+#endif         /*  LIBMIDIFILEX_MIDICVT_CACHE_H */
+
+/*
+ * midicvt_cache.h
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
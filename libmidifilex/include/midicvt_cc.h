@@ -1,3 +1,6 @@
+#ifndef LIBMIDIFILEX_MIDICVT_CC_H
+#define LIBMIDIFILEX_MIDICVT_CC_H
+
 /*
  * midicvt - A text-MIDI translater
  *
@@ -24,20 +27,31 @@
  * \file          midicvt_cc.h
  *
  *    This module provides a place to collect the names of MIDI Control
- *    Change (Continuous Controller, CC) for the upcoming --human option.
+ *    Change (Continuous Controller, CC) for the upcoming --human option,
+ *    and the names of the MIDI notes.
  *
  * \library       midicvt application
  * \author        Chris Ahlstrom
  * \date          2016-05-19
- * \updates       2016-05-19
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
- *    This module provides a function to safely access the static/private
- *    list of MIDI CC names.
+ *    This module provides functions to safely access the static/private
+ *    lists of MIDI CC names and note names.
  */
 
+#include <midicvt_macros.h>            /* cbool_t, EXTERN_C_DEC               */
+
+EXTERN_C_DEC
+
 extern const char * midi_controller_name (int cc);
+extern int midi_controller_name_length (int cc);
+extern const char * midi_note_name (int note, cbool_t letters, int * length);
+
+EXTERN_C_END
+
+#endif         /*  LIBMIDIFILEX_MIDICVT_CC_H */
 
 /*
  * midicvt_cc.h
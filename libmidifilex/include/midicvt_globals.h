@@ -32,12 +32,11 @@
  * \library       midicvt application portion of libmidifilex
  * \author        Chris Ahlstrom and others; see documentation
  * \date          2014-04-09
- * \updates       2016-05-19
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  */
 
-#include <setjmp.h>                    /* jmp_buf                             */
 #include <stdio.h>                     /* FILE *                              */
 #include <midicvt_macros.h>            /* cbool_t and other stuff             */
 
@@ -57,25 +56,24 @@
 
 /**
  *    Global variables!  We have managed to hide some of the other ones
- *    within the midicvt_globals.c module, but not all of them yet.
+ *    within the midicvt_globals.c module, but not all of them yet.  The
+ *    file and status variables are thread-local; see midifilex.c.
  */
 
-extern FILE * g_io_file;
-extern FILE * g_redirect_file;         /* for redirecting stdout              */
-extern jmp_buf g_status_erjump;
-extern int g_status_tracks_to_do;
-extern int g_status_err_cont;
-extern int g_status_format;
-extern int g_status_no_of_tracks;
-extern unsigned char * g_status_buffer;
-extern int g_status_buflen;
-extern int g_status_bufsiz;
-extern int g_status_track_number;
-extern int g_status_measure;
-extern int g_status_M0;
-extern int g_status_beat;
-extern int g_status_clicks;
-extern long g_status_T0;
+extern MIDICVT_THREAD_LOCAL FILE * g_io_file;
+extern MIDICVT_THREAD_LOCAL FILE * g_redirect_file;  /* for redirecting stdout */
+extern MIDICVT_THREAD_LOCAL int g_status_tracks_to_do;
+extern MIDICVT_THREAD_LOCAL int g_status_format;
+extern MIDICVT_THREAD_LOCAL int g_status_no_of_tracks;
+extern MIDICVT_THREAD_LOCAL unsigned char * g_status_buffer;
+extern MIDICVT_THREAD_LOCAL int g_status_buflen;
+extern MIDICVT_THREAD_LOCAL int g_status_bufsiz;
+extern MIDICVT_THREAD_LOCAL int g_status_track_number;
+extern MIDICVT_THREAD_LOCAL int g_status_measure;
+extern MIDICVT_THREAD_LOCAL int g_status_M0;
+extern MIDICVT_THREAD_LOCAL int g_status_beat;
+extern MIDICVT_THREAD_LOCAL int g_status_clicks;
+extern MIDICVT_THREAD_LOCAL long g_status_T0;
 extern char * g_option_Onmsg;
 extern char * g_option_Offmsg;
 extern char * g_option_PoPrmsg;
@@ -134,6 +132,30 @@ extern cbool_t midicvt_option_compile (void);
 extern void midicvt_set_option_m2m (cbool_t f);
 extern cbool_t midicvt_option_m2m (void);
 
+extern void midicvt_set_option_csv (char separator);  /* new 2026-10-18 */
+extern char midicvt_option_csv (void);
+
+extern void midicvt_set_option_binary (cbool_t flag); /* new 2026-10-18 */
+extern cbool_t midicvt_option_binary (void);
+
+extern void midicvt_set_option_json (int mode);       /* new 2026-10-18 */
+extern int midicvt_option_json (void);
+
+extern void midicvt_set_option_flex (cbool_t flag);   /* new 2026-10-18 */
+extern cbool_t midicvt_option_flex (void);
+
+extern void midicvt_set_option_jobs (int jobs);       /* new 2026-10-18 */
+extern int midicvt_option_jobs (void);
+
+extern void midicvt_set_option_cache (const char * dir); /* new 2026-10-18 */
+extern const char * midicvt_option_cache (void);
+
+extern void midicvt_set_option_stats (cbool_t flag);  /* new 2026-10-18 */
+extern cbool_t midicvt_option_stats (void);
+
+extern void midicvt_set_option_validate (cbool_t flag); /* new 2026-10-18 */
+extern cbool_t midicvt_option_validate (void);
+
 EXTERN_C_END
 
 #endif         /* LIBMIDIFILEX_MIDICVT_GLOBALS_H */
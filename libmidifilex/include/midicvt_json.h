@@ -0,0 +1,60 @@
+#ifndef LIBMIDIFILEX_MIDICVT_JSON_H
+#define LIBMIDIFILEX_MIDICVT_JSON_H
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version. This program is distributed in the hope that
+ * it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details. You should have received a
+ * copy of the GNU General Public License along with this program; if not,
+ * write to the...
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midicvt_json.h
+ *
+ *    This module provides functions for writing MIDI events as JSON, either
+ *    as JSON Lines or as a single JSON document.
+ *
+ * \library       midicvt application portion of libmidifilex
+ * \author        Chris Ahlstrom and many others; see documentation
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ */
+
+#include <midicvt_macros.h>            /* cbool_t and more                    */
+#include <midifilex.h>                 /* Mf_currtime and much more           */
+
+/**
+ *    Values for midicvt_set_option_json().  MIDICVT_JSON_LINES writes one
+ *    JSON object per line (--json), and MIDICVT_JSON_DOCUMENT writes one
+ *    JSON object for the whole file (--json-doc).
+ */
+
+#define MIDICVT_JSON_NONE           0
+#define MIDICVT_JSON_LINES          1
+#define MIDICVT_JSON_DOCUMENT       2
+
+EXTERN_C_DEC
+
+extern void midicvt_initfuncs_json (void);
+extern cbool_t midicvt_close_json (void);
+
+EXTERN_C_END
+
+#endif         /*  LIBMIDIFILEX_MIDICVT_JSON_H */
+
+/*
+ * midicvt_json.h
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
@@ -10,7 +10,7 @@
  * \library       libmidifilex
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2013-11-17
- * \updates       2016-05-19
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
@@ -119,6 +119,23 @@
 #define nullptr                  0
 #endif
 
+/**
+ *    Marks a global variable that belongs to the MIDI file being read or
+ *    written, such as the Mf_* callbacks.  Each thread then has its own
+ *    copy, and so can convert its own file at the same time as the
+ *    others.  The "initial-exec" model makes these variables about as
+ *    fast as plain globals, which matters for the per-byte callbacks; it
+ *    is fine for a library that is linked in rather than loaded with
+ *    dlopen().
+ */
+
+#if defined __GNUC__
+#define MIDICVT_THREAD_LOCAL \
+   __thread __attribute__((tls_model("initial-exec")))
+#else
+#define MIDICVT_THREAD_LOCAL
+#endif
+
 /**
  *    Provides a way to declare functions as having either a C++ or C
  *    interface.
@@ -0,0 +1,191 @@
+#ifndef LIBMIDIFILEX_MIDICVT_WRITER_H
+#define LIBMIDIFILEX_MIDICVT_WRITER_H
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version. This program is distributed in the hope that
+ * it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details. You should have received a
+ * copy of the GNU General Public License along with this program; if not,
+ * write to the...
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midicvt_writer.h
+ *
+ *    This module provides the pieces shared by the event writers of
+ *    midicvt_csv.c, midicvt_json.c, and midicvt_bin.c:  a buffered output
+ *    writer, and the Mf_* callbacks that reduce every MIDI event to either
+ *    a channel event or a data event.
+ *
+ * \library       midicvt application portion of libmidifilex
+ * \author        Chris Ahlstrom and many others; see documentation
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ */
+
+#include <stddef.h>                    /* size_t                              */
+
+#include <midicvt_macros.h>            /* cbool_t and more                    */
+#include <midifilex.h>                 /* Mf_currtime and much more           */
+
+/**
+ *    Provides the size of the output buffer of a midicvt_writer_t.  The
+ *    output is accumulated here and written out in large blocks.
+ */
+
+#define MIDICVT_WRITER_SIZE         (64 * 1024)
+
+/**
+ *    Holds the output of an event writer until it is written to
+ *    g_redirect_file.  The text is built directly in the buffer, without
+ *    any printf() formatting, so that the conversion of a large MIDI file
+ *    is limited by the disk, not by the formatting.
+ */
+
+typedef struct
+{
+   /**
+    *    Holds the output bytes.
+    */
+
+   char buffer [MIDICVT_WRITER_SIZE];
+
+   /**
+    *    Provides the number of bytes currently held in the buffer.
+    */
+
+   size_t count;
+
+   /**
+    *    Indicates that a write to the output file failed.  Further output
+    *    is then skipped.
+    */
+
+   cbool_t write_error;
+
+   /**
+    *    Names the kind of output, such as "CSV", for the error message.
+    */
+
+   const char * name;
+
+} midicvt_writer_t;
+
+/**
+ *    Receives a channel event from the callbacks set up by
+ *    midicvt_writer_callbacks().
+ *
+ *    The parameters are the event nybble (e.g. note_on), the channel
+ *    (0 to 15), the first data byte, and the second data byte, which is -1
+ *    for Program Change and Channel Pressure.
+ */
+
+typedef void (* midicvt_channel_event_t) (int, int, int, int);
+
+/**
+ *    Receives a meta, SysEx, or escaped event from the callbacks set up by
+ *    midicvt_writer_callbacks().
+ *
+ *    The parameters are the status byte (0xff, 0xf0, or 0xf7), the
+ *    meta-event type (-1 for SysEx and escaped events), the payload, and
+ *    the number of payload bytes.  The F0 byte of a SysEx event is not
+ *    part of the payload.
+ */
+
+typedef void (* midicvt_data_event_t)
+(
+   int, int, const unsigned char *, int
+);
+
+EXTERN_C_DEC
+
+extern void midicvt_writer_reset (midicvt_writer_t * w, const char * name);
+extern cbool_t midicvt_writer_flush (midicvt_writer_t * w);
+extern void midicvt_writer_putn
+(
+   midicvt_writer_t * w, const char * s, size_t length
+);
+extern void midicvt_writer_putu (midicvt_writer_t * w, unsigned long value);
+extern void midicvt_writer_puthex
+(
+   midicvt_writer_t * w, const unsigned char * p, int leng
+);
+extern void midicvt_writer_callbacks
+(
+   midicvt_channel_event_t channel_event,
+   midicvt_data_event_t data_event
+);
+
+EXTERN_C_END
+
+/**
+ *    Makes sure the output buffer has room for the given number of bytes,
+ *    flushing it if necessary.
+ *
+ * \param w
+ *    Provides the writer.
+ *
+ * \param count
+ *    Provides the number of bytes needed.  Must not exceed
+ *    MIDICVT_WRITER_SIZE.
+ */
+
+static inline void
+midicvt_writer_reserve (midicvt_writer_t * w, size_t count)
+{
+   if (w->count + count > MIDICVT_WRITER_SIZE)
+      (void) midicvt_writer_flush(w);
+}
+
+/**
+ *    Appends a single character to the output buffer.  The caller must
+ *    have reserved the room already.
+ *
+ * \param w
+ *    Provides the writer.
+ *
+ * \param c
+ *    Provides the character to be appended.
+ */
+
+static inline void
+midicvt_writer_putc (midicvt_writer_t * w, char c)
+{
+   w->buffer[w->count++] = c;
+}
+
+/**
+ *    Appends a null-terminated string to the output buffer.  The caller
+ *    must have reserved the room already.
+ *
+ * \param w
+ *    Provides the writer.
+ *
+ * \param s
+ *    Provides the characters to be appended.
+ */
+
+static inline void
+midicvt_writer_puts (midicvt_writer_t * w, const char * s)
+{
+   while (*s != 0)
+      w->buffer[w->count++] = *s++;
+}
+
+#endif         /*  LIBMIDIFILEX_MIDICVT_WRITER_H */
+
+/*
+ * midicvt_writer.h
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
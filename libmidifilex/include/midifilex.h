@@ -27,7 +27,7 @@
  * \library       libmidifilex
  * \author        Chris Ahlstrom and many other authors; see documentation
  * \date          2014-04-08
- * \updates       2014-05-20
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  */
@@ -35,40 +35,56 @@
 #include <stdio.h>                     /* FILE *                              */
 #include <midicvt_macros.h>            /* EXTERN_C_DEC, true, false, etc.     */
 
-extern int Mf_nomerge;
-extern long Mf_currtime;
+/**
+ *    Holds a track chunk, or several, built in memory rather than written
+ *    to a file.  It is used by mf_w_track_chunk() when the output cannot
+ *    seek, and by the --cache compile of midicvt_base.c.  Start with all
+ *    members zero, and release it with mf_track_buffer_free().
+ */
+
+typedef struct
+{
+   unsigned char * data;               /**< The bytes, from realloc().        */
+   unsigned long size;                 /**< The number of bytes in use.       */
+   unsigned long alloc;                /**< The allocated number of bytes.    */
+
+} mf_track_buffer_t;
+
+extern MIDICVT_THREAD_LOCAL int Mf_nomerge;
+extern MIDICVT_THREAD_LOCAL long Mf_currtime;
 
 /* definitions for MIDI file parsing code */
 
 EXTERN_C_DEC
 
-extern int (* Mf_getc) (void);
-extern int (* Mf_error) (const char *);
-extern int (* Mf_report) (const char *);
-extern int (* Mf_header) (int, int, int);
-extern int (* Mf_starttrack) (void);
-extern int (* Mf_endtrack) (long, unsigned long);
-extern int (* Mf_on) (int, int, int);
-extern int (* Mf_off) (int, int, int);
-extern int (* Mf_pressure) (int, int, int);
-extern int (* Mf_parameter) (int, int, int);
-extern int (* Mf_pitchbend) (int, int, int);
-extern int (* Mf_program) (int, int);
-extern int (* Mf_chanpressure) (int, int);
-extern int (* Mf_sysex) (int, char *);
-extern int (* Mf_metamisc) (int, int, char *);
-extern int (* Mf_sqspecific) (int, char *);
-extern int (* Mf_seqnum) (short int);
-extern int (* Mf_text) (int, int, char *);
-extern int (* Mf_eot) (void);
-extern int (* Mf_timesig) (int, int, int, int);
-extern int (* Mf_smpte) (int, int, int, int, int);
-extern int (* Mf_tempo) (long);
-extern int (* Mf_keysig) (int, int);
-extern int (* Mf_arbitrary) (int, char *);
-extern int (* Mf_putc) (unsigned char);
-extern int (* Mf_wtrack) (void);
-extern int (* Mf_wtempotrack) (void);
+extern MIDICVT_THREAD_LOCAL int (* Mf_getc) (void);
+extern MIDICVT_THREAD_LOCAL int (* Mf_error) (const char *);
+extern MIDICVT_THREAD_LOCAL int (* Mf_report) (const char *);
+extern MIDICVT_THREAD_LOCAL int (* Mf_header) (int, int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_starttrack) (void);
+extern MIDICVT_THREAD_LOCAL int (* Mf_endtrack) (long, unsigned long);
+extern MIDICVT_THREAD_LOCAL int (* Mf_on) (int, int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_off) (int, int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_pressure) (int, int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_parameter) (int, int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_pitchbend) (int, int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_program) (int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_chanpressure) (int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_sysex) (int, char *);
+extern MIDICVT_THREAD_LOCAL int (* Mf_metamisc) (int, int, char *);
+extern MIDICVT_THREAD_LOCAL int (* Mf_sqspecific) (int, char *);
+extern MIDICVT_THREAD_LOCAL int (* Mf_seqnum) (short int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_text) (int, int, char *);
+extern MIDICVT_THREAD_LOCAL int (* Mf_eot) (void);
+extern MIDICVT_THREAD_LOCAL int (* Mf_timesig) (int, int, int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_smpte) (int, int, int, int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_tempo) (long);
+extern MIDICVT_THREAD_LOCAL int (* Mf_keysig) (int, int);
+extern MIDICVT_THREAD_LOCAL int (* Mf_arbitrary) (int, char *);
+extern MIDICVT_THREAD_LOCAL int (* Mf_putc) (unsigned char);
+extern MIDICVT_THREAD_LOCAL int (* Mf_wtrack) (void);
+extern MIDICVT_THREAD_LOCAL int (* Mf_wtempotrack) (void);
+extern MIDICVT_THREAD_LOCAL void * Mf_userdata;
 
 extern float mf_ticks2sec (unsigned long, int, unsigned int);
 extern unsigned long mf_sec2ticks (float, int, unsigned int);
@@ -76,6 +92,8 @@ extern void write32bit (unsigned long data);
 
 extern void mfread (void);
 extern void mftransform (void);
+extern cbool_t mftransform_trapped (void);
+extern void mf_abort (void);
 extern void mfwrite (int, int, int, FILE *);
 extern void midifile (void);
 
@@ -86,6 +104,11 @@ extern void mf_w_track_chunk
    FILE * fp,
    int (* wtrack)(void)
 );
+extern unsigned long mf_w_track_data
+(
+   int which_track,
+   int (* wtrack)(void)
+);
 extern void mf_w_track_start
 (
    int which_track,
@@ -107,9 +130,39 @@ extern int mf_w_meta_event
 (
    unsigned long, unsigned char, unsigned char *, unsigned long
 );
+extern cbool_t mf_track_buffer_append
+(
+   mf_track_buffer_t * tb, const unsigned char * data, unsigned long size
+);
+extern void mf_track_buffer_free (mf_track_buffer_t * tb);
 
 EXTERN_C_END
 
+/**
+ *    Appends one byte to a track buffer, the fast way when there is room.
+ *    Suitable as the body of an Mf_putc() callback.
+ *
+ * \param tb
+ *    Provides the track buffer.
+ *
+ * \param c
+ *    Provides the byte to append.
+ *
+ * \return
+ *    Returns the byte, or EOF if out of memory.
+ */
+
+static inline int
+mf_track_buffer_putc (mf_track_buffer_t * tb, unsigned char c)
+{
+   if (tb->size < tb->alloc)
+      tb->data[tb->size++] = c;
+   else if (! mf_track_buffer_append(tb, &c, 1))
+      return EOF;
+
+   return c;
+}
+
 /**
  *    Provides lower-case (!) macros for MIDI status commands.  The most
  *    significant bit is 1.
@@ -28,7 +28,7 @@
  * \library       libmidifilex
  * \author        Chris Ahlstrom and many other authors
  * \date          2014-04-09
- * \updates       2015-08-22
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  */
@@ -56,6 +56,21 @@ extern "C"
 
 extern int yylex (void);
 extern int yylex_destroy ();           /* new ca 2015-08-22, now exposed */
+extern long bankno (char * s, int n);
+
+/*
+ * The hand-written alternative to yylex(), in t2mf_scanner.c.
+ */
+
+extern cbool_t t2mf_scanner_open (FILE * fp);
+extern int t2mf_scanner_lex (void);
+extern long t2mf_scanner_tell (void);
+extern const char * t2mf_scanner_text (long offset);
+extern long t2mf_scanner_size (void);
+extern int t2mf_scanner_column (void);
+extern void t2mf_scanner_seek (long offset, int line);
+extern int t2mf_scanner_find_tracks (long * offsets, int * lines, int count);
+extern void t2mf_scanner_close (void);
 
 #ifdef __cplusplus
 }                    /* extern "C" */
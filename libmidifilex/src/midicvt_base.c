@@ -28,7 +28,7 @@
  * \library       midicvt application
  * \author        Chris Ahlstrom and many other authors
  * \date          2014-04-09
- * \updates       2023-12-05
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
@@ -200,15 +200,19 @@
 #include <ctype.h>                     /* isprint(), islower()                */
 #include <malloc.h>                    /* malloc() and realloc()              */
 #include <errno.h>                     /* strerror() and errno                */
+#include <fcntl.h>                     /* open() and O_WRONLY                 */
+#include <sys/wait.h>                  /* wait() and WEXITSTATUS()            */
 #include <unistd.h>                    /* UNIX/Linux only                     */
 #include <stdio.h>                     /* FILE *, etc.                        */
 #include <stdlib.h>                    /* exit()                              */
 #include <string.h>                    /* strerror()                          */
 
 #include <midicvt_base.h>              /* this module's functions and stuff   */
+#include <midicvt_cache.h>             /* midicvt_cache_load(), etc.          */
+#include <midicvt_cc.h>                /* midi_note_name()                    */
 #include <midicvt_globals.h>           /* midicvt_setup_compile()             */
 #include <midicvt_helpers.h>           /* midicvt_input_file(), output_file() */
-#include <t2mf.h>                      /* yylex() and yyval global            */
+#include <t2mf.h>                      /* yylex(), yyval, and the new scanner */
 
 
 /**
@@ -230,22 +234,105 @@
  * Internal functions.
  */
 
-static void checkchan (void);
-static void checkeol (void);
-static void checknote (void);
-static void checkval (void);
-static void checkcon (void);
-static void checkprog (void);
+static cbool_t checkchan (void);
 static void checkeol (void);
+static cbool_t checknote (void);
+static cbool_t checkval (void);
+static cbool_t checkcon (void);
+static cbool_t checkprog (void);
 static int fileputc (unsigned char c);
 static int filegetc (void);
 static int getbyte (char * mess);
 static int getint (char * mess);
-static void gethex (void);
-static void get16val (void);
-static void splitval (void);
-static int prs_error (char * s);
-static void syntax (void);
+static cbool_t gethex (void);
+static cbool_t get16val (void);
+static cbool_t splitval (void);
+static cbool_t prs_error (char * s);
+static void skip_line (void);
+static int trackputc (unsigned char c);
+static void write_tracks (void);
+static cbool_t syntax (void);
+
+/**
+ *    Points to the scanner used by the --compile option:  the hand-written
+ *    t2mf_scanner_lex() by default, or the flex-generated yylex() if the
+ *    --flex option is given.  Set by midicvt_compile().
+ */
+
+static int (* gs_lexer) (void) = yylex;
+
+/**
+ *    Flags for gs_track_flags.  These describe what happened while a
+ *    track was compiled by a worker process of compile_parallel(), and
+ *    are passed back to the parent as the exit status of the worker.
+ *
+ *    TRACK_ERROR means that an error was reported.  TRACK_USES_METER
+ *    means that the track used a measure:beat:tick time or a TimeSig,
+ *    both of which depend on the TimeSig events of the earlier tracks.
+ *    TRACK_SETS_METER means that the track has a TimeSig.
+ *    TRACK_BAD_END means that the track did not end where the pre-scan
+ *    found the start of the next track.
+ */
+
+#define TRACK_ERROR                 0x01
+#define TRACK_USES_METER            0x02
+#define TRACK_SETS_METER            0x04
+#define TRACK_BAD_END               0x08
+
+/**
+ *    Holds the TRACK_ flags for the track being compiled.
+ */
+
+static int gs_track_flags = 0;
+
+/**
+ *    Is true while midicvt_compile() is running, so that error() can name
+ *    the position of the error in the ASCII file.
+ */
+
+static cbool_t gs_compiling = false;
+
+/**
+ *    Counts the errors reported while compiling, for --validate and
+ *    --stats.
+ */
+
+static int gs_error_count = 0;
+
+/**
+ *    Counts the tracks that have been compiled, for --stats.
+ */
+
+static int gs_track_count = 0;
+
+/**
+ *    Counts the events compiled in the current track, for --stats.
+ */
+
+static long gs_track_events = 0;
+
+/**
+ *    Counts the events compiled in the whole file, for --stats.
+ */
+
+static long gs_event_count = 0;
+
+/**
+ *    Writes the position of the current token, yytext, to standard error,
+ *    as "file:line:column: ".  The flex scanner does not keep the start
+ *    of the line, so with --flex the column is left out.
+ */
+
+static void
+print_position (void)
+{
+   int ln = eol_seen ? lineno-1 : lineno;
+   fprintf(stderr, "%s:%d:", midicvt_input_file(), ln);
+   if (gs_lexer == t2mf_scanner_lex)
+      fprintf(stderr, "%d:", t2mf_scanner_column());
+
+   fputc(' ', stderr);
+}
 
 /**
  *    Writes an obvious error string to standard error.
@@ -256,11 +343,21 @@ static void syntax (void);
  *
  * \param s
  *    Provides the null-terminated error message to be written.
+ *
+ * \change ca 2026-10-18
+ *    While compiling, the error is counted, and its position is written
+ *    first.
  */
 
 void
 error (const char * s)
 {
+   gs_track_flags |= TRACK_ERROR;
+   if (gs_compiling)
+   {
+      ++gs_error_count;
+      print_position();
+   }
    fprintf(stderr, "Error: %s\n", s);
 }
 
@@ -448,9 +545,9 @@ prhex (unsigned char * p, int leng)
 }
 
 /**
- *    Writes a note value to standard output.
+ *    Provides the text of a note value for the standard output.
  *
- *    If the --verbose option was given, then the note is written as a
+ *    If the --note option was given, then the note is written as a
  *    letter value with the octave number following it.  Otherwise, the
  *    note is written as a integer MIDI note value.
  *
@@ -458,30 +555,38 @@ prhex (unsigned char * p, int leng)
  *    Not sure why this function isn't called "prnote()", so I renamed it
  *    from "mknote()".
  *
- * \threadunsafe
- *    Due to the static buffer buf[8] used inside this function.
+ * \change ca 2026-10-18
+ *    The strings now come from the constant tables in midicvt_cc.c,
+ *    instead of being formatted into a static buffer for every note.
+ *    This is faster, and the function is now thread-safe.
+ *
+ *    A corrupt file can hold a note byte of 128 or more, which has no
+ *    entry in those tables.  It is written as a number, as it always was,
+ *    so that the text still shows the value, and can still be compiled.
  *
  * \param pitch
  *    Provides the MIDI note value to be written.
  *
  * \return
- *    Returns a pointer to the beginning of the static buffer buf[].
+ *    Returns a pointer to the constant note string, or to a per-thread
+ *    buffer holding the number.
  */
 
-static char *
+static const char *
 prnote (int pitch)
 {
-   static char * s_notes [] =
+   static MIDICVT_THREAD_LOCAL char s_number [16];
+   int length;
+   const char * result = midi_note_name
+   (
+      pitch, midicvt_option_verbose_notes(), &length
+   );
+   if (length == 0)
    {
-        "c", "c#", "d", "d#", "e", "f", "f#", "g", "g#", "a", "a#", "b"
-   };
-   static char buf[16];
-   if (midicvt_option_verbose_notes())
-      (void) snprintf(buf, sizeof(buf), "%s%d", s_notes[pitch % 12], pitch / 12);
-   else
-      (void) snprintf(buf, sizeof(buf), "%d", pitch);
-
-   return buf;
+      (void) snprintf(s_number, sizeof(s_number), "%d", pitch);
+      result = s_number;
+   }
+   return result;
 }
 
 /**
@@ -1304,6 +1409,50 @@ my_error (const char * s)
    return true;
 }
 
+/**
+ *    Writes a line about the track just compiled to standard error, if
+ *    the --stats option was given.
+ *
+ * \param line
+ *    Provides the line number of the "MTrk" that started the track.
+ *
+ * \param errors
+ *    Provides the number of errors in the track.
+ */
+
+static void
+report_track (int line, int errors)
+{
+   if (midicvt_option_stats())
+   {
+      fprintf
+      (
+         stderr, "%s:%d: MTrk %d, %ld events, %d lines, %d errors\n",
+         midicvt_input_file(), line, gs_track_count, gs_track_events,
+         lineno - line, errors
+      );
+   }
+}
+
+/**
+ *    Writes the totals for the whole ASCII file to standard error, if the
+ *    --stats option was given.
+ */
+
+static void
+report_totals (void)
+{
+   if (midicvt_option_stats())
+   {
+      fprintf
+      (
+         stderr, "%s: %d tracks, %ld events, %d lines, %d errors\n",
+         midicvt_input_file(), gs_track_count, gs_event_count, lineno - 1,
+         gs_error_count
+      );
+   }
+}
+
 /**
  *    Callback function implementing Mf_wtrack() and Mf_wtempotrack().
  *
@@ -1321,6 +1470,11 @@ my_error (const char * s)
  *    "MTrk" is found).  A bunch of other markers ("TrkEnd", "SysEx",
  *    "Meta", "Arb", and more (see t2mf.fl), are found and processed.
  *
+ *    When a line has an error, prs_error() reports it and skips the rest
+ *    of the line, and the helper functions return false, so that the loop
+ *    simply goes on to the next line.  If the end of the file is reached,
+ *    the application exits.
+ *
  *    For writing MIDI, the following functions from the midifilex.c
  *    module are called:
  *
@@ -1333,6 +1487,11 @@ my_error (const char * s)
  *
  * \return
  *    Returns -1 upon an error, otherwise returns true (1).
+ *
+ * \change ca 2026-10-18
+ *    No longer calls setjmp() for every line of the input.  Errors are
+ *    now passed back as return values, and the loop continues with the
+ *    next line.  Counts the events for --stats.
  */
 
 static int
@@ -1342,50 +1501,59 @@ my_writetrack (void)
    long currtime = 0;
    long newtime, delta;
    int i, k;
-   while ((opcode = yylex()) == EOL)
+   int line;
+   int errors = gs_error_count;
+   while ((opcode = gs_lexer()) == EOL)
       ;
 
+   line = lineno;
    if (opcode != MTRK)
       prs_error("Missing MTrk");
 
+   ++gs_track_count;
+   gs_track_events = 0;
    checkeol();
    for (;;)
    {
-      g_status_err_cont = 1;
-      setjmp(g_status_erjump);
-      switch (yylex())
+      switch (gs_lexer())
       {
       case MTRK:
 
          prs_error("Unexpected MTrk");
-         return -1;                    /* new ca 2014-04-11 */
+         continue;                     /* the line has been skipped        */
 
        case EOF:
 
-         g_status_err_cont = 0;
          error("Unexpected EOF");
+         report_track(line, gs_error_count - errors);
          return -1;
 
        case TRKEND:
 
-         g_status_err_cont = 0;
          checkeol();
+         report_track(line, gs_error_count - errors);
          return true;
 
        case INT:
 
          newtime = yyval;
-         if ((opcode = yylex()) == '/')
+         if ((opcode = gs_lexer()) == '/')
          {
-            if (yylex() != INT)
+            gs_track_flags |= TRACK_USES_METER;
+            if (gs_lexer() != INT)
+            {
                prs_error("Illegal time value");
-
+               continue;
+            }
             newtime = (newtime-g_status_M0) * g_status_measure + yyval;
-            if (yylex() != '/' || yylex() != INT)
+            if (gs_lexer() != '/' || gs_lexer() != INT)
+            {
                prs_error("Illegal time value");
+               continue;
+            }
 
             newtime = g_status_T0 + newtime * g_status_beat + yyval;
-            opcode = yylex();
+            opcode = gs_lexer();
          }
          delta = newtime - currtime;
          switch (opcode)
@@ -1394,38 +1562,41 @@ my_writetrack (void)
          case OFF:
          case POPR:
 
-            checkchan();
-            checknote();
-            checkval();
+            if (! checkchan() || ! checknote() || ! checkval())
+               continue;
+
             mf_w_midi_event(delta, opcode, gs_chan, gs_data, 2UL);
             break;
 
          case PAR:
 
-            checkchan();
-            checkcon();
-            checkval();
+            if (! checkchan() || ! checkcon() || ! checkval())
+               continue;
+
             mf_w_midi_event(delta, opcode, gs_chan, gs_data, 2UL);
             break;
 
          case PB:
 
-            checkchan();
-            splitval();
+            if (! checkchan() || ! splitval())
+               continue;
+
             mf_w_midi_event(delta, opcode, gs_chan, gs_data, 2UL);
             break;
 
          case PRCH:
 
-            checkchan();
-            checkprog();
+            if (! checkchan() || ! checkprog())
+               continue;
+
             mf_w_midi_event(delta, opcode, gs_chan, gs_data, 1UL);
             break;
 
          case CHPR:
 
-            checkchan();
-            checkval();
+            if (! checkchan() || ! checkval())
+               continue;
+
             gs_data[0] = gs_data[1];
             mf_w_midi_event(delta, opcode, gs_chan, gs_data, 1UL);
             break;
@@ -1433,24 +1604,31 @@ my_writetrack (void)
          case SYSEX:
          case ARB:
 
-            gethex();
+            if (! gethex())
+               continue;
+
             mf_w_sysex_event(delta, g_status_buffer, (long) g_status_buflen);
             break;
 
          case TEMPO:
 
-            if (yylex() != INT)
+            if (gs_lexer() != INT)
+            {
                syntax();
-
+               continue;
+            }
             mf_w_tempo(delta, yyval);
             break;
 
          case TIMESIG:
          {
             int nn, denom, cc, bb;
-            if (yylex() != INT || yylex() != '/')
+            gs_track_flags |= TRACK_USES_METER | TRACK_SETS_METER;
+            if (gs_lexer() != INT || gs_lexer() != '/')
+            {
                syntax();
-
+               continue;
+            }
             nn = yyval;
             denom = getbyte("Denom");
             cc = getbyte("clocks per click");
@@ -1489,8 +1667,11 @@ my_writetrack (void)
             if (i < -7 || i > 7)
                 error("Key Sig must be between -7 and 7");
 
-            if ((c = yylex()) != MINOR && c != MAJOR)
-                syntax();
+            if ((c = gs_lexer()) != MINOR && c != MAJOR)
+            {
+               syntax();
+               continue;
+            }
 
             gs_data[1] = (c == MINOR);
             mf_w_meta_event(delta, key_signature, gs_data, 2UL);
@@ -1504,13 +1685,15 @@ my_writetrack (void)
              * this version nor midi2text's uses it!
              */
 
-            get16val();                /* get16val("SeqNr"); */
+            if (! get16val())          /* get16val("SeqNr"); */
+               continue;
+
             mf_w_meta_event(delta, sequence_number, gs_data, 2UL);
             break;
 
          case META:
          {
-            int type = yylex();
+            int type = gs_lexer();
             switch (type)
             {
             case TRKEND:
@@ -1537,12 +1720,12 @@ my_writetrack (void)
             default:
 
                prs_error("Illegal Meta type");
-               break;
+               continue;
             }
             if (type == end_of_track)
                g_status_buflen = 0;
-            else
-               gethex();
+            else if (! gethex())
+               continue;
 
             mf_w_meta_event(delta, type, g_status_buffer, (long) g_status_buflen);
             break;
@@ -1554,7 +1737,9 @@ my_writetrack (void)
              *    sequencer_specific is a macro from libmidifilex.
              */
 
-            gethex();
+            if (! gethex())
+               continue;
+
             mf_w_meta_event
             (
                delta, sequencer_specific,  g_status_buffer,
@@ -1565,9 +1750,11 @@ my_writetrack (void)
          default:
 
             prs_error("Unknown input");
-             break;
+            continue;
           }
           currtime = newtime;
+          ++gs_track_events;
+          ++gs_event_count;
 
       case EOL:
 
@@ -1576,7 +1763,7 @@ my_writetrack (void)
        default:
 
           prs_error("Unknown input");
-          break;
+          continue;
       }
       checkeol();
    }
@@ -1646,50 +1833,640 @@ midicvt_initfuncs_mf2t (void)
 /**
  *    Outputs error messages to standard error.
  *
- *    This function also skips thto the end of the line of the input.  If
- *    the end-of-file is encountered, then exit(1) is called.  If there is
- *    an error status, then a longjmp() to g_status_erjump is called.
+ *    This function also skips to the end of the line of the input, by
+ *    calling skip_line(), so that the caller can simply go on to the next
+ *    line.
  *
  * \param s
  *    Provides the error string.  Note that yyleng and yytext are global
  *    inputs to this function, as well.
  *
  * \return
- *    Returns true, always.
+ *    Returns false, always, so that the helper functions can return the
+ *    result of this function as their error status.
+ *
+ * \change ca 2026-10-18
+ *    No longer does a longjmp() back to my_writetrack().  Now writes the
+ *    file name and column, as well as the line number, and counts the
+ *    error.
  */
 
-static int
+static cbool_t
 prs_error (char * s)
 {
-   int c;
-   int count;
-   int ln = eol_seen ? lineno-1 : lineno;
-   fprintf(stderr, "%d: %s\n", ln, s);
+   gs_track_flags |= TRACK_ERROR;
+   ++gs_error_count;
+   print_position();
+   fprintf(stderr, "%s\n", s);
    if (yyleng > 0 && *yytext != '\n')
-      fprintf(stderr, "*** %*s ***\n", (int) yyleng, yytext);
+      fprintf(stderr, "*** %.*s ***\n", (int) yyleng, yytext);
+
+   skip_line();
+   return false;
+}
+
+/**
+ *    Resynchronizes the parser with the input after an error, by skipping
+ *    the rest of the current line.  At most 100 tokens are skipped.  If
+ *    the end-of-file is encountered, then exit(1) is called.
+ */
 
-   count = 0;
-   while (count < 100 && (c = yylex()) != EOL && c != EOF)
+static void
+skip_line (void)
+{
+   int c;
+   int count = 0;
+   while (count < 100 && (c = gs_lexer()) != EOL && c != EOF)
    {
       count++;                         /* skip rest of line */
    }
    if (c == EOF)
+   {
+      if (Mf_putc == trackputc)         /* compile_cached() is in progress  */
+         write_tracks();
+
+      report_totals();
       exit(1);
+   }
+}
 
-   if (g_status_err_cont)
-      longjmp(g_status_erjump, 1);
+/**
+ *    Calls psr_error() with a message of "Syntax error".
+ *
+ * \return
+ *    Returns false, always.
+ */
 
-   return true;
+static cbool_t
+syntax (void)
+{
+   return prs_error("Syntax error");
 }
 
 /**
- *    Calls psr_error() with a message of "Syntax error".
+ *    Provides the size of the MThd chunk, which every worker of
+ *    compile_parallel() writes ahead of its track, and which the parent
+ *    skips when it assembles the tracks.
+ */
+
+#define MTHD_CHUNK_SIZE             14
+
+/**
+ *    Compiles one track, in a worker process forked by compile_parallel(),
+ *    and exits.  The worker writes a copy of the MThd chunk, followed by
+ *    the track, to its own temporary file, so that mf_w_track_chunk() can
+ *    seek back and fill in the track length exactly as it does in a serial
+ *    compile.  The standard error output is discarded; if there are errors,
+ *    the parent compiles the file again serially, and reports them then.
+ *
+ * \param track
+ *    Provides the index of the track, starting at 0.
+ *
+ * \param offsets
+ *    Provides the offsets of the "MTrk" tokens found by the pre-scan.
+ *
+ * \param lines
+ *    Provides the line numbers of the "MTrk" tokens.
+ *
+ * \param ntracks
+ *    Provides the number of tracks.
+ *
+ * \param part
+ *    Provides the temporary file to which the track is written.
  */
 
 static void
-syntax (void)
+compile_track_job
+(
+   int track,
+   const long * offsets,
+   const int * lines,
+   int ntracks,
+   FILE * part
+)
+{
+   int c;
+   int which = track;
+   int devnull = open("/dev/null", O_WRONLY);
+   if (devnull >= 0)
+      (void) dup2(devnull, STDERR_FILENO);
+
+   if (g_status_format == 1 && not_nullptr(Mf_wtempotrack))
+      --which;                         /* the tempo track is -1 in mfwrite()  */
+
+   g_io_file = part;                   /* fileputc() writes here              */
+   gs_track_flags = 0;
+   t2mf_scanner_seek(offsets[track], lines[track]);
+   mf_w_header_chunk(g_status_format, g_status_no_of_tracks, g_status_clicks);
+   mf_w_track_chunk(which, part, my_writetrack);
+   if (track + 1 < ntracks)
+   {
+      long offset;
+      while ((c = gs_lexer()) == EOL)
+         ;
+
+      offset = t2mf_scanner_tell() - (long) yyleng;
+      if (c != MTRK || offset != offsets[track+1])
+         gs_track_flags |= TRACK_BAD_END;
+   }
+   if (fflush(part) != 0)
+      gs_track_flags |= TRACK_ERROR;
+
+   _exit(gs_track_flags);
+}
+
+/**
+ *    Reads the track written by a worker of compile_parallel() into memory,
+ *    skipping the MThd chunk ahead of it, and closes the temporary file, so
+ *    that no more files are open than there are workers running.
+ *
+ * \param part
+ *    Provides the temporary file written by the worker.
+ *
+ * \param size
+ *    Returns the number of bytes read.
+ *
+ * \return
+ *    Returns the bytes, which the caller must free(), or a null pointer if
+ *    the file could not be read.
+ */
+
+static unsigned char *
+read_track_part (FILE * part, long * size)
+{
+   unsigned char * data = nullptr;
+   long end;
+   *size = 0;
+   if (fseek(part, 0, SEEK_END) == 0)
+      end = ftell(part);
+   else
+      end = -1;
+
+   if (end >= MTHD_CHUNK_SIZE)
+   {
+      *size = end - MTHD_CHUNK_SIZE;
+      data = malloc(*size > 0 ? *size : 1);
+      if
+      (
+         not_nullptr(data) &&
+         (
+            fseek(part, MTHD_CHUNK_SIZE, SEEK_SET) != 0 ||
+            fread(data, 1, *size, part) != (size_t) *size
+         )
+      )
+      {
+         free(data);
+         data = nullptr;
+      }
+   }
+   fclose(part);
+   return data;
+}
+
+/**
+ *    Compiles the tracks of the ASCII file at the same time, in up to
+ *    midicvt_option_jobs() worker processes, and then writes the MThd
+ *    chunk and the tracks, in order, to the output file.
+ *
+ *    The tracks are found by a pre-scan of the input for "MTrk" lines.
+ *    Worker processes are used, rather than threads, because the compiler
+ *    keeps its state in global variables, which a fork() simply gives
+ *    every worker its own copy of.  Each worker starts with the state
+ *    left by the MFile line.  The only state that a serial compile carries
+ *    from one track to the next is the meter set by TimeSig, so the
+ *    result is used only if no track that depends on the meter follows a
+ *    track that sets it.
+ *
+ *    Each worker writes to its own temporary file, which the parent reads
+ *    into memory, and closes, as soon as the worker is done.  So at most
+ *    --jobs temporary files are open at a time, however many tracks the
+ *    file has.
+ *
+ *    If the result cannot be used, for that reason, or because of an
+ *    error in any track, nothing is written, and the scanner is moved back
+ *    to where it was, so that the caller can compile the file serially.
+ *    If writing the result fails, the error is reported, and exit(1) is
+ *    called, just as mfwrite() does.
+ *
+ * \return
+ *    Returns true if the tracks were compiled and written.  Returns false
+ *    at once if --jobs was not given, or if there is only one track.
+ */
+
+static cbool_t
+compile_parallel (void)
+{
+   cbool_t result = false;
+   int ntracks = g_status_no_of_tracks;
+   int jobs = midicvt_option_jobs();
+   long start;
+   int startline;
+   long * offsets;
+   int * lines;
+   int * flags;
+   pid_t * pids;
+   FILE ** parts;
+   unsigned char ** datas;
+   long * sizes;
+   int c;
+   if (jobs <= 1 || ntracks <= 1)
+      return false;
+
+   start = t2mf_scanner_tell();
+   startline = lineno;
+   offsets = malloc(ntracks * sizeof(long));
+   lines = malloc(ntracks * sizeof(int));
+   flags = malloc(ntracks * sizeof(int));
+   pids = malloc(ntracks * sizeof(pid_t));
+   parts = calloc(ntracks, sizeof(FILE *));
+   datas = calloc(ntracks, sizeof(unsigned char *));
+   sizes = calloc(ntracks, sizeof(long));
+   if
+   (
+      not_nullptr(offsets) && not_nullptr(lines) && not_nullptr(flags) &&
+      not_nullptr(pids) && not_nullptr(parts) && not_nullptr(datas) &&
+      not_nullptr(sizes) &&
+      t2mf_scanner_find_tracks(offsets, lines, ntracks) == ntracks
+   )
+   {
+      while ((c = gs_lexer()) == EOL)  /* the first MTrk must come next     */
+         ;
+
+      result = c == MTRK && t2mf_scanner_tell() - (long) yyleng == offsets[0];
+   }
+   if (result)
+   {
+      int next = 0;
+      int running = 0;
+      fflush(stdout);                  /* do not let the workers repeat it    */
+      fflush(stderr);
+      fflush(g_io_file);
+      while (next < ntracks || running > 0)
+      {
+         int status;
+         pid_t pid;
+         while (result && running < jobs && next < ntracks)
+         {
+            parts[next] = tmpfile();
+            pid = is_nullptr(parts[next]) ? -1 : fork();
+            if (pid == 0)
+               compile_track_job(next, offsets, lines, ntracks, parts[next]);
+
+            if (pid < 0)
+               result = false;
+            else
+            {
+               pids[next++] = pid;
+               ++running;
+            }
+         }
+         if (running == 0)
+            break;
+
+         pid = wait(&status);
+         if (pid < 0)
+            break;
+
+         for (c = 0; c < next; ++c)
+         {
+            if (pids[c] == pid)
+            {
+               flags[c] = WIFEXITED(status) ?
+                  WEXITSTATUS(status) : TRACK_ERROR ;
+
+               datas[c] = read_track_part(parts[c], &sizes[c]);
+               parts[c] = nullptr;
+               if (is_nullptr(datas[c]))
+                  flags[c] |= TRACK_ERROR;
+
+               break;
+            }
+         }
+         --running;
+      }
+      if (result)
+      {
+         cbool_t meter_set = false;
+         for (c = 0; c < ntracks; ++c)
+         {
+            if ((flags[c] & (TRACK_ERROR | TRACK_BAD_END)) != 0)
+               result = false;
+            else if (meter_set && (flags[c] & TRACK_USES_METER) != 0)
+               result = false;
+
+            if ((flags[c] & TRACK_SETS_METER) != 0)
+               meter_set = true;
+         }
+      }
+      if (result)
+      {
+         mf_w_header_chunk(g_status_format, ntracks, g_status_clicks);
+         for (c = 0; c < ntracks; ++c)
+         {
+            size_t count = (size_t) sizes[c];
+            if (fwrite(datas[c], 1, count, g_io_file) != count)
+            {
+               error("Could not write the compiled tracks");
+               report_totals();
+               exit(1);                /* as mfwrite() does on a bad write */
+            }
+         }
+      }
+   }
+   if (not_nullptr(parts))
+   {
+      int i;
+      for (i = 0; i < ntracks; ++i)
+      {
+         if (not_nullptr(parts[i]))
+            fclose(parts[i]);
+      }
+   }
+   if (not_nullptr(datas))
+   {
+      int i;
+      for (i = 0; i < ntracks; ++i)
+         free(datas[i]);
+   }
+   free(sizes);
+   free(datas);
+   free(parts);
+   free(pids);
+   free(flags);
+   free(lines);
+   free(offsets);
+   if (! result)
+      t2mf_scanner_seek(start, startline);
+
+   return result;
+}
+
+/**
+ *    Holds the track chunks built in memory by compile_cached(), in order.
+ */
+
+static mf_track_buffer_t gs_tracks;
+
+/**
+ *    Appends bytes to gs_tracks.  Running out of memory is fatal.
+ *
+ * \param data
+ *    Provides the bytes to append.  If null, the bytes are set to 0.
+ *
+ * \param size
+ *    Provides the number of bytes.
+ */
+
+static void
+track_append (const unsigned char * data, unsigned long size)
 {
-   prs_error("Syntax error");
+   if (! mf_track_buffer_append(&gs_tracks, data, size))
+   {
+      error("Out of memory");
+      exit(1);
+   }
+}
+
+/**
+ *    Callback function implementing Mf_putc() for compile_cached().
+ *    Appends the byte to gs_tracks, so that tracks can be built in
+ *    memory, and then written even to a pipe.
+ *
+ * \param c
+ *    Provides the byte to append.
+ *
+ * \return
+ *    Returns the byte.
+ */
+
+static int
+trackputc (unsigned char c)
+{
+   if (mf_track_buffer_putc(&gs_tracks, c) == EOF)
+      track_append(&c, 1);             /* reports the error, and exits     */
+
+   return c;
+}
+
+/**
+ *    Writes the MThd chunk, and then the track chunks built in memory by
+ *    compile_cached(), to the output file.  If the compile stops at an
+ *    error, skip_line() calls this function before exiting, so that the
+ *    output is the same as that of mfwrite(), which writes as it goes.  A
+ *    failed write is reported, and exit(1) is called, as in mfwrite().
+ */
+
+static void
+write_tracks (void)
+{
+   Mf_putc = fileputc;
+   mf_w_header_chunk(g_status_format, g_status_no_of_tracks, g_status_clicks);
+   if (fwrite(gs_tracks.data, 1, gs_tracks.size, g_io_file) != gs_tracks.size)
+   {
+      error("Could not write the compiled tracks");
+      report_totals();
+      exit(1);                         /* as mfwrite() does on a bad write */
+   }
+
+   gs_tracks.size = 0;
+}
+
+/**
+ *    Compiles the tracks of the ASCII file one by one, taking from the
+ *    --cache directory every track whose text, and the compiler state at
+ *    its start, has not changed since it was compiled.  The other tracks
+ *    are compiled in memory, with mf_w_track_data(), and stored in the
+ *    cache.  Then the MThd chunk and the tracks are written.
+ *
+ *    A cached track is used only if the previous track is known to end
+ *    where the pre-scan found its "MTrk".  So a track is stored only when
+ *    the next token after it is that "MTrk", or the end of the input for
+ *    the last track (peeking at it does not move the scanner), and only if
+ *    it had no errors.  The number of lines it spans is stored with it,
+ *    since the last track of a file can be found again, unchanged, ahead
+ *    of tracks added later.  If a track does not end
+ *    where expected, the rest of the file is compiled without the cache,
+ *    exactly as mfwrite() would.  The state stored with each track is the
+ *    meter set by TimeSig events, which is all that a serial compile
+ *    carries from one track to the next.
+ *
+ * \return
+ *    Returns true if the tracks were compiled and written.  Returns false
+ *    at once if --cache was not given, or if the pre-scan does not find
+ *    the expected tracks, so that the caller can simply call mfwrite().
+ */
+
+static cbool_t
+compile_cached (void)
+{
+   cbool_t result = false;
+   cbool_t use_cache = true;
+   int ntracks = g_status_no_of_tracks;
+   long start;
+   int startline;
+   long * offsets;
+   int * lines;
+   int line = 0;                       /* lineno at the MTrk of each track */
+   int c, k;
+   if (is_nullptr(midicvt_option_cache()) || ntracks < 1)
+      return false;
+
+   start = t2mf_scanner_tell();
+   startline = lineno;
+   offsets = malloc(ntracks * sizeof(long));
+   lines = malloc(ntracks * sizeof(int));
+   if
+   (
+      not_nullptr(offsets) && not_nullptr(lines) &&
+      t2mf_scanner_find_tracks(offsets, lines, ntracks) == ntracks
+   )
+   {
+      while ((c = gs_lexer()) == EOL)  /* the first MTrk must come next     */
+         ;
+
+      result = c == MTRK && t2mf_scanner_tell() - (long) yyleng == offsets[0];
+      line = lineno;
+   }
+   t2mf_scanner_seek(start, startline);
+   if (result)
+   {
+      gs_tracks.size = 0;
+      Mf_putc = trackputc;
+      for (k = 0; k < ntracks; ++k)
+      {
+         long end = k + 1 < ntracks ? offsets[k+1] : t2mf_scanner_size();
+         const char * text = t2mf_scanner_text(offsets[k]);
+         unsigned long textsize = (unsigned long) (end - offsets[k]);
+         long state[MIDICVT_CACHE_STATE_COUNT];
+         long context[MIDICVT_CACHE_STATE_COUNT + 1];
+         char key[MIDICVT_CACHE_KEY_SIZE];
+         int count = 0;
+         cbool_t hit = false;
+         state[0] = g_status_M0;
+         state[1] = g_status_T0;
+         state[2] = g_status_measure;
+         state[3] = g_status_beat;
+         memcpy(context, state, sizeof state);
+         context[MIDICVT_CACHE_STATE_COUNT] = g_status_clicks;
+         if (use_cache)
+         {
+            unsigned char * data;
+            unsigned long size;
+            midicvt_cache_key
+            (
+               text, textsize, context, MIDICVT_CACHE_STATE_COUNT + 1, key
+            );
+            hit = midicvt_cache_load
+            (
+               key, text, textsize, context, MIDICVT_CACHE_STATE_COUNT + 1,
+               state, &count, &data, &size
+            );
+            if (hit)
+            {
+               track_append(data, size);
+               free(data);
+               g_status_M0 = (int) state[0];
+               g_status_T0 = state[1];
+               g_status_measure = (int) state[2];
+               g_status_beat = (int) state[3];
+               line += count;
+               if (k + 1 < ntracks)
+                  t2mf_scanner_seek(offsets[k+1], line);
+            }
+         }
+         if (! hit)
+         {
+            unsigned long mark = gs_tracks.size;
+            unsigned long length;
+            int which = k;
+            if (g_status_format == 1 && not_nullptr(Mf_wtempotrack))
+               --which;                /* the tempo track is -1 in mfwrite()  */
+
+            track_append((const unsigned char *) "MTrk", 4);
+            track_append(nullptr, 4);  /* the length, filled in below      */
+            gs_track_flags = 0;
+            length = mf_w_track_data(which, my_writetrack);
+            gs_tracks.data[mark+4] = (unsigned char) ((length >> 24) & 0xff);
+            gs_tracks.data[mark+5] = (unsigned char) ((length >> 16) & 0xff);
+            gs_tracks.data[mark+6] = (unsigned char) ((length >> 8) & 0xff);
+            gs_tracks.data[mark+7] = (unsigned char) (length & 0xff);
+            if (use_cache)
+            {
+               long here = t2mf_scanner_tell();
+               int hereline = lineno;
+               while ((c = gs_lexer()) == EOL)
+                  ;
+
+               if (k + 1 < ntracks)
+               {
+                  if (c != MTRK || t2mf_scanner_tell() - (long) yyleng != end)
+                     use_cache = false;
+               }
+               else if (c != EOF)
+                  use_cache = false;
+
+               count = lineno - line;  /* at the next MTrk, or at the end  */
+               line = lineno;
+               t2mf_scanner_seek(here, hereline);
+            }
+            if (use_cache && (gs_track_flags & TRACK_ERROR) == 0)
+            {
+               state[0] = g_status_M0;
+               state[1] = g_status_T0;
+               state[2] = g_status_measure;
+               state[3] = g_status_beat;
+               (void) midicvt_cache_store
+               (
+                  key, text, textsize, context,
+                  MIDICVT_CACHE_STATE_COUNT + 1, state, count,
+                  &gs_tracks.data[mark], gs_tracks.size - mark
+               );
+            }
+         }
+      }
+      write_tracks();
+   }
+   free(lines);
+   free(offsets);
+   return result;
+}
+
+/**
+ *    Callback function implementing Mf_putc() for validate_tracks().
+ *    Discards the byte.
+ *
+ * \param c
+ *    Provides the byte.
+ *
+ * \return
+ *    Returns the byte.
+ */
+
+static int
+nullputc (unsigned char c)
+{
+   return c;
+}
+
+/**
+ *    Compiles the tracks of the ASCII file for the --validate option,
+ *    exactly as mfwrite() would, but with every byte thrown away, so that
+ *    no output file is needed.
+ */
+
+static void
+validate_tracks (void)
+{
+   int k;
+   Mf_putc = nullputc;
+   for (k = 0; k < g_status_no_of_tracks; ++k)
+   {
+      int which = k;
+      if (g_status_format == 1 && not_nullptr(Mf_wtempotrack))
+         --which;                      /* the tempo track is -1 in mfwrite()  */
+
+      (void) mf_w_track_data(which, my_writetrack);
+   }
 }
 
 /**
@@ -1700,12 +2477,36 @@ syntax (void)
  * \note
  *    This function used to be called translate(), which was a bit
  *    ambiguous.
+ *
+ * \change ca 2026-10-18
+ *    The input is now scanned by t2mf_scanner_lex(), which works directly
+ *    on the whole file in memory, unless the --flex option is given.
+ *    With that scanner, the --jobs option compiles the tracks at the same
+ *    time, using compile_parallel(), and the --cache option compiles only
+ *    the tracks that have changed, using compile_cached().  The --validate
+ *    option compiles the file without writing it, using validate_tracks(),
+ *    and the --stats option writes a report to stderr.  Errors now name
+ *    the file, line, and column.  Both --validate and --stats compile the
+ *    tracks serially.
+ *
+ * \return
+ *    Returns true if no errors were found.
  */
 
-void
+cbool_t
 midicvt_compile (void)
 {
-   if (yylex() == MTHD)    /* true if "MFile" or (new) "MThd" is found */
+   if (midicvt_option_flex())
+      gs_lexer = yylex;
+   else if (t2mf_scanner_open(yyin))
+      gs_lexer = t2mf_scanner_lex;
+   else
+   {
+      fprintf(stderr, "Cannot read the ASCII file, can't continue\n");
+      exit(1);
+   }
+   gs_compiling = true;
+   if (gs_lexer() == MTHD)    /* true if "MFile" or (new) "MThd" is found */
    {
       /*
        * Do not change "MFile" to "MThd" here unless you're willing to
@@ -1720,13 +2521,30 @@ midicvt_compile (void)
             getint("MFile SMPTE division");
 
       checkeol();
-      mfwrite(g_status_format, g_status_no_of_tracks, g_status_clicks, g_io_file);
+      if (midicvt_option_validate())
+         validate_tracks();
+      else if
+      (
+         gs_lexer != t2mf_scanner_lex || midicvt_option_stats() ||
+         ! (compile_cached() || compile_parallel())
+      )
+      {
+         mfwrite
+         (
+            g_status_format, g_status_no_of_tracks, g_status_clicks, g_io_file
+         );
+      }
+
+      report_totals();
+      t2mf_scanner_close();
+      gs_compiling = false;
    }
    else
    {
       fprintf(stderr, "Missing MFile/MTrk token in ASCII file, can't continue\n");
       exit(1);
    }
+   return gs_error_count == 0;
 }
 
 /**
@@ -1776,7 +2594,7 @@ getbyte (char * mess)
 static int
 getint (char * mess)
 {
-   if (yylex() != INT)
+   if (gs_lexer() != INT)
    {
       char ermesg[128];
       (void) snprintf(ermesg, sizeof(ermesg), "Integer expected for %s", mess);
@@ -1792,106 +2610,146 @@ getint (char * mess)
  *
  * \sideeffect
  *    The global variable gs_chan is set to yyval - 1.
+ *
+ * \return
+ *    Returns false if there was a syntax error, in which case the rest of
+ *    the line has been skipped.  The other helper functions below return
+ *    their status in the same way.
  */
 
-static void
+static cbool_t
 checkchan (void)
 {
-   if (yylex() != CH || yylex() != INT)
-      syntax();                        /* calls prs_error("Syntax error")  */
+   if (gs_lexer() != CH || gs_lexer() != INT)
+      return syntax();                 /* calls prs_error("Syntax error")  */
 
    if (yyval < 1 || yyval > 16)
       error("Chan must be between 1 and 16");
 
    gs_chan = yyval - 1;
+   return true;
+}
+
+/**
+ *    Provides the semitone of each note letter, from 'a' to 'g', within
+ *    its octave, for note_value().
+ */
+
+static const int gs_note_semitones [7] =
+{
+   9,    /* a */
+   11,   /* b */
+   0,    /* c */
+   2,    /* d */
+   4,    /* e */
+   5,    /* f */
+   7     /* g */
+};
+
+/**
+ *    Converts a note name matched by the NOTEVAL pattern of the scanner,
+ *    "[a-g][#b+-]?[0-9]+" (in any case), to a MIDI note number, in one
+ *    pass over the token.  Octave 0 starts at note 0, so "c5" is 60.
+ *
+ * \param p
+ *    Provides the token, which need not be null-terminated.
+ *
+ * \param length
+ *    Provides the length of the token.
+ *
+ * \return
+ *    Returns the note number, which can be out of range, such as -1 for
+ *    "cb0".  The caller checks it.
+ */
+
+static long
+note_value (const char * p, int length)
+{
+   const char * pend = p + length;
+   long value = gs_note_semitones[(*p++ | 0x20) - 'a'];
+   long octave = 0;
+   switch (*p)
+   {
+   case '#':
+   case '+':
+
+      ++value;
+      ++p;
+      break;
+
+   case 'b':
+   case 'B':
+   case '-':
+
+      --value;
+      ++p;
+      break;
+   }
+   while (p < pend && *p >= '0' && *p <= '9')
+      octave = octave * 10 + (*p++ - '0');
+
+   return value + 12 * octave;
 }
 
 /**
  *    Checks the incoming value from flex.
  *
+ * \change ca 2026-10-18
+ *    Note names are now converted by note_value(), which uses yyleng,
+ *    instead of tolower() and atoi(), which need a null-terminated
+ *    yytext.
  */
 
-static void
+static cbool_t
 checknote (void)
 {
    int c;
-   if (yylex() != NOTE || ((c = yylex()) != INT && c != NOTEVAL))
-      syntax();
+   if (gs_lexer() != NOTE || ((c = gs_lexer()) != INT && c != NOTEVAL))
+      return syntax();
 
    if (c == NOTEVAL)
-   {
-      static int notes [] =
-      {
-         9,    /* a */
-         11,   /* b */
-         0,    /* c */
-         2,    /* d */
-         4,    /* e */
-         5,    /* f */
-         7     /* g */
-      };
-      char * p = yytext;               /* g_t2mf_yytext; */
-      c = *p++;
-      if (isupper(c))
-         c = tolower(c);
-
-      yyval = notes[c-'a'];
-      switch(*p)
-      {
-      case '#':
-      case '+':
+      yyval = note_value(yytext, (int) yyleng);
 
-         yyval++;
-         p++;
-         break;
-
-      case 'b':
-      case 'B':
-      case '-':
-
-         yyval--;
-         p++;
-         break;
-      }
-      yyval += 12 * atoi(p);
-   }
    if (yyval > 127)                    /* yyval is now unsigned */
       error("Note must be between 0 and 127");
 
    gs_data[0] = yyval;
+   return true;
 }
 
 /**
  *
  */
 
-static void
+static cbool_t
 checkval (void)
 {
-  if (yylex() != VAL || yylex() != INT)
-     syntax();
+   if (gs_lexer() != VAL || gs_lexer() != INT)
+      return syntax();
 
-  if (yyval > 127)                     /* yyval is now unsigned */
-     error("Value must be between 0 and 127");
+   if (yyval > 127)                    /* yyval is now unsigned */
+      error("Value must be between 0 and 127");
 
-  gs_data[1] = yyval;
+   gs_data[1] = yyval;
+   return true;
 }
 
 /**
  *
  */
 
-static void
+static cbool_t
 splitval (void)
 {
-   if (yylex() != VAL || yylex() != INT)
-      syntax();
+   if (gs_lexer() != VAL || gs_lexer() != INT)
+      return syntax();
 
    if (yyval > 16383)                  /* yyval is now unsigned */
       error("Value must be between 0 and 16383");
 
    gs_data[0] = yyval % 128;
    gs_data[1] = yyval / 128;
+   return true;
 }
 
 /**
@@ -1900,44 +2758,46 @@ splitval (void)
  *    Does this function need to have and use a char pointer???
  */
 
-static void
+static cbool_t
 get16val (void)
 {
-   if (yylex() != VAL || yylex() != INT)
-      syntax();
+   if (gs_lexer() != VAL || gs_lexer() != INT)
+      return syntax();
 
    if (yyval > 65535)                  /* yyval is now unsigned */
       error("Value must be between 0 and 65535");
 
    gs_data[0] = (yyval >> 8) & 0xff;
    gs_data[1] = yyval & 0xff;
+   return true;
 }
 
 /**
  *
  */
 
-static void
+static cbool_t
 checkcon (void)
 {
-   if (yylex() != CON || yylex() != INT)
-      syntax();
+   if (gs_lexer() != CON || gs_lexer() != INT)
+      return syntax();
 
    if (yyval > 127)                    /* yyval is now unsigned */
       error("Controller must be between 0 and 127");
 
    gs_data[0] = yyval;
+   return true;
 }
 
 /**
  *
  */
 
-static void
+static cbool_t
 checkprog (void)
 {
-   if (yylex() != PROG || yylex() != INT)
-      syntax();
+   if (gs_lexer() != PROG || gs_lexer() != INT)
+      return syntax();
 
    /*
     * Now unsigned: if (yyval < 0 || yyval > 127)
@@ -1947,6 +2807,7 @@ checkprog (void)
       error("Program number must be between 0 and 127");
 
    gs_data[0] = yyval;
+   return true;
 }
 
 /**
@@ -1960,123 +2821,195 @@ checkeol (void)
    if (eol_seen)
       return;
 
-   if (yylex() != EOL)
+   if (gs_lexer() != EOL)
    {
       prs_error("Garbage deleted");
-      while (! eol_seen)
-         yylex();
+      while (! eol_seen && gs_lexer() != EOF)
+         ;
    }
 }
 
 /**
+ *    Provides the value of each hexadecimal digit, indexed by character.
+ *    The value is -1 for characters that are not hexadecimal digits.
+ *    Used by gethex() to decode "\x" escapes in strings.
+ */
+
+static const signed char gs_hex_digits [256] =
+{
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+   -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/**
+ *    Makes sure that g_status_buffer can hold at least the given number of
+ *    bytes.  The buffer is kept from event to event, and, when it must
+ *    grow, it at least doubles in size, so that it is rarely reallocated.
+ *    Running out of memory is fatal.
  *
+ * \param size
+ *    Provides the number of bytes needed.
  */
 
 static void
+reserve_buffer (int size)
+{
+   if (size > g_status_bufsiz)
+   {
+      int newsize = g_status_bufsiz > 0 ? g_status_bufsiz * 2 : 256;
+      unsigned char * newbuffer;
+      if (newsize < size)
+         newsize = size;
+
+      newbuffer = realloc(g_status_buffer, newsize);   /* handles nullptr */
+      if (is_nullptr(newbuffer))
+      {
+         error("Out of memory");
+         exit(1);
+      }
+      g_status_buffer = newbuffer;
+      g_status_bufsiz = newsize;
+   }
+}
+
+/**
+ *    Gets the data bytes of a SysEx, Arb, Meta, or SeqSpec event, either
+ *    as a quoted string or as a list of hexadecimal integers, and puts
+ *    them into g_status_buffer.
+ *
+ *    A string can never decode to more bytes than it has characters, so
+ *    the buffer is sized from yyleng before decoding.  Runs of plain
+ *    characters are copied with memcpy(), and "\x" escapes are decoded
+ *    with the gs_hex_digits[] table.
+ *
+ * \return
+ *    Returns false if there was an error, in which case the rest of the
+ *    line has been skipped.
+ *
+ * \change ca 2026-10-18
+ *    Replaced the sscanf() call for each "\x" escape with a table lookup,
+ *    and the 128-byte growth steps for integer lists with doubling.
+ */
+
+static cbool_t
 gethex (void)
 {
    int c;
-   unsigned int * cptr = (unsigned int *) &c;      /* tricky code */
    g_status_buflen = 0;
    do_hex = 1;
-   c = yylex();
+   c = gs_lexer();
    if (c == STRING)
    {
-      int i = 0;
-      if ((int) yyleng - 1 > g_status_bufsiz)
+      const char * p = yytext;
+      const char * pend = yytext + (int) yyleng - 1;  /* skip closing quote */
+      unsigned char * dest;
+      reserve_buffer((int) yyleng);
+      dest = g_status_buffer;
+      while (p < pend)
       {
-         g_status_bufsiz = (int) (yyleng - 1);
-         if (g_status_buffer)
-            g_status_buffer = realloc(g_status_buffer, g_status_bufsiz);
-         else
-            g_status_buffer = malloc(g_status_bufsiz);
+         const char * bs = memchr(p, '\\', (size_t) (pend - p));
+         if (is_nullptr(bs))
+            bs = pend;
 
-         if (! g_status_buffer)
-            error("Out of memory");
-      }
-      while (i < (int) yyleng - 1)
-      {
-         c = yytext[i++];
-
-rescan:
-         if (c == '\\')
+         if (bs > p)
          {
-            switch (c = yytext[i++])
-            {
-            case '0':
-
-               c = '\0';
+            memcpy(dest, p, (size_t) (bs - p));
+            dest += bs - p;
+            p = bs;
+            if (p == pend)
                break;
+         }
+         ++p;                          /* skip the backslash               */
 
-            case 'n':
+rescan:
+         switch (c = (unsigned char) *p++)
+         {
+         case '0':
 
-               c = '\n';
-               break;
+            c = '\0';
+            break;
 
-            case 'r':
+         case 'n':
 
-               c = '\r';
-               break;
+            c = '\n';
+            break;
 
-            case 't':
+         case 'r':
 
-               c = '\t';
-               break;
+            c = '\r';
+            break;
 
-            case 'x':
+         case 't':
 
-               /*
-                * Note use of cptr for instead of "&c".
-                */
+            c = '\t';
+            break;
 
-               if (sscanf(yytext+i, "%2x", cptr) != 1)
-                  prs_error("Illegal \\x in string");
+         case 'x':
+         {
+            int hi = gs_hex_digits[(unsigned char) p[0]];
+            if (hi < 0)
+               return prs_error("Illegal \\x in string");
 
-               i += 2;
-               break;
+            c = hi;
+            if (gs_hex_digits[(unsigned char) p[1]] >= 0)
+               c = (hi << 4) | gs_hex_digits[(unsigned char) p[1]];
 
-            case '\r':
-            case '\n':
+            p += 2;
+            break;
+         }
+         case '\r':
+         case '\n':
 
-               while
-               (
-                  (c = yytext[i++]) == ' ' ||
-                  c == '\t' || c == '\r' || c == '\n'
-               )
-               {
-                  /* skip whitespace */
-               }
-               goto rescan;            /* apologies to EWD? */
+            while
+            (
+               (c = (unsigned char) *p++) == ' ' ||
+               c == '\t' || c == '\r' || c == '\n'
+            )
+            {
+               /* skip whitespace */
             }
+            if (c == '\\')
+               goto rescan;            /* apologies to EWD? */
+
+            break;
          }
-         g_status_buffer[g_status_buflen++] = c;
+         *dest++ = (unsigned char) c;
       }
+      g_status_buflen = (int) (dest - g_status_buffer);
    }
    else if (c == INT)
    {
       do
       {
          if (g_status_buflen >= g_status_bufsiz)
-         {
-            g_status_bufsiz += 128;
-            if (g_status_buffer)
-                g_status_buffer = realloc(g_status_buffer, g_status_bufsiz);
-            else
-               g_status_buffer = malloc(g_status_bufsiz);
+            reserve_buffer(g_status_buflen + 1);
 
-            if (! g_status_buffer)
-               error("Out of memory");
-         }
          g_status_buffer[g_status_buflen++] = yyval;
-         c = yylex();
+         c = gs_lexer();
 
       } while (c == INT);
 
       if (c != EOL)
-         prs_error("Unknown hex input");
+         return prs_error("Unknown hex input");
    }
    else
-      prs_error("String or hex input expected");
+      return prs_error("String or hex input expected");
+
+   return true;
 }
 
 /**
@@ -2259,7 +3192,8 @@ revert_stdout ()
 }
 
 /**
- *    Sets up the incoming text file for compiling into MIDI.
+ *    Sets up the incoming text file for compiling into MIDI.  With the
+ *    --validate option, no output file is opened.
  *
  * \return
  *    Returns true if all is well.
@@ -2269,6 +3203,11 @@ cbool_t
 midicvt_setup_compile (void)
 {
    cbool_t result;
+   if (midicvt_option_validate() && midicvt_option_binary())
+   {
+      errprint("--validate works only with ASCII input");
+      return false;
+   }
    if (midicvt_have_input_file())
       yyin = efopen(midicvt_input_file(), "r");
    else
@@ -2277,7 +3216,9 @@ midicvt_setup_compile (void)
       (void) midicvt_set_input_file("stdin");
    }
    result = not_nullptr(yyin);
-   if (result)
+   if (result && midicvt_option_validate())
+      g_io_file = nullptr;             /* --validate writes nothing           */
+   else if (result)
    {
       if (midicvt_have_output_file())
          g_io_file = efopen(midicvt_output_file(), "wb");
@@ -2324,9 +3265,7 @@ midicvt_close_compile (void)
       fclose(yyin);
 
    yyin = nullptr;
-   if (midicvt_have_output_file())
-      fclose(g_io_file);
-   else if (not_nullptr(g_io_file))
+   if (not_nullptr(g_io_file))         /* there is none with --validate       */
       fclose(g_io_file);
 
    g_io_file = nullptr;
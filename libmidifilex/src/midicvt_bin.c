@@ -0,0 +1,983 @@
+/*
+ * midicvt - A text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midicvt_bin.c
+ *
+ *    This module provides functions for converting MIDI to and from the
+ *    compact binary event format described in midicvt_bin.h.
+ *
+ * \library       midicvt application
+ * \author        Chris Ahlstrom and many other authors
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    The ASCII format is great for humans and for scripts, but it is
+ *    roughly ten times the size of the MIDI file, and has to be lexed
+ *    again by the --compile option.  A program that edits MIDI events can
+ *    use the binary format instead:
+ *
+\verbatim
+      midicvt --binary -i song.mid -o song.mcvb
+      (edit song.mcvb in place, or write a new one)
+      midicvt --binary -c -i song.mcvb -o song.mid
+\endverbatim
+ *
+ *    Converting from MIDI, the common callbacks of midicvt_writer.c pass
+ *    each event to bin_add(), which appends one record per event to an
+ *    in-memory record array, and the payloads of the meta, SysEx, and
+ *    escaped events to an in-memory heap.  The whole file is
+ *    written by midicvt_close_bin(), since the header needs the final
+ *    sizes and the output might be a pipe.
+ *
+ *    Converting to MIDI, the input is mapped into memory (or read into
+ *    memory, if it is not a regular file), checked, and then written by
+ *    mfwrite(), with a write-track callback that walks the records of each
+ *    track in turn.  No parsing is needed.
+ */
+
+#include <errno.h>                     /* errno, for strerror(errno)          */
+#include <stdio.h>                     /* FILE *, fwrite(), fread()           */
+#include <stdlib.h>                    /* exit(), realloc(), free()           */
+#include <string.h>                    /* memcpy(), memcmp(), strerror()      */
+#include <sys/mman.h>                  /* mmap(), munmap(), UNIX/Linux only   */
+#include <sys/stat.h>                  /* fstat()                             */
+
+#include <midicvt_macros.h>            /* nullptr, true, false, etc.          */
+#include <midicvt_bin.h>               /* this module's functions and stuff   */
+#include <midicvt_globals.h>           /* g_io_file, g_redirect_file, etc.    */
+#include <midicvt_helpers.h>           /* midicvt_input_file(), etc.          */
+#include <midicvt_writer.h>            /* midicvt_writer_callbacks()          */
+#include <midifilex.h>                 /* routines that read/write MIDI data  */
+#include <t2mf.h>                      /* yyin, the input of --compile        */
+
+/**
+ *    Provides the initial size of the record array and of the payload
+ *    heap.  Both double in size whenever they fill up.
+ */
+
+#define BIN_INITIAL_SIZE            (16 * 1024)
+
+/**
+ *    Provides the largest value that fits in a 32-bit field of the
+ *    format.
+ */
+
+#define BIN_MAX_FIELD               0xffffffffUL
+
+/**
+ *    Holds the encoded event records.
+ */
+
+static unsigned char * gs_bin_records = nullptr;
+
+/**
+ *    Provides the number of records in gs_bin_records.
+ */
+
+static unsigned long gs_bin_record_count = 0;
+
+/**
+ *    Provides the allocated size, in bytes, of gs_bin_records.
+ */
+
+static unsigned long gs_bin_record_alloc = 0;
+
+/**
+ *    Holds the payload heap.
+ */
+
+static unsigned char * gs_bin_heap = nullptr;
+
+/**
+ *    Provides the number of bytes used in gs_bin_heap.
+ */
+
+static unsigned long gs_bin_heap_size = 0;
+
+/**
+ *    Provides the allocated size, in bytes, of gs_bin_heap.
+ */
+
+static unsigned long gs_bin_heap_alloc = 0;
+
+/**
+ *    Indicates that the memory for the records or the heap could not be
+ *    allocated.  Once set, no more events are stored, and
+ *    midicvt_close_bin() fails.
+ */
+
+static cbool_t gs_bin_out_of_memory = false;
+
+/**
+ *    Provides the current track number, starting at 0.
+ */
+
+static int gs_bin_track = -1;
+
+/**
+ *    Holds the SMF format (0, 1, or 2), from the header.
+ */
+
+static int gs_bin_format = 1;
+
+/**
+ *    Holds the division, from the header.
+ */
+
+static int gs_bin_division = 0;
+
+/**
+ *    Holds the decoded header of the file being compiled.
+ */
+
+static midicvt_bin_header_t gs_bin_in_header;
+
+/**
+ *    Points to the contents of the file being compiled.
+ */
+
+static const unsigned char * gs_bin_in_data = nullptr;
+
+/**
+ *    Provides the index of the next record to be written to the MIDI
+ *    file.
+ */
+
+static unsigned long gs_bin_in_index = 0;
+
+/**
+ *    Provides the number of the track being written to the MIDI file.
+ */
+
+static int gs_bin_in_track = 0;
+
+/**
+ *    Holds the status byte plus the payload for mf_w_sysex_event(), which
+ *    wants them together.  Sized by bin_check_records().
+ */
+
+static unsigned char * gs_bin_sysex = nullptr;
+
+/**
+ *    Provides the allocated size of gs_bin_sysex.
+ */
+
+static unsigned long gs_bin_sysex_alloc = 0;
+
+/**
+ *    Stores a 16-bit value in little-endian order.
+ */
+
+static void
+put16 (unsigned char * p, unsigned long v)
+{
+   p[0] = (unsigned char) (v & 0xff);
+   p[1] = (unsigned char) ((v >> 8) & 0xff);
+}
+
+/**
+ *    Stores a 32-bit value in little-endian order.
+ */
+
+static void
+put32 (unsigned char * p, unsigned long v)
+{
+   p[0] = (unsigned char) (v & 0xff);
+   p[1] = (unsigned char) ((v >> 8) & 0xff);
+   p[2] = (unsigned char) ((v >> 16) & 0xff);
+   p[3] = (unsigned char) ((v >> 24) & 0xff);
+}
+
+/**
+ *    Fetches a 16-bit little-endian value.
+ */
+
+static unsigned long
+get16 (const unsigned char * p)
+{
+   return (unsigned long) p[0] | ((unsigned long) p[1] << 8);
+}
+
+/**
+ *    Fetches a 32-bit little-endian value.
+ */
+
+static unsigned long
+get32 (const unsigned char * p)
+{
+   return (unsigned long) p[0] | ((unsigned long) p[1] << 8) |
+      ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+/**
+ *    Makes sure a buffer can hold the given number of bytes, doubling its
+ *    size as needed.
+ *
+ * \param buffer
+ *    Provides the address of the buffer pointer, which is updated.
+ *
+ * \param alloc
+ *    Provides the address of the allocated size, which is updated.
+ *
+ * \param needed
+ *    Provides the number of bytes needed.
+ *
+ * \return
+ *    Returns true if the buffer is big enough.
+ */
+
+static cbool_t
+bin_grow (unsigned char ** buffer, unsigned long * alloc, unsigned long needed)
+{
+   if (needed > *alloc)
+   {
+      unsigned long newsize = *alloc > 0 ? *alloc : BIN_INITIAL_SIZE;
+      unsigned char * p;
+      while (newsize < needed)
+         newsize *= 2;
+
+      p = realloc(*buffer, (size_t) newsize);
+      if (is_nullptr(p))
+         return false;
+
+      *buffer = p;
+      *alloc = newsize;
+   }
+   return true;
+}
+
+/**
+ *    Appends one event record, and its payload, if any.
+ *
+ * \param status
+ *    Provides the status byte.
+ *
+ * \param d1
+ *    Provides the first data byte, or the meta-event type.
+ *
+ * \param d2
+ *    Provides the second data byte.
+ *
+ * \param payload
+ *    Provides the payload bytes.  Can be null if \a leng is 0.
+ *
+ * \param leng
+ *    Provides the number of payload bytes.
+ */
+
+static void
+bin_add (int status, int d1, int d2, const unsigned char * payload, long leng)
+{
+   unsigned char * r;
+   unsigned long offset = gs_bin_heap_size;
+   if (gs_bin_out_of_memory)
+      return;
+
+   if (leng < 0)
+      leng = 0;
+
+   if
+   (
+      ! bin_grow
+      (
+         &gs_bin_records, &gs_bin_record_alloc,
+         (gs_bin_record_count + 1) * MIDICVT_BIN_RECORD_SIZE
+      ) ||
+      ! bin_grow(&gs_bin_heap, &gs_bin_heap_alloc, offset + (unsigned long) leng)
+   )
+   {
+      errprint("bin_add(): out of memory for the binary events");
+      gs_bin_out_of_memory = true;
+      return;
+   }
+   if (leng > 0)
+   {
+      memcpy(&gs_bin_heap[offset], payload, (size_t) leng);
+      gs_bin_heap_size += (unsigned long) leng;
+   }
+   r = &gs_bin_records[gs_bin_record_count * MIDICVT_BIN_RECORD_SIZE];
+   put32(&r[0], (unsigned long) Mf_currtime);
+   put32(&r[4], offset);
+   put32(&r[8], (unsigned long) leng);
+   put16(&r[12], (unsigned long) gs_bin_track);
+   r[14] = (unsigned char) status;
+   r[15] = (unsigned char) d1;
+   r[16] = (unsigned char) d2;
+   r[17] = r[18] = r[19] = 0;
+   ++gs_bin_record_count;
+}
+
+/**
+ *    Callback function implementing Mf_header().  Saves the values for
+ *    the header of the binary file.
+ *
+ * \param format
+ *    Provides the format (0, 1, or 2) of the MIDI file.
+ *
+ * \param ntrks
+ *    Provides the number of tracks in the MIDI file.
+ *
+ * \param division
+ *    Provides the time-division value.
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+static int
+bin_header (int format, int ntrks, int division)
+{
+   if (format < 0 || format > 2)
+   {
+      fprintf(stderr, "Can't deal with format %d or missing files\n", format);
+      exit(1);
+   }
+   gs_bin_format = format;
+   gs_bin_division = division;
+   g_status_tracks_to_do = ntrks;
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_starttrack().
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+static int
+bin_trstart (void)
+{
+   ++gs_bin_track;
+   return true;
+}
+
+/**
+ *    Receives the channel events from the callbacks of midicvt_writer.c.
+ *    Program Change and Channel Pressure have no second data byte, which
+ *    is stored as 0.
+ *
+ * \param status
+ *    Provides the event nybble (e.g. note_on).
+ *
+ * \param chan
+ *    Provides the channel, 0 to 15.
+ *
+ * \param d1
+ *    Provides the first data byte.
+ *
+ * \param d2
+ *    Provides the second data byte, or -1 if the event has only one.
+ */
+
+static void
+bin_channel_event (int status, int chan, int d1, int d2)
+{
+   bin_add(status | chan, d1, d2 < 0 ? 0 : d2, nullptr, 0);
+}
+
+/**
+ *    Receives the meta, SysEx, and escaped events from the callbacks of
+ *    midicvt_writer.c.  The meta type is stored as the first data byte.
+ *
+ * \param status
+ *    Provides the status byte, 0xff, 0xf0, or 0xf7.
+ *
+ * \param type
+ *    Provides the meta-event type, or -1 for SysEx and escaped events.
+ *
+ * \param p
+ *    Provides the payload bytes.
+ *
+ * \param leng
+ *    Provides the number of payload bytes.
+ */
+
+static void
+bin_data_event (int status, int type, const unsigned char * p, int leng)
+{
+   bin_add(status, type < 0 ? 0 : type, 0, p, leng);
+}
+
+/**
+ *    Callback function implementing Mf_putc(), for writing the MIDI file
+ *    in midicvt_compile_bin().
+ *
+ * \param c
+ *    Provides the character to be written.
+ *
+ * \return
+ *    Returns the value returned by putc().
+ */
+
+static int
+fileputc (unsigned char c)
+{
+   return putc((int) c, g_io_file);
+}
+
+/**
+ *    Frees the record array and the payload heap.
+ */
+
+static void
+bin_free (void)
+{
+   if (not_nullptr(gs_bin_records))
+   {
+      free(gs_bin_records);
+      gs_bin_records = nullptr;
+   }
+   if (not_nullptr(gs_bin_heap))
+   {
+      free(gs_bin_heap);
+      gs_bin_heap = nullptr;
+   }
+   gs_bin_record_count = gs_bin_record_alloc = 0;
+   gs_bin_heap_size = gs_bin_heap_alloc = 0;
+}
+
+/**
+ *    Makes the function assignments needed by the midifile library when
+ *    converting a MIDI file to the binary event format, and resets the
+ *    state of the converter.
+ */
+
+void
+midicvt_initfuncs_bin (void)
+{
+   bin_free();
+   gs_bin_out_of_memory = false;
+   gs_bin_track      = -1;
+   gs_bin_format     = 1;
+   gs_bin_division   = 0;
+   midicvt_writer_callbacks(bin_channel_event, bin_data_event);
+   Mf_header         = bin_header;
+   Mf_starttrack     = bin_trstart;
+}
+
+/**
+ *    Provides the number of event records stored so far by the callbacks
+ *    set up by midicvt_initfuncs_bin().
+ *
+ * \return
+ *    Returns the number of records, which is the size needed for each of
+ *    the columns of midicvt_bin_get_columns().
+ */
+
+unsigned long
+midicvt_bin_record_count (void)
+{
+   return gs_bin_record_count;
+}
+
+/**
+ *    Copies the status and data bytes of the stored records into three
+ *    columns, so that they can be edited together, such as by the
+ *    midipp::midimapper::apply() function of midicvtpp.  Must be called
+ *    after mfread() and before midicvt_close_bin().
+ *
+ * \param status
+ *    Provides the status column, which must hold at least
+ *    midicvt_bin_record_count() bytes.
+ *
+ * \param data1
+ *    Provides the column for the first data byte.
+ *
+ * \param data2
+ *    Provides the column for the second data byte.
+ */
+
+void
+midicvt_bin_get_columns
+(
+   unsigned char * status,
+   unsigned char * data1,
+   unsigned char * data2
+)
+{
+   const unsigned char * r = gs_bin_records;
+   unsigned long i;
+   for (i = 0; i < gs_bin_record_count; ++i, r += MIDICVT_BIN_RECORD_SIZE)
+   {
+      status[i] = r[14];
+      data1[i] = r[15];
+      data2[i] = r[16];
+   }
+}
+
+/**
+ *    Copies the columns filled by midicvt_bin_get_columns(), once edited,
+ *    back into the stored records, and removes the records that are not
+ *    to be kept.  Only channel events can be removed, since the payloads
+ *    of the other events are left where they are in the heap.
+ *
+ * \param status
+ *    Provides the edited status column.
+ *
+ * \param data1
+ *    Provides the edited column for the first data byte.
+ *
+ * \param data2
+ *    Provides the edited column for the second data byte.
+ *
+ * \param keep
+ *    Provides a byte for each record, 0 if the record is to be removed.
+ *    If null, all the records are kept.
+ */
+
+void
+midicvt_bin_put_columns
+(
+   const unsigned char * status,
+   const unsigned char * data1,
+   const unsigned char * data2,
+   const unsigned char * keep
+)
+{
+   unsigned long kept = 0;
+   unsigned long i;
+   for (i = 0; i < gs_bin_record_count; ++i)
+   {
+      if (is_nullptr(keep) || keep[i] != 0 || status[i] >= 0xf0)
+      {
+         unsigned char * r = &gs_bin_records[kept * MIDICVT_BIN_RECORD_SIZE];
+         if (kept != i)
+         {
+            memcpy
+            (
+               r, &gs_bin_records[i * MIDICVT_BIN_RECORD_SIZE],
+               MIDICVT_BIN_RECORD_SIZE
+            );
+         }
+         r[14] = status[i];
+         r[15] = data1[i];
+         r[16] = data2[i];
+         ++kept;
+      }
+   }
+   gs_bin_record_count = kept;
+}
+
+/**
+ *    Writes the binary event file (header, records, and heap) to the
+ *    output, and frees the memory.  Must be called after mfread() and
+ *    before midicvt_close_mfread().
+ *
+ * \return
+ *    Returns true if the whole file was written.
+ */
+
+cbool_t
+midicvt_close_bin (void)
+{
+   cbool_t result = ! gs_bin_out_of_memory && not_nullptr(g_redirect_file);
+   if (result)
+   {
+      unsigned char h[MIDICVT_BIN_HEADER_SIZE];
+      unsigned long recbytes = gs_bin_record_count * MIDICVT_BIN_RECORD_SIZE;
+      unsigned long heapoffset = MIDICVT_BIN_HEADER_SIZE + recbytes;
+      if (heapoffset + gs_bin_heap_size > BIN_MAX_FIELD)
+      {
+         errprint("midicvt_close_bin(): too many events for the binary format");
+         result = false;
+      }
+      else
+      {
+         memcpy(&h[0], MIDICVT_BIN_MAGIC, 4);
+         put16(&h[4], MIDICVT_BIN_VERSION);
+         put16(&h[6], (unsigned long) gs_bin_format);
+         put16(&h[8], (unsigned long) (gs_bin_track + 1));
+         put16(&h[10], (unsigned long) gs_bin_division);
+         put32(&h[12], gs_bin_record_count);
+         put32(&h[16], gs_bin_heap_size);
+         put32(&h[20], MIDICVT_BIN_HEADER_SIZE);
+         put32(&h[24], heapoffset);
+         put32(&h[28], 0);
+         result =
+            fwrite(h, 1, sizeof h, g_redirect_file) == sizeof h &&
+            fwrite(gs_bin_records, 1, recbytes, g_redirect_file) == recbytes &&
+            fwrite(gs_bin_heap, 1, gs_bin_heap_size, g_redirect_file) ==
+               gs_bin_heap_size;
+
+         if (result)
+            result = fflush(g_redirect_file) == 0;
+
+         if (! result)
+            errprint("midicvt_close_bin(): failed to write the binary events");
+      }
+   }
+   bin_free();
+   return result;
+}
+
+/**
+ *    Decodes and checks the header of a binary event file.
+ *
+ * \param data
+ *    Provides the contents of the file.
+ *
+ * \param size
+ *    Provides the size of the file, in bytes.
+ *
+ * \param header
+ *    Provides the destination for the decoded header.
+ *
+ * \return
+ *    Returns true if the file has the right magic number and version, and
+ *    the records and heap fit inside the file.
+ */
+
+cbool_t
+midicvt_bin_get_header
+(
+   const unsigned char * data,
+   unsigned long size,
+   midicvt_bin_header_t * header
+)
+{
+   cbool_t result = not_nullptr(data) && size >= MIDICVT_BIN_HEADER_SIZE;
+   if (result)
+      result = memcmp(data, MIDICVT_BIN_MAGIC, 4) == 0;
+
+   if (result)
+      result = get16(&data[4]) == MIDICVT_BIN_VERSION;
+
+   if (result)
+   {
+      header->format = (int) get16(&data[6]);
+      header->ntracks = (int) get16(&data[8]);
+      header->division = (int) get16(&data[10]);
+      header->record_count = get32(&data[12]);
+      header->heap_size = get32(&data[16]);
+      header->record_offset = get32(&data[20]);
+      header->heap_offset = get32(&data[24]);
+      result =
+         header->record_offset >= MIDICVT_BIN_HEADER_SIZE &&
+         header->record_offset <= size &&
+         header->record_count <=
+            (size - header->record_offset) / MIDICVT_BIN_RECORD_SIZE &&
+         header->heap_offset <= size &&
+         header->heap_size <= size - header->heap_offset;
+   }
+   return result;
+}
+
+/**
+ *    Decodes one event record.  The index is not checked; the caller must
+ *    keep it less than header->record_count.
+ *
+ * \param data
+ *    Provides the contents of the file.
+ *
+ * \param header
+ *    Provides the header, as decoded by midicvt_bin_get_header().
+ *
+ * \param index
+ *    Provides the index of the record.
+ *
+ * \param ev
+ *    Provides the destination for the decoded record.
+ */
+
+void
+midicvt_bin_get_event
+(
+   const unsigned char * data,
+   const midicvt_bin_header_t * header,
+   unsigned long index,
+   midicvt_bin_event_t * ev
+)
+{
+   const unsigned char * r =
+      &data[header->record_offset + index * MIDICVT_BIN_RECORD_SIZE];
+
+   ev->tick = get32(&r[0]);
+   ev->payload_offset = get32(&r[4]);
+   ev->payload_length = get32(&r[8]);
+   ev->track = (int) get16(&r[12]);
+   ev->status = r[14];
+   ev->data1 = r[15];
+   ev->data2 = r[16];
+}
+
+/**
+ *    Checks every record of the input file, so that the write-track
+ *    callback need not worry about bad values.  Also allocates the SysEx
+ *    buffer, big enough for the longest SysEx or escaped event.
+ *
+ * \return
+ *    Returns true if the records are in track order, in time order within
+ *    each track, have legal status bytes, and have payloads inside the
+ *    heap.
+ */
+
+static cbool_t
+bin_check_records (void)
+{
+   const midicvt_bin_header_t * h = &gs_bin_in_header;
+   unsigned long i;
+   int track = 0;
+   unsigned long tick = 0;
+   unsigned long longest = 0;
+   for (i = 0; i < h->record_count; ++i)
+   {
+      midicvt_bin_event_t ev;
+      const char * problem = nullptr;
+      midicvt_bin_get_event(gs_bin_in_data, h, i, &ev);
+      if (ev.track >= h->ntracks || ev.track < track)
+         problem = "track number out of order";
+      else
+      {
+         if (ev.track > track)
+         {
+            track = ev.track;
+            tick = 0;
+         }
+         if (ev.tick < tick)
+            problem = "time out of order";
+         else if (ev.status < 0x80)
+            problem = "bad status byte";
+         else if (ev.status < 0xf0 && (ev.data1 > 0x7f || ev.data2 > 0x7f))
+            problem = "bad data byte";
+         else if
+         (
+            ev.status >= 0xf0 && ev.status != meta_event &&
+            ev.status != system_exclusive && ev.status != 0xf7
+         )
+         {
+            problem = "unsupported status byte";
+         }
+         else if
+         (
+            ev.payload_offset > h->heap_size ||
+            ev.payload_length > h->heap_size - ev.payload_offset
+         )
+         {
+            problem = "payload outside of the heap";
+         }
+         else if (ev.status != meta_event && ev.payload_length > longest)
+            longest = ev.payload_length;
+
+         tick = ev.tick;
+      }
+      if (not_nullptr(problem))
+      {
+         fprintf
+         (
+            stderr, "? %s: record %lu: %s\n",
+            midicvt_input_file(), i, problem
+         );
+         return false;
+      }
+   }
+   if (! bin_grow(&gs_bin_sysex, &gs_bin_sysex_alloc, longest + 1))
+   {
+      errprint("bin_check_records(): out of memory for the SysEx events");
+      return false;
+   }
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_wtrack() for midicvt_compile_bin().
+ *    Writes all of the records for the current track, converting their
+ *    absolute times to delta times.
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+static int
+bin_writetrack (void)
+{
+   const midicvt_bin_header_t * h = &gs_bin_in_header;
+   unsigned long lasttick = 0;
+   while (gs_bin_in_index < h->record_count)
+   {
+      midicvt_bin_event_t ev;
+      const unsigned char * payload;
+      unsigned long delta;
+      midicvt_bin_get_event(gs_bin_in_data, h, gs_bin_in_index, &ev);
+      if (ev.track != gs_bin_in_track)
+         break;
+
+      ++gs_bin_in_index;
+      delta = ev.tick - lasttick;
+      lasttick = ev.tick;
+      payload = &gs_bin_in_data[h->heap_offset + ev.payload_offset];
+      if (ev.status == meta_event)
+      {
+         (void) mf_w_meta_event
+         (
+            delta, (unsigned char) ev.data1,
+            (unsigned char *) payload, ev.payload_length
+         );
+      }
+      else if (ev.status == system_exclusive || ev.status == 0xf7)
+      {
+         gs_bin_sysex[0] = (unsigned char) ev.status;
+         memcpy(&gs_bin_sysex[1], payload, (size_t) ev.payload_length);
+         (void) mf_w_sysex_event(delta, gs_bin_sysex, ev.payload_length + 1);
+      }
+      else
+      {
+         int type = ev.status & 0xf0;
+         unsigned char s_data[2];
+         unsigned long size = 2;
+         s_data[0] = (unsigned char) ev.data1;
+         s_data[1] = (unsigned char) ev.data2;
+         if (type == program_chng || type == channel_aftertouch)
+            size = 1;
+
+         (void) mf_w_midi_event
+         (
+            delta, (unsigned int) type, (unsigned int) (ev.status & 0x0f),
+            s_data, size
+         );
+      }
+   }
+   ++gs_bin_in_track;
+   return true;
+}
+
+/**
+ *    Reads a binary event file and writes it as a MIDI file.  The input
+ *    and output are set up by midicvt_setup_compile(), and closed by
+ *    midicvt_close_compile().
+ *
+ *    A regular input file is mapped into memory with mmap().  Otherwise
+ *    (e.g. for a pipe) it is read into a buffer.
+ *
+ * \return
+ *    Returns true if the input file was valid and was converted.
+ */
+
+cbool_t
+midicvt_compile_bin (void)
+{
+   cbool_t result = not_nullptr(yyin) && not_nullptr(g_io_file);
+   unsigned char * buffer = nullptr;
+   void * mapped = MAP_FAILED;
+   unsigned long size = 0;
+   if (result)
+   {
+      struct stat st;
+      int fd = fileno(yyin);
+      if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+      {
+         size = (unsigned long) st.st_size;
+         mapped = mmap(nullptr, (size_t) size, PROT_READ, MAP_PRIVATE, fd, 0);
+      }
+      if (mapped != MAP_FAILED)
+         gs_bin_in_data = (const unsigned char *) mapped;
+      else
+      {
+         unsigned long alloc = 0;
+         size_t count;
+         size = 0;
+         do
+         {
+            if (! bin_grow(&buffer, &alloc, size + BIN_INITIAL_SIZE))
+            {
+               errprint("midicvt_compile_bin(): out of memory for the input");
+               result = false;
+               break;
+            }
+            count = fread(&buffer[size], 1, BIN_INITIAL_SIZE, yyin);
+            size += (unsigned long) count;
+
+         } while (count > 0);
+
+         if (ferror(yyin))
+         {
+            fprintf
+            (
+               stderr, "? %s: read error, %s\n",
+               midicvt_input_file(), strerror(errno)
+            );
+            result = false;
+         }
+         gs_bin_in_data = buffer;
+      }
+   }
+   if (result)
+   {
+      result = midicvt_bin_get_header(gs_bin_in_data, size, &gs_bin_in_header);
+      if (! result)
+      {
+         fprintf
+         (
+            stderr, "? %s: not a valid midicvt binary event file\n",
+            midicvt_input_file()
+         );
+      }
+   }
+   if (result)
+      result = bin_check_records();
+
+   if (result)
+   {
+      if (midicvt_option_debug())
+      {
+         fprintf
+         (
+            stderr, "Writing %lu events in %d tracks to %s...\n",
+            gs_bin_in_header.record_count, gs_bin_in_header.ntracks,
+            midicvt_output_file()
+         );
+      }
+      gs_bin_in_index = 0;
+      gs_bin_in_track = 0;
+      Mf_putc = fileputc;
+      Mf_wtrack = bin_writetrack;
+      Mf_wtempotrack = nullptr;
+      mfwrite
+      (
+         gs_bin_in_header.format, gs_bin_in_header.ntracks,
+         gs_bin_in_header.division, g_io_file
+      );
+   }
+   if (mapped != MAP_FAILED)
+      (void) munmap(mapped, (size_t) size);
+
+   if (not_nullptr(buffer))
+      free(buffer);
+
+   if (not_nullptr(gs_bin_sysex))
+   {
+      free(gs_bin_sysex);
+      gs_bin_sysex = nullptr;
+      gs_bin_sysex_alloc = 0;
+   }
+   gs_bin_in_data = nullptr;
+   return result;
+}
+
+/*
+ * midicvt_bin.c
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
@@ -0,0 +1,489 @@
+/*
+ * midicvt - A text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midicvt_cache.c
+ *
+ *    This module provides the directory of compiled tracks used by the
+ *    --cache option of --compile.  The file format is described in
+ *    midicvt_cache.h.
+ *
+ * \library       midicvt application
+ * \author        Chris Ahlstrom and many other authors
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    This module only finds, reads, and writes the cache files.  Deciding
+ *    which tracks can be taken from the cache is done by compile_cached()
+ *    in midicvt_base.c, which knows how the compiler moves from one track
+ *    to the next.
+ *
+ *    A new file is first written under a temporary name, and then renamed,
+ *    so that another midicvt running at the same time never sees a partly
+ *    written track.  Any cache file that cannot be read or that fails a
+ *    check, including a text or context that differs from that of the
+ *    track being compiled, is simply treated as missing.
+ */
+
+#include <errno.h>                     /* errno, EEXIST                       */
+#include <stdio.h>                     /* FILE *, fopen(), rename()           */
+#include <stdlib.h>                    /* malloc(), free()                    */
+#include <string.h>                    /* memcmp(), memcpy(), memmove()       */
+#include <sys/stat.h>                  /* mkdir()                             */
+#include <unistd.h>                    /* getpid(), unlink()                  */
+
+#include <midicvt_macros.h>            /* nullptr, true, false, etc.          */
+#include <midicvt_cache.h>             /* this module's functions and stuff   */
+#include <midicvt_globals.h>           /* midicvt_option_cache()              */
+
+/**
+ *    Provides the four bytes that start every cache file.
+ */
+
+#define CACHE_MAGIC                 "MCVC"
+
+/**
+ *    Provides the size of the fixed part of the cache-file header, in front
+ *    of the context values, the text, and the chunk.
+ */
+
+#define CACHE_HEADER_SIZE           (20 + 4 * MIDICVT_CACHE_STATE_COUNT)
+
+/**
+ *    Provides the size of the "MTrk" and length fields of a track chunk.
+ */
+
+#define CACHE_CHUNK_HEADER_SIZE     8
+
+/**
+ *    Provides the size of the buffer for a cache-file path name.
+ */
+
+#define CACHE_PATH_SIZE             1024
+
+/**
+ *    Stores a 32-bit value in little-endian order.
+ */
+
+static void
+cache_put32 (unsigned char * p, unsigned long v)
+{
+   p[0] = (unsigned char) (v & 0xff);
+   p[1] = (unsigned char) ((v >> 8) & 0xff);
+   p[2] = (unsigned char) ((v >> 16) & 0xff);
+   p[3] = (unsigned char) ((v >> 24) & 0xff);
+}
+
+/**
+ *    Fetches a 32-bit little-endian value.
+ */
+
+static unsigned long
+cache_get32 (const unsigned char * p)
+{
+   return
+   (
+      (unsigned long) p[0] | ((unsigned long) p[1] << 8) |
+      ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24)
+   );
+}
+
+/**
+ *    Converts a 32-bit value, as read by cache_get32(), back to a signed
+ *    value.
+ */
+
+static long
+cache_signed32 (unsigned long v)
+{
+   return (v & 0x80000000UL) ? (long) v - 0xffffffffL - 1 : (long) v;
+}
+
+/**
+ *    Makes the path name of a cache file.
+ *
+ * \param key
+ *    Provides the key made by midicvt_cache_key().
+ *
+ * \param suffix
+ *    Provides the extension, such as ".mtrk".
+ *
+ * \param path
+ *    Provides the destination, CACHE_PATH_SIZE bytes.
+ *
+ * \return
+ *    Returns true if there is a cache directory, and the name fit.
+ */
+
+static cbool_t
+cache_path (const char * key, const char * suffix, char * path)
+{
+   const char * dir = midicvt_option_cache();
+   int count;
+   if (is_nullptr(dir))
+      return false;
+
+   count = snprintf(path, CACHE_PATH_SIZE, "%s/%s%s", dir, key, suffix);
+   return count > 0 && count < CACHE_PATH_SIZE;
+}
+
+/**
+ *    Checks that the context values and the text stored in a cache file
+ *    are those of the track being compiled.  The values are compared as
+ *    they are stored, 32 bits each, just as midicvt_cache_key() hashes
+ *    them.
+ *
+ * \param p
+ *    Provides the stored context values, followed by the stored text.
+ *
+ * \param text
+ *    Provides the text of the track.
+ *
+ * \param length
+ *    Provides the length of the text, already checked against the length
+ *    stored in the file.
+ *
+ * \param context
+ *    Provides the context values of the track.
+ *
+ * \param count
+ *    Provides the number of context values, already checked against the
+ *    number stored in the file.
+ *
+ * \return
+ *    Returns true if all of the values and all of the text are the same.
+ */
+
+static cbool_t
+cache_source_matches
+(
+   const unsigned char * p,
+   const char * text,
+   unsigned long length,
+   const long * context,
+   int count
+)
+{
+   int c;
+   for (c = 0; c < count; ++c, p += 4)
+   {
+      if (cache_get32(p) != ((unsigned long) context[c] & 0xffffffffUL))
+         return false;
+   }
+   return length == 0 || memcmp(p, text, length) == 0;
+}
+
+/**
+ *    Hashes the text of a track, plus the context in which it is
+ *    compiled, into a key for midicvt_cache_load() and
+ *    midicvt_cache_store().  Two 32-bit hashes, FNV-1a and a
+ *    multiply-by-33 hash, are made in one pass and put together.
+ *
+ * \param text
+ *    Provides the text of the track.
+ *
+ * \param length
+ *    Provides the length of the text.
+ *
+ * \param context
+ *    Provides the other values on which the compiled track depends.
+ *
+ * \param count
+ *    Provides the number of context values.
+ *
+ * \param key
+ *    Provides the destination, MIDICVT_CACHE_KEY_SIZE bytes.  It is
+ *    filled with 16 hexadecimal digits.
+ */
+
+void
+midicvt_cache_key
+(
+   const char * text,
+   unsigned long length,
+   const long * context,
+   int count,
+   char * key
+)
+{
+   unsigned long h1 = 2166136261UL;
+   unsigned long h2 = 5381UL;
+   unsigned long i;
+   int c;
+   for (i = 0; i < length; ++i)
+   {
+      unsigned char b = (unsigned char) text[i];
+      h1 = ((h1 ^ b) * 16777619UL) & 0xffffffffUL;
+      h2 = ((h2 * 33) ^ b) & 0xffffffffUL;
+   }
+   for (c = 0; c < count; ++c)
+   {
+      unsigned char b[4];
+      int j;
+      cache_put32(b, (unsigned long) context[c]);
+      for (j = 0; j < 4; ++j)
+      {
+         h1 = ((h1 ^ b[j]) * 16777619UL) & 0xffffffffUL;
+         h2 = ((h2 * 33) ^ b[j]) & 0xffffffffUL;
+      }
+   }
+   (void) snprintf
+   (
+      key, MIDICVT_CACHE_KEY_SIZE, "%08lx%08lx", h1 ^ length, h2
+   );
+}
+
+/**
+ *    Reads a compiled track from the cache directory.
+ *
+ * \param key
+ *    Provides the key made by midicvt_cache_key().
+ *
+ * \param text
+ *    Provides the text of the track, which must match the text stored
+ *    with it.
+ *
+ * \param length
+ *    Provides the length of the text.
+ *
+ * \param context
+ *    Provides the values given to midicvt_cache_key(), which must match
+ *    those stored with the track.
+ *
+ * \param count
+ *    Provides the number of context values.
+ *
+ * \param state
+ *    Provides the destination for the MIDICVT_CACHE_STATE_COUNT state
+ *    values stored with the track.
+ *
+ * \param lines
+ *    Provides the destination for the number of lines in the track.
+ *
+ * \param data
+ *    Provides the destination for the complete MTrk chunk, which is
+ *    allocated with malloc().  The caller must free() it.
+ *
+ * \param size
+ *    Provides the destination for the size of the MTrk chunk.
+ *
+ * \return
+ *    Returns true if the track was found and passed all the checks.
+ */
+
+cbool_t
+midicvt_cache_load
+(
+   const char * key,
+   const char * text,
+   unsigned long length,
+   const long * context,
+   int count,
+   long * state,
+   int * lines,
+   unsigned char ** data,
+   unsigned long * size
+)
+{
+   cbool_t result = false;
+   char path[CACHE_PATH_SIZE];
+   FILE * fp;
+   struct stat st;
+   int olderrno = errno;               /* a missing file is not an error      */
+   if (! cache_path(key, ".mtrk", path))
+      return false;
+
+   fp = fopen(path, "rb");
+   if (is_nullptr(fp))
+   {
+      errno = olderrno;
+      return false;
+   }
+
+   if
+   (
+      fstat(fileno(fp), &st) == 0 &&
+      st.st_size >= CACHE_HEADER_SIZE + CACHE_CHUNK_HEADER_SIZE
+   )
+   {
+      unsigned long total = (unsigned long) st.st_size;
+      unsigned long source = CACHE_HEADER_SIZE + 4UL * count + length;
+      unsigned char * buffer = malloc(total);
+      if
+      (
+         not_nullptr(buffer) && fread(buffer, 1, total, fp) == total &&
+         memcmp(buffer, CACHE_MAGIC, 4) == 0 &&
+         cache_get32(&buffer[4]) == MIDICVT_CACHE_VERSION &&
+         cache_get32(&buffer[12 + 4 * MIDICVT_CACHE_STATE_COUNT]) ==
+            (unsigned long) count &&
+         cache_get32(&buffer[16 + 4 * MIDICVT_CACHE_STATE_COUNT]) == length &&
+         total >= source + CACHE_CHUNK_HEADER_SIZE &&
+         cache_source_matches
+         (
+            &buffer[CACHE_HEADER_SIZE], text, length, context, count
+         )
+      )
+      {
+         const unsigned char * chunk = &buffer[source];
+         unsigned long chunksize = total - source;
+         unsigned long tracklength =
+            ((unsigned long) chunk[4] << 24) |
+            ((unsigned long) chunk[5] << 16) |
+            ((unsigned long) chunk[6] << 8) | (unsigned long) chunk[7];
+
+         if
+         (
+            memcmp(chunk, "MTrk", 4) == 0 &&
+            tracklength == chunksize - CACHE_CHUNK_HEADER_SIZE
+         )
+         {
+            int i;
+            *lines = (int) cache_signed32(cache_get32(&buffer[8]));
+            for (i = 0; i < MIDICVT_CACHE_STATE_COUNT; ++i)
+               state[i] = cache_signed32(cache_get32(&buffer[12 + 4 * i]));
+
+            memmove(buffer, chunk, chunksize);
+            *data = buffer;
+            *size = chunksize;
+            buffer = nullptr;
+            result = true;
+         }
+      }
+      free(buffer);
+   }
+   fclose(fp);
+   errno = olderrno;
+   return result;
+}
+
+/**
+ *    Writes a compiled track to the cache directory, creating the
+ *    directory if needed.  Failing to write the track is not an error;
+ *    the track is simply compiled again the next time.
+ *
+ * \param key
+ *    Provides the key made by midicvt_cache_key().
+ *
+ * \param text
+ *    Provides the text of the track, stored so that midicvt_cache_load()
+ *    can check it.
+ *
+ * \param length
+ *    Provides the length of the text.
+ *
+ * \param context
+ *    Provides the values given to midicvt_cache_key(), also stored.
+ *
+ * \param count
+ *    Provides the number of context values.
+ *
+ * \param state
+ *    Provides the MIDICVT_CACHE_STATE_COUNT state values to store.
+ *
+ * \param lines
+ *    Provides the number of lines from the "MTrk" of this track to that
+ *    of the next one, so that line numbers stay right after it.
+ *
+ * \param data
+ *    Provides the complete MTrk chunk.
+ *
+ * \param size
+ *    Provides the size of the MTrk chunk.
+ *
+ * \return
+ *    Returns true if the track was stored.
+ */
+
+cbool_t
+midicvt_cache_store
+(
+   const char * key,
+   const char * text,
+   unsigned long length,
+   const long * context,
+   int count,
+   const long * state,
+   int lines,
+   const unsigned char * data,
+   unsigned long size
+)
+{
+   cbool_t result = false;
+   char path[CACHE_PATH_SIZE];
+   char temppath[CACHE_PATH_SIZE];
+   char suffix[32];
+   FILE * fp;
+   int olderrno = errno;
+   (void) snprintf(suffix, sizeof suffix, ".tmp%ld", (long) getpid());
+   if (! cache_path(key, ".mtrk", path) || ! cache_path(key, suffix, temppath))
+      return false;
+
+   if (mkdir(midicvt_option_cache(), 0777) != 0 && errno != EEXIST)
+   {
+      errno = olderrno;
+      return false;
+   }
+
+   fp = fopen(temppath, "wb");
+   if (not_nullptr(fp))
+   {
+      unsigned char header[CACHE_HEADER_SIZE];
+      int i;
+      memcpy(header, CACHE_MAGIC, 4);
+      cache_put32(&header[4], MIDICVT_CACHE_VERSION);
+      cache_put32(&header[8], (unsigned long) lines);
+      for (i = 0; i < MIDICVT_CACHE_STATE_COUNT; ++i)
+         cache_put32(&header[12 + 4 * i], (unsigned long) state[i]);
+
+      cache_put32(&header[12 + 4 * i], (unsigned long) count);
+      cache_put32(&header[16 + 4 * i], length);
+      result = fwrite(header, 1, sizeof header, fp) == sizeof header;
+      for (i = 0; result && i < count; ++i)
+      {
+         unsigned char value[4];
+         cache_put32(value, (unsigned long) context[i]);
+         result = fwrite(value, 1, sizeof value, fp) == sizeof value;
+      }
+      result = result &&
+         fwrite(text, 1, length, fp) == length &&
+         fwrite(data, 1, size, fp) == size;
+
+      if (fclose(fp) != 0)
+         result = false;
+
+      if (result)
+         result = rename(temppath, path) == 0;
+
+      if (! result)
+         (void) unlink(temppath);
+   }
+   errno = olderrno;
+   return result;
+}
+
+/*
+ * midicvt_cache.c
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
@@ -24,156 +24,295 @@
  * \file          midicvt_cc.c
  *
  *    This module provides a place to collect the names of MIDI Control
- *    Change (Continuous Controller, CC) for the upcoming --human option.
+ *    Change (Continuous Controller, CC) for the upcoming --human option,
+ *    and the names of the MIDI notes.
  *
  * \library       midicvt application
  * \author        Chris Ahlstrom
  * \date          2016-05-18
- * \updates       2016-05-19
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
- *    This module provides a static/private list of MIDI CC names, and a
- *    function to safely access them.
+ *    This module provides static/private lists of MIDI CC names and note
+ *    names, and functions to safely access them.
+ *
+ *    All of the strings are compile-time constants, stored along with
+ *    their lengths, so that the text, CSV, and JSON writers can copy them
+ *    directly into their output, without formatting a note name or
+ *    calling strlen() for every event.
  */
 
 #include <midicvt_macros.h>            /* nullptr and other stock stuff       */
 #include <midicvt_cc.h>                /* declares these global variables     */
 
+/**
+ *    Holds a constant name along with its length.
+ */
+
+typedef struct
+{
+   /**
+    *    The null-terminated name.
+    */
+
+   const char * name;
+
+   /**
+    *    The length of the name, not counting the terminating null.
+    */
+
+   int length;
+
+} midi_name_t;
+
+/**
+ *    Builds a midi_name_t from a string literal, letting the compiler
+ *    calculate the length.
+ */
+
+#define MIDI_NAME(s)    { s, (int) sizeof(s) - 1 }
+
 /**
  *  Provides the default names of MIDI controllers.
  */
 
-static const char * const s_controller_names[MIDI_VALUE_COUNT] =
+static const midi_name_t s_controller_names[MIDI_VALUE_COUNT] =
 {
-    /*   0 */ "Bank Select",
-    /*   1 */ "Modulation Wheel",
-    /*   2 */ "Breath Controller",
-    /*   3 */ "Undefined",
-    /*   4 */ "Foot Pedal",
-    /*   5 */ "Portamento Time",
-    /*   6 */ "Data Entry",
-    /*   7 */ "Volume",
-    /*   8 */ "Balance",
-    /*   9 */ "Undefined",
-    /*  10 */ "Pan Position",
-    /*  11 */ "Expression",
-    /*  12 */ "Effect Controller 1",
-    /*  13 */ "Effect Controller 2",
-    /*  14 */ "Undefined",
-    /*  15 */ "Undefined",
-    /*  16 */ "General Purpose Slider 1",
-    /*  17 */ "General Purpose Slider 2",
-    /*  18 */ "General Purpose Slider 3",
-    /*  19 */ "General Purpose Slider 4",
-    /*  20 */ "Undefined",
-    /*  21 */ "Undefined",
-    /*  22 */ "Undefined",
-    /*  23 */ "Undefined",
-    /*  24 */ "Undefined",
-    /*  25 */ "Undefined",
-    /*  26 */ "Undefined",
-    /*  27 */ "Undefined",
-    /*  28 */ "Undefined",
-    /*  29 */ "Undefined",
-    /*  30 */ "Undefined",
-    /*  31 */ "Undefined",
-    /*  32 */ "Bank Select (fine)",
-    /*  33 */ "Modulation Wheel (fine)",
-    /*  34 */ "Breath Controller (fine)",
-    /*  35 */ "Undefined Controller (fine)",
-    /*  36 */ "Foot Pedal (fine)",
-    /*  37 */ "Portamento Time (fine)",
-    /*  38 */ "Data Entry (fine)",
-    /*  39 */ "Volume (fine)",
-    /*  40 */ "Balance (fine)",
-    /*  41 */ "Undefined Controller (fine)",
-    /*  42 */ "Pan position (fine)",
-    /*  43 */ "Expression (fine)",
-    /*  44 */ "Effect Control 1 (fine)",
-    /*  45 */ "Effect Control 2 (fine)",
-    /*  46 */ "Undefined Controller (fine)",
-    /*  47 */ "Undefined Controller (fine)",
-    /*  48 */ "General Purpose Slider 1 (fine)",
-    /*  49 */ "General Purpose Slider 2 (fine)",
-    /*  50 */ "General Purpose Slider 3 (fine)",
-    /*  51 */ "General Purpose Slider 4 (fine)",
-    /*  52 */ "Undefined Controller (fine)",
-    /*  53 */ "Undefined Controller (fine)",
-    /*  54 */ "Undefined Controller (fine)",
-    /*  55 */ "Undefined Controller (fine)",
-    /*  56 */ "Undefined Controller (fine)",
-    /*  57 */ "Undefined Controller (fine)",
-    /*  58 */ "Undefined Controller (fine)",
-    /*  59 */ "Undefined Controller (fine)",
-    /*  60 */ "Undefined Controller (fine)",
-    /*  61 */ "Undefined Controller (fine)",
-    /*  62 */ "Undefined Controller (fine)",
-    /*  63 */ "Undefined Controller (fine)",
-    /*  64 */ "Hold Pedal (on/off)",   /* Damper Pedal 0-63=Off, 64-127=on */
-    /*  65 */ "Portamento (on/off)",
-    /*  66 */ "Sustenuto Pedal (on/off)",
-    /*  67 */ "Soft Pedal (on/off)",
-    /*  68 */ "Legato Pedal (on/off)",
-    /*  69 */ "Hold 2 Pedal (on/off)",
-    /*  70 */ "Sound Variation",
-    /*  71 */ "Sound Timbre",
-    /*  72 */ "Sound Release Time",
-    /*  73 */ "Sound Attack Time",
-    /*  74 */ "Sound Brightness",
-    /*  75 */ "Sound Control 6",
-    /*  76 */ "Sound Control 7",
-    /*  77 */ "Sound Control 8",
-    /*  78 */ "Sound Control 9",
-    /*  79 */ "Sound Control 10",
-    /*  80 */ "General Purpose Button 1 (on/off)",
-    /*  81 */ "General Purpose Button 2 (on/off)",
-    /*  82 */ "General Purpose Button 3 (on/off)",
-    /*  83 */ "General Purpose Button 4 (on/off)",
-    /*  84 */ "Portamento CC",
-    /*  85 */ "Undefined",
-    /*  86 */ "Undefined",
-    /*  87 */ "Undefined",
-    /*  88 */ "Undefined",
-    /*  89 */ "Undefined",
-    /*  90 */ "Undefined",
-    /*  91 */ "Reverb Level",
-    /*  92 */ "Tremulo Level",
-    /*  93 */ "Chorus Level",
-    /*  94 */ "Detune Level",
-    /*  95 */ "Phaser Level",
-    /*  96 */ "Data Button Increment",
-    /*  97 */ "Data Button Decrement",
-    /*  98 */ "Non-registered Parameter (fine)",   /* for 6, 38, 96, 97 */
-    /*  99 */ "Non-registered Parameter (coarse)", /* for 6, 38, 96, 97 */
-    /* 100 */ "Registered Parameter (fine)",       /* for 6, 38, 96, 97 */
-    /* 101 */ "Registered Parameter (coarse)",     /* for 6, 38, 96, 97 */
-    /* 102 */ "Undefined",
-    /* 103 */ "Undefined",
-    /* 104 */ "Undefined",
-    /* 105 */ "Undefined",
-    /* 106 */ "Undefined",
-    /* 107 */ "Undefined",
-    /* 108 */ "Undefined",
-    /* 109 */ "Undefined",
-    /* 110 */ "Undefined",
-    /* 111 */ "Undefined",
-    /* 112 */ "Undefined",
-    /* 113 */ "Undefined",
-    /* 114 */ "Undefined",
-    /* 115 */ "Undefined",
-    /* 116 */ "Undefined",
-    /* 117 */ "Undefined",
-    /* 118 */ "Undefined",
-    /* 119 */ "Undefined",
-    /* 120 */ "All Sound Off",
-    /* 121 */ "All Controllers Off",
-    /* 122 */ "Local Keyboard (on/off)",
-    /* 123 */ "All Notes Off",
-    /* 124 */ "Omni Mode Off",
-    /* 125 */ "Omni Mode On",
-    /* 126 */ "Mono Operation",
-    /* 127 */ "Poly Operation"
+    /*   0 */ MIDI_NAME("Bank Select"),
+    /*   1 */ MIDI_NAME("Modulation Wheel"),
+    /*   2 */ MIDI_NAME("Breath Controller"),
+    /*   3 */ MIDI_NAME("Undefined"),
+    /*   4 */ MIDI_NAME("Foot Pedal"),
+    /*   5 */ MIDI_NAME("Portamento Time"),
+    /*   6 */ MIDI_NAME("Data Entry"),
+    /*   7 */ MIDI_NAME("Volume"),
+    /*   8 */ MIDI_NAME("Balance"),
+    /*   9 */ MIDI_NAME("Undefined"),
+    /*  10 */ MIDI_NAME("Pan Position"),
+    /*  11 */ MIDI_NAME("Expression"),
+    /*  12 */ MIDI_NAME("Effect Controller 1"),
+    /*  13 */ MIDI_NAME("Effect Controller 2"),
+    /*  14 */ MIDI_NAME("Undefined"),
+    /*  15 */ MIDI_NAME("Undefined"),
+    /*  16 */ MIDI_NAME("General Purpose Slider 1"),
+    /*  17 */ MIDI_NAME("General Purpose Slider 2"),
+    /*  18 */ MIDI_NAME("General Purpose Slider 3"),
+    /*  19 */ MIDI_NAME("General Purpose Slider 4"),
+    /*  20 */ MIDI_NAME("Undefined"),
+    /*  21 */ MIDI_NAME("Undefined"),
+    /*  22 */ MIDI_NAME("Undefined"),
+    /*  23 */ MIDI_NAME("Undefined"),
+    /*  24 */ MIDI_NAME("Undefined"),
+    /*  25 */ MIDI_NAME("Undefined"),
+    /*  26 */ MIDI_NAME("Undefined"),
+    /*  27 */ MIDI_NAME("Undefined"),
+    /*  28 */ MIDI_NAME("Undefined"),
+    /*  29 */ MIDI_NAME("Undefined"),
+    /*  30 */ MIDI_NAME("Undefined"),
+    /*  31 */ MIDI_NAME("Undefined"),
+    /*  32 */ MIDI_NAME("Bank Select (fine)"),
+    /*  33 */ MIDI_NAME("Modulation Wheel (fine)"),
+    /*  34 */ MIDI_NAME("Breath Controller (fine)"),
+    /*  35 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  36 */ MIDI_NAME("Foot Pedal (fine)"),
+    /*  37 */ MIDI_NAME("Portamento Time (fine)"),
+    /*  38 */ MIDI_NAME("Data Entry (fine)"),
+    /*  39 */ MIDI_NAME("Volume (fine)"),
+    /*  40 */ MIDI_NAME("Balance (fine)"),
+    /*  41 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  42 */ MIDI_NAME("Pan position (fine)"),
+    /*  43 */ MIDI_NAME("Expression (fine)"),
+    /*  44 */ MIDI_NAME("Effect Control 1 (fine)"),
+    /*  45 */ MIDI_NAME("Effect Control 2 (fine)"),
+    /*  46 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  47 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  48 */ MIDI_NAME("General Purpose Slider 1 (fine)"),
+    /*  49 */ MIDI_NAME("General Purpose Slider 2 (fine)"),
+    /*  50 */ MIDI_NAME("General Purpose Slider 3 (fine)"),
+    /*  51 */ MIDI_NAME("General Purpose Slider 4 (fine)"),
+    /*  52 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  53 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  54 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  55 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  56 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  57 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  58 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  59 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  60 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  61 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  62 */ MIDI_NAME("Undefined Controller (fine)"),
+    /*  63 */ MIDI_NAME("Undefined Controller (fine)"),
+    /* Damper Pedal 0-63=Off, 64-127=on */
+    /*  64 */ MIDI_NAME("Hold Pedal (on/off)"),
+    /*  65 */ MIDI_NAME("Portamento (on/off)"),
+    /*  66 */ MIDI_NAME("Sustenuto Pedal (on/off)"),
+    /*  67 */ MIDI_NAME("Soft Pedal (on/off)"),
+    /*  68 */ MIDI_NAME("Legato Pedal (on/off)"),
+    /*  69 */ MIDI_NAME("Hold 2 Pedal (on/off)"),
+    /*  70 */ MIDI_NAME("Sound Variation"),
+    /*  71 */ MIDI_NAME("Sound Timbre"),
+    /*  72 */ MIDI_NAME("Sound Release Time"),
+    /*  73 */ MIDI_NAME("Sound Attack Time"),
+    /*  74 */ MIDI_NAME("Sound Brightness"),
+    /*  75 */ MIDI_NAME("Sound Control 6"),
+    /*  76 */ MIDI_NAME("Sound Control 7"),
+    /*  77 */ MIDI_NAME("Sound Control 8"),
+    /*  78 */ MIDI_NAME("Sound Control 9"),
+    /*  79 */ MIDI_NAME("Sound Control 10"),
+    /*  80 */ MIDI_NAME("General Purpose Button 1 (on/off)"),
+    /*  81 */ MIDI_NAME("General Purpose Button 2 (on/off)"),
+    /*  82 */ MIDI_NAME("General Purpose Button 3 (on/off)"),
+    /*  83 */ MIDI_NAME("General Purpose Button 4 (on/off)"),
+    /*  84 */ MIDI_NAME("Portamento CC"),
+    /*  85 */ MIDI_NAME("Undefined"),
+    /*  86 */ MIDI_NAME("Undefined"),
+    /*  87 */ MIDI_NAME("Undefined"),
+    /*  88 */ MIDI_NAME("Undefined"),
+    /*  89 */ MIDI_NAME("Undefined"),
+    /*  90 */ MIDI_NAME("Undefined"),
+    /*  91 */ MIDI_NAME("Reverb Level"),
+    /*  92 */ MIDI_NAME("Tremulo Level"),
+    /*  93 */ MIDI_NAME("Chorus Level"),
+    /*  94 */ MIDI_NAME("Detune Level"),
+    /*  95 */ MIDI_NAME("Phaser Level"),
+    /*  96 */ MIDI_NAME("Data Button Increment"),
+    /*  97 */ MIDI_NAME("Data Button Decrement"),
+    /* 98 to 101 are for 6, 38, 96, 97 */
+    /*  98 */ MIDI_NAME("Non-registered Parameter (fine)"),
+    /*  99 */ MIDI_NAME("Non-registered Parameter (coarse)"),
+    /* 100 */ MIDI_NAME("Registered Parameter (fine)"),
+    /* 101 */ MIDI_NAME("Registered Parameter (coarse)"),
+    /* 102 */ MIDI_NAME("Undefined"),
+    /* 103 */ MIDI_NAME("Undefined"),
+    /* 104 */ MIDI_NAME("Undefined"),
+    /* 105 */ MIDI_NAME("Undefined"),
+    /* 106 */ MIDI_NAME("Undefined"),
+    /* 107 */ MIDI_NAME("Undefined"),
+    /* 108 */ MIDI_NAME("Undefined"),
+    /* 109 */ MIDI_NAME("Undefined"),
+    /* 110 */ MIDI_NAME("Undefined"),
+    /* 111 */ MIDI_NAME("Undefined"),
+    /* 112 */ MIDI_NAME("Undefined"),
+    /* 113 */ MIDI_NAME("Undefined"),
+    /* 114 */ MIDI_NAME("Undefined"),
+    /* 115 */ MIDI_NAME("Undefined"),
+    /* 116 */ MIDI_NAME("Undefined"),
+    /* 117 */ MIDI_NAME("Undefined"),
+    /* 118 */ MIDI_NAME("Undefined"),
+    /* 119 */ MIDI_NAME("Undefined"),
+    /* 120 */ MIDI_NAME("All Sound Off"),
+    /* 121 */ MIDI_NAME("All Controllers Off"),
+    /* 122 */ MIDI_NAME("Local Keyboard (on/off)"),
+    /* 123 */ MIDI_NAME("All Notes Off"),
+    /* 124 */ MIDI_NAME("Omni Mode Off"),
+    /* 125 */ MIDI_NAME("Omni Mode On"),
+    /* 126 */ MIDI_NAME("Mono Operation"),
+    /* 127 */ MIDI_NAME("Poly Operation")
+};
+
+/**
+ *    Provides the names of the MIDI notes, as written by the --note
+ *    option:  the note letter, a '#' for sharps, and the octave, which is
+ *    the note number divided by 12.  Middle C (60) is "c5".
+ */
+
+static const midi_name_t s_note_names[MIDI_VALUE_COUNT] =
+{
+    /* 0 to 11 */
+    MIDI_NAME("c0"), MIDI_NAME("c#0"), MIDI_NAME("d0"), MIDI_NAME("d#0"),
+    MIDI_NAME("e0"), MIDI_NAME("f0"), MIDI_NAME("f#0"), MIDI_NAME("g0"),
+    MIDI_NAME("g#0"), MIDI_NAME("a0"), MIDI_NAME("a#0"), MIDI_NAME("b0"),
+
+    /* 12 to 23 */
+    MIDI_NAME("c1"), MIDI_NAME("c#1"), MIDI_NAME("d1"), MIDI_NAME("d#1"),
+    MIDI_NAME("e1"), MIDI_NAME("f1"), MIDI_NAME("f#1"), MIDI_NAME("g1"),
+    MIDI_NAME("g#1"), MIDI_NAME("a1"), MIDI_NAME("a#1"), MIDI_NAME("b1"),
+
+    /* 24 to 35 */
+    MIDI_NAME("c2"), MIDI_NAME("c#2"), MIDI_NAME("d2"), MIDI_NAME("d#2"),
+    MIDI_NAME("e2"), MIDI_NAME("f2"), MIDI_NAME("f#2"), MIDI_NAME("g2"),
+    MIDI_NAME("g#2"), MIDI_NAME("a2"), MIDI_NAME("a#2"), MIDI_NAME("b2"),
+
+    /* 36 to 47 */
+    MIDI_NAME("c3"), MIDI_NAME("c#3"), MIDI_NAME("d3"), MIDI_NAME("d#3"),
+    MIDI_NAME("e3"), MIDI_NAME("f3"), MIDI_NAME("f#3"), MIDI_NAME("g3"),
+    MIDI_NAME("g#3"), MIDI_NAME("a3"), MIDI_NAME("a#3"), MIDI_NAME("b3"),
+
+    /* 48 to 59 */
+    MIDI_NAME("c4"), MIDI_NAME("c#4"), MIDI_NAME("d4"), MIDI_NAME("d#4"),
+    MIDI_NAME("e4"), MIDI_NAME("f4"), MIDI_NAME("f#4"), MIDI_NAME("g4"),
+    MIDI_NAME("g#4"), MIDI_NAME("a4"), MIDI_NAME("a#4"), MIDI_NAME("b4"),
+
+    /* 60 to 71 */
+    MIDI_NAME("c5"), MIDI_NAME("c#5"), MIDI_NAME("d5"), MIDI_NAME("d#5"),
+    MIDI_NAME("e5"), MIDI_NAME("f5"), MIDI_NAME("f#5"), MIDI_NAME("g5"),
+    MIDI_NAME("g#5"), MIDI_NAME("a5"), MIDI_NAME("a#5"), MIDI_NAME("b5"),
+
+    /* 72 to 83 */
+    MIDI_NAME("c6"), MIDI_NAME("c#6"), MIDI_NAME("d6"), MIDI_NAME("d#6"),
+    MIDI_NAME("e6"), MIDI_NAME("f6"), MIDI_NAME("f#6"), MIDI_NAME("g6"),
+    MIDI_NAME("g#6"), MIDI_NAME("a6"), MIDI_NAME("a#6"), MIDI_NAME("b6"),
+
+    /* 84 to 95 */
+    MIDI_NAME("c7"), MIDI_NAME("c#7"), MIDI_NAME("d7"), MIDI_NAME("d#7"),
+    MIDI_NAME("e7"), MIDI_NAME("f7"), MIDI_NAME("f#7"), MIDI_NAME("g7"),
+    MIDI_NAME("g#7"), MIDI_NAME("a7"), MIDI_NAME("a#7"), MIDI_NAME("b7"),
+
+    /* 96 to 107 */
+    MIDI_NAME("c8"), MIDI_NAME("c#8"), MIDI_NAME("d8"), MIDI_NAME("d#8"),
+    MIDI_NAME("e8"), MIDI_NAME("f8"), MIDI_NAME("f#8"), MIDI_NAME("g8"),
+    MIDI_NAME("g#8"), MIDI_NAME("a8"), MIDI_NAME("a#8"), MIDI_NAME("b8"),
+
+    /* 108 to 119 */
+    MIDI_NAME("c9"), MIDI_NAME("c#9"), MIDI_NAME("d9"), MIDI_NAME("d#9"),
+    MIDI_NAME("e9"), MIDI_NAME("f9"), MIDI_NAME("f#9"), MIDI_NAME("g9"),
+    MIDI_NAME("g#9"), MIDI_NAME("a9"), MIDI_NAME("a#9"), MIDI_NAME("b9"),
+
+    /* 120 to 127 */
+    MIDI_NAME("c10"), MIDI_NAME("c#10"), MIDI_NAME("d10"), MIDI_NAME("d#10"),
+    MIDI_NAME("e10"), MIDI_NAME("f10"), MIDI_NAME("f#10"), MIDI_NAME("g10")
+};
+
+/**
+ *    Provides the MIDI note numbers as decimal strings, as written when
+ *    the --note option is not in force.
+ */
+
+static const midi_name_t s_note_numbers[MIDI_VALUE_COUNT] =
+{
+    MIDI_NAME("0"), MIDI_NAME("1"), MIDI_NAME("2"), MIDI_NAME("3"),
+    MIDI_NAME("4"), MIDI_NAME("5"), MIDI_NAME("6"), MIDI_NAME("7"),
+    MIDI_NAME("8"), MIDI_NAME("9"), MIDI_NAME("10"), MIDI_NAME("11"),
+    MIDI_NAME("12"), MIDI_NAME("13"), MIDI_NAME("14"), MIDI_NAME("15"),
+    MIDI_NAME("16"), MIDI_NAME("17"), MIDI_NAME("18"), MIDI_NAME("19"),
+    MIDI_NAME("20"), MIDI_NAME("21"), MIDI_NAME("22"), MIDI_NAME("23"),
+    MIDI_NAME("24"), MIDI_NAME("25"), MIDI_NAME("26"), MIDI_NAME("27"),
+    MIDI_NAME("28"), MIDI_NAME("29"), MIDI_NAME("30"), MIDI_NAME("31"),
+    MIDI_NAME("32"), MIDI_NAME("33"), MIDI_NAME("34"), MIDI_NAME("35"),
+    MIDI_NAME("36"), MIDI_NAME("37"), MIDI_NAME("38"), MIDI_NAME("39"),
+    MIDI_NAME("40"), MIDI_NAME("41"), MIDI_NAME("42"), MIDI_NAME("43"),
+    MIDI_NAME("44"), MIDI_NAME("45"), MIDI_NAME("46"), MIDI_NAME("47"),
+    MIDI_NAME("48"), MIDI_NAME("49"), MIDI_NAME("50"), MIDI_NAME("51"),
+    MIDI_NAME("52"), MIDI_NAME("53"), MIDI_NAME("54"), MIDI_NAME("55"),
+    MIDI_NAME("56"), MIDI_NAME("57"), MIDI_NAME("58"), MIDI_NAME("59"),
+    MIDI_NAME("60"), MIDI_NAME("61"), MIDI_NAME("62"), MIDI_NAME("63"),
+    MIDI_NAME("64"), MIDI_NAME("65"), MIDI_NAME("66"), MIDI_NAME("67"),
+    MIDI_NAME("68"), MIDI_NAME("69"), MIDI_NAME("70"), MIDI_NAME("71"),
+    MIDI_NAME("72"), MIDI_NAME("73"), MIDI_NAME("74"), MIDI_NAME("75"),
+    MIDI_NAME("76"), MIDI_NAME("77"), MIDI_NAME("78"), MIDI_NAME("79"),
+    MIDI_NAME("80"), MIDI_NAME("81"), MIDI_NAME("82"), MIDI_NAME("83"),
+    MIDI_NAME("84"), MIDI_NAME("85"), MIDI_NAME("86"), MIDI_NAME("87"),
+    MIDI_NAME("88"), MIDI_NAME("89"), MIDI_NAME("90"), MIDI_NAME("91"),
+    MIDI_NAME("92"), MIDI_NAME("93"), MIDI_NAME("94"), MIDI_NAME("95"),
+    MIDI_NAME("96"), MIDI_NAME("97"), MIDI_NAME("98"), MIDI_NAME("99"),
+    MIDI_NAME("100"), MIDI_NAME("101"), MIDI_NAME("102"), MIDI_NAME("103"),
+    MIDI_NAME("104"), MIDI_NAME("105"), MIDI_NAME("106"), MIDI_NAME("107"),
+    MIDI_NAME("108"), MIDI_NAME("109"), MIDI_NAME("110"), MIDI_NAME("111"),
+    MIDI_NAME("112"), MIDI_NAME("113"), MIDI_NAME("114"), MIDI_NAME("115"),
+    MIDI_NAME("116"), MIDI_NAME("117"), MIDI_NAME("118"), MIDI_NAME("119"),
+    MIDI_NAME("120"), MIDI_NAME("121"), MIDI_NAME("122"), MIDI_NAME("123"),
+    MIDI_NAME("124"), MIDI_NAME("125"), MIDI_NAME("126"), MIDI_NAME("127")
 };
 
 /**
@@ -193,7 +332,67 @@ midi_controller_name (int cc)
 {
    const char * result = nullptr;
    if (cc >= 0 && cc < MIDI_VALUE_COUNT)
-      result = s_controller_names[cc];
+      result = s_controller_names[cc].name;
+
+   return result;
+}
+
+/**
+ *    Provides the length of a controller name.
+ *
+ * \param cc
+ *    The putative MIDI CC value, which is validated before usage.
+ *
+ * \return
+ *    Returns the length of the name returned by midi_controller_name(),
+ *    or 0 if the \a cc parameter is not valid.
+ */
+
+int
+midi_controller_name_length (int cc)
+{
+   int result = 0;
+   if (cc >= 0 && cc < MIDI_VALUE_COUNT)
+      result = s_controller_names[cc].length;
+
+   return result;
+}
+
+/**
+ *    Provides safe access to the s_note_names and s_note_numbers strings.
+ *
+ * \param note
+ *    The putative MIDI note value, which is validated before usage.
+ *
+ * \param letters
+ *    If true, the note name (e.g. "c#5") is wanted.  Otherwise, the note
+ *    number in decimal (e.g. "61") is wanted.
+ *
+ * \param length
+ *    If not null, the length of the string is stored here.  It is set to
+ *    0 if the \a note parameter is not valid.
+ *
+ * \return
+ *    Returns a pointer to the desired string if the \a note parameter is
+ *    valid.  Otherwise, an empty string is returned, so that the result
+ *    can always be written.
+ */
+
+const char *
+midi_note_name (int note, cbool_t letters, int * length)
+{
+   const char * result = "";
+   int count = 0;
+   if (note >= 0 && note < MIDI_VALUE_COUNT)
+   {
+      const midi_name_t * n = letters ?
+         &s_note_names[note] : &s_note_numbers[note] ;
+
+      result = n->name;
+      count = n->length;
+   }
+   if (not_nullptr(length))
+      *length = count;
 
    return result;
 }
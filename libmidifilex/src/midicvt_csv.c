@@ -0,0 +1,686 @@
+/*
+ * midicvt - A text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midicvt_csv.c
+ *
+ *    This module provides functions for writing MIDI events as rows of
+ *    comma-separated (--csv) or tab-separated (--tsv) values.
+ *
+ * \library       midicvt application
+ * \author        Chris Ahlstrom and many other authors
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    The normal MIDI-to-text output is meant for humans and for the
+ *    --compile option.  It is awkward to load into a spreadsheet or a
+ *    database.  The callbacks in this module write one row per event,
+ *    with a fixed set of columns:
+ *
+\verbatim
+      file,track,abs_tick,seconds,status,channel,data1,data2,meta_type,payload_hex
+\endverbatim
+ *
+ *       -  <b>file</b>.  The name of the input file, as given on the
+ *          command line ("stdin" if none).
+ *       -  <b>track</b>.  The track number, starting at 0.
+ *       -  <b>abs_tick</b>.  The absolute time of the event in ticks,
+ *          from the start of the track.
+ *       -  <b>seconds</b>.  The absolute time of the event in seconds,
+ *          calculated from the tempo changes seen so far (see below), with
+ *          microsecond resolution.
+ *       -  <b>status</b>.  The status byte of the event, in decimal.
+ *          Channel events include the channel nybble (e.g. 144 for a
+ *          Note On on channel 1), meta events are 255, SysEx events are
+ *          240, and escaped (F7) events are 247.
+ *       -  <b>channel</b>.  The channel number, 1 to 16, for channel
+ *          events, matching the "ch=" value of the text output.  Empty
+ *          otherwise.
+ *       -  <b>data1</b>, <b>data2</b>.  The data bytes of a channel event.
+ *          Empty if the event does not have them.
+ *       -  <b>meta_type</b>.  The meta-event type byte (e.g. 81 for
+ *          Tempo).  Empty for non-meta events.
+ *       -  <b>payload_hex</b>.  The raw data bytes of meta, SysEx, and
+ *          escaped events, as lower-case hexadecimal with no separators.
+ *
+ *    All numbers are written in decimal, without padding, so that they
+ *    can be loaded directly into integer columns.
+ *
+ *    The rows are built directly in the buffer of a midicvt_writer_t,
+ *    without any printf() formatting, and the buffer is handed to fwrite()
+ *    only when it fills up.  For a large collection of MIDI files, the
+ *    conversion is then limited by the disk, not by the formatting.  The
+ *    Mf_* callbacks are the common ones of midicvt_writer.c.
+ *
+ * Seconds:
+ *
+ *    In an SMF 1 file, the tempo events are normally all in the first
+ *    track, which is read before the other tracks.  Each tempo event is
+ *    added to a small tempo map, kept in order of ticks, along with the
+ *    elapsed time at that tick.  The time of an event is then the time of
+ *    the last tempo change at or before it, plus the remaining ticks at
+ *    that tempo.  In an SMF 2 file, each track is independent, so the
+ *    tempo map is cleared at the start of each track.  For SMPTE
+ *    divisions, the tempo is not used at all.
+ */
+
+#include <stdio.h>                     /* FILE *, fprintf()                   */
+#include <stdlib.h>                    /* atexit(), exit(), realloc(), free() */
+#include <string.h>                    /* strlen(), memmove()                 */
+
+#include <midicvt_macros.h>            /* nullptr, true, false, etc.          */
+#include <midicvt_csv.h>               /* this module's functions and stuff   */
+#include <midicvt_globals.h>           /* g_io_file, g_redirect_file, etc.    */
+#include <midicvt_helpers.h>           /* midicvt_input_file()                */
+#include <midicvt_writer.h>            /* midicvt_writer_t, callbacks         */
+#include <midifilex.h>                 /* routines that read/write MIDI data  */
+
+/**
+ *    Provides the room we require in the output buffer before starting
+ *    the fixed part of a row:  the numeric columns and separators.  The
+ *    file name and the payload are checked separately, since they have no
+ *    fixed size.
+ */
+
+#define CSV_ROW_RESERVE             128
+
+/**
+ *    Provides the tempo that applies until the first Tempo event:  500000
+ *    microseconds per quarter note, or 120 beats per minute.
+ */
+
+#define CSV_DEFAULT_TEMPO           500000L
+
+/**
+ *    Provides the number of tempo-map entries added each time the tempo
+ *    map must grow.
+ */
+
+#define CSV_TEMPO_CHUNK             64
+
+/**
+ *    Holds one entry in the tempo map.
+ */
+
+typedef struct
+{
+   /**
+    *    The tick at which the tempo changes.
+    */
+
+   long tick;
+
+   /**
+    *    The tempo, in microseconds per quarter note.
+    */
+
+   long tempo;
+
+   /**
+    *    The elapsed time at this tick, in microseconds.
+    */
+
+   double usec;
+
+} csv_tempo_t;
+
+/**
+ *    Holds the rows until they are written to g_redirect_file.
+ */
+
+static midicvt_writer_t gs_csv_writer;
+
+/**
+ *    Provides the column separator, either a comma or a tab.
+ */
+
+static char gs_csv_separator = ',';
+
+/**
+ *    Holds the input file name, already quoted or cleaned up as needed by
+ *    the separator, so that it can simply be copied into every row.
+ */
+
+static char * gs_csv_file = nullptr;
+
+/**
+ *    Provides the length of gs_csv_file, so that it need not be
+ *    recalculated for every row.
+ */
+
+static size_t gs_csv_file_length = 0;
+
+/**
+ *    Provides the current track number, starting at 0.
+ */
+
+static int gs_csv_track = -1;
+
+/**
+ *    Holds the SMF format (0, 1, or 2), from the header.
+ */
+
+static int gs_csv_format = 1;
+
+/**
+ *    Holds the division (PPQN or SMPTE), from the header.
+ */
+
+static int gs_csv_division = 0;
+
+/**
+ *    Holds the tempo map.  The first entry is always the default tempo
+ *    at tick 0.
+ */
+
+static csv_tempo_t * gs_csv_tempos = nullptr;
+
+/**
+ *    Provides the number of used entries in gs_csv_tempos.
+ */
+
+static int gs_csv_tempo_count = 0;
+
+/**
+ *    Provides the number of allocated entries in gs_csv_tempos.
+ */
+
+static int gs_csv_tempo_size = 0;
+
+/**
+ *    Provides the tempo-map index to start searching from.  Events in a
+ *    track arrive in increasing time order, so the search only moves
+ *    forward, and is reset at the start of each track.
+ */
+
+static int gs_csv_tempo_cursor = 0;
+
+/**
+ *    Sets up gs_csv_file from the input file name.  For CSV, the name is
+ *    enclosed in double quotes if it contains a comma, a double quote, or
+ *    a line ending, and any double quotes are doubled, as per RFC 4180.
+ *    TSV has no quoting convention, so any tabs or line endings are
+ *    replaced with spaces.
+ *
+ * \return
+ *    Returns true if the name could be allocated.
+ */
+
+static cbool_t
+csv_make_file_column (void)
+{
+   const char * name = midicvt_input_file();
+   size_t length = strlen(name);
+   cbool_t quote = false;
+   size_t i;
+   char * dest;
+   if (gs_csv_separator == ',')
+   {
+      for (i = 0; i < length; ++i)
+      {
+         char c = name[i];
+         if (c == ',' || c == '"' || c == '\n' || c == '\r')
+         {
+            quote = true;
+            break;
+         }
+      }
+   }
+   if (not_nullptr(gs_csv_file))
+      free(gs_csv_file);
+
+   gs_csv_file = malloc(2 * length + 3);
+   if (is_nullptr(gs_csv_file))
+   {
+      gs_csv_file_length = 0;
+      return false;
+   }
+   dest = gs_csv_file;
+   if (quote)
+      *dest++ = '"';
+
+   for (i = 0; i < length; ++i)
+   {
+      char c = name[i];
+      if (quote && c == '"')
+         *dest++ = '"';
+      else if (gs_csv_separator != ',')
+      {
+         if (c == '\t' || c == '\n' || c == '\r')
+            c = ' ';
+      }
+      *dest++ = c;
+   }
+   if (quote)
+      *dest++ = '"';
+
+   *dest = 0;
+   gs_csv_file_length = (size_t) (dest - gs_csv_file);
+   return true;
+}
+
+/**
+ *    Empties the tempo map, leaving only the default tempo at tick 0.
+ */
+
+static void
+csv_tempo_reset (void)
+{
+   gs_csv_tempo_count = 0;
+   gs_csv_tempo_cursor = 0;
+   if (gs_csv_tempo_size > 0)
+   {
+      gs_csv_tempos[0].tick = 0;
+      gs_csv_tempos[0].tempo = CSV_DEFAULT_TEMPO;
+      gs_csv_tempos[0].usec = 0.0;
+      gs_csv_tempo_count = 1;
+   }
+}
+
+/**
+ *    Calculates the number of microseconds between two ticks at a given
+ *    tempo.
+ *
+ * \param ticks
+ *    Provides the number of ticks.
+ *
+ * \param tempo
+ *    Provides the tempo, in microseconds per quarter note.  Not used for
+ *    SMPTE divisions.
+ *
+ * \return
+ *    Returns the duration, in microseconds.
+ */
+
+static double
+csv_ticks_to_usec (long ticks, long tempo)
+{
+   if (gs_csv_division & 0x8000)                   /* SMPTE                   */
+   {
+      int fps = (-(gs_csv_division >> 8)) & 0xff;
+      int resolution = gs_csv_division & 0xff;
+      if (fps > 0 && resolution > 0)
+         return (double) ticks * 1000000.0 / ((double) fps * resolution);
+      else
+         return 0.0;
+   }
+   else if (gs_csv_division > 0)
+      return (double) ticks * (double) tempo / (double) gs_csv_division;
+   else
+      return 0.0;
+}
+
+/**
+ *    Adds a tempo change to the tempo map, keeping the map in tick order.
+ *    A change at the same tick as an existing entry replaces that entry.
+ *    The elapsed time of the new entry and of every later entry is then
+ *    recalculated.
+ *
+ * \param tick
+ *    Provides the tick at which the tempo changes.
+ *
+ * \param tempo
+ *    Provides the new tempo, in microseconds per quarter note.
+ */
+
+static void
+csv_tempo_add (long tick, long tempo)
+{
+   int index;
+   if (gs_csv_tempo_count == gs_csv_tempo_size)
+   {
+      int newsize = gs_csv_tempo_size + CSV_TEMPO_CHUNK;
+      csv_tempo_t * t = realloc
+      (
+         gs_csv_tempos, (size_t) newsize * sizeof(csv_tempo_t)
+      );
+      if (is_nullptr(t))
+      {
+         errprint("csv_tempo_add(): out of memory for the tempo map");
+         return;
+      }
+      gs_csv_tempos = t;
+      gs_csv_tempo_size = newsize;
+      if (gs_csv_tempo_count == 0)
+         csv_tempo_reset();
+   }
+   index = gs_csv_tempo_count;
+   while (index > 0 && gs_csv_tempos[index - 1].tick > tick)
+      --index;
+
+   if (index > 0 && gs_csv_tempos[index - 1].tick == tick)
+      gs_csv_tempos[index - 1].tempo = tempo;
+   else
+   {
+      memmove
+      (
+         &gs_csv_tempos[index + 1], &gs_csv_tempos[index],
+         (size_t) (gs_csv_tempo_count - index) * sizeof(csv_tempo_t)
+      );
+      gs_csv_tempos[index].tick = tick;
+      gs_csv_tempos[index].tempo = tempo;
+      ++gs_csv_tempo_count;
+   }
+   for ( ; index < gs_csv_tempo_count; ++index)
+   {
+      csv_tempo_t * prev = &gs_csv_tempos[index - 1];
+      gs_csv_tempos[index].usec = prev->usec +
+         csv_ticks_to_usec(gs_csv_tempos[index].tick - prev->tick, prev->tempo);
+   }
+   if (gs_csv_tempo_cursor >= gs_csv_tempo_count)
+      gs_csv_tempo_cursor = gs_csv_tempo_count - 1;
+}
+
+/**
+ *    Calculates the elapsed time at the current tick, Mf_currtime.
+ *
+ * \return
+ *    Returns the time, in microseconds, rounded to the nearest
+ *    microsecond.
+ */
+
+static unsigned long
+csv_current_usec (void)
+{
+   double usec;
+   if (gs_csv_tempo_count > 0)
+   {
+      const csv_tempo_t * t;
+      if (gs_csv_tempos[gs_csv_tempo_cursor].tick > Mf_currtime)
+         gs_csv_tempo_cursor = 0;
+
+      while
+      (
+         gs_csv_tempo_cursor + 1 < gs_csv_tempo_count &&
+         gs_csv_tempos[gs_csv_tempo_cursor + 1].tick <= Mf_currtime
+      )
+      {
+         ++gs_csv_tempo_cursor;
+      }
+      t = &gs_csv_tempos[gs_csv_tempo_cursor];
+      usec = t->usec + csv_ticks_to_usec(Mf_currtime - t->tick, t->tempo);
+   }
+   else
+      usec = csv_ticks_to_usec(Mf_currtime, CSV_DEFAULT_TEMPO);
+
+   return (unsigned long) (usec + 0.5);
+}
+
+/**
+ *    Appends a column separator.  The caller must have reserved the room
+ *    already.
+ */
+
+static void
+csv_sep (void)
+{
+   midicvt_writer_putc(&gs_csv_writer, gs_csv_separator);
+}
+
+/**
+ *    Writes the columns common to every row:  file, track, abs_tick,
+ *    seconds, and status, each followed by a separator.
+ *
+ * \param status
+ *    Provides the status byte of the event.
+ */
+
+static void
+csv_row_start (int status)
+{
+   unsigned long usec = csv_current_usec();
+   unsigned long fraction = usec % 1000000UL;
+   unsigned long divisor;
+   midicvt_writer_t * w = &gs_csv_writer;
+   midicvt_writer_putn(w, gs_csv_file, gs_csv_file_length);
+   midicvt_writer_reserve(w, CSV_ROW_RESERVE);
+   csv_sep();
+   midicvt_writer_putu(w, (unsigned long) gs_csv_track);
+   csv_sep();
+   midicvt_writer_putu(w, (unsigned long) Mf_currtime);
+   csv_sep();
+   midicvt_writer_putu(w, usec / 1000000UL);
+   midicvt_writer_putc(w, '.');
+   for (divisor = 100000UL; divisor > 0; divisor /= 10)
+      midicvt_writer_putc(w, (char) ('0' + (fraction / divisor) % 10));
+
+   csv_sep();
+   midicvt_writer_putu(w, (unsigned long) status);
+   csv_sep();
+}
+
+/**
+ *    Writes a complete row for a channel event.
+ *
+ * \param status
+ *    Provides the event nybble (e.g. note_on).
+ *
+ * \param chan
+ *    Provides the channel, 0 to 15.
+ *
+ * \param d1
+ *    Provides the first data byte.
+ *
+ * \param d2
+ *    Provides the second data byte, or -1 if the event has only one.
+ */
+
+static void
+csv_channel_row (int status, int chan, int d1, int d2)
+{
+   midicvt_writer_t * w = &gs_csv_writer;
+   csv_row_start(status | chan);
+   midicvt_writer_putu(w, (unsigned long) (chan + 1));
+   csv_sep();
+   midicvt_writer_putu(w, (unsigned long) d1);
+   csv_sep();
+   if (d2 >= 0)
+      midicvt_writer_putu(w, (unsigned long) d2);
+
+   csv_sep();                          /* empty meta_type                     */
+   csv_sep();                          /* empty payload_hex                   */
+   midicvt_writer_putc(w, '\n');
+}
+
+/**
+ *    Writes a complete row for a meta, SysEx, or escaped event.  The
+ *    new tempo of a Tempo event is added to the tempo map after its row
+ *    is written, so that it applies only to the events that follow.
+ *
+ * \param status
+ *    Provides the status byte, 0xff, 0xf0, or 0xf7.
+ *
+ * \param type
+ *    Provides the meta-event type, or -1 for SysEx and escaped events.
+ *
+ * \param p
+ *    Provides the payload bytes.
+ *
+ * \param leng
+ *    Provides the number of payload bytes.
+ */
+
+static void
+csv_data_row (int status, int type, const unsigned char * p, int leng)
+{
+   midicvt_writer_t * w = &gs_csv_writer;
+   csv_row_start(status);
+   csv_sep();                          /* empty channel                       */
+   csv_sep();                          /* empty data1                         */
+   csv_sep();                          /* empty data2                         */
+   if (type >= 0)
+      midicvt_writer_putu(w, (unsigned long) type);
+
+   csv_sep();
+   midicvt_writer_puthex(w, p, leng);
+   midicvt_writer_reserve(w, 1);
+   midicvt_writer_putc(w, '\n');
+   if (status == meta_event && type == set_tempo && leng == 3)
+   {
+      long tempo = ((long) p[0] << 16) | ((long) p[1] << 8) | (long) p[2];
+      csv_tempo_add(Mf_currtime, tempo);
+   }
+}
+
+/**
+ *    Callback function implementing Mf_header().  Writes the header row
+ *    and saves the format and division for the time calculations.
+ *
+ * \param format
+ *    Provides the format (0, 1, or 2) of the MIDI file.
+ *
+ * \param ntrks
+ *    Provides the number of tracks in the MIDI file.
+ *
+ * \param division
+ *    Provides the time-division value.
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+static int
+csv_header (int format, int ntrks, int division)
+{
+   static const char * const s_columns [] =
+   {
+      "file", "track", "abs_tick", "seconds", "status", "channel",
+      "data1", "data2", "meta_type", "payload_hex"
+   };
+   int c;
+   if (format < 0 || format > 2)
+   {
+      fprintf(stderr, "Can't deal with format %d or missing files\n", format);
+      exit(1);
+   }
+   gs_csv_format = format;
+   gs_csv_division = division;
+   g_status_tracks_to_do = ntrks;
+   for (c = 0; c < (int) (sizeof(s_columns) / sizeof(s_columns[0])); ++c)
+   {
+      if (c > 0)
+         midicvt_writer_putn(&gs_csv_writer, &gs_csv_separator, 1);
+
+      midicvt_writer_putn(&gs_csv_writer, s_columns[c], strlen(s_columns[c]));
+   }
+   midicvt_writer_putn(&gs_csv_writer, "\n", 1);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_starttrack().  Bumps the track
+ *    number, and restarts the tempo-map search.  For SMF 2, each track
+ *    has its own tempo, so the tempo map is cleared.
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+static int
+csv_trstart (void)
+{
+   ++gs_csv_track;
+   if (gs_csv_format == 2)
+      csv_tempo_reset();
+
+   gs_csv_tempo_cursor = 0;
+   return true;
+}
+
+/**
+ *    Writes out any rows still in the buffer when the program exits
+ *    early.  The midifile library calls exit() on a bad MIDI file (see
+ *    mferror()), and the rows already converted should then be written,
+ *    just as the normal text output would be.
+ */
+
+static void
+csv_atexit (void)
+{
+   (void) midicvt_writer_flush(&gs_csv_writer);
+}
+
+/**
+ *    Makes the function assignments needed by the midifile library when
+ *    converting a MIDI file to CSV or TSV rows, and resets the state of
+ *    the writer.  The separator is taken from midicvt_option_csv().
+ */
+
+void
+midicvt_initfuncs_csv (void)
+{
+   static cbool_t s_atexit_registered = false;
+   if (! s_atexit_registered)
+      s_atexit_registered = atexit(csv_atexit) == 0;
+
+   gs_csv_separator  = midicvt_option_csv() == '\t' ? '\t' : ',' ;
+   gs_csv_track      = -1;
+   gs_csv_format     = 1;
+   gs_csv_division   = 0;
+   midicvt_writer_reset(&gs_csv_writer, "CSV");
+   csv_tempo_reset();
+   if (! csv_make_file_column())
+      errprint("midicvt_initfuncs_csv(): out of memory for the file name");
+
+   midicvt_writer_callbacks(csv_channel_row, csv_data_row);
+   Mf_header         = csv_header;
+   Mf_starttrack     = csv_trstart;
+}
+
+/**
+ *    Writes out any rows remaining in the buffer, and frees the tempo map
+ *    and the file-name column.  Must be called after mfread() and before
+ *    midicvt_close_mfread().
+ *
+ * \return
+ *    Returns true if all of the output was written.
+ */
+
+cbool_t
+midicvt_close_csv (void)
+{
+   cbool_t result = midicvt_writer_flush(&gs_csv_writer);
+   if (result && not_nullptr(g_redirect_file))
+      result = fflush(g_redirect_file) == 0;
+
+   if (not_nullptr(gs_csv_tempos))
+   {
+      free(gs_csv_tempos);
+      gs_csv_tempos = nullptr;
+   }
+   gs_csv_tempo_count = gs_csv_tempo_size = gs_csv_tempo_cursor = 0;
+   if (not_nullptr(gs_csv_file))
+   {
+      free(gs_csv_file);
+      gs_csv_file = nullptr;
+   }
+   gs_csv_file_length = 0;
+   return result;
+}
+
+/*
+ * midicvt_csv.c
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
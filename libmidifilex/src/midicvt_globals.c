@@ -29,32 +29,37 @@
  * \library       midicvt application
  * \author        Chris Ahlstrom
  * \date          2014-04-09
- * \updates       2015-08-19
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  */
 
+#include <unistd.h>                    /* sysconf()                           */
+
 #include <midicvt_macros.h>            /* nullptr and other stock stuff       */
 #include <midicvt_globals.h>           /* declares these global variables     */
 #include <midicvt_helpers.h>           /* help and file-management functions  */
 #include <t2mf.h>                      /* yyin flex variable                  */
 
-FILE * g_io_file                 = nullptr;
-FILE * g_redirect_file           = nullptr;
-jmp_buf g_status_erjump;
-int g_status_tracks_to_do        = 1;
-int g_status_err_cont            = 0;
-int g_status_format;
-int g_status_no_of_tracks;
-unsigned char * g_status_buffer  = nullptr;
-int g_status_buflen              = 0;
-int g_status_bufsiz              = 0;
-int g_status_track_number;
-int g_status_measure;
-int g_status_M0;
-int g_status_beat;
-int g_status_clicks;
-long g_status_T0;
+/*
+ *    These variables hold the state of the file being read or written,
+ *    and so each thread has its own copy.
+ */
+
+MIDICVT_THREAD_LOCAL FILE * g_io_file                = nullptr;
+MIDICVT_THREAD_LOCAL FILE * g_redirect_file          = nullptr;
+MIDICVT_THREAD_LOCAL int g_status_tracks_to_do       = 1;
+MIDICVT_THREAD_LOCAL int g_status_format;
+MIDICVT_THREAD_LOCAL int g_status_no_of_tracks;
+MIDICVT_THREAD_LOCAL unsigned char * g_status_buffer = nullptr;
+MIDICVT_THREAD_LOCAL int g_status_buflen             = 0;
+MIDICVT_THREAD_LOCAL int g_status_bufsiz             = 0;
+MIDICVT_THREAD_LOCAL int g_status_track_number;
+MIDICVT_THREAD_LOCAL int g_status_measure;
+MIDICVT_THREAD_LOCAL int g_status_M0;
+MIDICVT_THREAD_LOCAL int g_status_beat;
+MIDICVT_THREAD_LOCAL int g_status_clicks;
+MIDICVT_THREAD_LOCAL long g_status_T0;
 
 char * g_option_Onmsg            = "On ch=%d n=%s v=%d\n";
 char * g_option_Offmsg           = "Off ch=%d n=%s v=%d\n";
@@ -86,6 +91,14 @@ static cbool_t g_option_debug           = false;
 static cbool_t g_option_docompile       = false;
 static cbool_t g_option_midi2midi       = false;
 static cbool_t g_option_human           = false;   /* new 2015-05-19 */
+static char g_option_csv                = 0;       /* new 2026-10-18 */
+static cbool_t g_option_binary          = false;   /* new 2026-10-18 */
+static int g_option_json                = 0;       /* new 2026-10-18 */
+static cbool_t g_option_flex            = false;   /* new 2026-10-18 */
+static int g_option_jobs                = 1;       /* new 2026-10-18 */
+static const char * g_option_cache      = nullptr; /* new 2026-10-18 */
+static cbool_t g_option_stats           = false;   /* new 2026-10-18 */
+static cbool_t g_option_validate        = false;   /* new 2026-10-18 */
 
 /**
  * Use externs from an include file!  The flex-generated code is a bit
@@ -127,6 +140,14 @@ midicvt_set_defaults (void)
    g_option_debug          = false;
    g_option_docompile      = false;
    g_option_human          = false;       /* new 2015-05-19 */
+   g_option_csv            = 0;           /* new 2026-10-18 */
+   g_option_binary         = false;       /* new 2026-10-18 */
+   g_option_json           = 0;           /* new 2026-10-18 */
+   g_option_flex           = false;       /* new 2026-10-18 */
+   g_option_jobs           = 1;           /* new 2026-10-18 */
+   g_option_cache          = nullptr;     /* new 2026-10-18 */
+   g_option_stats          = false;       /* new 2026-10-18 */
+   g_option_validate       = false;       /* new 2026-10-18 */
    g_option_Onmsg          = "On ch=%d n=%s v=%d\n";
    g_option_Offmsg         = "Off ch=%d n=%s v=%d\n";
    g_option_PoPrmsg        = "PoPr ch=%d n=%s v=%d\n";
@@ -346,6 +367,226 @@ midicvt_option_m2m (void)
    return g_option_midi2midi;
 }
 
+/**
+ * \setter g_option_csv
+ *
+ * \param separator
+ *    Provides the column separator for the --csv (',') or --tsv (tab)
+ *    option.  A value of 0 turns off the columnar output.
+ */
+
+void
+midicvt_set_option_csv (char separator)
+{
+   g_option_csv = separator;
+}
+
+/**
+ * \getter g_option_csv
+ *
+ *    We need to expose this value for main() to use.
+ *
+ * \return
+ *    Returns the column separator, or 0 if neither --csv nor --tsv was
+ *    given.
+ */
+
+char
+midicvt_option_csv (void)
+{
+   return g_option_csv;
+}
+
+/**
+ * \setter g_option_binary
+ *
+ * \param flag
+ *    If true, MIDI is written in the binary event format of
+ *    midicvt_bin.h, or, with the --compile option, the binary event format
+ *    is read instead of ASCII text.
+ */
+
+void
+midicvt_set_option_binary (cbool_t flag)
+{
+   g_option_binary = flag;
+}
+
+/**
+ * \getter g_option_binary
+ *
+ *    We need to expose this value for main() to use.
+ */
+
+cbool_t
+midicvt_option_binary (void)
+{
+   return g_option_binary;
+}
+
+/**
+ * \setter g_option_json
+ *
+ * \param mode
+ *    Provides MIDICVT_JSON_LINES (1) for the --json option, or
+ *    MIDICVT_JSON_DOCUMENT (2) for the --json-doc option.  A value of 0
+ *    turns off the JSON output.  See midicvt_json.h.
+ */
+
+void
+midicvt_set_option_json (int mode)
+{
+   g_option_json = mode;
+}
+
+/**
+ * \getter g_option_json
+ *
+ *    We need to expose this value for main() to use.
+ *
+ * \return
+ *    Returns the JSON output style, or 0 if neither --json nor --json-doc
+ *    was given.
+ */
+
+int
+midicvt_option_json (void)
+{
+   return g_option_json;
+}
+
+/**
+ * \setter g_option_flex
+ *
+ * \param flag
+ *    If true, the --compile option uses the flex-generated scanner,
+ *    instead of the faster hand-written one in t2mf_scanner.c.
+ */
+
+void
+midicvt_set_option_flex (cbool_t flag)
+{
+   g_option_flex = flag;
+}
+
+/**
+ * \getter g_option_flex
+ */
+
+cbool_t
+midicvt_option_flex (void)
+{
+   return g_option_flex;
+}
+
+/**
+ * \setter g_option_jobs
+ *
+ * \param jobs
+ *    Provides the number of tracks that --compile can compile at the
+ *    same time, or the number of files that "midicvtpp --batch" can
+ *    convert at the same time.  If 0, the number of online processors is
+ *    used.  The default, 1, does one after the other.
+ */
+
+void
+midicvt_set_option_jobs (int jobs)
+{
+   if (jobs <= 0)
+   {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      jobs = cpus > 0 ? (int) cpus : 1;
+   }
+   g_option_jobs = jobs;
+}
+
+/**
+ * \getter g_option_jobs
+ */
+
+int
+midicvt_option_jobs (void)
+{
+   return g_option_jobs;
+}
+
+/**
+ * \setter g_option_cache
+ *
+ * \param dir
+ *    Provides the directory in which --compile keeps compiled tracks, so
+ *    that only the tracks that have changed are compiled again.  The
+ *    string is not copied, so it must last as long as the application.
+ */
+
+void
+midicvt_set_option_cache (const char * dir)
+{
+   g_option_cache = dir;
+}
+
+/**
+ * \getter g_option_cache
+ *
+ * \return
+ *    Returns the cache directory, or a null pointer if --cache was not
+ *    given.
+ */
+
+const char *
+midicvt_option_cache (void)
+{
+   return g_option_cache;
+}
+
+/**
+ * \setter g_option_stats
+ *
+ * \param flag
+ *    If true, --compile writes a report of the tracks, events, lines, and
+ *    errors of the ASCII file to stderr.
+ */
+
+void
+midicvt_set_option_stats (cbool_t flag)
+{
+   g_option_stats = flag;
+}
+
+/**
+ * \getter g_option_stats
+ */
+
+cbool_t
+midicvt_option_stats (void)
+{
+   return g_option_stats;
+}
+
+/**
+ * \setter g_option_validate
+ *
+ * \param flag
+ *    If true, --compile checks the ASCII file, but writes no MIDI file,
+ *    and fails if there are any errors.
+ */
+
+void
+midicvt_set_option_validate (cbool_t flag)
+{
+   g_option_validate = flag;
+}
+
+/**
+ * \getter g_option_validate
+ */
+
+cbool_t
+midicvt_option_validate (void)
+{
+   return g_option_validate;
+}
+
 /*
  * midicvt_globals.c
  *
@@ -28,7 +28,7 @@
  * \library       midicvt application
  * \author        Chris Ahlstrom
  * \date          2014-04-19
- * \updates       2016-04-24
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
@@ -45,6 +45,7 @@
 #include <midifilex.h>                 /* global variables from midifile lib  */
 #include <midicvt_globals.h>           /* global option variables             */
 #include <midicvt_helpers.h>           /* provides flex and help-text support */
+#include <midicvt_json.h>              /* MIDICVT_JSON_LINES, etc.            */
 #include "midicvt-config.h"            /* settings from configure.ac          */
 
 /**
@@ -100,6 +101,35 @@ static const char * const gs_help_usage_2_3 =
    "                 ignore them; midicvt otherwise treats them as tracks.\n"
    ;
 
+static const char * const gs_help_usage_2_4 =
+   " --csv           Write MIDI as comma-separated rows, one per event, with\n"
+   "                 columns file, track, abs_tick, seconds, status, channel,\n"
+   "                 data1, data2, meta_type, and payload_hex.\n"
+   " --tsv           Same as --csv, but the columns are separated by tabs.\n"
+   " --binary        Write MIDI as compact binary event records (.mcvb).\n"
+   "                 With --compile, read binary events instead of text.\n"
+   ;
+
+static const char * const gs_help_usage_2_5 =
+   " --json          Write MIDI as JSON Lines:  a file object, then one\n"
+   "                 object per event.  Add --note for note and controller\n"
+   "                 names.\n"
+   " --json-doc      Same as --json, but write one JSON document per file.\n"
+   " --flex          With --compile, use the older flex scanner instead of\n"
+   "                 the faster built-in one."
+   ;
+
+static const char * const gs_help_usage_2_6 =
+   " -j, --jobs [n]  With --compile, compile up to n tracks at the same time\n"
+   "                 (default: one per processor).  With the --batch option\n"
+   "                 of midicvtpp, convert up to n files at the same time.\n"
+   " --cache dir     With --compile, keep the compiled tracks in dir, and\n"
+   "                 compile again only the tracks that have changed.\n"
+   " --stats         With --compile, report tracks, events, and errors.\n"
+   " --validate      Check an ASCII file as --compile does, but write no\n"
+   "                 MIDI file.  Fails if there are any errors.\n"
+   ;
+
 static const char * const gs_help_usage_3 =
    "To translate a MIDI/SMF file to plain ASCII format:\n"
    "\n"
@@ -160,10 +190,10 @@ static cbool_t gs_have_output_file = false;
 static char gs_output_file[MIDICVT_PATH_MAX];
 
 /**
- *    Provides the current offset into the global input file.
+ *    Provides the current offset into the input file of this thread.
  */
 
-static long gs_file_offset = 0;
+static MIDICVT_THREAD_LOCAL long gs_file_offset = 0;
 
 /**
  *    Indicates if --version appeared on the command line.
@@ -203,6 +233,9 @@ midicvt_help (const char * version)
    fprintf(stderr, "%s\n", gs_help_usage_2_1);
    fprintf(stderr, "%s\n", gs_help_usage_2_2);
    fprintf(stderr, "%s\n", gs_help_usage_2_3);
+   fprintf(stderr, "%s\n", gs_help_usage_2_4);
+   fprintf(stderr, "%s\n", gs_help_usage_2_5);
+   fprintf(stderr, "%s\n", gs_help_usage_2_6);
    fprintf(stderr, "%s\n", gs_help_usage_3);
    fprintf(stderr, "%s\n", gs_help_usage_4);
 }
@@ -624,6 +657,68 @@ midicvt_parse (int argc, char * argv [], const char * version)
       {
          midicvt_set_option_mfile(false);
       }
+      else if (check_option(argv[option_index], "", "--csv"))
+      {
+         midicvt_set_option_csv(',');
+      }
+      else if (check_option(argv[option_index], "", "--tsv"))
+      {
+         midicvt_set_option_csv('\t');
+      }
+      else if (check_option(argv[option_index], "", "--json"))
+      {
+         midicvt_set_option_json(MIDICVT_JSON_LINES);
+      }
+      else if (check_option(argv[option_index], "", "--json-doc"))
+      {
+         midicvt_set_option_json(MIDICVT_JSON_DOCUMENT);
+      }
+      else if (check_option(argv[option_index], "", "--flex"))
+      {
+         midicvt_set_option_flex(true);
+      }
+      else if (check_option(argv[option_index], "-j", "--jobs"))
+      {
+         int jobs = 0;                 /* 0 means one per processor           */
+         if ((option_index + 1) < argc)
+         {
+            option_index++;
+            jobs = atoi(argv[option_index]);
+            if (jobs <= 0)             /* found an option, not a number       */
+            {
+               option_index--;
+               jobs = 0;
+            }
+         }
+         midicvt_set_option_jobs(jobs);
+      }
+      else if (check_option(argv[option_index], "", "--cache"))
+      {
+         if ((option_index + 1) < argc && argv[option_index+1][0] != '-')
+         {
+            option_index++;
+            midicvt_set_option_cache(argv[option_index]);
+         }
+         else
+         {
+            errprint("--cache option requires a directory name");
+            result = false;
+            break;
+         }
+      }
+      else if (check_option(argv[option_index], "", "--stats"))
+      {
+         midicvt_set_option_stats(true);
+      }
+      else if (check_option(argv[option_index], "", "--validate"))
+      {
+         midicvt_set_option_validate(true);
+         midicvt_set_option_compile(true);
+      }
+      else if (check_option(argv[option_index], "", "--binary"))
+      {
+         midicvt_set_option_binary(true);
+      }
       else if (check_option(argv[option_index], "-v", "--verbose"))
       {
          midicvt_set_option_verbose(true);
@@ -658,6 +753,8 @@ midicvt_parse (int argc, char * argv [], const char * version)
           * implemented in the C++ code, and so are legal.
           */
 
+         check_option(argv[option_index], "", "--batch") ||
+         check_option(argv[option_index], "", "--compile-map") ||
          check_option(argv[option_index], "", "--csv-drum") ||
          check_option(argv[option_index], "", "--csv-drums") ||
          check_option(argv[option_index], "", "--csv-patch") ||
@@ -665,6 +762,7 @@ midicvt_parse (int argc, char * argv [], const char * version)
          check_option(argv[option_index], "", "--extract") ||
          check_option(argv[option_index], "", "--reject") ||
          check_option(argv[option_index], "", "--reverse") ||
+         check_option(argv[option_index], "", "--round-trip") ||
          check_option(argv[option_index], "", "--summarize") ||
          check_option(argv[option_index], "", "--testing")
       )
@@ -696,10 +794,13 @@ midicvt_parse (int argc, char * argv [], const char * version)
 
             if
             (
+               check_option(argv[option_index], "", "--batch") ||
+               check_option(argv[option_index], "", "--compile-map") ||
                check_option(argv[option_index], "", "--csv-drum") ||
                check_option(argv[option_index], "", "--csv-patch") ||
                check_option(argv[option_index], "", "--extract") ||
-               check_option(argv[option_index], "", "--reject")
+               check_option(argv[option_index], "", "--reject") ||
+               check_option(argv[option_index], "", "--round-trip")
             )
             {
                if ((option_index + 1) < argc)
@@ -0,0 +1,489 @@
+/*
+ * midicvt - A text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midicvt_json.c
+ *
+ *    This module provides functions for writing MIDI events as JSON Lines
+ *    (--json) or as a single JSON document (--json-doc).
+ *
+ * \library       midicvt application
+ * \author        Chris Ahlstrom and many other authors
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    With --json, the first line describes the file, and each following
+ *    line is one event:
+ *
+\verbatim
+      {"file":"ex1.mid","format":1,"ntracks":2,"division":96}
+      {"track":0,"tick":0,"status":255,"meta":81,"data":"07a120"}
+      {"track":1,"tick":0,"status":144,"channel":1,"data1":60,"data2":100}
+\endverbatim
+ *
+ *    With --json-doc, the same event objects are written as the elements
+ *    of an "events" array in the file object, one per line.
+ *
+ *    The members of an event object are:
+ *
+ *       -  <b>track</b>.  The track number, starting at 0.
+ *       -  <b>tick</b>.  The absolute time of the event in ticks, from the
+ *          start of the track.
+ *       -  <b>status</b>.  The status byte, in decimal.  Channel events
+ *          include the channel nybble, meta events are 255, SysEx events
+ *          are 240, and escaped (F7) events are 247.
+ *       -  <b>channel</b>, <b>data1</b>, <b>data2</b>.  Only for channel
+ *          events.  The channel is 1 to 16, as in the text output.
+ *          Program Change and Channel Pressure have no data2.
+ *       -  <b>meta</b>.  Only for meta events, the meta-event type.
+ *       -  <b>data</b>.  Only for meta, SysEx, and escaped events, the data
+ *          bytes as lower-case hexadecimal.  The F0 byte of a SysEx event
+ *          is not included.
+ *       -  <b>text</b>.  Only for the text meta events (types 1 to 15), the
+ *          text as a JSON string.  Bytes above 127 are written as
+ *          \\u0080 to \\u00ff, as if the text were Latin-1.
+ *       -  <b>note</b>.  Only with the --note option, for Note On, Note
+ *          Off, and Aftertouch events, the note name ("c#4").
+ *       -  <b>controller</b>.  Only with the --note option, for Control
+ *          Change events, the name of the controller.
+ *
+ *    As in midicvt_csv.c, the output is built directly in the buffer of a
+ *    midicvt_writer_t that is written out whenever it fills up, so no
+ *    memory is allocated per event, and the memory used does not depend
+ *    on the size of the MIDI file.  The Mf_* callbacks are the common ones
+ *    of midicvt_writer.c.
+ */
+
+#include <stdio.h>                     /* FILE *, fprintf()                   */
+#include <stdlib.h>                    /* atexit(), exit()                    */
+#include <string.h>                    /* strlen()                            */
+
+#include <midicvt_macros.h>            /* nullptr, true, false, etc.          */
+#include <midicvt_cc.h>                /* midi_note_name(), etc.              */
+#include <midicvt_json.h>              /* this module's functions and stuff   */
+#include <midicvt_globals.h>           /* g_io_file, g_redirect_file, etc.    */
+#include <midicvt_helpers.h>           /* midicvt_input_file()                */
+#include <midicvt_writer.h>            /* midicvt_writer_t, callbacks         */
+#include <midifilex.h>                 /* routines that read/write MIDI data  */
+
+/**
+ *    Provides the room we require in the output buffer before starting
+ *    the fixed part of an event object:  the numeric members, the note
+ *    name, and the punctuation.  Strings and payloads are checked
+ *    separately, since they have no fixed size.
+ */
+
+#define JSON_EVENT_RESERVE          192
+
+/**
+ *    Holds the JSON until it is written to g_redirect_file.
+ */
+
+static midicvt_writer_t gs_json_writer;
+
+/**
+ *    Provides the output style, MIDICVT_JSON_LINES or
+ *    MIDICVT_JSON_DOCUMENT.
+ */
+
+static int gs_json_mode = MIDICVT_JSON_LINES;
+
+/**
+ *    Provides the number of events written so far, used to place the
+ *    commas between the elements of the events array in a document.
+ */
+
+static unsigned long gs_json_events = 0;
+
+/**
+ *    Indicates that the document was started, and needs to be closed by
+ *    midicvt_close_json().
+ */
+
+static cbool_t gs_json_started = false;
+
+/**
+ *    Indicates that the note and controller names are to be added, as
+ *    requested by the --note option.
+ */
+
+static cbool_t gs_json_names = false;
+
+/**
+ *    Provides the current track number, starting at 0.
+ */
+
+static int gs_json_track = -1;
+
+/**
+ *    Provides the lower-case hexadecimal digits for \\u escapes.
+ */
+
+static const char gs_json_hex_digits [] = "0123456789abcdef";
+
+/**
+ *    Appends a member name and an unsigned integer value, preceded by a
+ *    comma.  The caller must have reserved the room already.
+ *
+ * \param name
+ *    Provides the member name, already quoted, with the colon, such as
+ *    ",\"tick\":".
+ *
+ * \param value
+ *    Provides the value to be appended.
+ */
+
+static void
+json_member (const char * name, unsigned long value)
+{
+   midicvt_writer_puts(&gs_json_writer, name);
+   midicvt_writer_putu(&gs_json_writer, value);
+}
+
+/**
+ *    Appends a byte sequence as a quoted string of hexadecimal digits,
+ *    flushing the buffer as often as needed.
+ *
+ * \param p
+ *    Provides the bytes to be appended.
+ *
+ * \param leng
+ *    Provides the number of bytes.
+ */
+
+static void
+json_puthex (const unsigned char * p, int leng)
+{
+   midicvt_writer_t * w = &gs_json_writer;
+   midicvt_writer_reserve(w, 1);
+   midicvt_writer_putc(w, '"');
+   midicvt_writer_puthex(w, p, leng);
+   midicvt_writer_reserve(w, 1);
+   midicvt_writer_putc(w, '"');
+}
+
+/**
+ *    Appends a byte sequence as a quoted JSON string, flushing the buffer
+ *    as often as needed.  Quotes, backslashes, and control characters are
+ *    escaped.  Bytes above 127 are written as \\u escapes, treating them
+ *    as Latin-1, so that the output is always valid UTF-8 whatever the
+ *    encoding of the MIDI text.
+ *
+ * \param p
+ *    Provides the bytes to be appended.
+ *
+ * \param leng
+ *    Provides the number of bytes.
+ */
+
+static void
+json_putstr (const unsigned char * p, int leng)
+{
+   midicvt_writer_t * w = &gs_json_writer;
+   midicvt_writer_reserve(w, 1);
+   midicvt_writer_putc(w, '"');
+   while (leng-- > 0)
+   {
+      unsigned char c = *p++;
+      midicvt_writer_reserve(w, 6);
+      if (c == '"' || c == '\\')
+      {
+         midicvt_writer_putc(w, '\\');
+         midicvt_writer_putc(w, (char) c);
+      }
+      else if (c == '\n')
+         midicvt_writer_puts(w, "\\n");
+      else if (c == '\r')
+         midicvt_writer_puts(w, "\\r");
+      else if (c == '\t')
+         midicvt_writer_puts(w, "\\t");
+      else if (c < 0x20 || c > 0x7e)
+      {
+         midicvt_writer_puts(w, "\\u00");
+         midicvt_writer_putc(w, gs_json_hex_digits[(c >> 4) & 0x0f]);
+         midicvt_writer_putc(w, gs_json_hex_digits[c & 0x0f]);
+      }
+      else
+         midicvt_writer_putc(w, (char) c);
+   }
+   midicvt_writer_reserve(w, 1);
+   midicvt_writer_putc(w, '"');
+}
+
+/**
+ *    Writes the start of an event object, through the status member.  In
+ *    a document, a comma and line ending separate the event from the
+ *    previous one.
+ *
+ * \param status
+ *    Provides the status byte of the event.
+ */
+
+static void
+json_event_start (int status)
+{
+   midicvt_writer_t * w = &gs_json_writer;
+   midicvt_writer_reserve(w, JSON_EVENT_RESERVE);
+   if (gs_json_mode == MIDICVT_JSON_DOCUMENT && gs_json_events > 0)
+      midicvt_writer_puts(w, ",\n");
+
+   ++gs_json_events;
+   json_member("{\"track\":", (unsigned long) gs_json_track);
+   json_member(",\"tick\":", (unsigned long) Mf_currtime);
+   json_member(",\"status\":", (unsigned long) status);
+}
+
+/**
+ *    Writes the end of an event object.  For JSON Lines, the line ending
+ *    follows each event.
+ */
+
+static void
+json_event_end (void)
+{
+   midicvt_writer_t * w = &gs_json_writer;
+   midicvt_writer_reserve(w, 2);
+   midicvt_writer_putc(w, '}');
+   if (gs_json_mode != MIDICVT_JSON_DOCUMENT)
+      midicvt_writer_putc(w, '\n');
+}
+
+/**
+ *    Writes a complete object for a channel event.
+ *
+ * \param status
+ *    Provides the event nybble (e.g. note_on).
+ *
+ * \param chan
+ *    Provides the channel, 0 to 15.
+ *
+ * \param d1
+ *    Provides the first data byte.
+ *
+ * \param d2
+ *    Provides the second data byte, or -1 if the event has only one.
+ */
+
+static void
+json_channel_event (int status, int chan, int d1, int d2)
+{
+   midicvt_writer_t * w = &gs_json_writer;
+   json_event_start(status | chan);
+   json_member(",\"channel\":", (unsigned long) (chan + 1));
+   json_member(",\"data1\":", (unsigned long) d1);
+   if (d2 >= 0)
+      json_member(",\"data2\":", (unsigned long) d2);
+
+   if (gs_json_names)
+   {
+      if (status == note_on || status == note_off || status == poly_aftertouch)
+      {
+         int length;
+         const char * name = midi_note_name(d1, true, &length);
+         midicvt_writer_puts(w, ",\"note\":\"");
+         midicvt_writer_putn(w, name, (size_t) length);
+         midicvt_writer_putc(w, '"');
+      }
+      else if (status == control_change)
+      {
+         const char * name = midi_controller_name(d1);
+         if (not_nullptr(name))
+         {
+            midicvt_writer_puts(w, ",\"controller\":");
+            json_putstr
+            (
+               (const unsigned char *) name, midi_controller_name_length(d1)
+            );
+         }
+      }
+   }
+   json_event_end();
+}
+
+/**
+ *    Writes a complete object for a meta, SysEx, or escaped event.
+ *
+ * \param status
+ *    Provides the status byte, 0xff, 0xf0, or 0xf7.
+ *
+ * \param type
+ *    Provides the meta-event type, or -1 for SysEx and escaped events.
+ *
+ * \param p
+ *    Provides the payload bytes.
+ *
+ * \param leng
+ *    Provides the number of payload bytes.
+ */
+
+static void
+json_data_event (int status, int type, const unsigned char * p, int leng)
+{
+   midicvt_writer_t * w = &gs_json_writer;
+   json_event_start(status);
+   if (type >= 0)
+      json_member(",\"meta\":", (unsigned long) type);
+
+   midicvt_writer_puts(w, ",\"data\":");
+   json_puthex(p, leng);
+   if (type >= 0x01 && type <= 0x0f)
+   {
+      midicvt_writer_reserve(w, 8);
+      midicvt_writer_puts(w, ",\"text\":");
+      json_putstr(p, leng);
+   }
+   json_event_end();
+}
+
+/**
+ *    Callback function implementing Mf_header().  Writes the file object
+ *    (JSON Lines) or the start of it (document).
+ *
+ * \param format
+ *    Provides the format (0, 1, or 2) of the MIDI file.
+ *
+ * \param ntrks
+ *    Provides the number of tracks in the MIDI file.
+ *
+ * \param division
+ *    Provides the time-division value.
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+static int
+json_header (int format, int ntrks, int division)
+{
+   midicvt_writer_t * w = &gs_json_writer;
+   const char * name = midicvt_input_file();
+   if (format < 0 || format > 2)
+   {
+      fprintf(stderr, "Can't deal with format %d or missing files\n", format);
+      exit(1);
+   }
+   g_status_tracks_to_do = ntrks;
+   midicvt_writer_reserve(w, 16);
+   midicvt_writer_puts(w, "{\"file\":");
+   json_putstr((const unsigned char *) name, (int) strlen(name));
+   midicvt_writer_reserve(w, JSON_EVENT_RESERVE);
+   json_member(",\"format\":", (unsigned long) format);
+   json_member(",\"ntracks\":", (unsigned long) ntrks);
+   json_member(",\"division\":", (unsigned long) division);
+   if (gs_json_mode == MIDICVT_JSON_DOCUMENT)
+   {
+      midicvt_writer_puts(w, ",\"events\":[\n");
+      gs_json_started = true;
+   }
+   else
+      midicvt_writer_puts(w, "}\n");
+
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_starttrack().
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+static int
+json_trstart (void)
+{
+   ++gs_json_track;
+   return true;
+}
+
+/**
+ *    Writes out any JSON still in the buffer when the program exits
+ *    early, as in midicvt_csv.c.  A document is left unterminated, which
+ *    lets the consumer see that the conversion failed.
+ */
+
+static void
+json_atexit (void)
+{
+   (void) midicvt_writer_flush(&gs_json_writer);
+}
+
+/**
+ *    Makes the function assignments needed by the midifile library when
+ *    converting a MIDI file to JSON, and resets the state of the writer.
+ *    The output style is taken from midicvt_option_json(), and the names
+ *    are added if midicvt_option_verbose_notes() is set.
+ */
+
+void
+midicvt_initfuncs_json (void)
+{
+   static cbool_t s_atexit_registered = false;
+   if (! s_atexit_registered)
+      s_atexit_registered = atexit(json_atexit) == 0;
+
+   gs_json_mode = midicvt_option_json() == MIDICVT_JSON_DOCUMENT ?
+      MIDICVT_JSON_DOCUMENT : MIDICVT_JSON_LINES ;
+
+   gs_json_names     = midicvt_option_verbose_notes();
+   gs_json_events    = 0;
+   gs_json_track     = -1;
+   gs_json_started   = false;
+   midicvt_writer_reset(&gs_json_writer, "JSON");
+   midicvt_writer_callbacks(json_channel_event, json_data_event);
+   Mf_header         = json_header;
+   Mf_starttrack     = json_trstart;
+}
+
+/**
+ *    Closes the document, if any, and writes out any JSON remaining in the
+ *    buffer.  Must be called after mfread() and before
+ *    midicvt_close_mfread().
+ *
+ * \return
+ *    Returns true if all of the output was written.
+ */
+
+cbool_t
+midicvt_close_json (void)
+{
+   midicvt_writer_t * w = &gs_json_writer;
+   cbool_t result;
+   if (gs_json_started)
+   {
+      midicvt_writer_reserve(w, 8);
+      midicvt_writer_puts(w, gs_json_events > 0 ? "\n]}\n" : "]}\n");
+      gs_json_started = false;
+   }
+   result = midicvt_writer_flush(&gs_json_writer);
+   if (result && not_nullptr(g_redirect_file))
+      result = fflush(g_redirect_file) == 0;
+
+   return result;
+}
+
+/*
+ * midicvt_json.c
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
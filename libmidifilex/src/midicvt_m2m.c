@@ -28,7 +28,7 @@
  * \library       midicvt application
  * \author        Chris Ahlstrom and many other authors
  * \date          2014-04-27
- * \updates       2016-04-17
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
@@ -64,13 +64,15 @@
  *    Callback function implementing Mf_putc() for MIDI-to-MIDI
  *    conversions.
  *
- *    This function writes to the g_redirect_file FILE pointer.
+ *    This function writes to the g_redirect_file FILE pointer.  Each
+ *    thread has its own g_redirect_file, so the stream does not need to
+ *    be locked for every byte.
  *
  * \param c
  *    Provides the character to be written.
  *
  * \return
- *    Returns the value returned by putc(), or a -1 upon error.
+ *    Returns the value returned by putc_unlocked(), or a -1 upon error.
  */
 
 static int
@@ -78,7 +80,7 @@ fileputc (unsigned char c)
 {
    cbool_t ok = not_nullptr(g_redirect_file);
    if (ok)
-      return putc((int) c, g_redirect_file);
+      return putc_unlocked((int) c, g_redirect_file);
    else
    {
       errprint("null redirect pointer in m2m's fileputc()");
@@ -89,10 +91,11 @@ fileputc (unsigned char c)
 /**
  *    Callback function implementing Mf_getc().
  *
- *    This function reads from the g_io_file FILE pointer.
+ *    This function reads from the g_io_file FILE pointer, which, like
+ *    g_redirect_file, belongs to the calling thread.
  *
  * \return
- *    Returns the value returned by getc(), or a -1 upon error.
+ *    Returns the value returned by getc_unlocked(), or a -1 upon error.
  */
 
 static int
@@ -102,7 +105,7 @@ filegetc (void)
    if (ok)
    {
       midi_file_offset_increment();
-      return getc(g_io_file);
+      return getc_unlocked(g_io_file);
    }
    else
    {
@@ -174,7 +177,7 @@ m2m_header (int format, int ntrks, int division)
    if (format < 0 || format > 2)
    {
       fprintf(stderr, "Can't deal with format %d or missing files\n", format);
-      exit(1);
+      mf_abort();
    }
    else
       mf_w_header_chunk(format, ntrks, division);
@@ -0,0 +1,569 @@
+/*
+ * midicvt - A text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midicvt_writer.c
+ *
+ *    This module provides the buffered writer and the Mf_* callbacks
+ *    shared by the CSV, JSON, and binary event writers.
+ *
+ * \library       midicvt application
+ * \author        Chris Ahlstrom and many other authors
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    Each event writer needs the same two dozen Mf_* callbacks, and they
+ *    differ only in what they do with the event.  The callbacks here
+ *    reduce every event to one of two calls:  a channel event, with its
+ *    status, channel, and data bytes, or a data event (meta, SysEx, or
+ *    escaped), with its status, meta type, and payload.  The meta events
+ *    that the library decodes (sequence number, tempo, key and time
+ *    signature, SMPTE offset) have their payload bytes rebuilt, so that
+ *    the writers see them just like any other meta event.
+ *
+ *    The writer then sets up its own Mf_header() and Mf_starttrack()
+ *    callbacks, which carry its per-file state.
+ */
+
+#include <stdio.h>                     /* FILE *, fwrite(), getc()            */
+#include <string.h>                    /* memcpy()                            */
+
+#include <midicvt_writer.h>            /* this module's functions and stuff   */
+#include <midicvt_globals.h>           /* g_io_file, g_redirect_file, etc.    */
+#include <midicvt_helpers.h>           /* midi_file_offset_increment()        */
+
+/**
+ *    Provides the lower-case hexadecimal digits for
+ *    midicvt_writer_puthex().
+ */
+
+static const char gs_writer_hex_digits [] = "0123456789abcdef";
+
+/**
+ *    Receives the channel events, as set by midicvt_writer_callbacks().
+ *    Thread-local, like the Mf_* pointers that lead here.
+ */
+
+static MIDICVT_THREAD_LOCAL
+midicvt_channel_event_t gs_channel_event = nullptr;
+
+/**
+ *    Receives the data events, as set by midicvt_writer_callbacks().
+ */
+
+static MIDICVT_THREAD_LOCAL
+midicvt_data_event_t gs_data_event = nullptr;
+
+/**
+ *    Empties a writer and clears its error flag.
+ *
+ * \param w
+ *    Provides the writer.
+ *
+ * \param name
+ *    Names the kind of output, such as "CSV", for the error message.
+ */
+
+void
+midicvt_writer_reset (midicvt_writer_t * w, const char * name)
+{
+   w->count = 0;
+   w->write_error = false;
+   w->name = name;
+}
+
+/**
+ *    Writes out the accumulated output and empties the buffer.
+ *
+ * \param w
+ *    Provides the writer.
+ *
+ * \return
+ *    Returns true if the write succeeded, or if there was nothing to write.
+ */
+
+cbool_t
+midicvt_writer_flush (midicvt_writer_t * w)
+{
+   cbool_t result = ! w->write_error;
+   if (result && w->count > 0)
+   {
+      result = not_nullptr(g_redirect_file);
+      if (result)
+      {
+         size_t count = fwrite(w->buffer, 1, w->count, g_redirect_file);
+         result = count == w->count;
+      }
+      if (! result)
+      {
+         errprintf("? failed to write the %s output\n", w->name);
+         w->write_error = true;
+      }
+   }
+   w->count = 0;
+   return result;
+}
+
+/**
+ *    Appends a string of known length to the output buffer, flushing the
+ *    buffer as often as needed.
+ *
+ * \param w
+ *    Provides the writer.
+ *
+ * \param s
+ *    Provides the characters to be appended.
+ *
+ * \param length
+ *    Provides the number of characters to be appended.
+ */
+
+void
+midicvt_writer_putn (midicvt_writer_t * w, const char * s, size_t length)
+{
+   while (length > 0)
+   {
+      size_t room = MIDICVT_WRITER_SIZE - w->count;
+      size_t count = length < room ? length : room;
+      memcpy(&w->buffer[w->count], s, count);
+      w->count += count;
+      s += count;
+      length -= count;
+      if (length > 0)
+         (void) midicvt_writer_flush(w);
+   }
+}
+
+/**
+ *    Appends an unsigned integer, in decimal, to the output buffer.  The
+ *    caller must have reserved the room already.
+ *
+ * \param w
+ *    Provides the writer.
+ *
+ * \param value
+ *    Provides the value to be appended.
+ */
+
+void
+midicvt_writer_putu (midicvt_writer_t * w, unsigned long value)
+{
+   char digits[24];
+   int count = 0;
+   do
+   {
+      digits[count++] = (char) ('0' + (value % 10));
+      value /= 10;
+
+   } while (value > 0);
+
+   while (count > 0)
+      w->buffer[w->count++] = digits[--count];
+}
+
+/**
+ *    Appends a byte sequence as lower-case hexadecimal digits, with no
+ *    separators, flushing the buffer as often as needed.
+ *
+ * \param w
+ *    Provides the writer.
+ *
+ * \param p
+ *    Provides the bytes to be appended.
+ *
+ * \param leng
+ *    Provides the number of bytes.
+ */
+
+void
+midicvt_writer_puthex
+(
+   midicvt_writer_t * w,
+   const unsigned char * p,
+   int leng
+)
+{
+   while (leng-- > 0)
+   {
+      midicvt_writer_reserve(w, 2);
+      w->buffer[w->count++] = gs_writer_hex_digits[(*p >> 4) & 0x0f];
+      w->buffer[w->count++] = gs_writer_hex_digits[*p & 0x0f];
+      ++p;
+   }
+}
+
+/**
+ *    Callback function implementing Mf_error().
+ *
+ * \param s
+ *    Provides the error string to report.
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+static int
+writer_error (const char * s)
+{
+   if (g_status_tracks_to_do <= 0)
+      fprintf(stderr, "Error: Garbage at end '%s'\n", s);
+   else
+      fprintf(stderr, "Error: %s\n", s);
+
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_endtrack().  Decrements the
+ *    global "tracks to do" counter.  Nothing is written; the End of Track
+ *    meta event is a data event of its own.
+ *
+ * \param header_offset
+ *    Offset of the header of the track that is now ending.  Shown only
+ *    with the --debug option.
+ *
+ * \param track_size
+ *    Provides the actual size of the track.  Shown only with the --debug
+ *    option.
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+static int
+writer_trend (long header_offset, unsigned long track_size)
+{
+   --g_status_tracks_to_do;
+   if (midicvt_option_debug())
+   {
+      char mesg[128];
+      (void) snprintf
+      (
+         mesg, sizeof(mesg),
+         "Tracks left %d:  track size = %lu; header offset = %ld",
+         g_status_tracks_to_do, track_size, header_offset
+      );
+      infoprint(mesg);
+   }
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_on().
+ */
+
+static int
+writer_non (int chan, int pitch, int vol)
+{
+   gs_channel_event(note_on, chan, pitch, vol);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_off().
+ */
+
+static int
+writer_noff (int chan, int pitch, int vol)
+{
+   gs_channel_event(note_off, chan, pitch, vol);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_pressure().
+ */
+
+static int
+writer_pressure (int chan, int pitch, int pressure)
+{
+   gs_channel_event(poly_aftertouch, chan, pitch, pressure);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_parameter().
+ */
+
+static int
+writer_parameter (int chan, int control, int value)
+{
+   gs_channel_event(control_change, chan, control, value);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_pitchbend().  The data bytes are
+ *    passed in MIDI order, LSB first.
+ */
+
+static int
+writer_pitchbend (int chan, int lsb, int msb)
+{
+   gs_channel_event(pitch_wheel, chan, lsb, msb);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_program().
+ */
+
+static int
+writer_program (int chan, int program)
+{
+   gs_channel_event(program_chng, chan, program, -1);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_chanpressure().
+ */
+
+static int
+writer_chanpressure (int chan, int pressure)
+{
+   gs_channel_event(channel_aftertouch, chan, pressure, -1);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_sysex().  The message from the
+ *    library starts with the F0 byte, which is not passed on in the
+ *    payload.
+ */
+
+static int
+writer_sysex (int leng, char * mess)
+{
+   const unsigned char * p = (const unsigned char *) mess;
+   if (leng > 0 && p[0] == system_exclusive)
+   {
+      ++p;
+      --leng;
+   }
+   gs_data_event(system_exclusive, -1, p, leng);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_arbitrary(), for F7 (escaped)
+ *    events.
+ */
+
+static int
+writer_arbitrary (int leng, char * mess)
+{
+   gs_data_event(0xf7, -1, (const unsigned char *) mess, leng);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_metamisc().
+ */
+
+static int
+writer_mmisc (int typecode, int leng, char * mess)
+{
+   gs_data_event(meta_event, typecode, (const unsigned char *) mess, leng);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_sqspecific().
+ */
+
+static int
+writer_mspecial (int leng, char * mess)
+{
+   gs_data_event
+   (
+      meta_event, sequencer_specific, (const unsigned char *) mess, leng
+   );
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_text().
+ */
+
+static int
+writer_mtext (int type, int leng, char * mess)
+{
+   gs_data_event(meta_event, type, (const unsigned char *) mess, leng);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_seqnum().  The library passes only
+ *    the decoded number, so the two payload bytes are rebuilt.
+ */
+
+static int
+writer_mseq (short int num)
+{
+   unsigned char s_data[2];
+   s_data[0] = (num & 0xff00) >> 8;
+   s_data[1] = (num & 0x00ff);
+   gs_data_event(meta_event, sequence_number, s_data, 2);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_eot().
+ */
+
+static int
+writer_meot (void)
+{
+   gs_data_event(meta_event, end_of_track, nullptr, 0);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_keysig().
+ */
+
+static int
+writer_keysig (int sf, int mi)
+{
+   unsigned char s_data[2];
+   s_data[0] = sf;
+   s_data[1] = mi;
+   gs_data_event(meta_event, key_signature, s_data, 2);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_tempo().
+ */
+
+static int
+writer_tempo (long tempo)
+{
+   unsigned char s_data[3];
+   s_data[0] = (tempo >> 16) & 0xff;
+   s_data[1] = (tempo >> 8) & 0xff;
+   s_data[2] = tempo & 0xff;
+   gs_data_event(meta_event, set_tempo, s_data, 3);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_timesig().
+ */
+
+static int
+writer_timesig (int nn, int dd, int cc, int bb)
+{
+   unsigned char s_data[4];
+   s_data[0] = nn;
+   s_data[1] = dd;
+   s_data[2] = cc;
+   s_data[3] = bb;
+   gs_data_event(meta_event, time_signature, s_data, 4);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_smpte().
+ */
+
+static int
+writer_smpte (int hr, int mn, int se, int fr, int ff)
+{
+   unsigned char s_data[5];
+   s_data[0] = hr;
+   s_data[1] = mn;
+   s_data[2] = se;
+   s_data[3] = fr;
+   s_data[4] = ff;
+   gs_data_event(meta_event, smpte_offset, s_data, 5);
+   return true;
+}
+
+/**
+ *    Callback function implementing Mf_getc().
+ *
+ * \return
+ *    Returns the value returned by getc().
+ */
+
+static int
+writer_getc (void)
+{
+   midi_file_offset_increment();
+   return getc(g_io_file);
+}
+
+/**
+ *    Makes the function assignments needed by the midifile library when
+ *    converting a MIDI file with one of the event writers.  Every event
+ *    is passed to one of the two given functions.  The caller must also
+ *    set Mf_header and Mf_starttrack.
+ *
+ * \param channel_event
+ *    Provides the function that receives the channel events.
+ *
+ * \param data_event
+ *    Provides the function that receives the meta, SysEx, and escaped
+ *    events.
+ */
+
+void
+midicvt_writer_callbacks
+(
+   midicvt_channel_event_t channel_event,
+   midicvt_data_event_t data_event
+)
+{
+   gs_channel_event  = channel_event;
+   gs_data_event     = data_event;
+   Mf_error          = writer_error;
+   Mf_endtrack       = writer_trend;
+   Mf_on             = writer_non;
+   Mf_off            = writer_noff;
+   Mf_pressure       = writer_pressure;
+   Mf_parameter      = writer_parameter;
+   Mf_pitchbend      = writer_pitchbend;
+   Mf_program        = writer_program;
+   Mf_chanpressure   = writer_chanpressure;
+   Mf_sysex          = writer_sysex;
+   Mf_metamisc       = writer_mmisc;
+   Mf_seqnum         = writer_mseq;
+   Mf_eot            = writer_meot;
+   Mf_timesig        = writer_timesig;
+   Mf_smpte          = writer_smpte;
+   Mf_tempo          = writer_tempo;
+   Mf_keysig         = writer_keysig;
+   Mf_sqspecific     = writer_mspecial;
+   Mf_text           = writer_mtext;
+   Mf_arbitrary      = writer_arbitrary;
+   Mf_getc           = writer_getc;
+}
+
+/*
+ * midicvt_writer.c
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
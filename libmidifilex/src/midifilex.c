@@ -60,7 +60,7 @@
  * \author        Other authors (see below), with modifications by Chris
  *                Ahlstrom,
  * \date          2014-04-08
- * \updates       2023-12-12
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
@@ -161,6 +161,7 @@
  *       received.  RCM bytes range from 0xF8 to 0xFF.
  */
 
+#include <setjmp.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -171,59 +172,94 @@
 
 /**
  *    Functions to be called while processing and writing the MIDI file.
+ *    These, and the rest of the state of the file being read or written,
+ *    are thread-local, so that each thread has its own parser and writer
+ *    context, and several files can be converted at the same time.
  */
 
-int (* Mf_getc) (void)                          = nullptr;
-int (* Mf_error) (const char *)                 = nullptr;
-int (* Mf_report) (const char *)                = nullptr;
-int (* Mf_header) (int, int, int)               = nullptr;
-int (* Mf_starttrack) (void)                    = nullptr;
-int (* Mf_endtrack) (long, unsigned long)       = nullptr;
-int (* Mf_on) (int, int, int)                   = nullptr;
-int (* Mf_off) (int, int, int)                  = nullptr;
-int (* Mf_pressure) (int, int, int)             = nullptr;
-int (* Mf_parameter) (int, int, int)            = nullptr;
-int (* Mf_pitchbend) (int, int, int)            = nullptr;
-int (* Mf_program) (int, int)                   = nullptr;
-int (* Mf_chanpressure) (int, int)              = nullptr;
-int (* Mf_sysex) (int, char *)                  = nullptr;
-int (* Mf_arbitrary) (int, char *)              = nullptr;
-int (* Mf_metamisc) (int, int, char *)          = nullptr;
-int (* Mf_seqnum) (short int)                   = nullptr;
-int (* Mf_eot) (void)                           = nullptr;
-int (* Mf_smpte) (int, int, int, int, int)      = nullptr;
-int (* Mf_tempo) (long)                         = nullptr;
-int (* Mf_timesig) (int, int, int, int)         = nullptr;
-int (* Mf_keysig) (int, int)                    = nullptr;
-int (* Mf_sqspecific) (int, char *)             = nullptr;
-int (* Mf_text) (int, int, char *)              = nullptr;
-int (* Mf_putc) (unsigned char)                 = nullptr;
-int (* Mf_wtrack) (void)                        = nullptr;
-int (* Mf_wtempotrack) (void)                   = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_getc) (void)                       = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_error) (const char *)              = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_report) (const char *)             = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_header) (int, int, int)            = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_starttrack) (void)                 = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_endtrack) (long, unsigned long)    = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_on) (int, int, int)                = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_off) (int, int, int)               = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_pressure) (int, int, int)          = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_parameter) (int, int, int)         = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_pitchbend) (int, int, int)         = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_program) (int, int)                = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_chanpressure) (int, int)           = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_sysex) (int, char *)               = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_arbitrary) (int, char *)           = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_metamisc) (int, int, char *)       = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_seqnum) (short int)                = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_eot) (void)                        = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_smpte) (int, int, int, int, int)   = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_tempo) (long)                      = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_timesig) (int, int, int, int)      = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_keysig) (int, int)                 = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_sqspecific) (int, char *)          = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_text) (int, int, char *)           = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_putc) (unsigned char)              = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_wtrack) (void)                     = nullptr;
+MIDICVT_THREAD_LOCAL int (* Mf_wtempotrack) (void)                = nullptr;
+
+/**
+ *    Provides a pointer that the caller can use to bind its own data,
+ *    such as a midipp::midimapper, to the callbacks of this thread.  It
+ *    is not used by this module.
+ */
+
+MIDICVT_THREAD_LOCAL void * Mf_userdata                           = nullptr;
 
 /**
  *    1 => continue'ed system exclusives are not collapsed.
  */
 
-int Mf_nomerge = 0;
+MIDICVT_THREAD_LOCAL int Mf_nomerge = 0;
 
 /**
  *    Current time in delta-time units.
  */
 
-long Mf_currtime = 0L;
+MIDICVT_THREAD_LOCAL long Mf_currtime = 0L;
 
 /**
  *    Private book-keeping global (static) variables for the number of
  *    bytes expected in an event, and the number of bytes written..
  */
 
-static long s_Mf_toberead = 0L;
-static long s_Mf_numbyteswritten = 0L;
+static MIDICVT_THREAD_LOCAL long s_Mf_toberead = 0L;
+static MIDICVT_THREAD_LOCAL long s_Mf_numbyteswritten = 0L;
+
+/**
+ *    Points to the place that mftransform_trapped() returns to when the
+ *    file it reads has an error.  Null if mftransform_trapped() is not in
+ *    use, in which case an error exits the application.
+ */
+
+static MIDICVT_THREAD_LOCAL jmp_buf * s_error_trap = nullptr;
+
+/**
+ *    Ends the reading or writing of a MIDI file after an error has been
+ *    reported.  Exits the application with an error-code of 1, unless
+ *    the file is being read by mftransform_trapped(), which then returns
+ *    false, so that one bad file does not stop the other threads.
+ */
+
+void
+mf_abort (void)
+{
+   if (not_nullptr(s_error_trap))
+      longjmp(*s_error_trap, 1);
+
+   exit(1);
+}
 
 /**
  *    Reports an error, then calls Mf_error if the Mf_error callback has
- *    been assigned, then exits with an error-code of 1.
+ *    been assigned, then calls mf_abort().
  *
  * \param s
  *    Provides the error message.
@@ -240,7 +276,7 @@ mferror (char * s)
    if (Mf_error)
        (void) (*Mf_error)(s);
 
-   exit(1);
+   mf_abort();
 }
 
 /**
@@ -357,19 +393,19 @@ egetc (void)
  *    msgleng().
  */
 
-static char * s_message_buffer = nullptr;
+static MIDICVT_THREAD_LOCAL char * s_message_buffer = nullptr;
 
 /**
  *    Holds the size of the currently allocated message buffer.
  */
 
-static int s_message_size = 0;
+static MIDICVT_THREAD_LOCAL int s_message_size = 0;
 
 /**
  *    Holds the index of next available location in s_message_buffer.
  */
 
-static int s_message_index = 0;
+static MIDICVT_THREAD_LOCAL int s_message_index = 0;
 
 /**
  *    Re-allocates the message buffer by the standard increment of 128
@@ -482,6 +518,23 @@ msgadd (int c)
    }
 }
 
+/**
+ *    Frees the message buffer when a file is done, and resets its size,
+ *    so that the next file read by this thread starts a new one.
+ */
+
+static void
+msgfree (void)
+{
+   if (not_nullptr(s_message_buffer))
+   {
+      free(s_message_buffer);
+      s_message_buffer = nullptr;
+   }
+   s_message_size = 0;
+   s_message_index = 0;
+}
+
 /*
  *    Combines egetc() and msgadd().
  *
@@ -1245,7 +1298,7 @@ chunk_size_report (long toberead)
  *    This value is use only for m2m (MIDI-to-MIDI) processing.
  */
 
-static long s_track_header_offset = 0;
+static MIDICVT_THREAD_LOCAL long s_track_header_offset = 0;
 
 /**
  *    Reads a track chunk for MIDI-to-ASCII or for
@@ -1499,11 +1552,7 @@ mfread (void)
       while (readtrack(false))         /* not in M2M mode */
           ;
    }
-   if (not_nullptr(s_message_buffer))
-   {
-      free(s_message_buffer);
-      s_message_buffer = nullptr;
-   }
+   msgfree();
 }
 
 /**
@@ -1521,24 +1570,175 @@ midifile (void)
  *    Holds the last status code.
  */
 
-static int s_laststat = 0;
+static MIDICVT_THREAD_LOCAL int s_laststat = 0;
 
 /**
  *    Holds the last meta event type.
  */
 
-static int s_lastmeta = 0;
+static MIDICVT_THREAD_LOCAL int s_lastmeta = 0;
+
+/**
+ *    Writes the events of a track chunk, without the "MTrk" header and
+ *    the track length, via the Mf_putc() callback.  This function does
+ *    not need to seek, so, with an Mf_putc() that writes to memory, the
+ *    caller can build complete track chunks even when the output is a
+ *    pipe.
+ *
+ *       -# Call the wtrack callback.
+ *       -# Write 0, meta-event, end-of-track, and 0, if the callback did
+ *          not end the track itself.
+ *
+ * \param which_track
+ *    Indicates the track number of the track to be written.  If -1, then
+ *    the track is a tempo-track.  Used only for reporting.
+ *
+ * \param wtrack
+ *    The function to call to do that actual writing.
+ *
+ * \return
+ *    Returns the number of bytes written, which is the track length to be
+ *    written in the track chunk header.
+ */
+
+unsigned long
+mf_w_track_data (int which_track, int (* wtrack)(void))
+{
+   s_Mf_numbyteswritten = 0L;          /* the header's length doesn't count   */
+   s_laststat = 0;                     /* global variable!!!                  */
+   if (mfreportable())
+   {
+      char tmp[64];
+      snprintf(tmp, sizeof tmp, "Writing track chunk %d", which_track);
+      mfreport(tmp);
+   }
+
+   /*
+    * Not sure if it is an error not have a tempo-track function wired
+    * into libmidifilex for real usage in compiling a text file into MIDI.
+    */
+
+   if (not_nullptr(wtrack))
+      (*wtrack)();                     /* global side-effects occur           */
+
+   if (s_laststat != meta_event || s_lastmeta != end_of_track)
+   {
+       eputc(0);                       /* write end of track meta event       */
+       eputc(meta_event);
+       eputc(end_of_track);
+       eputc(0);
+   }
+   s_laststat = 0;
+   return (unsigned long) s_Mf_numbyteswritten;
+}
+
+/**
+ *    Appends bytes to a track buffer, doubling its size as needed.
+ *
+ * \param tb
+ *    Provides the track buffer.
+ *
+ * \param data
+ *    Provides the bytes to append.  If null, the bytes are set to 0, to
+ *    make room for a value that is filled in later.
+ *
+ * \param size
+ *    Provides the number of bytes.
+ *
+ * \return
+ *    Returns false if out of memory, in which case nothing is appended.
+ */
+
+cbool_t
+mf_track_buffer_append
+(
+   mf_track_buffer_t * tb,
+   const unsigned char * data,
+   unsigned long size
+)
+{
+   if (tb->size + size > tb->alloc)
+   {
+      unsigned long newalloc = tb->alloc > 0 ? tb->alloc : 4096 ;
+      unsigned char * newdata;
+      while (newalloc < tb->size + size)
+         newalloc *= 2;
+
+      newdata = realloc(tb->data, newalloc);
+      if (is_nullptr(newdata))
+         return false;
+
+      tb->data = newdata;
+      tb->alloc = newalloc;
+   }
+   if (not_nullptr(data))
+      memcpy(&tb->data[tb->size], data, size);
+   else
+      memset(&tb->data[tb->size], 0, size);
+
+   tb->size += size;
+   return true;
+}
+
+/**
+ *    Frees the memory of a track buffer, and empties it, so that it can be
+ *    used again.
+ *
+ * \param tb
+ *    Provides the track buffer.
+ */
+
+void
+mf_track_buffer_free (mf_track_buffer_t * tb)
+{
+   free(tb->data);
+   tb->data = nullptr;
+   tb->size = tb->alloc = 0;
+}
+
+/**
+ *    Holds a track chunk that mf_w_track_chunk() builds in memory, when the
+ *    output file cannot seek.  It is kept from one track to the next, and
+ *    freed at the end of mfwrite().
+ */
+
+static MIDICVT_THREAD_LOCAL mf_track_buffer_t s_track_buffer;
+
+/**
+ *    Stands in for Mf_putc() while mf_w_track_chunk() builds a track in
+ *    memory.
+ *
+ * \param c
+ *    Provides the byte to append.
+ *
+ * \return
+ *    Returns the byte, or EOF if out of memory, in which case eputc()
+ *    calls mferror().
+ */
+
+static int
+trackbufputc (unsigned char c)
+{
+   return mf_track_buffer_putc(&s_track_buffer, c);
+}
 
 /**
  *    Writes a track chunk.  This involves the following steps:
  *
  *       -# Write "MTrk" (as a tricky #define in midifilex.h)
  *       -# Write 0 as the track length.
- *       -# Call the wtrack callback.
- *       -# Write 0, meta-event, end-of-track, and 0.
+ *       -# Call mf_w_track_data() to write the events.
  *       -# Go back and rewrite the 32-bit track header.
  *       -# Rewrite the 32-bit track length.
  *
+ *    If the output cannot seek, such as a pipe, the events are built in
+ *    memory instead, and then written, after the track header and the
+ *    right length, when the track is complete.
+ *
+ * \change ca 2026-10-18
+ *    Added the in-memory path for pipes.  It used to write the header a
+ *    second time after the track, which made a bad MIDI file.
+ *
  * \note
  *    Why not use the global Mf_wtrack() function instead of passing it as
  *    a parameter here?
@@ -1573,33 +1773,24 @@ mf_w_track_chunk
     */
 
    long offset = ftell(fp);
-   write32bit(trkhdr);                 /* Write the track chunk header        */
-   write32bit(trklength);
-   s_Mf_numbyteswritten = 0L;          /* the header's length doesn't count   */
-   s_laststat = 0;                     /* global variable!!!                  */
-   if (mfreportable())
+   if (offset < 0)                     /* a pipe, for example                 */
    {
-      char tmp[64];
-      snprintf(tmp, sizeof tmp, "Writing track chunk %d", which_track);
-      mfreport(tmp);
-   }
-
-   /*
-    * Not sure if it is an error not have a tempo-track function wired
-    * into libmidifilex for real usage in compiling a text file into MIDI.
-    */
-
-   if (not_nullptr(wtrack))
-      (*wtrack)();                     /* global side-effects occur           */
-
-   if (s_laststat != meta_event || s_lastmeta != end_of_track)
-   {
-       eputc(0);                       /* write end of track meta event       */
-       eputc(meta_event);
-       eputc(end_of_track);
-       eputc(0);
+      int (* putc_func) (unsigned char) = Mf_putc;
+      unsigned long i;
+      s_track_buffer.size = 0;
+      Mf_putc = trackbufputc;
+      trklength = mf_w_track_data(which_track, wtrack);
+      Mf_putc = putc_func;
+      write32bit(trkhdr);
+      write32bit(trklength);
+      for (i = 0; i < s_track_buffer.size; ++i)
+         eputc(s_track_buffer.data[i]);
+
+      return;
    }
-   s_laststat = 0;
+   write32bit(trkhdr);                 /* Write the track chunk header        */
+   write32bit(trklength);
+   (void) mf_w_track_data(which_track, wtrack);
 
    /*
     * It's impossible to know how long the track chunk will be beforehand,
@@ -1786,6 +1977,8 @@ mfwrite (int format, int ntracks, int division, FILE * fp)
    }
    for (i = 0; i < ntracks; i++)       /* rest of file is a series of tracks  */
        mf_w_track_chunk(i, fp, Mf_wtrack);
+
+   mf_track_buffer_free(&s_track_buffer);  /* used only if fp cannot seek     */
 }
 
 /**
@@ -1846,7 +2039,7 @@ mf_w_midi_event
 )
 {
 #if 0
-   static int s_runstat = 0;           /* if non-zero, use running status     */
+   static MIDICVT_THREAD_LOCAL int s_runstat = 0;  /* non-zero: running status */
 #endif
    int i;
    unsigned char c;
@@ -2102,10 +2295,37 @@ mftransform (void)
       while (readtrack(true))          /* use M2M mode   */
           ;
    }
-   if (not_nullptr(s_message_buffer))
+   msgfree();
+}
+
+/**
+ *    Does the same as mftransform(), but if the MIDI file has an error,
+ *    returns false instead of exiting the application.  This lets a
+ *    thread that converts many files go on to the next one.
+ *
+ *    The callbacks must not leave anything that needs cleaning up on the
+ *    stack when they report an error, since it is skipped by longjmp().
+ *
+ * \return
+ *    Returns true if the whole file was transformed.
+ */
+
+cbool_t
+mftransform_trapped (void)
+{
+   jmp_buf trap;
+   if (setjmp(trap) == 0)
    {
-      free(s_message_buffer);
-      s_message_buffer = nullptr;
+      s_error_trap = &trap;
+      mftransform();
+      s_error_trap = nullptr;
+      return true;
+   }
+   else
+   {
+      s_error_trap = nullptr;
+      msgfree();
+      return false;
    }
 }
 
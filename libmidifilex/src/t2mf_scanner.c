@@ -0,0 +1,926 @@
+/*
+ * midicvt - A text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          t2mf_scanner.c
+ *
+ *    This module provides a hand-written scanner for the --compile option,
+ *    as a faster alternative to the flex scanner generated from t2mf.fl.
+ *
+ * \library       midicvt application
+ * \author        Chris Ahlstrom and many other authors
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    The flex scanner reads yyin through its own buffer, copies every
+ *    token into yytext, and converts numbers with sscanf().  For large
+ *    ASCII files, that is where most of the time of "midicvt -c" goes.
+ *
+ *    This scanner instead maps the whole input file into memory (or reads
+ *    it into one buffer, for a pipe), and returns exactly the same tokens
+ *    as yylex(), with yytext and yyleng pointing at the token inside the
+ *    file data, without any copying.  Integers are converted in place.
+ *    The keywords are found with a perfect hash on the length and the
+ *    first, second, and last letters, followed by a single comparison.
+ *
+ *    The rules of t2mf.fl are followed exactly, including its longest-match
+ *    behavior, the -i (ignore case) flag it is built with, and the HEX and
+ *    QUOTE start conditions used by gethex() in midicvt_base.c.  The
+ *    globals do_hex, eol_seen, lineno, and yyval are shared with the flex
+ *    scanner.  The --flex option selects the flex scanner instead.
+ *
+ *    The one difference is that yytext is not null-terminated at the end of
+ *    the token, nor at the end of the file.  Callers must use yyleng, as
+ *    prs_error(), gethex(), and note_value() do.
+ */
+
+#include <stdio.h>                     /* FILE *, fread(), fileno()           */
+#include <stdlib.h>                    /* malloc(), realloc(), free()         */
+#include <string.h>                    /* memchr()                            */
+#include <sys/mman.h>                  /* mmap(), munmap(), UNIX/Linux only   */
+#include <sys/stat.h>                  /* fstat()                             */
+
+#include <midicvt_macros.h>            /* nullptr, true, false, etc.          */
+#include <midicvt_base.h>              /* error()                             */
+#include <t2mf.h>                      /* tokens, yytext, yyleng, yyval, etc. */
+
+/**
+ *    Provides the size of the chunks used to read a non-regular input
+ *    file, such as a pipe, into memory.
+ */
+
+#define SCAN_READ_SIZE              (64 * 1024)
+
+/**
+ *    Provides the length of the longest keyword, "copyright" or
+ *    "instrname".  Longer words are not looked up.
+ */
+
+#define SCAN_KEYWORD_MAX            9
+
+/**
+ *    Provides the perfect hash of a keyword, given its length and its
+ *    first, second, and last letters, already in lower case.  For
+ *    one-letter keywords, the "second" letter is the first one again.
+ *    The coefficients were found by a brute-force search so that no two
+ *    keywords collide in a table of 128 entries.  If a keyword is added,
+ *    a new search may be needed; t2mf_scanner_open() checks the table in
+ *    debug builds.
+ */
+
+#define SCAN_HASH(len, c0, c1, cn) \
+   (((len) + 4 * (c0) + 10 * (c1) + 7 * (cn)) & 127)
+
+/**
+ *    The states of the scanner, matching the start conditions of t2mf.fl.
+ */
+
+typedef enum
+{
+   SCAN_INITIAL,
+   SCAN_HEX,
+   SCAN_QUOTE
+
+} scan_state_t;
+
+/**
+ *    Holds one keyword of the ASCII format.
+ */
+
+typedef struct
+{
+   /**
+    *    The keyword, in lower case.
+    */
+
+   const char * name;
+
+   /**
+    *    The length of the keyword.
+    */
+
+   int length;
+
+   /**
+    *    The token returned for the keyword.
+    */
+
+   int token;
+
+   /**
+    *    If true, the keyword must be followed by '=', as in "ch=".  The
+    *    '=' is part of the token.
+    */
+
+   cbool_t equals;
+
+} scan_keyword_t;
+
+/**
+ *    Provides the keywords, with the same spellings as t2mf.fl.  Entry 0
+ *    is a placeholder for "no keyword" in s_hash_index.
+ */
+
+static const scan_keyword_t s_keywords [] =
+{
+   /*  0 */ { nullptr,     0, ERR,       false },
+   /*  1 */ { "mfile",     5, MTHD,      false },
+   /*  2 */ { "mthd",      4, MTHD,      false },
+   /*  3 */ { "mtrk",      4, MTRK,      false },
+   /*  4 */ { "trkend",    6, TRKEND,    false },
+   /*  5 */ { "on",        2, ON,        false },
+   /*  6 */ { "off",       3, OFF,       false },
+   /*  7 */ { "popr",      4, POPR,      false },
+   /*  8 */ { "polypr",    6, POPR,      false },
+   /*  9 */ { "par",       3, PAR,       false },
+   /* 10 */ { "param",     5, PAR,       false },
+   /* 11 */ { "pb",        2, PB,        false },
+   /* 12 */ { "prch",      4, PRCH,      false },
+   /* 13 */ { "progch",    6, PRCH,      false },
+   /* 14 */ { "chpr",      4, CHPR,      false },
+   /* 15 */ { "chanpr",    6, CHPR,      false },
+   /* 16 */ { "sysex",     5, SYSEX,     false },
+   /* 17 */ { "meta",      4, META,      false },
+   /* 18 */ { "seqspec",   7, SEQSPEC,   false },
+   /* 19 */ { "text",      4, TEXT,      false },
+   /* 20 */ { "copyright", 9, COPYRIGHT, false },
+   /* 21 */ { "trkname",   7, SEQNAME,   false },
+   /* 22 */ { "seqname",   7, SEQNAME,   false },
+   /* 23 */ { "instrname", 9, INSTRNAME, false },
+   /* 24 */ { "lyric",     5, LYRIC,     false },
+   /* 25 */ { "marker",    6, MARKER,    false },
+   /* 26 */ { "cue",       3, CUE,       false },
+   /* 27 */ { "seqnr",     5, SEQNR,     false },
+   /* 28 */ { "keysig",    6, KEYSIG,    false },
+   /* 29 */ { "tempo",     5, TEMPO,     false },
+   /* 30 */ { "timesig",   7, TIMESIG,   false },
+   /* 31 */ { "smpte",     5, SMPTE,     false },
+   /* 32 */ { "arb",       3, ARB,       false },
+   /* 33 */ { "minor",     5, MINOR,     false },
+   /* 34 */ { "major",     5, MAJOR,     false },
+   /* 35 */ { "ch",        2, CH,        true },
+   /* 36 */ { "n",         1, NOTE,      true },
+   /* 37 */ { "note",      4, NOTE,      true },
+   /* 38 */ { "v",         1, VAL,       true },
+   /* 39 */ { "val",       3, VAL,       true },
+   /* 40 */ { "vol",       3, VAL,       true },
+   /* 41 */ { "c",         1, CON,       true },
+   /* 42 */ { "con",       3, CON,       true },
+   /* 43 */ { "p",         1, PROG,      true },
+   /* 44 */ { "prog",      4, PROG,      true }
+};
+
+/**
+ *    Maps the SCAN_HASH() value of a keyword to its index in s_keywords.
+ *    A 0 means that no keyword has that hash.
+ */
+
+static const unsigned char s_hash_index [128] =
+{
+    0,  0,  0,  0,  0,  6,  4, 36, 22, 44, 10,  0,  5,  0, 21,  0,
+   12,  0, 13,  0,  0,  0,  0, 20,  0, 39,  0,  0,  0,  0,  0,  0,
+   41, 34, 25,  0, 24, 40,  0,  0,  0, 32,  0,  9,  0,  3,  0, 38,
+    0, 43,  0,  0,  0,  0,  0,  0,  7,  0,  8,  0, 23,  0, 14,  0,
+   15,  0, 30,  0, 11,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   29, 17,  0, 16,  0, 37, 31,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    0, 27,  0,  0, 26,  0,  0, 42,  0,  0,  0,  0,  0,  0,  0,  0,
+    0, 33, 19,  0,  0, 28, 35,  0,  1,  0, 18,  0,  2,  0,  0,  0
+};
+
+/**
+ *    Points to the start of the input data.
+ */
+
+static const char * gs_scan_data = nullptr;
+
+/**
+ *    Points to the next character to be scanned.
+ */
+
+static const char * gs_scan_ptr = nullptr;
+
+/**
+ *    Points just past the end of the input data.
+ */
+
+static const char * gs_scan_end = nullptr;
+
+/**
+ *    Provides the size of the mapping, if the data is mapped, or 0 if it
+ *    was read into a buffer.
+ */
+
+static size_t gs_scan_mapped = 0;
+
+/**
+ *    Provides the current start condition.
+ */
+
+static scan_state_t gs_scan_state = SCAN_INITIAL;
+
+/**
+ *    Tests for an ASCII letter.
+ */
+
+static int
+scan_is_letter (int c)
+{
+   return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+/**
+ *    Tests for a decimal digit.
+ */
+
+static int
+scan_is_digit (int c)
+{
+   return c >= '0' && c <= '9';
+}
+
+/**
+ *    Converts a hexadecimal digit to its value.
+ *
+ * \return
+ *    Returns the value, or -1 if the character is not a hexadecimal digit.
+ */
+
+static int
+scan_hex_value (int c)
+{
+   if (c >= '0' && c <= '9')
+      return c - '0';
+   else if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   else if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+   else
+      return -1;
+}
+
+/**
+ *    Sets yytext and yyleng to a token, and moves past it.
+ *
+ * \param start
+ *    Provides the start of the token.
+ *
+ * \param length
+ *    Provides the length of the token.
+ */
+
+static void
+scan_token (const char * start, size_t length)
+{
+   yytext = (char *) start;
+   yyleng = length;
+   gs_scan_ptr = start + length;
+}
+
+/**
+ *    Looks up a word of letters in the keyword table.
+ *
+ * \param p
+ *    Provides the start of the word.
+ *
+ * \param length
+ *    Provides the number of letters in the word.
+ *
+ * \return
+ *    Returns a pointer to the keyword, or a null pointer if the word is
+ *    not a keyword.
+ */
+
+static const scan_keyword_t *
+scan_keyword (const char * p, int length)
+{
+   if (length <= SCAN_KEYWORD_MAX)
+   {
+      int c0 = p[0] | 0x20;
+      int c1 = length > 1 ? p[1] | 0x20 : c0 ;
+      int cn = p[length - 1] | 0x20;
+      const scan_keyword_t * k =
+         &s_keywords[s_hash_index[SCAN_HASH(length, c0, c1, cn)]];
+
+      if (k->length == length)
+      {
+         int i;
+         for (i = 0; i < length; ++i)
+         {
+            if ((p[i] | 0x20) != k->name[i])
+               return nullptr;
+         }
+         return k;
+      }
+   }
+   return nullptr;
+}
+
+/**
+ *    Scans a word that starts with a letter, in the INITIAL state.  The
+ *    longest match among the NOTEVAL pattern, the keywords, and the
+ *    catch-all "[a-z]+" error pattern wins, as in flex.
+ *
+ * \return
+ *    Returns the token.
+ */
+
+static int
+scan_word (void)
+{
+   const char * p = gs_scan_ptr;
+   const scan_keyword_t * k;
+   int length = 1;
+   int c = p[0] | 0x20;
+   if (c >= 'a' && c <= 'g')           /* [a-g][#b+-]?[0-9]+, NOTEVAL     */
+   {
+      int n = 1;
+      if (p + 1 < gs_scan_end)
+      {
+         int c1 = p[1];
+         if (c1 == '#' || c1 == '+' || c1 == '-' || c1 == 'b' || c1 == 'B')
+            ++n;
+      }
+      if (p + n < gs_scan_end && scan_is_digit(p[n]))
+      {
+         while (p + n < gs_scan_end && scan_is_digit(p[n]))
+            ++n;
+
+         scan_token(p, (size_t) n);
+         return NOTEVAL;
+      }
+   }
+   while (p + length < gs_scan_end && scan_is_letter(p[length]))
+      ++length;
+
+   k = scan_keyword(p, length);
+   if (not_nullptr(k))
+   {
+      if (! k->equals)
+      {
+         scan_token(p, (size_t) length);
+         return k->token;
+      }
+      else if (p + length < gs_scan_end && p[length] == '=')
+      {
+         scan_token(p, (size_t) length + 1);
+         return k->token;
+      }
+   }
+   scan_token(p, (size_t) length);
+   return ERR;
+}
+
+/**
+ *    Scans a decimal integer with an optional sign, or a hexadecimal
+ *    integer starting with "0x", in the INITIAL state, and sets yyval.
+ *    The value wraps around on overflow, instead of being undefined as
+ *    with sscanf().
+ *
+ * \return
+ *    Returns INT.
+ */
+
+static int
+scan_number (void)
+{
+   const char * p = gs_scan_ptr;
+   unsigned long value = 0;
+   int n = 0;
+   if
+   (
+      p[0] == '0' && p + 2 < gs_scan_end &&
+      (p[1] == 'x' || p[1] == 'X') && scan_hex_value(p[2]) >= 0
+   )
+   {
+      int h;
+      n = 2;
+      while (p + n < gs_scan_end && (h = scan_hex_value(p[n])) >= 0)
+      {
+         value = value * 16 + (unsigned long) h;
+         ++n;
+      }
+      yyval = (long) value;
+   }
+   else
+   {
+      cbool_t negative = p[0] == '-';
+      if (p[0] == '-' || p[0] == '+')
+         n = 1;
+
+      while (p + n < gs_scan_end && scan_is_digit(p[n]))
+      {
+         value = value * 10 + (unsigned long) (p[n] - '0');
+         ++n;
+      }
+      yyval = negative ? -(long) value : (long) value;
+   }
+   scan_token(p, (size_t) n);
+   return INT;
+}
+
+/**
+ *    Scans the rest of a quoted string, in the QUOTE state.  As with the
+ *    flex scanner, yytext starts just after the opening quote and
+ *    includes the closing quote, and escape sequences are left for
+ *    gethex() to handle.
+ *
+ * \param start
+ *    Provides the first character after the opening quote.
+ *
+ * \return
+ *    Returns STRING, or EOL for a line ending in the string, or EOF.
+ */
+
+static int
+scan_string (const char * start)
+{
+   const char * p = start;
+   while (p < gs_scan_end)
+   {
+      char c = *p;
+      if (c == '"')
+      {
+         gs_scan_state = SCAN_INITIAL;
+         scan_token(start, (size_t) (p - start + 1));
+         return STRING;
+      }
+      else if (c == '\\')
+      {
+         if (p + 1 >= gs_scan_end)
+            break;
+
+         p += 2;                       /* even an escaped newline         */
+      }
+      else if (c == '\n')
+      {
+         error("unterminated string");
+         ++lineno;
+         ++eol_seen;
+         gs_scan_state = SCAN_INITIAL;
+         scan_token(start, (size_t) (p - start + 1));
+         return EOL;
+      }
+      else
+         ++p;
+   }
+   error("EOF in string");
+   gs_scan_ptr = gs_scan_end;
+   yytext = (char *) gs_scan_end;
+   yyleng = 0;
+   return EOF;
+}
+
+/**
+ *    Scans a token in the HEX state, where one or two hexadecimal digits
+ *    make an INT, and any other word is an error that ends the HEX state.
+ *
+ * \return
+ *    Returns INT or ERR.
+ */
+
+static int
+scan_hex (void)
+{
+   const char * p = gs_scan_ptr;
+   int h = scan_hex_value(p[0]);
+   if (h >= 0)
+   {
+      int h2 = p + 1 < gs_scan_end ? scan_hex_value(p[1]) : -1 ;
+      if (h2 >= 0)
+      {
+         yyval = h * 16 + h2;
+         scan_token(p, 2);
+      }
+      else
+      {
+         yyval = h;
+         scan_token(p, 1);
+      }
+      return INT;
+   }
+   else
+   {
+      int c = p[0] | 0x20;
+      size_t length = 1;
+      if (scan_is_letter(p[0]) && c >= 'g')    /* [g-z][a-z]+             */
+      {
+         while (p + length < gs_scan_end && scan_is_letter(p[length]))
+            ++length;
+      }
+      gs_scan_state = SCAN_INITIAL;
+      scan_token(p, length);
+      return ERR;
+   }
+}
+
+/**
+ *    Provides the replacement for yylex().  Returns the next token of the
+ *    input, setting yytext, yyleng, yyval, lineno, and eol_seen just as
+ *    the flex scanner does.
+ *
+ * \return
+ *    Returns the token, or EOF at the end of the input.
+ */
+
+int
+t2mf_scanner_lex (void)
+{
+   if (do_hex)
+   {
+      gs_scan_state = SCAN_HEX;
+      do_hex = 0;
+   }
+   eol_seen = 0;
+   if (gs_scan_state == SCAN_QUOTE)
+      return scan_string(gs_scan_ptr);
+
+   while (gs_scan_ptr < gs_scan_end)
+   {
+      const char * p = gs_scan_ptr;
+      char c = *p;
+      if (c == ' ' || c == '\t' || c == '\r')
+      {
+         ++gs_scan_ptr;
+      }
+      else if (c == '\n')
+      {
+         ++lineno;
+         ++eol_seen;
+         gs_scan_state = SCAN_INITIAL;
+         scan_token(p, 1);
+         return EOL;
+      }
+      else if (c == '#')                  /* "#".*\n, a comment           */
+      {
+         const char * q = p + 1;
+         while (q < gs_scan_end && *q != '\n')
+            ++q;
+
+         if (q == gs_scan_end)            /* no newline, just '.'         */
+         {
+            if (gs_scan_state == SCAN_HEX)
+               gs_scan_state = SCAN_INITIAL;
+
+            scan_token(p, 1);
+            return ERR;
+         }
+         ++lineno;
+         gs_scan_ptr = q + 1;
+      }
+      else if (c == '\\')                 /* \\[ \t\r]*\n, a continuation */
+      {
+         const char * q = p + 1;
+         while (q < gs_scan_end && (*q == ' ' || *q == '\t' || *q == '\r'))
+            ++q;
+
+         if (q < gs_scan_end && *q == '\n')
+         {
+            ++lineno;
+            gs_scan_ptr = q + 1;
+         }
+         else
+         {
+            if (gs_scan_state == SCAN_HEX)
+               gs_scan_state = SCAN_INITIAL;
+
+            scan_token(p, 1);
+            return ERR;
+         }
+      }
+      else if (c == '"')
+      {
+         gs_scan_state = SCAN_QUOTE;
+         return scan_string(p + 1);
+      }
+      else if (gs_scan_state == SCAN_HEX)
+      {
+         return scan_hex();
+      }
+      else if (scan_is_letter(c))
+      {
+         return scan_word();
+      }
+      else if
+      (
+         scan_is_digit(c) ||
+         (
+            (c == '-' || c == '+') &&
+            p + 1 < gs_scan_end && scan_is_digit(p[1])
+         )
+      )
+      {
+         return scan_number();
+      }
+      else if (c == ':' || c == '/')
+      {
+         scan_token(p, 1);
+         return '/';
+      }
+      else if (c == '$')                  /* \$[A-H1-8]+, a bank number   */
+      {
+         size_t n = 1;
+         while (p + n < gs_scan_end)
+         {
+            int b = p[n] | 0x20;
+            if ((b >= 'a' && b <= 'h') || (p[n] >= '1' && p[n] <= '8'))
+               ++n;
+            else
+               break;
+         }
+         if (n > 1)
+         {
+            yyval = bankno((char *) p + 1, (int) n - 1);
+            scan_token(p, n);
+            return INT;
+         }
+         scan_token(p, 1);
+         return ERR;
+      }
+      else
+      {
+         scan_token(p, 1);
+         return ERR;
+      }
+   }
+   yytext = (char *) gs_scan_end;
+   yyleng = 0;
+   return EOF;
+}
+
+/**
+ *    Loads the whole input file for t2mf_scanner_lex().  A regular file
+ *    is mapped into memory.  Anything else is read into a buffer.
+ *
+ * \param fp
+ *    Provides the input file, normally yyin.
+ *
+ * \return
+ *    Returns true if the input could be loaded.
+ */
+
+cbool_t
+t2mf_scanner_open (FILE * fp)
+{
+   struct stat st;
+   int fd;
+   t2mf_scanner_close();
+   if (is_nullptr(fp))
+      return false;
+
+#ifdef DEBUG
+   {
+      int i;
+      for (i = 1; i < (int) (sizeof(s_keywords) / sizeof(s_keywords[0])); ++i)
+      {
+         if (scan_keyword(s_keywords[i].name, s_keywords[i].length) !=
+            &s_keywords[i])
+         {
+            errprint("t2mf_scanner_open(): bad keyword hash table");
+            return false;
+         }
+      }
+   }
+#endif
+
+   fd = fileno(fp);
+   if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+   {
+      size_t size = (size_t) st.st_size;
+      void * m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (m != MAP_FAILED)
+      {
+         gs_scan_data = (const char *) m;
+         gs_scan_end = gs_scan_data + size;
+         gs_scan_mapped = size;
+      }
+   }
+   if (is_nullptr(gs_scan_data))
+   {
+      char * buffer = nullptr;
+      size_t alloc = 0;
+      size_t size = 0;
+      for (;;)
+      {
+         size_t count;
+         if (size + SCAN_READ_SIZE + 1 > alloc)
+         {
+            char * b;
+            alloc = alloc > 0 ? alloc * 2 : SCAN_READ_SIZE * 2;
+            b = realloc(buffer, alloc);
+            if (is_nullptr(b))
+            {
+               free(buffer);
+               errprint("t2mf_scanner_open(): out of memory for the input");
+               return false;
+            }
+            buffer = b;
+         }
+         count = fread(&buffer[size], 1, SCAN_READ_SIZE, fp);
+         size += count;
+         if (count == 0)
+            break;
+      }
+      buffer[size] = 0;
+      gs_scan_data = buffer;
+      gs_scan_end = buffer + size;
+      gs_scan_mapped = 0;
+   }
+   gs_scan_ptr = gs_scan_data;
+   gs_scan_state = SCAN_INITIAL;
+   return true;
+}
+
+/**
+ *    Gets the current position of the scanner, for t2mf_scanner_seek().
+ *
+ * \return
+ *    Returns the offset, from the start of the input, of the first
+ *    character that has not yet been scanned.
+ */
+
+long
+t2mf_scanner_tell (void)
+{
+   return (long) (gs_scan_ptr - gs_scan_data);
+}
+
+/**
+ *    Gets a pointer to the input data, such as the text of a track.
+ *
+ * \param offset
+ *    Provides the offset from the start of the input.
+ *
+ * \return
+ *    Returns a pointer to the data at that offset.
+ */
+
+const char *
+t2mf_scanner_text (long offset)
+{
+   return gs_scan_data + offset;
+}
+
+/**
+ * \getter gs_scan_end
+ *
+ * \return
+ *    Returns the size of the input data.
+ */
+
+long
+t2mf_scanner_size (void)
+{
+   return (long) (gs_scan_end - gs_scan_data);
+}
+
+/**
+ *    Finds the column of the current token, yytext, for error messages.
+ *    Since the whole input is in memory, and lineno is already kept up to
+ *    date, the column is found by looking back from the token to the
+ *    start of its line.  Nothing is done until an error asks for it.
+ *
+ * \return
+ *    Returns the column, starting at 1, or 0 if yytext is not in the
+ *    input data.
+ */
+
+int
+t2mf_scanner_column (void)
+{
+   const char * p = yytext;
+   const char * q;
+   if (is_nullptr(gs_scan_data) || p < gs_scan_data || p > gs_scan_end)
+      return 0;
+
+   for (q = p; q > gs_scan_data && q[-1] != '\n'; --q)
+      ;
+
+   return (int) (p - q) + 1;
+}
+
+/**
+ *    Moves the scanner to a new position in the input.  The position
+ *    must be outside of any string, such as the start of a line.
+ *
+ * \param offset
+ *    Provides the offset of the new position, as returned by
+ *    t2mf_scanner_tell() or t2mf_scanner_find_tracks().
+ *
+ * \param line
+ *    Provides the line number at the new position, for error messages.
+ */
+
+void
+t2mf_scanner_seek (long offset, int line)
+{
+   gs_scan_ptr = gs_scan_data + offset;
+   gs_scan_state = SCAN_INITIAL;
+   lineno = line;
+   eol_seen = 1;
+   do_hex = 0;
+}
+
+/**
+ *    Finds the lines that start an MTrk section, from the current
+ *    position to the end of the input, without scanning any tokens.
+ *    A line starts a section if its first word is "MTrk", in any case.
+ *
+ *    This is only a quick pre-scan.  Since it does not know about
+ *    strings that continue onto the next line, a caller must check that
+ *    the scanner really ends each track where the next one starts.
+ *
+ * \param offsets
+ *    Provides an array to hold the offset of each "MTrk".
+ *
+ * \param lines
+ *    Provides an array to hold the line number of each "MTrk".
+ *
+ * \param count
+ *    Provides the number of elements in each array.
+ *
+ * \return
+ *    Returns the number of "MTrk" lines found, which can be more than
+ *    \a count.
+ */
+
+int
+t2mf_scanner_find_tracks (long * offsets, int * lines, int count)
+{
+   int found = 0;
+   int line = lineno;
+   const char * p = gs_scan_ptr;
+   while (p < gs_scan_end)
+   {
+      const char * eol;
+      while (p < gs_scan_end && (*p == ' ' || *p == '\t' || *p == '\r'))
+         ++p;
+
+      if
+      (
+         gs_scan_end - p >= 4 &&
+         (p[0] | 0x20) == 'm' && (p[1] | 0x20) == 't' &&
+         (p[2] | 0x20) == 'r' && (p[3] | 0x20) == 'k' &&
+         (gs_scan_end - p == 4 || ! scan_is_letter(p[4]))
+      )
+      {
+         if (found < count)
+         {
+            offsets[found] = (long) (p - gs_scan_data);
+            lines[found] = line;
+         }
+         ++found;
+      }
+      eol = memchr(p, '\n', (size_t) (gs_scan_end - p));
+      if (is_nullptr(eol))
+         break;
+
+      p = eol + 1;
+      ++line;
+   }
+   return found;
+}
+
+/**
+ *    Unmaps or frees the input data loaded by t2mf_scanner_open().
+ */
+
+void
+t2mf_scanner_close (void)
+{
+   if (not_nullptr(gs_scan_data))
+   {
+      if (gs_scan_mapped > 0)
+         (void) munmap((void *) gs_scan_data, gs_scan_mapped);
+      else
+         free((void *) gs_scan_data);
+   }
+   gs_scan_data = gs_scan_ptr = gs_scan_end = nullptr;
+   gs_scan_mapped = 0;
+}
+
+/*
+ * t2mf_scanner.c
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=c
+ */
@@ -0,0 +1,353 @@
+#ifndef MIDIPP_FLATMAP_HPP
+#define MIDIPP_FLATMAP_HPP
+
+/*
+ * midicvtpp - A MIDI-text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          flatmap.hpp
+ *
+ *    This module defines a sorted-vector stand-in for std::map, for
+ *    containers that are filled once and then looked up many times.
+ *
+ * \library       libmidipp
+ * \author        Chris Ahlstrom
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ */
+
+#include <algorithm>                   /* std::lower_bound(), stable_sort()   */
+#include <utility>                     /* std::pair                           */
+#include <vector>                      /* std::vector                         */
+
+namespace midipp
+{
+
+/**
+ *    Provides the subset of the std::map interface that stringmap and
+ *    initree use, on top of a std::vector of key/value pairs kept sorted
+ *    by key.
+ *
+ *    An std::map allocates one node per element, so a lookup hops from
+ *    node to node all over the heap.  Here the elements sit side by side,
+ *    and find() is a binary search over contiguous memory.  Iteration
+ *    visits the keys in the same order that std::map does, so callers
+ *    that walk the container see no difference.
+ *
+ *    The price is that insert() shifts the elements after the insertion
+ *    point, and invalidates all iterators and references into the
+ *    container, so that filling a large container with insert() takes
+ *    time that grows as the square of its size.  A container that is
+ *    filled all at once, as the INI data is while parsing, is instead
+ *    filled with append(), and then sorted once with sort().
+ *
+ * \warning
+ *    Unlike std::map, the key in the value_type is not const.  Do not
+ *    change it through an iterator, or the container will no longer be
+ *    sorted.
+ */
+
+template <class KEYTYPE, class VALUETYPE>
+class flatmap
+{
+
+public:
+
+   /**
+    *    Provides the element type, a key/value pair.
+    */
+
+   typedef std::pair<KEYTYPE, VALUETYPE> value_type;
+
+   /**
+    *    Provides the type of the underlying sorted vector.
+    */
+
+   typedef std::vector<value_type> Container;
+
+   /**
+    *    Provides a constant-iterator type for notational convenience.
+    */
+
+   typedef typename Container::const_iterator const_iterator;
+
+   /**
+    *    Provides an iterator type for notational convenience.
+    */
+
+   typedef typename Container::iterator iterator;
+
+private:
+
+   /**
+    *    Orders the elements, and a lookup key against an element, by key
+    *    alone.
+    */
+
+   struct key_less
+   {
+      bool operator () (const value_type & a, const KEYTYPE & k) const
+      {
+         return a.first < k;
+      }
+   };
+
+   /**
+    *    Orders the indices of two elements by the keys of the elements,
+    *    for sort().
+    */
+
+   struct index_less
+   {
+      const Container & elements;
+
+      explicit index_less (const Container & c) : elements (c)
+      {
+         // done
+      }
+
+      bool operator () (size_t a, size_t b) const
+      {
+         return elements[a].first < elements[b].first;
+      }
+   };
+
+   /**
+    *    Holds the elements, sorted by key, with no duplicate keys.
+    */
+
+   Container m_elements;
+
+public:
+
+   /**
+    * \defaultctor
+    *    Creates an empty container.
+    */
+
+   flatmap () : m_elements ()
+   {
+      // done
+   }
+
+   /**
+    *    Inserts a key/value pair, unless the key is already present, in
+    *    which case the container is left alone, as with std::map.
+    *
+    * \param v
+    *    The key/value pair to be copied into the container.
+    *
+    * \return
+    *    Returns an iterator to the element with the key, and true if it
+    *    was newly inserted.
+    */
+
+   std::pair<iterator, bool> insert (const value_type & v)
+   {
+      iterator i = std::lower_bound
+      (
+         m_elements.begin(), m_elements.end(), v.first, key_less()
+      );
+      if (i != m_elements.end() && ! (v.first < i->first))
+         return std::make_pair(i, false);
+
+      return std::make_pair(m_elements.insert(i, v), true);
+   }
+
+   /**
+    *    Adds a key/value pair at the end, without looking for its place
+    *    or for a duplicate key, so that filling the container costs no
+    *    more than filling a vector.  The container cannot be searched
+    *    again until sort() is called.
+    *
+    * \param v
+    *    The key/value pair to be copied into the container.
+    */
+
+   void append (const value_type & v)
+   {
+      m_elements.push_back(v);
+   }
+
+   /**
+    *    Sorts the elements added by append(), once, so that find() can be
+    *    used.  If a key was appended more than once, the first element
+    *    appended with a key already present is dropped, along with every
+    *    element appended after it.  That leaves the elements that a
+    *    series of insert() calls would have added before the first one
+    *    that failed.
+    *
+    * \return
+    *    Returns true if no key was appended more than once.
+    */
+
+   bool sort ()
+   {
+      size_t count = m_elements.size();
+      std::vector<size_t> order(count);
+      for (size_t i = 0; i < count; ++i)
+         order[i] = i;
+
+      std::stable_sort(order.begin(), order.end(), index_less(m_elements));
+
+      size_t first = count;            /* first duplicate, as appended      */
+      for (size_t i = 1; i < count; ++i)
+      {
+         const KEYTYPE & previous = m_elements[order[i - 1]].first;
+         if (! (previous < m_elements[order[i]].first) && order[i] < first)
+            first = order[i];
+      }
+
+      Container sorted;
+      sorted.reserve(first);
+      for (size_t i = 0; i < count; ++i)
+      {
+         if (order[i] < first)
+            sorted.push_back(m_elements[order[i]]);
+      }
+      m_elements.swap(sorted);
+      return first == count;
+   }
+
+   /**
+    *    Looks up a key by binary search.
+    *
+    * \param key
+    *    The key to be looked up.
+    *
+    * \return
+    *    Returns an iterator to the element, or end() if not found.
+    */
+
+   iterator find (const KEYTYPE & key)
+   {
+      iterator i = std::lower_bound
+      (
+         m_elements.begin(), m_elements.end(), key, key_less()
+      );
+      if (i != m_elements.end() && ! (key < i->first))
+         return i;
+
+      return m_elements.end();
+   }
+
+   /**
+    *    Looks up a key by binary search.  This is the const version.
+    *
+    * \param key
+    *    The key to be looked up.
+    *
+    * \return
+    *    Returns a const iterator to the element, or end() if not found.
+    */
+
+   const_iterator find (const KEYTYPE & key) const
+   {
+      const_iterator i = std::lower_bound
+      (
+         m_elements.begin(), m_elements.end(), key, key_less()
+      );
+      if (i != m_elements.end() && ! (key < i->first))
+         return i;
+
+      return m_elements.end();
+   }
+
+   /**
+    * \accessor m_elements.begin()
+    */
+
+   iterator begin ()
+   {
+      return m_elements.begin();
+   }
+
+   /**
+    * \accessor m_elements.begin() const
+    */
+
+   const_iterator begin () const
+   {
+      return m_elements.begin();
+   }
+
+   /**
+    * \accessor m_elements.end()
+    */
+
+   iterator end ()
+   {
+      return m_elements.end();
+   }
+
+   /**
+    * \accessor m_elements.end() const
+    */
+
+   const_iterator end () const
+   {
+      return m_elements.end();
+   }
+
+   /**
+    * \accessor m_elements.size()
+    */
+
+   size_t size () const
+   {
+      return m_elements.size();
+   }
+
+   /**
+    * \accessor m_elements.empty()
+    */
+
+   bool empty () const
+   {
+      return m_elements.empty();
+   }
+
+   /**
+    *    Empties the container.
+    */
+
+   void clear ()
+   {
+      m_elements.clear();
+   }
+
+};                // class flatmap
+
+}                 // namespace midipp
+
+#endif            // MIDIPP_FLATMAP_HPP
+
+/******************************************************************************
+ * flatmap.hpp
+ *-----------------------------------------------------------------------------
+ * Local Variables:
+ * End:
+ *-----------------------------------------------------------------------------
+ * vim: ts=3 sw=3 et ft=cpp
+ *----------------------------------------------------------------------------*/
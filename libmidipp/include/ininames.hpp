@@ -10,7 +10,7 @@
  * \library       libmidipp
  * \author        Chris Ahlstrom
  * \date          2014-05-06
- * \updates       2014-05-17
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       $XPC_SUITE_GPL_LICENSE$
  *
@@ -26,13 +26,17 @@ namespace midipp
 
 /**
  *    Provides a selection switch for the supported INI section types.
- *    Currently that includes "Drum" and "Patch" sections.
+ *    Currently that includes "Drum", "Patch", "Control", "Velocity", and
+ *    "Bend" sections.
  */
 
 typedef enum
 {
    INI_SECTION_DRUM,          /**< Marks a "[ Drum ]" section.                */
    INI_SECTION_PATCH,         /**< Marks a "[ Patch ]" section.               */
+   INI_SECTION_CONTROL,       /**< Marks a "[ Control ]" section.             */
+   INI_SECTION_VELOCITY,      /**< Marks a "[ Velocity ]" section.            */
+   INI_SECTION_BEND,          /**< Marks a "[ Bend ]" section.                */
    INI_SECTION_CHANNEL,       /**< Marks a "[ Channel ]" section.             */
    INI_SECTION_UNKNOWN        /**< Marks an unknown section name.             */
 
@@ -210,6 +214,90 @@ const std::string PATCH_LABEL_DEV_PATCH   =  "dev-patch";
 
 const std::string PATCH_LABEL_GM_EQUIV    =  "gm-equiv";
 
+/**
+ *    Provides the prefix for the initial part of the controller-section
+ *    name.  These names are of the form "Control nnn" where nnn is the
+ *    MIDI controller number, ranging from 0 to 127.
+ */
+
+const std::string CONTROL_SECTION         = "Control";
+
+/**
+ *    Provides the string for the name of the incoming controller, as
+ *    shown in the INI file.
+ */
+
+const std::string CONTROL_LABEL_GM_NAME   =  "gm-name";
+
+/**
+ *    Provides the string for the number of the incoming controller, as
+ *    shown in the INI file.
+ */
+
+const std::string CONTROL_LABEL_GM_CONTROL =  "gm-control";
+
+/**
+ *    Provides the string for the name of the outgoing controller, as
+ *    shown in the INI file.
+ */
+
+const std::string CONTROL_LABEL_DEV_NAME  =  "dev-name";
+
+/**
+ *    Provides the string for the number of the outgoing controller, as
+ *    shown in the INI file.  If missing, the controller number is not
+ *    changed, and only its values are remapped.
+ */
+
+const std::string CONTROL_LABEL_DEV_CONTROL =  "dev-control";
+
+/**
+ *    Provides the string for the GM name of the outgoing controller, as
+ *    shown in the INI file.
+ */
+
+const std::string CONTROL_LABEL_GM_EQUIV  =  "gm-equiv";
+
+/**
+ *    Provides the string for the optional curve that remaps the values of
+ *    a controller, in the same form as CURVE_LABEL.
+ */
+
+const std::string CONTROL_LABEL_VALUES    =  "values";
+
+/**
+ *    Provides the prefix of the name of a section that remaps the velocity
+ *    of Note On events through a curve.
+ */
+
+const std::string VELOCITY_SECTION        = "Velocity";
+
+/**
+ *    Provides the prefix of the name of a section that remaps the 14-bit
+ *    value of Pitch Bend events through a curve.
+ */
+
+const std::string BEND_SECTION            = "Bend";
+
+/**
+ *    Provides the string for the curve of a velocity or bend section.  A
+ *    curve is a list of "in:out" points, such as "0:0 64:90 127:127",
+ *    joined by straight lines.  If the first or last value of the range
+ *    is not given, it maps to itself.
+ */
+
+const std::string CURVE_LABEL             =  "curve";
+
+/**
+ *    Provides the string for the optional channel of a drum, patch,
+ *    control, velocity, or bend section.  If present, the section remaps
+ *    only the events on that channel, numbered from 1 to 16.  Otherwise,
+ *    a drum section applies to the device channel, and the other sections
+ *    to all channels.
+ */
+
+const std::string SECTION_LABEL_CHANNEL   =  "channel";
+
 /* --------------------------------------------------------------------
  *    Value-names for the unnamed section of the INI file.
  * -------------------------------------------------------------------- */
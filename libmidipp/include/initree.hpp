@@ -10,7 +10,7 @@
  * \library       libmidipp
  * \author        Chris Ahlstrom
  * \date          2014-04-22
- * \updates       2014-05-21
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       $MIDIPP_SUITE_GPL_LICENSE$
  *
@@ -18,11 +18,397 @@
  *    configuration file.
  */
 
-#include <stringmap.hpp>               /* midipp::stringmap<> template class  */
+#include <string.h>                    /* memcmp(), strlen()                  */
+
+#include <string>                      /* std::string                         */
+#include <vector>                      /* std::vector                         */
+
+#include <flatmap.hpp>                 /* midipp::flatmap<> template class    */
 
 namespace midipp
 {
 
+/**
+ *    Provides a view of a name or value read from an INI file:  a pointer
+ *    to its characters, which are null-terminated, and its length.  The
+ *    characters are not owned by the view.  Those read by initree live in
+ *    the text of the INI file that the initree holds, so no string is
+ *    allocated for each name and value.
+ *
+ *    A view can be made from an std::string, for a lookup, and converted
+ *    back to one, so that the callers of the initree can keep using
+ *    std::string where they need their own copy.
+ */
+
+class inistring
+{
+
+private:
+
+   /**
+    *    Points to the null-terminated characters.  Never null.
+    */
+
+   const char * m_data;
+
+   /**
+    *    Provides the number of characters, without the null.
+    */
+
+   size_t m_length;
+
+public:
+
+   /**
+    * \defaultctor
+    *    Creates a view of an empty string.
+    */
+
+   inistring () : m_data (""), m_length (0)
+   {
+      // done
+   }
+
+   /**
+    *    Creates a view of characters that are followed by a null.
+    *
+    * \param s
+    *    Provides the characters, which must outlive the view.
+    *
+    * \param length
+    *    Provides the number of characters, not counting the null.
+    */
+
+   inistring (const char * s, size_t length) : m_data (s), m_length (length)
+   {
+      // done
+   }
+
+   /**
+    *    Creates a view of a C string, as for a lookup.
+    *
+    * \param s
+    *    Provides the null-terminated string, which must outlive the view.
+    */
+
+   inistring (const char * s) : m_data (s), m_length (strlen(s))
+   {
+      // done
+   }
+
+   /**
+    *    Creates a view of an std::string, as for a lookup.
+    *
+    * \param s
+    *    Provides the string, which must outlive the view.
+    */
+
+   inistring (const std::string & s) : m_data (s.c_str()), m_length (s.size())
+   {
+      // done
+   }
+
+   /**
+    *    Makes a copy of the characters, for callers that need an
+    *    std::string of their own.
+    */
+
+   operator std::string () const
+   {
+      return std::string(m_data, m_length);
+   }
+
+   /**
+    * \getter m_data
+    */
+
+   const char * c_str () const
+   {
+      return m_data;
+   }
+
+   /**
+    * \getter m_length
+    */
+
+   size_t size () const
+   {
+      return m_length;
+   }
+
+   /**
+    * \getter m_length == 0
+    */
+
+   bool empty () const
+   {
+      return m_length == 0;
+   }
+
+   /**
+    *    Compares with another string, as std::string::compare() does.
+    *
+    * \param s
+    *    Provides the string to compare with.
+    *
+    * \return
+    *    Returns a negative number, 0, or a positive number, as this string
+    *    sorts before, equal to, or after \a s.
+    */
+
+   int compare (const inistring & s) const
+   {
+      size_t n = m_length < s.m_length ? m_length : s.m_length ;
+      int result = memcmp(m_data, s.m_data, n);
+      if (result == 0 && m_length != s.m_length)
+         result = m_length < s.m_length ? -1 : 1 ;
+
+      return result;
+   }
+
+   /**
+    *    Compares part of this string with another string, as
+    *    std::string::compare() does.
+    *
+    * \param pos
+    *    Provides the index of the first character of the part.
+    *
+    * \param n
+    *    Provides the most characters the part can have.
+    *
+    * \param s
+    *    Provides the string to compare with.
+    *
+    * \return
+    *    Returns a negative number, 0, or a positive number, as the part
+    *    sorts before, equal to, or after \a s.
+    */
+
+   int compare (size_t pos, size_t n, const inistring & s) const
+   {
+      if (pos > m_length)
+         pos = m_length;
+
+      if (n > m_length - pos)
+         n = m_length - pos;
+
+      return inistring(m_data + pos, n).compare(s);
+   }
+
+};                // class inistring
+
+/**
+ *    Orders two inistrings as std::string would.
+ */
+
+inline bool
+operator < (const inistring & a, const inistring & b)
+{
+   return a.compare(b) < 0;
+}
+
+/**
+ *    Tests two inistrings for equality.
+ */
+
+inline bool
+operator == (const inistring & a, const inistring & b)
+{
+   return a.size() == b.size() && a.compare(b) == 0;
+}
+
+/**
+ *    Tests two inistrings for inequality.
+ */
+
+inline bool
+operator != (const inistring & a, const inistring & b)
+{
+   return ! (a == b);
+}
+
+/**
+ *    Provides a section of an INI file:  its name, and its options, each a
+ *    name and a value.  It provides the part of the stringmap interface
+ *    that the readers of an initree use, but it holds only views.  All of
+ *    them point into the text held by the initree.
+ *
+ *    A section is filled once while parsing and then only looked up, so
+ *    its options are kept in a flatmap, a sorted vector, rather than in
+ *    the nodes of an std::map.
+ */
+
+class inisection
+{
+
+public:
+
+   /**
+    *    Provides the type of the container of the options.
+    */
+
+   typedef midipp::flatmap<inistring, inistring> Container;
+
+   /**
+    *    Provides a constant-iterator type for notational convenience.
+    */
+
+   typedef Container::const_iterator const_iterator;
+
+   /**
+    *    Provides an iterator type for notational convenience.
+    */
+
+   typedef Container::iterator iterator;
+
+private:
+
+   /**
+    *    Provides the name of the section, empty for the unnamed section.
+    */
+
+   inistring m_name;
+
+   /**
+    *    Holds the options, keyed by name.
+    */
+
+   Container m_options;
+
+public:
+
+   /**
+    * \defaultctor
+    *    Creates an empty and unnamed section.
+    */
+
+   inisection () : m_name (), m_options ()
+   {
+      // done
+   }
+
+   /**
+    *    Creates an empty, but named, section.
+    *
+    * \param name
+    *    Provides the name, which must outlive the section.
+    */
+
+   explicit inisection (const inistring & name) : m_name (name), m_options ()
+   {
+      // done
+   }
+
+   /**
+    * \getter m_name
+    */
+
+   const inistring & name () const
+   {
+      return m_name;
+   }
+
+   /**
+    *    Adds an option, unless an option of that name is already present.
+    *
+    * \param key
+    *    Provides the name of the option, which must outlive the section.
+    *
+    * \param value
+    *    Provides the value of the option, which must outlive the section.
+    *
+    * \return
+    *    The size of the container after insertion is returned.  If
+    *    important, the caller should check that the size is one larger.
+    */
+
+   int insert (const inistring & key, const inistring & value)
+   {
+      m_options.insert(std::make_pair(key, value));
+      return int(m_options.size());
+   }
+
+   /**
+    *    Adds an option at the end, without checking for a duplicate.  The
+    *    section cannot be searched until sort() is called.
+    *
+    * \param key
+    *    Provides the name of the option, which must outlive the section.
+    *
+    * \param value
+    *    Provides the value of the option, which must outlive the section.
+    */
+
+   void append (const inistring & key, const inistring & value)
+   {
+      m_options.append(std::make_pair(key, value));
+   }
+
+   /**
+    * \accessor m_options.sort()
+    */
+
+   bool sort ()
+   {
+      return m_options.sort();
+   }
+
+   /**
+    * \accessor m_options.find() const
+    */
+
+   const_iterator find (const inistring & key) const
+   {
+      return m_options.find(key);
+   }
+
+   /**
+    * \accessor m_options.find()
+    */
+
+   iterator find (const inistring & key)
+   {
+      return m_options.find(key);
+   }
+
+   /**
+    * \accessor m_options.begin() const
+    */
+
+   const_iterator begin () const
+   {
+      return m_options.begin();
+   }
+
+   /**
+    * \accessor m_options.end() const
+    */
+
+   const_iterator end () const
+   {
+      return m_options.end();
+   }
+
+   /**
+    * \accessor m_options.size()
+    */
+
+   size_t size () const
+   {
+      return m_options.size();
+   }
+
+   /**
+    * \accessor m_options.empty()
+    */
+
+   bool empty () const
+   {
+      return m_options.empty();
+   }
+
+};                // class inisection
+
 /**
  *    This class provides a way to read and represent an INI file as a kind
  *    of tree structure that can be navigate to look up information.
@@ -44,9 +430,12 @@ public:
     *    Note that Sections will generally have a name.  However, an unnamed
     *    section is useful for representing INI files that have no section
     *    information.
+    *
+    *    A Section holds views of its name and options, which point into
+    *    the text of the INI file held in m_text.  See inisection.
     */
 
-   typedef midipp::stringmap<std::string> Section;
+   typedef inisection Section;
 
    /**
     *    Provides a type that holds a map of strings, keyed by strings.
@@ -58,9 +447,14 @@ public:
     *    where the key is the name of an option, and the value is the
     *    option's value.  This pair comes from an entry in the INI file of
     *    the form "Name = Value".
+    *
+    *    Like the options, the sections are kept sorted in a flatmap.  It
+    *    iterates in the same order as std::map did, so the sections are
+    *    still visited in name order.  Inserting a section invalidates any
+    *    iterator or reference into the container.
     */
 
-   typedef std::map <std::string, Section> Container;
+   typedef midipp::flatmap<inistring, Section> Container;
 
    /**
     *    Provides a constant-iterator type for notational convenience.
@@ -84,7 +478,7 @@ public:
     *    Provides a pair type for notational convenience.
     */
 
-   typedef std::pair<std::string, Section> pair;
+   typedef std::pair<inistring, Section> pair;
 
 private:
 
@@ -101,6 +495,16 @@ private:
 
    std::string m_name;
 
+   /**
+    *    Holds the text of the INI file, read in one piece.  The parser
+    *    ends each name and value with a null in place, and the sections
+    *    hold views of them, so this is the only copy of the strings.  It
+    *    is never resized after parsing, and so the initree is not
+    *    copyable.
+    */
+
+   std::vector<char> m_text;
+
    /**
     *    Provides a section container.  All of the sections together specify
     *    all of the existing sections in an INI file.
@@ -129,8 +533,6 @@ public:
       const std::string & name,
       const std::string & filespec
    );
-   initree (const initree & source);
-   initree & operator = (const initree & source);
 
    /**
     * \destructor
@@ -164,9 +566,10 @@ public:
    /**
     *    Allows the insertion of an stringmap object into the container.
     *
-    * \param section
+    * \param sectionname
     *    The string that is to serve as the lookup value for the inserted
-    *    object.
+    *    object.  It, and the strings of the section, must outlive the
+    *    initree.
     *
     * \param value
     *    The value object to be added to the container.
@@ -176,7 +579,7 @@ public:
     *    important, the caller should check that the size is one larger.
     */
 
-   int insert (const std::string & sectionname, const Section & section)
+   int insert (const inistring & sectionname, const Section & section)
    {
       m_sections.insert(std::make_pair(sectionname, section));
       return int(m_sections.size());
@@ -194,7 +597,7 @@ public:
     *    Returns a constant reference to the Section found.
     */
 
-   const Section & section (const std::string & sectionname) const
+   const Section & section (const inistring & sectionname) const
    {
       return section(sectionname);
    }
@@ -291,7 +694,7 @@ public:
     *    any.  Otherwise end() is returned.
     */
 
-   const_iterator find (const std::string & sectionname) const
+   const_iterator find (const inistring & sectionname) const
    {
       return const_iterator(m_sections.find(sectionname));
    }
@@ -319,7 +722,7 @@ protected:
     *    author's responsibility to check if the Section is useful or not.
     */
 
-   Section & section (const std::string & sectionname)
+   Section & section (const inistring & sectionname)
    {
       iterator ci = m_sections.find(sectionname);
       if (ci == m_sections.end())
@@ -346,7 +749,7 @@ protected:
     *    Otherwise end() is returned.
     */
 
-   iterator find (const std::string & sectionname)
+   iterator find (const inistring & sectionname)
    {
       return iterator(m_sections.find(sectionname));
    }
@@ -375,18 +778,21 @@ protected:
        return c == '#' || c == ';' || c == '!' || c == '\'' || c == '"';
    }
 
-   std::string process_section_name
-   (
-      const std::string & s,
-      std::string::size_type p
-   );
+   bool parse (char * text, size_t size);
+   inistring process_section_name (char * s, size_t length, size_t p);
    bool process_option
    (
-      const std::string & s,
-      std::string::size_type p,
-      const std::string & sectionname
+      char * s,
+      size_t length,
+      size_t p,
+      Section & section
    );
-   bool make_section (const std::string & sectionname);
+   void make_section (const inistring & sectionname);
+
+private:
+
+   initree (const initree &);                   /* owns m_text, so it   */
+   initree & operator = (const initree &);      /* is not copyable      */
 
 };                // class initree
 
@@ -397,6 +803,11 @@ protected:
  */
 
 extern void show (const std::string & tag, const midipp::initree & container);
+extern void show
+(
+   const std::string & tag,
+   const midipp::inisection & container
+);
 
 #endif            // MIDIPP_INITREE_HPP
 
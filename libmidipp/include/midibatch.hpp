@@ -0,0 +1,239 @@
+#ifndef MIDIPP_MIDIBATCH_HPP
+#define MIDIPP_MIDIBATCH_HPP
+
+/*
+ * midicvtpp - A MIDI-text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midibatch.hpp
+ *
+ *    This module provides a class for remapping many MIDI files with one
+ *    midimapper, using a number of worker threads.
+ *
+ * \library       libmidipp
+ * \author        Chris Ahlstrom
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    The INI file is read only once, by the midimapper given to the
+ *    midibatch.  The worker threads all remap with it, reading its tables
+ *    without changing them, and each counts its conversions in a
+ *    midicounts of its own.
+ */
+
+#include <pthread.h>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <midimapper.hpp>              /* class midipp::midimapper            */
+
+namespace midipp
+{
+
+/**
+ *    The midibatch class holds a list of input MIDI files, and converts
+ *    each of them to a new MIDI file, as "midicvtpp --m2m" would.  The
+ *    name of each output file is made from the name of its input file.
+ */
+
+class midibatch
+{
+
+private:
+
+   /**
+    *    Holds the data that each worker thread needs.
+    */
+
+   typedef struct
+   {
+      midibatch * batch;
+      midicounts * counts;
+      midicounts * back_counts;
+
+   } worker_data;
+
+   /**
+    *    Provides the mapper that was set up by the caller.  It is shared
+    *    by the worker threads, and their counts are added to it when all
+    *    the files are done.
+    */
+
+   midimapper & m_mapper;
+
+   /**
+    *    Provides the template for the output file-names.  A "%s" is
+    *    replaced by the base name of the input file, without its directory
+    *    or extension, and a "%%" is replaced by "%".
+    */
+
+   std::string m_out_template;
+
+   /**
+    *    Provides the template for the names of the round-trip files, in
+    *    the same form as m_out_template.  If not empty, each output file
+    *    is converted back to one of these files, with the other direction
+    *    of the mapper.  See round_trip().
+    */
+
+   std::string m_back_template;
+
+   /**
+    *    Provides the number of worker threads to use.  There are never more
+    *    threads than files.
+    */
+
+   int m_jobs;
+
+   /**
+    *    Holds the names of the input files, in the order they are to be
+    *    converted.
+    */
+
+   std::vector<std::string> m_in_files;
+
+   /**
+    *    Holds the names of the output files, one for each input file.  They
+    *    are all made, and checked, by check_outputs() before any file is
+    *    converted.
+    */
+
+   std::vector<std::string> m_out_files;
+
+   /**
+    *    Holds the names of the round-trip files, one for each input file,
+    *    if m_back_template is not empty.  They are checked along with
+    *    m_out_files.
+    */
+
+   std::vector<std::string> m_back_files;
+
+   /**
+    *    Provides the index of the next file in m_in_files that a worker
+    *    thread is to convert.  Guarded by m_lock.
+    */
+
+   size_t m_next_file;
+
+   /**
+    *    Counts the files that could not be converted.  Guarded by m_lock.
+    */
+
+   int m_failures;
+
+   /**
+    *    Holds the Mf_nomerge setting of the thread that called run().  The
+    *    libmidifilex settings are kept per thread, so each worker thread
+    *    must be given the settings made by the command-line parser.
+    */
+
+   int m_nomerge;
+
+   /**
+    *    Holds the Mf_report callback of the thread that called run(), for
+    *    the same reason.
+    */
+
+   int (* m_report) (const char *);
+
+   /**
+    *    Guards m_next_file and m_failures, which the worker threads share.
+    */
+
+   pthread_mutex_t m_lock;
+
+public:
+
+   midibatch (midimapper & mm, const std::string & outtemplate, int jobs);
+   ~midibatch ();
+
+   bool add_files (const std::string & source);
+   std::string output_name
+   (
+      const std::string & infile, bool back = false
+   ) const;
+   bool run ();
+
+   static bool convert
+   (
+      const std::string & infile, const std::string & outfile
+   );
+
+   /**
+    * \setter m_back_template
+    *    The mapper given to the constructor must have been built for both
+    *    directions, so that the round trip uses the same parse of the INI
+    *    file.
+    */
+
+   void round_trip (const std::string & backtemplate)
+   {
+      m_back_template = backtemplate;
+   }
+
+   /**
+    * \getter m_in_files.size()
+    */
+
+   int file_count () const
+   {
+      return int(m_in_files.size());
+   }
+
+   /**
+    * \getter m_failures
+    *    Valid after run() returns.
+    */
+
+   int failures () const
+   {
+      return m_failures;
+   }
+
+private:
+
+   midibatch (const midibatch &);               /* not copyable         */
+   midibatch & operator = (const midibatch &);  /* not assignable       */
+
+   bool add_directory (const std::string & dirname);
+   bool add_list (std::istream & in);
+   bool check_outputs ();
+   bool next_file (size_t & index);
+   void convert_files (midicounts & counts, midicounts & backcounts);
+
+   static void * worker (void * data);
+
+};
+
+}                 // namespace midipp
+
+#endif            // MIDIPP_MIDIBATCH_HPP
+
+/*
+ * midibatch.hpp
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=cpp
+ */
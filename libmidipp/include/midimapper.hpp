@@ -31,12 +31,15 @@
  * \library       libmidipp
  * \author        Chris Ahlstrom
  * \date          2014-04-24
- * \updates       2016-04-23
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
- *    The mapping process works though static functions that reference a
- *    global midimapper object.
+ *    The mapping process works through static C callbacks that use the
+ *    midimapper object passed to midimap_init().  That function binds the
+ *    mapper, and the counts of the calling thread, to Mf_userdata, and
+ *    sets the Mf_* callbacks, all of which are thread-local.  So there is
+ *    no global midimapper, and threads can share one mapper.
  *
  *    This object gets its setup from an INI file.  This INI file has an
  *    unnamed section with the following format:
@@ -68,6 +71,36 @@
          dev-name = Jazz Organ 1
          dev-patch = 16
          gm-equiv = Drawbar Organ
+\endverbatim
+ *
+ *    A drum or patch section can also have a "channel" value, from 1 to
+ *    16, so that it remaps only the notes or programs on that channel.
+ *    Such sections can give each part of a multi-timbral file its own
+ *    drum kit or patch bank, and override the other sections on that
+ *    channel.  A drum section without a channel applies to the device
+ *    channel, and a patch section without one applies to every channel.
+ *
+ *    Controllers are remapped by "Control" sections, which can change the
+ *    controller number, and remap its values through a curve.  Curves
+ *    are lists of "in:out" points joined by straight lines.  A "Velocity"
+ *    section remaps the velocities of Note On events, and a "Bend" section
+ *    remaps the 14-bit (0 to 16383) values of Pitch Bend events.  Each can
+ *    also have a "channel" value.
+ *
+\verbatim
+         [ Control 7 ]
+         gm-name = Volume
+         gm-control = 7
+         dev-name = Expression
+         dev-control = 11
+         values = "0:0 127:100"
+
+         [ Velocity ]
+         curve = "0:0 64:90 127:127"
+
+         [ Bend Channel 2 ]
+         channel = 2
+         curve = "0:4096 16383:12287"
 \endverbatim
  *
  *    The gm-equiv fields are currently just a way to see how good the
@@ -86,21 +119,47 @@
            . . .
          ch_16 = 16
 \endverbatim
+ *
+ *    Once the INI file is read, the maps are compiled into small flat
+ *    tables, indexed by the incoming note, patch, or channel, so that
+ *    remapping an event costs a single array lookup.  For note and patch
+ *    events, the channel and the value are remapped together by one
+ *    table indexed by both.  The maps themselves, with their annotations,
+ *    are kept only for reporting.  Events that are already decoded into
+ *    columns, such as the records of a binary event file, can be
+ *    remapped all at once by apply(), with the same tables.
+ *
+ *    The maps read from an INI file, in both directions, can also be
+ *    saved by compile_map() into a compiled map file, which the
+ *    constructor loads in place of the INI file.  See midimapfile.cpp.
+ *    A mapper can also be built for both directions from one parse of the
+ *    INI file, so that a round trip needs only one load, and each
+ *    conversion picks its direction with direction().
+ *
+ *    Several mappers can be chained, so that the output of one is
+ *    remapped by the next.  The chain() function fuses the tables of the
+ *    next mapper into this one, so that a chained conversion still costs
+ *    one lookup per event, and one pass through the MIDI file.
  */
 
 #include <map>
+#include <stddef.h>                    /* size_t                              */
+#include <stdint.h>                    /* uint8_t, int8_t, uint32_t           */
 #include <string>
+#include <vector>
 
 namespace midipp
 {
 
+class initree;                         /* read only by midimapper.cpp         */
+
 /**
  *    This class is meant to extend the map of values with additional data
  *    that can be written out to summarize some information about the MIDI
  *    remapping that was done.  Instead of just the integer value to use,
- *    this class holds the names of the items on both ends of the mapping,
- *    plus a usage count.  We also added the "GM equivalent" name to this
- *    class as well.
+ *    this class holds the names of the items on both ends of the mapping.
+ *    We also added the "GM equivalent" name to this class as well.  The
+ *    usage counts are kept in a midicounts, in tables indexed by the key.
  */
 
 class annotation
@@ -137,13 +196,6 @@ private:
 
    const std::string m_gm_name;
 
-   /**
-    *    The number of times this particular mapping was performed in the
-    *    MIDI remapping operation.
-    */
-
-   int m_remap_count;
-
 private:
 
    annotation ();                      /* hide the default constructor */
@@ -199,25 +251,21 @@ public:
       return m_gm_name;
    }
 
-   /**
-    * \setter m_remap_count
-    */
-
-   void increment_count ()
-   {
-      ++m_remap_count;
-   }
+};       // class annotation
 
-   /**
-    * \getter m_remap_count
-    */
+/**
+ *    Points to the columns of an array of decoded MIDI events, for
+ *    midimapper::apply().  Each column holds one byte per event, so the
+ *    events can be remapped in one pass, without a callback per event.
+ */
 
-   int count () const
-   {
-      return m_remap_count;
-   }
+typedef struct
+{
+   uint8_t * status;                   /**< Status, with the channel.      */
+   uint8_t * data1;                    /**< Data byte 1, or meta type.     */
+   uint8_t * data2;                    /**< Data byte 2.                   */
 
-};       // class annotation
+} midievents;
 
 /**
  *    This class provides for some basic remappings to be done to MIDI
@@ -226,9 +274,12 @@ public:
  *    It works by holding all sorts of standard C++ map objects that are
  *    used to translate from one numeric value to another.
  *
- *    For use in the midicvtpp application, a single global instance of
- *    this object is created, and is used in static C-style callback
- *    functions that can be used in the C library libmidifilex.
+ *    The midicvtpp application creates an instance of this object and
+ *    passes it to midimap_init(), which binds it to the static C-style
+ *    callback functions of the calling thread through Mf_userdata.  The
+ *    object is only read while remapping, so the worker threads of
+ *    midibatch share one instance, each counting its conversions in its
+ *    own midicounts.
  */
 
 class midimapper
@@ -250,8 +301,86 @@ public:
 
    static const int NOT_ACTIVE = -1;
 
+   /**
+    *    Provides the number of MIDI note or patch values, the size of the
+    *    flat note and patch tables.
+    */
+
+   static const int VALUE_COUNT = 128;
+
+   /**
+    *    Provides the number of MIDI channels, the size of the flat channel
+    *    table.
+    */
+
+   static const int CHANNEL_COUNT = 16;
+
+   /**
+    *    Provides the largest 14-bit value of a Pitch Bend event.
+    */
+
+   static const int BEND_MAXIMUM = 16383;
+
+   /**
+    *    Holds the conversion counts reported by the --summarize option,
+    *    one histogram each for notes, patches, and controllers, indexed by
+    *    the channel and the value of the incoming event.  The counts are
+    *    kept apart from the tables of the midimapper, so that its tables
+    *    are never written while remapping, and one midimapper can be
+    *    shared by several threads, each counting into a midicounts of its
+    *    own.  The counts of the threads are added together when they are
+    *    done.  It is nested here so that it is sized by the constants
+    *    above; it is known as midipp::midicounts.
+    */
+
+   class midicounts
+   {
+
+      friend class midimapper;
+
+   private:
+
+      /**
+       *    Counts the times each note was looked up on each channel.  Only
+       *    the device channel is reported, by show_maps(), but counting
+       *    them all saves a test for every event.
+       */
+
+      int m_notes [CHANNEL_COUNT][VALUE_COUNT];
+
+      /**
+       *    Counts the times each patch was looked up on each channel.
+       */
+
+      int m_patches [CHANNEL_COUNT][VALUE_COUNT];
+
+      /**
+       *    Counts the times each controller was looked up on each channel.
+       */
+
+      int m_controls [CHANNEL_COUNT][VALUE_COUNT];
+
+   public:
+
+      midicounts ();
+
+      void clear ();
+      void add (const midicounts & other);
+
+   };    // class midicounts
+
 private:
 
+   /**
+    *    Marks an entry of m_note_table or m_program_table whose event is
+    *    to be dropped.  The low 7 bits of an entry hold the new note or
+    *    program, and the next 4 bits hold the new channel.  Bits 16 and up
+    *    of an m_note_table entry hold the index of the velocity table of
+    *    the channel in m_value_tables.
+    */
+
+   static const unsigned REMAP_DROP = 0x8000;
+
    /**
     *    Provides the type of the map between one set of values and
     *    another set of values.
@@ -260,6 +389,30 @@ private:
    typedef std::map<int, annotation> midimap;
    typedef std::map<int, annotation>::iterator iterator;
    typedef std::map<int, annotation>::const_iterator const_iterator;
+   typedef std::map<int, midimap> channel_midimaps;
+
+   /**
+    *    Provides the type of a curve, a list of (in, out) points sorted by
+    *    the input value, from the lowest to the highest value in the
+    *    range, joined by straight lines.
+    */
+
+   typedef std::vector< std::pair<int, int> > curve;
+
+   /**
+    *    Provides a list of curves, applied one after the other.  A curve
+    *    read from an INI file is a list of one; chain() adds the curves of
+    *    the next mapper.
+    */
+
+   typedef std::vector<curve> curves;
+
+   /**
+    *    Provides the curves of a mapper, keyed by channel (NOT_ACTIVE for
+    *    the curve of all channels) or, for controllers, by control_key().
+    */
+
+   typedef std::map<int, curves> curve_map;
    typedef std::pair<int, annotation> midimap_pair;
    typedef std::pair<iterator, bool> midimap_result;
    typedef std::pair<std::map<int, int>::iterator, bool> intmap_result;
@@ -447,6 +600,164 @@ private:
 
    std::map<int, int> m_channel_map;
 
+   /**
+    *    Provides the drum maps of the sections that have a "channel" value,
+    *    keyed by that channel on the 0-15 scale.  On its channel, such a
+    *    map overrides m_drum_map, and applies even if the channel is not
+    *    the device channel.  If m_map_reversed is true, the key is the
+    *    channel to which the forward mapping sends that channel.
+    */
+
+   channel_midimaps m_channel_drum_maps;
+
+   /**
+    *    Provides the patch maps of the sections that have a "channel"
+    *    value, which override m_patch_map on that channel, in the same way
+    *    as m_channel_drum_maps.
+    */
+
+   channel_midimaps m_channel_patch_maps;
+
+   /**
+    *    Provides the mapping between controller numbers, in the same way as
+    *    m_patch_map.  A controller whose values are remapped, but whose
+    *    number is not, maps to itself.
+    */
+
+   midimap m_control_map;
+
+   /**
+    *    Provides the controller maps of sections that have a "channel"
+    *    value, which override m_control_map on that channel.
+    */
+
+   channel_midimaps m_channel_control_maps;
+
+   /**
+    *    Provides the value curves of the controllers, keyed by
+    *    control_key() of the channel of the section (NOT_ACTIVE if none)
+    *    and the incoming controller number.
+    */
+
+   curve_map m_control_curves;
+
+   /**
+    *    Provides the velocity curves, keyed by channel, with NOT_ACTIVE
+    *    for the curve of all channels.
+    */
+
+   curve_map m_velocity_curves;
+
+   /**
+    *    Provides the pitch-bend curves, keyed in the same way as
+    *    m_velocity_curves.
+    */
+
+   curve_map m_bend_curves;
+
+   /**
+    *    Provides the drum maps compiled into a flat table for each channel.
+    *    Each entry holds the new note for the channel and note used as its
+    *    indices, which is the same note if it is not remapped.
+    */
+
+   uint8_t m_drum_table [CHANNEL_COUNT][VALUE_COUNT];
+
+   /**
+    *    Provides the patch maps compiled into a flat table for each
+    *    channel, in the same way as m_drum_table.
+    */
+
+   uint8_t m_patch_table [CHANNEL_COUNT][VALUE_COUNT];
+
+   /**
+    *    Provides the result of rechannel() for each channel, worked out
+    *    ahead of time from the channel filter, the drum channels, and
+    *    m_channel_map.  NOT_ACTIVE means that the channel is dropped.
+    */
+
+   int8_t m_channel_table [CHANNEL_COUNT];
+
+   /**
+    *    Provides m_channel_table, m_drum_table, and m_velocity_table fused
+    *    into one table, indexed by the channel and note of a note or
+    *    key-pressure event.  Each entry packs the new channel and note,
+    *    plus REMAP_DROP if the channel is filtered out, and, in bits 16
+    *    and up, the index of the velocity table of the channel in
+    *    m_value_tables, so that remap_note() and remap_note_on() need only
+    *    one lookup, just as remap_control() does.
+    */
+
+   uint32_t m_note_table [CHANNEL_COUNT][VALUE_COUNT];
+
+   /**
+    *    Provides m_channel_table and m_patch_table fused in the same way,
+    *    indexed by the channel and program of a program-change event.
+    */
+
+   uint16_t m_program_table [CHANNEL_COUNT][VALUE_COUNT];
+
+   /**
+    *    Provides the fused controller table, indexed by the channel and
+    *    number of a Control Change event.  Each entry packs the new
+    *    channel and controller number, plus REMAP_DROP, as in
+    *    m_note_table, and, in bits 16 and up, the index of the value table
+    *    in m_value_tables.
+    */
+
+   uint32_t m_control_table [CHANNEL_COUNT][VALUE_COUNT];
+
+   /**
+    *    Holds the value tables of the controllers and the velocities,
+    *    VALUE_COUNT entries each, one after the other.  The first table
+    *    maps each value to itself.
+    */
+
+   std::vector<uint8_t> m_value_tables;
+
+   /**
+    *    Provides the velocity curves compiled into a flat table for each
+    *    channel.  It is copied into m_value_tables for m_note_table, and
+    *    kept for remap_velocity() and chain().
+    */
+
+   uint8_t m_velocity_table [CHANNEL_COUNT][VALUE_COUNT];
+
+   /**
+    *    Provides the pitch-bend curves of each channel.  They are applied
+    *    directly, as a 14-bit table would be large, and pitch bends are
+    *    few compared to notes.  An empty list leaves the value alone.
+    */
+
+   curves m_bend_table [CHANNEL_COUNT];
+
+   /**
+    *    Holds the conversion counts shown by show_maps().  The remapping
+    *    functions count into the midicounts they are given, which for the
+    *    main thread is this one, and the counts of other threads are added
+    *    to it by add_counts().
+    */
+
+   midicounts m_counts;
+
+   /**
+    *    Counts the entries of the INI file that this mapper could not hold,
+    *    because another entry already maps from the same value.  In a
+    *    reversed map, these are the entries whose forward mapping is not
+    *    one-to-one (non-injective), and so cannot be undone exactly.
+    */
+
+   int m_non_injective;
+
+   /**
+    *    Holds the mapper for the other direction, when the constructor is
+    *    asked for both directions.  It is read from the same parse of the
+    *    INI file, or from the same compiled map, and is owned by this
+    *    mapper.  Otherwise it is null.
+    */
+
+   midimapper * m_inverse;
+
    /**
     *    Indicates if the setup is valid.
     */
@@ -464,12 +775,46 @@ public:
       int filter_channel            = NOT_ACTIVE,
       bool reject_it                = false,
       const std::string & infile    = "",
-      const std::string & outfile   = ""
+      const std::string & outfile   = "",
+      bool both_ways                = false
    );
+   ~midimapper ();
 
-   int repitch (int channel, int input);
-   int rechannel (int channel);
-   int repatch (int program);
+   const midimapper & direction (bool reversed) const;
+   midimapper & direction (bool reversed);
+
+   int repitch (int channel, int input, midicounts & counts) const;
+   int rechannel (int channel) const;
+   int repatch (int channel, int program, midicounts & counts) const;
+   bool remap_note (int & channel, int & note, midicounts & counts) const;
+   bool remap_note_on
+   (
+      int & channel, int & note, int & velocity, midicounts & counts
+   ) const;
+   bool remap_program
+   (
+      int & channel, int & program, midicounts & counts
+   ) const;
+   bool remap_control
+   (
+      int & channel, int & control, int & value, midicounts & counts
+   ) const;
+   int remap_velocity (int channel, int velocity) const;
+   bool remap_bend (int & channel, int & value) const;
+   size_t apply
+   (
+      const midievents & events, size_t count,
+      uint8_t * keep, midicounts & counts
+   ) const;
+   void add_counts (const midicounts & counts);
+   void chain (const midimapper & next);
+
+   static bool compile_map
+   (
+      const std::string & inifile,
+      const std::string & mapfile
+   );
+   static bool is_compiled_map (const std::string & filename);
 
    /**
     *    Determines if the value parameter is usable, or "active".
@@ -662,6 +1007,163 @@ public:
       return m_channel_map;
    }
 
+   /**
+    * \getter m_channel_drum_maps
+    *    Returns a reference to the drum maps of single channels.
+    */
+
+   const channel_midimaps & channel_drum_maps () const
+   {
+      return m_channel_drum_maps;
+   }
+
+   /**
+    * \getter m_channel_patch_maps
+    *    Returns a reference to the patch maps of single channels.
+    */
+
+   const channel_midimaps & channel_patch_maps () const
+   {
+      return m_channel_patch_maps;
+   }
+
+   /**
+    * \getter m_control_map
+    *    Returns a reference to the controller map.
+    */
+
+   const midimap & control_map () const
+   {
+      return m_control_map;
+   }
+
+   /**
+    * \getter m_channel_control_maps
+    *    Returns a reference to the controller maps of single channels.
+    */
+
+   const channel_midimaps & channel_control_maps () const
+   {
+      return m_channel_control_maps;
+   }
+
+   /**
+    * \getter m_control_curves
+    */
+
+   const curve_map & control_curves () const
+   {
+      return m_control_curves;
+   }
+
+   /**
+    * \getter m_velocity_curves
+    */
+
+   const curve_map & velocity_curves () const
+   {
+      return m_velocity_curves;
+   }
+
+   /**
+    * \getter m_bend_curves
+    */
+
+   const curve_map & bend_curves () const
+   {
+      return m_bend_curves;
+   }
+
+   /**
+    *    Makes the key of a controller in m_control_curves.
+    *
+    * \param channel
+    *    Provides the channel of the section, 0 to 15, or NOT_ACTIVE.
+    *
+    * \param control
+    *    Provides the incoming controller number.
+    *
+    * \return
+    *    Returns the key.
+    */
+
+   static int control_key (int channel, int control)
+   {
+      return (channel + 1) * VALUE_COUNT + control;
+   }
+
+   /**
+    * \getter m_counts
+    *    Returns the counts of this mapper, for the remapping done in the
+    *    main thread.
+    */
+
+   midicounts & counts ()
+   {
+      return m_counts;
+   }
+
+   /**
+    * \getter m_counts.m_notes
+    *    Returns the number of times the given note was remapped on the
+    *    device channel by m_drum_map.
+    */
+
+   int drum_count (int note) const
+   {
+      return scoped(m_channel_drum_maps, m_device_channel, note) ?
+         0 : drum_count(m_device_channel, note) ;
+   }
+
+   /**
+    * \getter m_counts.m_notes
+    *    Returns the number of times the given note was looked up on the
+    *    given channel (0 to 15).
+    */
+
+   int drum_count (int channel, int note) const
+   {
+      bool ok =
+         channel >= 0 && channel < CHANNEL_COUNT &&
+         note >= 0 && note < VALUE_COUNT;
+
+      return ok ? m_counts.m_notes[channel][note] : 0 ;
+   }
+
+   int patch_count (int patch) const;
+   int control_count (int control) const;
+   std::string control_values (int channel, int control) const;
+
+   /**
+    * \getter m_counts.m_controls
+    *    Returns the number of times the given controller was looked up on
+    *    the given channel (0 to 15).
+    */
+
+   int control_count (int channel, int control) const
+   {
+      bool ok =
+         channel >= 0 && channel < CHANNEL_COUNT &&
+         control >= 0 && control < VALUE_COUNT;
+
+      return ok ? m_counts.m_controls[channel][control] : 0 ;
+   }
+
+   /**
+    * \getter m_counts.m_patches
+    *    Returns the number of times the given patch was looked up on the
+    *    given channel (0 to 15).
+    */
+
+   int patch_count (int channel, int patch) const
+   {
+      bool ok =
+         channel >= 0 && channel < CHANNEL_COUNT &&
+         patch >= 0 && patch < VALUE_COUNT;
+
+      return ok ? m_counts.m_patches[channel][patch] : 0 ;
+   }
+
    /**
     * \getter m_map_reversed
     */
@@ -671,14 +1173,71 @@ public:
       return m_map_reversed;
    }
 
+   /**
+    * \getter m_non_injective
+    */
+
+   int non_injective () const
+   {
+      return m_non_injective;
+   }
+
 private:
 
+   midimapper (const midimapper &);            /* owns m_inverse, so  */
+   midimapper & operator = (const midimapper &); /* it is not copyable  */
+
    bool read_maps (const std::string & filename);
+   bool read_tree (const initree & it, bool inverse);
+   bool read_compiled (const std::string & mapfile);
+   void put_state (std::string & buffer) const;
+   bool get_state (const unsigned char * & p, const unsigned char * end);
    bool read_unnamed_section (const initree & it);
    bool read_channel_section (const initree & it);
+   void build_tables ();
+   void build_table
+   (
+      const midimap & m, uint8_t * table, const std::string & secname
+   );
+   int forward_channel (int channel) const;
+   const curves * find_control_curves (int channel, int control) const;
+   static const curves * find_curves (const curve_map & m, int channel);
+   int value_table (const curves & c);
+   int value_table (const uint8_t * table);
+   void pack_velocities ();
+   size_t apply_scalar
+   (
+      const midievents & events, size_t first, size_t count,
+      uint8_t * keep, midicounts & counts, const unsigned * route
+   ) const;
+   static void count_lookups
+   (
+      const midievents & events, size_t count, midicounts & counts
+   );
+   void apply_bends (const midievents & events, size_t count) const;
+   static bool parse_curve (const std::string & text, int maximum, curve & c);
+   static bool reverse_curve (curve & c);
+   static int curve_value (const curve & c, int x);
+   static int apply_curves (const curves & c, int x);
+   static void append_curves (curves & c, const curves * more);
+   static std::string curves_text (const curves & c);
+   const annotation * drum_annotation (int channel, int note) const;
+   static int mapped (const annotation * an, int key);
+   static const annotation * lookup (const midimap & m, int key);
+   static const annotation * lookup
+   (
+      const channel_midimaps & m, int channel, int key
+   );
+   static bool scoped (const channel_midimaps & m, int channel, int key);
 
 };
 
+/**
+ *    Provides the conversion counts under their own name.
+ */
+
+typedef midimapper::midicounts midicounts;
+
 /*
  * Free functions in the midipp namespace.
  */
@@ -697,6 +1256,11 @@ extern void show_maps
  */
 
 extern void midimap_init (midipp::midimapper & mm);
+extern void midimap_init
+(
+   const midipp::midimapper & mm,
+   midipp::midicounts & counts
+);
 
 #endif            // MIDIPP_MIDIMAPPER_HPP
 
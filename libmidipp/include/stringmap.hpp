@@ -6,12 +6,12 @@
  * \library       libmidipp
  * \author        Chris Ahlstrom
  * \date          2014-04-22
- * \updates       2014-05-21
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       $MIDIPP_SUITE_GPL_LICENSE$
  *
  *    This module defines an std::map template class using std::string as a
- *    key value.
+ *    key value.  The container can be swapped for midipp::flatmap.
  */
 
 #include <algorithm>					      /* std::for_each                       */
@@ -19,6 +19,8 @@
 #include <string>						      /* std::string                         */
 #include <stdio.h>						   /* fprintf() and stdout !              */
 
+#include <flatmap.hpp>                 /* midipp::flatmap<> template class    */
+
 /*
  * Global functions.
  */
@@ -68,8 +70,12 @@ extern bool iequal (const std::string & s1, const std::string & s2);
  *       -  show().  The object must have its own overload of the global
  *          show() function.  See the stringmap.cpp module.
  *
- *    The type of container is given by the Container typedef.  The
- *    stringmap template is essentially a wrapper for this class.
+ *    The type of container is given by the CONTAINER parameter, and
+ *    by the Container typedef.  The stringmap template is essentially a
+ *    wrapper for this class.  It defaults to std::map.  A stringmap that
+ *    is filled once and then looked up many times, such as an INI
+ *    section, can use midipp::flatmap instead, which keeps its elements
+ *    in one sorted vector.  Both iterate in key order.
  *
  * \todo
  *    -  Consider implementing lookup by integer index; right now, iterators
@@ -78,7 +84,11 @@ extern bool iequal (const std::string & s1, const std::string & s2);
  *       container, somehow.
  */
 
-template <class VALUETYPE>
+template
+<
+   class VALUETYPE,
+   class CONTAINER = std::map<std::string, VALUETYPE>
+>
 class stringmap
 {
 
@@ -91,7 +101,7 @@ public:
     *    items (e.g. database fields) by name.
     */
 
-   typedef std::map<std::string, VALUETYPE> Container;
+   typedef CONTAINER Container;
 
    /**
     *    Provides a constant-iterator type for notational convenience.
@@ -434,9 +444,9 @@ protected:
  *
  */
 
-template <class VALUETYPE>
+template <class VALUETYPE, class CONTAINER>
 void
-show_pair (const typename stringmap<VALUETYPE>::pair & p)
+show_pair (const typename stringmap<VALUETYPE, CONTAINER>::pair & p)
 {
    show("key", p.first);
    show("value", p.second);
@@ -465,12 +475,12 @@ show_pair (const typename stringmap<VALUETYPE>::pair & p)
  *
  */
 
-template <class VALUETYPE>
+template <class VALUETYPE, class CONTAINER>
 void
 show
 (
    const std::string & tag,
-   const stringmap<VALUETYPE> & container
+   const stringmap<VALUETYPE, CONTAINER> & container
 )
 {
    fprintf
@@ -484,7 +494,10 @@ show
       container.name().c_str(),
       int(container.size())
    );
-   std::for_each(container.begin(), container.end(), show_pair<VALUETYPE>);
+   std::for_each
+   (
+      container.begin(), container.end(), show_pair<VALUETYPE, CONTAINER>
+   );
 }
 
 }                 // namespace midipp
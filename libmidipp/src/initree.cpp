@@ -6,7 +6,7 @@
  * \library       libmidipp
  * \author        Chris Ahlstrom
  * \date          2014-04-22
- * \updates       2014-05-21
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       $XPC_SUITE_GPL_LICENSE$
  *
@@ -41,37 +41,33 @@
  */
 
 #include <cctype>                      /* toupper(), isalpha(), etc. macros   */
-#include <fstream>
+#include <fcntl.h>                     /* open()                              */
+#include <stdio.h>                     /* fprintf()                           */
+#include <string.h>                    /* memchr()                            */
+#include <sys/stat.h>                  /* fstat()                             */
+#include <unistd.h>                    /* read(), close()                     */
 
 #include <initree.hpp>                 /* the functions in this module        */
+#include <midicvt_macros.h>            /* nullptr, not_nullptr(), etc.        */
+#include <stringmap.hpp>               /* show() for a string                 */
 
 /**
- * \internal
- *    Provides a consistent definition of the whitespace characters.  This
- *    define does not bother to try to trap all the characters that could be
- *    considered whitespace or outside the range of legal section and option
- *    names.
- */
-
-#define TOKEN_SPACES    " \t\0"
-
-/**
- * \internal
- *    Provides a consistent definition of the characters that can end a
- *    token.  These characters consist of token-spaces and the ']', '=',
- *    ";", and "#" characters.
- */
-
-#define TOKEN_ENDERS    TOKEN_SPACES "]=;#"
-
-/**
- * \internal
- *    Provides a consistent definition of the characters that can end an
- *    option.  These characters consist of token-spaces and the '='
- *    character.
+ *    Checks for the characters that separate the tokens of a line:  only
+ *    the space and the tab.  Other control characters are taken as part
+ *    of a token.
+ *
+ * \param c
+ *    The character to be checked.
+ *
+ * \return
+ *    Returns 'true' if the character is a space or a tab.
  */
 
-#define OPTION_ENDERS   TOKEN_SPACES "="
+static inline bool
+is_space (char c)
+{
+   return c == ' ' || c == '\t';
+}
 
 namespace midipp
 {
@@ -96,10 +92,11 @@ initree::initree ()
  :
    m_source_file        (),
    m_name               (),
+   m_text               (),
    m_sections           (),
    m_has_named_section  (false)
 {
-   (void) make_section(std::string(""));
+   make_section(inistring());
 }
 
 /**
@@ -127,10 +124,11 @@ initree::initree
 ) :
    m_source_file        (filespec),
    m_name               (name),
+   m_text               (),
    m_sections           (),
    m_has_named_section  (false)
 {
-   (void) make_section(std::string(""));
+   make_section(inistring());
    if (! m_source_file.empty())
    {
       (void) readfile(filespec);
@@ -138,45 +136,67 @@ initree::initree
 }
 
 /**
- *    Creates an unnamed and empty initree.  The name can be added later
- *    with a call to name(), and sections can be added with the insert()
- *    function.
+ *    Opens a file, and tries to construct an initree object, and a number
+ *    of section objects, in it.
+ *
+ *    The whole file is read into m_text, in one piece, and then handed to
+ *    parse().  No copy of a line is made, and no string is made for the
+ *    names and values that are stored in the sections.  They are views of
+ *    m_text, which is why it is not resized once it is parsed.
+ *
+ * \param filespec
+ *    Provides the full path to the file to be processed.
+ *
+ * \return
+ *    Returns 'true' if the file could be read, and nothing bad was found
+ *    in it.
  */
 
-initree::initree (const initree & source)
- :
-   m_source_file        (source.m_source_file),
-   m_name               (source.m_name),
-   m_sections           (source.m_sections),
-   m_has_named_section  (source.m_has_named_section)
+bool
+initree::readfile (const std::string & filespec)
 {
-   // no other code
-}
+   bool result = false;
+   int fd = open(filespec.c_str(), O_RDONLY);
+   if (fd >= 0)
+   {
+      struct stat st;
+      if (fstat(fd, &st) == 0)
+      {
+         size_t size = 0;
+         size_t capacity = S_ISREG(st.st_mode) ? size_t(st.st_size) : 0 ;
+         ssize_t count;
+         for (;;)
+         {
+            if (size == capacity)
+               capacity = capacity > 0 ? capacity * 2 : 4096 ;
 
-/**
- *    Creates an unnamed and empty initree.  The name can be added later
- *    with a call to name(), and sections can be added with the insert()
- *    function.
- */
+            m_text.resize(capacity + 1);        /* room for a final null  */
+            count = read(fd, &m_text[size], capacity - size);
+            if (count <= 0)
+               break;
 
-initree &
-initree::operator = (const initree & source)
-{
-   if (this != &source)
-   {
-      m_source_file        = source.m_source_file;
-      m_name               = source.m_name;
-      m_sections           = source.m_sections;
-      m_has_named_section  = source.m_has_named_section;
+            size += size_t(count);
+            if (S_ISREG(st.st_mode) && size == size_t(st.st_size))
+            {
+               count = 0;                       /* all of it, no more     */
+               break;
+            }
+         }
+         m_text.resize(size + 1);
+         m_text[size] = 0;
+         result = count == 0 && parse(&m_text[0], size);
+      }
+      close(fd);
    }
-   return *this;
+   return result;
 }
 
 /**
- *    Opens a file, and tries to construct an initree object, and a number
- *    of section objects, in it.
- *
- *    This function reads a file line by line.
+ *    Parses the text of an INI file, line by line, in place.  Each line is
+ *    handled as a pointer and a length into the text, which is never
+ *    copied.  Instead, each name and value is ended by writing a null
+ *    over the character that follows it, and the sections keep views of
+ *    them.
  *
  *       -  Blank lines are skipped.
  *       -  Lines that start with ";", "#", "!", "'", or double-quote are
@@ -192,79 +212,88 @@ initree::operator = (const initree & source)
  *       -  Values are anything following the equals.  Leading and trailing
  *          spaces are stripped, unless quoted.
  *
- * \param filespec
- *    Provides the full path to the file to be processed.
+ *    The options are added to the section of the last section-name line,
+ *    which is looked up once, when the section is made, rather than once
+ *    for every option.
+ *
+ * \param text
+ *    Provides the text of the INI file, followed by a null, which must
+ *    outlive the initree.
+ *
+ * \param size
+ *    Provides the number of characters in the text, without the null.
  *
  * \return
- *    Returns 'true' if any legal option was found, and 'false' if anything
- *    bad was found.
+ *    Returns 'true' if no bad line was found.  Processing stops at the
+ *    first bad line.  A duplicate section or option is found only when
+ *    its container is sorted, and the containers are sorted even after a
+ *    bad line, so that the sections and options read so far can be looked
+ *    up.
  */
 
 bool
-initree::readfile (const std::string & filespec)
+initree::parse (char * text, size_t size)
 {
-   std::ifstream input(filespec.c_str());
-   bool result = input.good();
-   if (result)
+   bool result = true;
+   iterator current = find(inistring());        /* the unnamed section    */
+   char * textend = text + size;
+   for (char * line = text; line < textend; )
    {
-      std::string current_section;     // starts out empty
-      for (std::string s; getline(input, s);)
+      char * eol = static_cast<char *>
+      (
+         memchr(line, '\n', size_t(textend - line))
+      );
+      if (is_nullptr(eol))
+         eol = textend;                           /* no newline at the end  */
+
+      /**
+       * The code checks only for white-space characters; it is possible
+       * to embed control characters and have them treated as tokens.  At
+       * your own risk, baby!
+       */
+
+      char * s = line;
+      size_t length = size_t(eol - line);
+      size_t p = 0;
+      line = eol + 1;
+      while (p < length && is_space(s[p]))
+         ++p;
+
+      if (p == length || is_comment(s[p]))
+         continue;
+
+      if (s[p] == '[')
       {
-         if (input.good())
-         {
-            if (s.empty())             // skip blank lines
-               continue;
-            else
-            {
-               /**
-                * The code checks only for white-space characters; it is
-                * possible to embed control characters and have them treated
-                * as tokens.  At your own risk, baby!
-                */
-
-               std::string::size_type p = s.find_first_not_of(TOKEN_SPACES);
-               if (p == std::string::npos)
-                  continue;
-               else
-               {
-                  if (is_comment(s[p]))
-                     continue;
-                  else
-                  {
-                     if (s[p] == '[')
-                     {
-                        current_section = process_section_name(s, p);
-                        if (current_section.empty())
-                        {
-                           result = false;
-                           break;
-                        }
-                        else
-                        {
-                           result = make_section(current_section);
-                           if (! result)
-                              break;   // same section name found again
-                        }
-                     }
-                     else if (isalpha(s[p]))
-                     {
-                        result = process_option(s, p, current_section);
-                        if (! result)
-                           break;
-                     }
-                     else
-                     {
-                        result = false;
-                        break;
-                     }
-                  }
-               }
-            }
-         }
-         else
+         result = current->second.sort();
+         if (! result)
+            break;                     // same option found again
+
+         inistring sectionname = process_section_name(s, length, p);
+         result = ! sectionname.empty();
+         if (! result)
+            break;                     // bad name
+
+         make_section(sectionname);
+         current = m_sections.end() - 1;
+      }
+      else if (isalpha((unsigned char) s[p]))
+      {
+         result = process_option(s, length, p, current->second);
+         if (! result)
             break;
       }
+      else
+      {
+         result = false;
+         break;
+      }
    }
+   if (! current->second.sort())
+      result = false;                  // same option found again
+
+   if (! m_sections.sort())
+      result = false;                  // same section found again
+
    return result;
 }
 
@@ -286,42 +315,42 @@ initree::readfile (const std::string & filespec)
  *    or the line is considered to be malformed.
  *
  * \param s
- *    Provides the current line of text, which starts with '['.
+ *    Provides the current line of text, which is not null-terminated.  A
+ *    null is written after the name.
+ *
+ * \param length
+ *    Provides the length of the line, without its newline.
  *
  * \param p
  *    Provides the position of the '[' character.
  *
  * \return
- *    Returns the name of the newly-created section.  If this name is
- *    empty, then an error occurred.
+ *    Returns a view of the name of the newly-created section.  If this
+ *    name is empty, then an error occurred.
  */
 
-std::string
-initree::process_section_name
-(
-   const std::string & s,
-   std::string::size_type p
-)
+inistring
+initree::process_section_name (char * s, size_t length, size_t p)
 {
-   std::string result;
-   std::string::size_type pbegin = p + 1;
-   if (isspace(s[pbegin]))
-      pbegin = s.find_first_not_of(TOKEN_SPACES, pbegin);
+   inistring result;
+   size_t pbegin = p + 1;
+   while (pbegin < length && is_space(s[pbegin]))
+      ++pbegin;
 
-   if (pbegin != std::string::npos)
+   if (pbegin < length && isalpha((unsigned char) s[pbegin]))
    {
-      if (isalpha(s[pbegin]))
+      const char * prbracket = static_cast<const char *>
+      (
+         memchr(s + pbegin + 1, ']', length - pbegin - 1)
+      );
+      if (not_nullptr(prbracket))
       {
-         std::string::size_type prbracket = s.find_first_of("]", pbegin+1);
-         if (prbracket != std::string::npos)
-         {
-            std::string::size_type pend = s.find_last_not_of
-            (
-               TOKEN_ENDERS, prbracket-1
-            );
-            size_t length = pend - pbegin + 1;
-            result = s.substr(pbegin, length);
-         }
+         size_t pend = size_t(prbracket - s) - 1;
+         while (pend > pbegin && is_space(s[pend]))
+            --pend;
+
+         s[pend + 1] = 0;                 /* the ']' or a space      */
+         result = inistring(s + pbegin, pend - pbegin + 1);
       }
    }
    return result;
@@ -348,23 +377,25 @@ initree::process_section_name
  *
  *    Every option has a string value.  If the value is not provided, then
  *    it is set to empty.  If the string value is in double-quotes, it is
- *    translated via snprintf().  Use double quites if spaces and special
- *    characters are part of the string.
+ *    taken as is, from the first double-quote to the last one.  Use double
+ *    quotes if spaces and special characters are part of the string.
  *
  *    Comment characters other than single- or double-quotes end a value.
  *
  * \param s
- *    Provides the current line of text, which starts with a letter.
+ *    Provides the current line of text, which is not null-terminated.
+ *    Nulls are written after the option name and after the value.
+ *
+ * \param length
+ *    Provides the length of the line, without its newline.  The
+ *    character after the line, a newline or a null, can be overwritten.
  *
  * \param p
  *    Provides the position of the first letter.
  *
- * \param currentsection
- *    Points to the current Section (which might be an unnamed section).
- *    Option entries are added to this section.  This pointer is checked
- *    elsewhere, and will not be null here unless we haven't yet hit a
- *    section.  In that case, this function will created an unnamed section,
- *    if one does not yet exist.
+ * \param section
+ *    Provides the current Section (which might be the unnamed section).
+ *    The option is added to this section.
  *
  * \return
  *    Returns 'true' if the option was proper and properly processed.
@@ -374,148 +405,157 @@ initree::process_section_name
 bool
 initree::process_option
 (
-   const std::string & s,
-   std::string::size_type p,
-   const std::string & sectionname
+   char * s,
+   size_t length,
+   size_t p,
+   Section & section
 )
 {
-   std::string::size_type linelength = s.size();
-   bool result = s.size() > 0 && p != std::string::npos;
-   if (result)
-   {
-      std::string option;
-      std::string value;
-      std::string::size_type pbegin = p;
-      if (isspace(s[pbegin]))
-         pbegin = s.find_first_not_of(TOKEN_SPACES, pbegin);
-
-      result = pbegin != std::string::npos;
-      if (result)
-      {
-         bool no_value = false;
+   bool result = true;
+   char * value = nullptr;             /* no value, even an empty one       */
+   char * valueend = nullptr;
 
-         /*
-          * It is easiest to get the value first, if flagged by '='.
-          */
+   /*
+    * It is easiest to get the value first, if flagged by '='.
+    */
 
-         std::string::size_type pvalue = s.find_first_of("=");
-         if (pvalue == std::string::npos)
-            no_value = true;
+   char * pvalue = static_cast<char *>(memchr(s, '=', length));
+   if (not_nullptr(pvalue))
+   {
+      char * pquote1 = static_cast<char *>(memchr(s, '"', length));
+      if (not_nullptr(pquote1))
+      {
+         char * pquote2 = s + length - 1;
+         while (*pquote2 != '"')
+            --pquote2;
 
-         if (! no_value)
+         if (pquote2 > pquote1)
          {
-            std::string::size_type pquote1 = s.find_first_of("\"");
-            if (pquote1 != std::string::npos)
-            {
-               std::string::size_type pquote2 = s.find_last_of("\"");
-               if (pquote2 > pquote1)
-               {
-                  if (pquote2 > (pquote1 + 1))           // anything in quotes?
-                  {
-                     pquote1++;                          // skip 1st quote
-                     size_t sublength = pquote2 - pquote1;
-                     value = s.substr(pquote1, sublength);
-                  }
-               }
-               else
-                  result = false;                        // no closing quote
-            }
-            else                                         // no quotes
-            {
-               pvalue++;                                 // move one past "="
-               while (isspace(s[pvalue]) && pvalue < s.size())
-                  pvalue++;
-
-               if (pvalue < s.size())
-               {
-                  while
-                  (
-                     ! isspace(s[pvalue]) &&
-                     s[pvalue] != '#' &&
-                     s[pvalue] != ';' &&
-                     pvalue < linelength
-                  )
-                  {
-                     value += s[pvalue];
-                     pvalue++;
-                  }
-               }
-            }
+            value = pquote1 + 1;                         // maybe empty
+            valueend = pquote2;
          }
-
-         /*
-          * We now know the disposition of the value (do we have one, what
-          * is it)?  Now to peel out the option.  If there is no value, the
-          * end of the string or start of spaces ends the option.  If there
-          * is a value, the "=" can also end the option.  The pbegin index
-          * points to the first non-space character.
-          */
-
-         if (result)
+         else
+            result = false;                              // no closing quote
+      }
+      else                                               // no quotes
+      {
+         char * pend = s + length;
+         ++pvalue;                                       // move one past "="
+         while (pvalue < pend && isspace((unsigned char) *pvalue))
+            ++pvalue;
+
+         char * pstop = pvalue;
+         while
+         (
+            pstop < pend &&
+            ! isspace((unsigned char) *pstop) &&
+            *pstop != '#' &&
+            *pstop != ';'
+         )
          {
-            while
-            (
-               (isalnum(s[pbegin]) || (s[pbegin] == '_') || (s[pbegin] == '-'))
-                  && (pbegin < linelength)
-            )
-            {
-               option += s[pbegin];
-               pbegin++;
-            }
-            result = ! option.empty();
+            ++pstop;
          }
+         value = pvalue;
+         valueend = pstop;
       }
-      if (result)
+   }
+
+   /*
+    * We now know the disposition of the value (do we have one, what is
+    * it)?  Now to peel out the option.  If there is no value, the end of
+    * the string or start of spaces ends the option.  If there is a value,
+    * the "=" can also end the option.  The p index points to the first
+    * letter.
+    */
+
+   if (result)
+   {
+      size_t pend = p;
+      while
+      (
+         pend < length &&
+         (isalnum((unsigned char) s[pend]) || s[pend] == '_' || s[pend] == '-')
+      )
       {
-         /*
-          * Now create an option/value pair and insert it in the Section.
-          */
+         ++pend;
+      }
 
-         iterator ci = find(sectionname);
-         if (ci != end())
-         {
-            int currsize = ci->second.size();
-            int newsize = ci->second.insert(option, value);
-            result = newsize == (currsize + 1);
-         }
+      /*
+       * Now end the name and the value in place, which is safe only now
+       * that the line has been scanned, and append views of them to the
+       * Section.  The character after each one is not part of the other.
+       */
+
+      inistring v;
+      if (not_nullptr(value))
+      {
+         *valueend = 0;
+         v = inistring(value, size_t(valueend - value));
       }
+      s[pend] = 0;
+
+      section.append(inistring(s + p, pend - p), v);
    }
    return result;
 }
 
 /**
- *    Created a new section, with the given name, and inserts it into the
- *    initree.
+ *    Creates a new section, with the given name, and appends it to the
+ *    initree.  A section of the same name is found only when the sections
+ *    are sorted, at the end of parse().
  *
  * \param sectionname
- *    Provides the name of new section that is to be created.
- *
- * \return
- *    Returns 'true' if the section was successfully inserted into the
- *    initree.
+ *    Provides the name of new section that is to be created, which must
+ *    outlive the initree.
  *
  * \sideeffect
  *    If the created section has a name, then m_has_named_section is set to
  *    'true'.
  */
 
-bool
-initree::make_section (const std::string & sectionname)
+void
+initree::make_section (const inistring & sectionname)
 {
-   Section sec(sectionname);
-   int treecount = int(m_sections.size());
-   int newcount = insert(sectionname, sec);  // copy new section into tree
-   bool result = newcount == (treecount + 1);
-   if (result)
-   {
-      if (! sectionname.empty())
-         m_has_named_section = true;
-   }
-   return result;
+   m_sections.append(std::make_pair(sectionname, Section(sectionname)));
+   if (! sectionname.empty())
+      m_has_named_section = true;
 }
 
 }                 // namespace midipp
 
+/**
+ *    Writes out the name and options of a section, in the same form as the
+ *    show() function of the stringmap container.
+ *
+ * \param tag
+ *    Identifies the object in the human-readable output.
+ *
+ * \param container
+ *    The section to be shown.
+ */
+
+void
+show (const std::string & tag, const midipp::inisection & container)
+{
+   fprintf
+   (
+      stdout,
+      "- xpc::stringmap '%s':\n"
+      "-    Name:                    '%s'\n"
+      "-    Size:                     %d\n"
+      ,
+      tag.c_str(),
+      container.name().c_str(),
+      int(container.size())
+   );
+   midipp::inisection::const_iterator ci;
+   for (ci = container.begin(); ci != container.end(); ++ci)
+   {
+      show("key", ci->first);
+      show("value", ci->second);
+   }
+}
+
 /**
  *    Writes out the contents of the stringmap container.
  *
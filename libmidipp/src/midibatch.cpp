@@ -0,0 +1,645 @@
+/*
+ * midicvtpp - A MIDI-text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midibatch.cpp
+ *
+ *    This module provides the --batch mode of midicvtpp, which remaps many
+ *    MIDI files with one INI file.
+ *
+ * \library       libmidipp
+ * \author        Chris Ahlstrom
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    The libmidifilex state of a conversion (the callbacks, the file
+ *    pointers, and the parser status) is kept per thread, so each worker
+ *    thread can run mftransform_trapped() on its own file while the
+ *    others do the same.  The worker threads take the files in the
+ *    order given, one at a time, until none are left.
+ *
+ *    A file with an error is reported and skipped, but the other files are
+ *    still converted.  Each output file is written under a temporary name,
+ *    and renamed only when it is complete, so a failed conversion leaves
+ *    any earlier file of that name alone.  Before anything is converted,
+ *    all of the output names are made and checked, so that no output file
+ *    can overwrite an input file, or another output file.
+ *
+ *    For a round trip, each output file is also converted back, with the
+ *    other direction of the same mapper, so that both directions come
+ *    from one parse of the INI file.
+ */
+
+#include <ctype.h>                     /* tolower()                           */
+#include <dirent.h>                    /* opendir(), readdir(), closedir()    */
+#include <limits.h>                    /* PATH_MAX                            */
+#include <stdio.h>                     /* fopen(), fclose(), rename()         */
+#include <stdlib.h>                    /* realpath()                          */
+#include <sys/stat.h>                  /* stat(), S_ISREG()                   */
+#include <unistd.h>                    /* getpid()                            */
+
+#include <algorithm>                   /* std::sort()                         */
+#include <fstream>                     /* std::ifstream                       */
+#include <iostream>                    /* std::cin                            */
+#include <map>                         /* std::map                            */
+#include <set>                         /* std::set                            */
+#include <utility>                     /* std::pair, std::make_pair()         */
+
+#include <midibatch.hpp>               /* this module's functions and stuff   */
+#include <midicvt_globals.h>           /* g_io_file, g_redirect_file, etc.    */
+#include <midicvt_helpers.h>           /* midi_file_offset_clear()            */
+#include <midicvt_macros.h>            /* nullptr, true, false, etc.          */
+#include <midifilex.h>                 /* mftransform_trapped()               */
+
+namespace midipp
+{
+
+/**
+ *    Creates an empty batch.  The files to convert are added with
+ *    add_files().
+ *
+ * \param mm
+ *    Provides the mapper to use for all of the files.  It must be valid.
+ *
+ * \param outtemplate
+ *    Provides the template for the output file-names.  See output_name().
+ *
+ * \param jobs
+ *    Provides the number of worker threads, normally the value of the
+ *    --jobs option.  A value less than 1 is treated as 1.
+ */
+
+midibatch::midibatch
+(
+   midimapper & mm,
+   const std::string & outtemplate,
+   int jobs
+) :
+   m_mapper          (mm),
+   m_out_template    (outtemplate),
+   m_back_template   (),
+   m_jobs            (jobs > 0 ? jobs : 1),
+   m_in_files        (),
+   m_out_files       (),
+   m_back_files      (),
+   m_next_file       (0),
+   m_failures        (0),
+   m_nomerge         (0),
+   m_report          (nullptr),
+   m_lock            ()
+{
+   pthread_mutex_init(&m_lock, nullptr);
+}
+
+/**
+ *    Releases the mutex.
+ */
+
+midibatch::~midibatch ()
+{
+   pthread_mutex_destroy(&m_lock);
+}
+
+/**
+ *    Adds the files to convert.
+ *
+ * \param source
+ *    Provides either the name of a directory, in which case all of its
+ *    ".mid" and ".midi" files are added, in sorted order, or the name of
+ *    a text file that lists one input file per line.  Blank lines, and
+ *    lines that start with "#", are ignored.  A name of "-" reads the
+ *    list from standard input.
+ *
+ * \return
+ *    Returns true if the directory or list could be read.
+ */
+
+bool
+midibatch::add_files (const std::string & source)
+{
+   bool result = false;
+   struct stat st;
+   if (source == "-")
+      result = add_list(std::cin);
+   else if (stat(source.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+      result = add_directory(source);
+   else
+   {
+      std::ifstream in(source.c_str());
+      if (in.is_open())
+         result = add_list(in);
+      else
+         errprintf("? could not open batch list '%s'\n", source.c_str());
+   }
+   return result;
+}
+
+/**
+ *    Adds the MIDI files in a directory, sorted by name.  Subdirectories
+ *    are not searched.
+ *
+ * \param dirname
+ *    Provides the name of the directory.
+ *
+ * \return
+ *    Returns true if the directory could be read.
+ */
+
+bool
+midibatch::add_directory (const std::string & dirname)
+{
+   DIR * dir = opendir(dirname.c_str());
+   if (is_nullptr(dir))
+   {
+      errprintf("? could not open batch directory '%s'\n", dirname.c_str());
+      return false;
+   }
+
+   std::vector<std::string> names;
+   struct dirent * entry;
+   while (not_nullptr(entry = readdir(dir)))
+   {
+      std::string name = entry->d_name;
+      std::string::size_type dot = name.find_last_of('.');
+      if (dot != std::string::npos && dot > 0)
+      {
+         std::string ext = name.substr(dot);
+         for (std::string::size_type i = 0; i < ext.size(); ++i)
+            ext[i] = char(tolower(ext[i]));
+
+         if (ext == ".mid" || ext == ".midi")
+         {
+            std::string path = dirname + "/" + name;
+            struct stat st;
+            if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+               names.push_back(path);
+         }
+      }
+   }
+   closedir(dir);
+   std::sort(names.begin(), names.end());
+   m_in_files.insert(m_in_files.end(), names.begin(), names.end());
+   return true;
+}
+
+/**
+ *    Adds the files named in a list, one per line.  Leading and trailing
+ *    white space is removed from each line.
+ *
+ * \param in
+ *    Provides the stream from which the list is read.
+ *
+ * \return
+ *    Returns true, always.
+ */
+
+bool
+midibatch::add_list (std::istream & in)
+{
+   std::string line;
+   while (std::getline(in, line))
+   {
+      std::string::size_type first = line.find_first_not_of(" \t\r");
+      if (first != std::string::npos && line[first] != '#')
+      {
+         std::string::size_type last = line.find_last_not_of(" \t\r");
+         m_in_files.push_back(line.substr(first, last - first + 1));
+      }
+   }
+   return true;
+}
+
+/**
+ *    Makes the name of the output file for an input file, from the output
+ *    template.  A "%s" in the template is replaced by the base name of the
+ *    input file, without its directory or extension, and a "%%" is
+ *    replaced by "%".  For example, with a template of "out/%s-pss.mid",
+ *    "songs/intro.mid" is written to "out/intro-pss.mid".
+ *
+ * \param infile
+ *    Provides the name of the input file.
+ *
+ * \param back
+ *    If true, the name of the round-trip file is made instead, from the
+ *    template given to round_trip().
+ *
+ * \return
+ *    Returns the name of the output file.
+ */
+
+std::string
+midibatch::output_name (const std::string & infile, bool back) const
+{
+   const std::string & tmpl = back ? m_back_template : m_out_template ;
+   std::string base = infile;
+   std::string::size_type slash = base.find_last_of('/');
+   if (slash != std::string::npos)
+      base.erase(0, slash + 1);
+
+   std::string::size_type dot = base.find_last_of('.');
+   if (dot != std::string::npos && dot > 0)
+      base.erase(dot);
+
+   std::string result;
+   for (std::string::size_type i = 0; i < tmpl.size(); ++i)
+   {
+      char c = tmpl[i];
+      if (c == '%' && i + 1 < tmpl.size())
+      {
+         char next = tmpl[i + 1];
+         if (next == 's')
+         {
+            result += base;
+            ++i;
+            continue;
+         }
+         else if (next == '%')
+         {
+            result += '%';
+            ++i;
+            continue;
+         }
+      }
+      result += c;
+   }
+   return result;
+}
+
+/**
+ *    Makes the canonical name of a file that need not exist yet, by
+ *    resolving the directory part with realpath(), so that names such as
+ *    "out/a.mid" and "./out//a.mid" compare equal.
+ *
+ * \param filename
+ *    Provides the name of the file.
+ *
+ * \return
+ *    Returns the canonical name, or the name as given if its directory
+ *    cannot be resolved.
+ */
+
+static std::string
+canonical_name (const std::string & filename)
+{
+   std::string dir = ".";
+   std::string base = filename;
+   std::string::size_type slash = filename.find_last_of('/');
+   if (slash != std::string::npos)
+   {
+      dir = slash > 0 ? filename.substr(0, slash) : std::string("/");
+      base = filename.substr(slash + 1);
+   }
+
+   char resolved[PATH_MAX];
+   if (is_nullptr(realpath(dir.c_str(), resolved)))
+      return filename;
+
+   std::string result = resolved;
+   if (result.empty() || result[result.size() - 1] != '/')
+      result += '/';
+
+   return result + base;
+}
+
+/**
+ *    Makes the name of the output file of every input file, and checks
+ *    them all before anything is converted.  An output file may not be
+ *    the same file as any input file, as found by the device and inode
+ *    numbers from stat(), and no two input files may have the same output
+ *    file, as happens when two directories hold files of the same name.
+ *    The round-trip files, if any, are checked the same way.  Every
+ *    problem found is reported.
+ *
+ * \return
+ *    Returns true if the output files can all be written safely.
+ */
+
+bool
+midibatch::check_outputs ()
+{
+   typedef std::pair<dev_t, ino_t> file_id;
+   bool result = true;
+   std::set<file_id> inputs;
+   std::map<std::string, size_t> outputs;
+   std::vector<std::pair<std::string, size_t> > names;
+   m_out_files.clear();
+   m_back_files.clear();
+   for (size_t i = 0; i < m_in_files.size(); ++i)
+   {
+      struct stat st;
+      if (stat(m_in_files[i].c_str(), &st) == 0)
+         inputs.insert(file_id(st.st_dev, st.st_ino));
+
+      m_out_files.push_back(output_name(m_in_files[i]));
+      names.push_back(std::make_pair(m_out_files.back(), i));
+      if (! m_back_template.empty())
+      {
+         m_back_files.push_back(output_name(m_in_files[i], true));
+         names.push_back(std::make_pair(m_back_files.back(), i));
+      }
+   }
+   for (size_t n = 0; n < names.size(); ++n)
+   {
+      const std::string & outfile = names[n].first;
+      size_t i = names[n].second;
+      struct stat st;
+      if
+      (
+         stat(outfile.c_str(), &st) == 0 &&
+         inputs.find(file_id(st.st_dev, st.st_ino)) != inputs.end()
+      )
+      {
+         errprintf("? output '%s' is also an input file\n", outfile.c_str());
+         result = false;
+      }
+
+      std::pair<std::map<std::string, size_t>::iterator, bool> added =
+         outputs.insert(std::make_pair(canonical_name(outfile), i));
+
+      if (! added.second)
+      {
+         std::string message = "'" + m_in_files[added.first->second] +
+            "' and '" + m_in_files[i] + "' both make output '" + outfile + "'";
+
+         errprintf("? %s\n", message.c_str());
+         result = false;
+      }
+   }
+   return result;
+}
+
+/**
+ *    Converts all of the files, using up to m_jobs threads.  With one
+ *    job, the files are converted in the calling thread.  Otherwise, the
+ *    threads share the mapper given to the constructor, and afterward
+ *    the conversion counts of all the threads are added to it.
+ *
+ *    If check_outputs() finds a problem with the output names, nothing
+ *    is converted.
+ *
+ * \return
+ *    Returns true if every file was converted.
+ */
+
+bool
+midibatch::run ()
+{
+   if (m_out_template.find("%s") == std::string::npos)
+   {
+      errprint("the --batch output name must contain '%s'");
+      return false;
+   }
+   if
+   (
+      ! m_back_template.empty() &&
+      m_back_template.find("%s") == std::string::npos
+   )
+   {
+      errprint("the --batch round-trip name must contain '%s'");
+      return false;
+   }
+   if (! check_outputs())
+   {
+      errprint("no --batch files were converted");
+      return false;
+   }
+
+   int jobs = m_jobs;
+   if (jobs > file_count())
+      jobs = file_count();
+
+   m_next_file = 0;
+   m_failures = 0;
+   m_nomerge = Mf_nomerge;
+   m_report = Mf_report;
+   midimapper & back = m_mapper.direction(! m_mapper.map_reversed());
+   if (jobs <= 1)
+   {
+      convert_files(m_mapper.counts(), back.counts());
+   }
+   else
+   {
+      std::vector<midicounts> counts(jobs);
+      std::vector<midicounts> backcounts(jobs);
+      std::vector<worker_data> data(jobs);
+      std::vector<pthread_t> threads(jobs);
+      std::vector<bool> started(jobs, false);
+      for (int j = 0; j < jobs; ++j)
+      {
+         data[j].batch = this;
+         data[j].counts = &counts[j];
+         data[j].back_counts = &backcounts[j];
+         started[j] =
+            pthread_create(&threads[j], nullptr, worker, &data[j]) == 0;
+
+         if (! started[j])
+            errprint("could not start a --batch thread");
+      }
+      for (int j = 0; j < jobs; ++j)
+      {
+         if (started[j])
+         {
+            pthread_join(threads[j], nullptr);
+            m_mapper.add_counts(counts[j]);
+            back.add_counts(backcounts[j]);
+         }
+      }
+
+      /*
+       * If no thread could be started, the files are still converted.
+       */
+
+      if (m_next_file < m_in_files.size())
+         convert_files(m_mapper.counts(), back.counts());
+   }
+   if (m_failures > 0)
+   {
+      char counts[48];
+      (void) snprintf
+      (
+         counts, sizeof counts, "%d of %d", m_failures, file_count()
+      );
+      errprintf("? %s files could not be converted\n", counts);
+   }
+   return m_failures == 0;
+}
+
+/**
+ *    The function run by each worker thread.
+ *
+ * \param data
+ *    Provides a pointer to the worker_data for the thread.
+ *
+ * \return
+ *    Returns null, always.
+ */
+
+void *
+midibatch::worker (void * data)
+{
+   worker_data * wd = static_cast<worker_data *>(data);
+   wd->batch->convert_files(*wd->counts, *wd->back_counts);
+   return nullptr;
+}
+
+/**
+ *    Gets the next file to convert.
+ *
+ * \param index
+ *    Provides the destination for the index of the file in m_in_files and
+ *    m_out_files.
+ *
+ * \return
+ *    Returns false if there are no files left.
+ */
+
+bool
+midibatch::next_file (size_t & index)
+{
+   bool result = false;
+   pthread_mutex_lock(&m_lock);
+   if (m_next_file < m_in_files.size())
+   {
+      index = m_next_file++;
+      result = true;
+   }
+   pthread_mutex_unlock(&m_lock);
+   return result;
+}
+
+/**
+ *    Converts files until there are none left.  The shared mapper is
+ *    hooked into the libmidifilex callbacks of the calling thread, which
+ *    are also given the parser settings of the thread that called run().
+ *    For a round trip, each output file is then converted back with the
+ *    other direction of the mapper.
+ *
+ * \param counts
+ *    Provides the calling thread's own conversion counts.
+ *
+ * \param backcounts
+ *    Provides the calling thread's own conversion counts for the other
+ *    direction, used only for a round trip.
+ */
+
+void
+midibatch::convert_files (midicounts & counts, midicounts & backcounts)
+{
+   const midimapper & back = m_mapper.direction(! m_mapper.map_reversed());
+   size_t index;
+   Mf_nomerge = m_nomerge;
+   Mf_report = m_report;
+   while (next_file(index))
+   {
+      midimap_init(m_mapper, counts);
+      bool ok = convert(m_in_files[index], m_out_files[index]);
+      if (ok && ! m_back_files.empty())
+      {
+         midimap_init(back, backcounts);
+         ok = convert(m_out_files[index], m_back_files[index]);
+      }
+      if (! ok)
+      {
+         pthread_mutex_lock(&m_lock);
+         ++m_failures;
+         pthread_mutex_unlock(&m_lock);
+      }
+   }
+}
+
+/**
+ *    Converts one file in the calling thread, using the callbacks set up
+ *    by midimap_init().  It is static, so that midicvtpp can also use it
+ *    for the round trip of a single file.  The output is written to a
+ *    temporary file in the same directory, which is renamed to the output
+ *    name only if the conversion succeeds, and removed otherwise.
+ *
+ * \param infile
+ *    Provides the name of the MIDI file to read.
+ *
+ * \param outfile
+ *    Provides the name of the MIDI file to write.
+ *
+ * \return
+ *    Returns true if the file was converted.
+ */
+
+bool
+midibatch::convert (const std::string & infile, const std::string & outfile)
+{
+   bool result = false;
+   char suffix[32];
+   (void) snprintf(suffix, sizeof suffix, ".tmp%ld", long(getpid()));
+   std::string tempfile = outfile + suffix;    /* the outputs are unique   */
+   if (midicvt_option_debug())
+   {
+      fprintf
+      (
+         stderr, "Converting '%s' to '%s'\n", infile.c_str(), outfile.c_str()
+      );
+   }
+   g_io_file = fopen(infile.c_str(), "rb");
+   if (not_nullptr(g_io_file))
+   {
+      g_redirect_file = fopen(tempfile.c_str(), "wb");
+      if (not_nullptr(g_redirect_file))
+      {
+         g_status_tracks_to_do = 1;
+         g_status_track_number = 0;
+         midi_file_offset_clear();
+         result = mftransform_trapped() && ! ferror(g_io_file);
+         if (fclose(g_redirect_file) != 0)
+            result = false;
+
+         g_redirect_file = nullptr;
+         if (result && rename(tempfile.c_str(), outfile.c_str()) != 0)
+         {
+            errprintf("? could not rename to '%s'\n", outfile.c_str());
+            result = false;
+         }
+         if (! result)
+            (void) remove(tempfile.c_str());
+      }
+      else
+         errprintf("? could not create '%s'\n", outfile.c_str());
+
+      fclose(g_io_file);
+      g_io_file = nullptr;
+   }
+   else
+      errprintf("? could not open '%s'\n", infile.c_str());
+
+   if (! result)
+      errprintf("? failed to convert '%s'\n", infile.c_str());
+
+   return result;
+}
+
+}                 // namespace midipp
+
+/*
+ * midibatch.cpp
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=cpp
+ */
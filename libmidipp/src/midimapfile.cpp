@@ -0,0 +1,749 @@
+/*
+ * midicvtpp - A MIDI-text-MIDI translater
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/**
+ * \file          midimapfile.cpp
+ *
+ *    This module provides the compiled map files of midipp::midimapper,
+ *    written by "midicvtpp --compile-map", so that an INI file does not
+ *    have to be parsed for every --m2m conversion.
+ *
+ * \library       libmidipp
+ * \author        Chris Ahlstrom
+ * \date          2026-10-18
+ * \updates       2026-10-18
+ * \version       $Revision$
+ * \license       GNU GPL
+ *
+ *    A compiled map holds the maps read from the INI file twice, once as
+ *    read normally, and once as read with --reverse, so that one file
+ *    serves both directions.  The channel filter and the setup name of
+ *    the command line are applied when it is loaded, in the same way
+ *    that read_maps() applies them, and the flat tables are then built as
+ *    usual.  All values are little-endian.
+ *
+\verbatim
+      Offset  Size  Field
+       0      4     Magic "MCVM"
+       4      4     Version (MAP_VERSION)
+       8      8     Modification time of the INI file, in seconds
+      16      8     Size of the INI file
+      24      16    Hash of the INI file, from midicvt_cache_key()
+      40      4+n   Full path of the INI file
+      ...           The forward maps, then the reversed maps
+\endverbatim
+ *
+ *    Each set of maps holds the file style, setup name, and map type
+ *    strings, the record count, the number of entries left out because
+ *    they are not one-to-one, the GM and device channels, the filter
+ *    channel and flags, and then the drum, patch, controller, and channel
+ *    maps, each preceded by its size.  Then come the number of channels
+ *    with their own drum maps, and the channel and drum map of each, and
+ *    the same for the patch and controller maps of single channels.
+ *    Last come the controller, velocity, and bend curves, each set
+ *    preceded by its size, and each entry stored as its key, its number
+ *    of curves, and the number of points and the points of each curve.
+ *    A string is stored as its length followed by its characters.
+ *
+ *    When a compiled map is loaded, its INI file is checked.  If the INI
+ *    file has a new time or size, and its contents no longer match the
+ *    hash, the map is compiled again from it.  If the INI file is gone,
+ *    the compiled map is used as it is.
+ */
+
+#include <fcntl.h>                     /* open()                              */
+#include <limits.h>                    /* PATH_MAX                            */
+#include <stdio.h>                     /* FILE *, fopen(), rename()           */
+#include <stdlib.h>                    /* realpath()                          */
+#include <string.h>                    /* memcmp()                            */
+#include <sys/mman.h>                  /* mmap(), munmap()                    */
+#include <sys/stat.h>                  /* stat(), fstat()                     */
+#include <unistd.h>                    /* close(), getpid(), unlink()         */
+
+#include <ininames.hpp>                /* GM_INI_TESTING                      */
+#include <midicvt_cache.h>             /* midicvt_cache_key()                 */
+#include <midicvt_globals.h>           /* midicvt_option_debug()              */
+#include <midicvt_macros.h>            /* nullptr, true, false, etc.          */
+#include <midimapper.hpp>              /* this module's functions and stuff   */
+
+/**
+ *    Provides the four bytes that start every compiled map file.
+ */
+
+#define MAP_MAGIC                   "MCVM"
+
+/**
+ *    Provides the version of the compiled map files.  A file with another
+ *    version is treated as an INI file, and so is rejected.
+ */
+
+#define MAP_VERSION                 4
+
+/**
+ *    Provides the size of the fixed part of the header.
+ */
+
+#define MAP_HEADER_SIZE             (24 + MIDICVT_CACHE_KEY_SIZE - 1)
+
+/**
+ *    Appends a 32-bit value in little-endian order.
+ */
+
+static void
+put32 (std::string & b, unsigned long v)
+{
+   b += char(v & 0xff);
+   b += char((v >> 8) & 0xff);
+   b += char((v >> 16) & 0xff);
+   b += char((v >> 24) & 0xff);
+}
+
+/**
+ *    Appends a 64-bit value, as two 32-bit values, low half first.
+ */
+
+static void
+put64 (std::string & b, unsigned long v)
+{
+   put32(b, v & 0xffffffffUL);
+   put32(b, (v >> 16) >> 16);
+}
+
+/**
+ *    Appends a string, preceded by its length.
+ */
+
+static void
+putstr (std::string & b, const std::string & s)
+{
+   put32(b, (unsigned long) s.size());
+   b += s;
+}
+
+/**
+ *    Fetches a 32-bit little-endian value, if there is room for it.
+ */
+
+static bool
+get32 (const unsigned char * & p, const unsigned char * end, unsigned long & v)
+{
+   if (end - p < 4)
+      return false;
+
+   v =
+      (unsigned long) p[0] | ((unsigned long) p[1] << 8) |
+      ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+
+   p += 4;
+   return true;
+}
+
+/**
+ *    Fetches a 64-bit value stored by put64().
+ */
+
+static bool
+get64 (const unsigned char * & p, const unsigned char * end, unsigned long & v)
+{
+   unsigned long low;
+   unsigned long high;
+   if (! get32(p, end, low) || ! get32(p, end, high))
+      return false;
+
+   v = low | ((high << 16) << 16);
+   return true;
+}
+
+/**
+ *    Fetches a signed 32-bit value.
+ */
+
+static bool
+getint (const unsigned char * & p, const unsigned char * end, int & v)
+{
+   unsigned long u;
+   if (! get32(p, end, u))
+      return false;
+
+   v = (u & 0x80000000UL) ? int(long(u) - 0xffffffffL - 1) : int(u);
+   return true;
+}
+
+/**
+ *    Fetches a string stored by putstr().
+ */
+
+static bool
+getstr
+(
+   const unsigned char * & p,
+   const unsigned char * end,
+   std::string & s
+)
+{
+   unsigned long length;
+   if (! get32(p, end, length) || (unsigned long) (end - p) < length)
+      return false;
+
+   s.assign(reinterpret_cast<const char *>(p), length);
+   p += length;
+   return true;
+}
+
+/**
+ *    Appends a drum or patch map, preceded by its size.
+ */
+
+static void
+putmap (std::string & b, const std::map<int, midipp::annotation> & m)
+{
+   put32(b, (unsigned long) m.size());
+   std::map<int, midipp::annotation>::const_iterator mi = m.begin();
+   for ( ; mi != m.end(); ++mi)
+   {
+      put32(b, (unsigned long) mi->first);
+      put32(b, (unsigned long) mi->second.value());
+      putstr(b, mi->second.key_name());
+      putstr(b, mi->second.value_name());
+      putstr(b, mi->second.gm_name());
+   }
+}
+
+/**
+ *    Fetches a map stored by putmap().
+ */
+
+static bool
+getmap
+(
+   const unsigned char * & p,
+   const unsigned char * end,
+   std::map<int, midipp::annotation> & m
+)
+{
+   int count = 0;
+   bool result = getint(p, end, count);
+   m.clear();
+   for (int i = 0; result && i < count; ++i)
+   {
+      int key;
+      int value;
+      std::string keyname;
+      std::string valuename;
+      std::string gmname;
+      result =
+         getint(p, end, key) && getint(p, end, value) &&
+         getstr(p, end, keyname) && getstr(p, end, valuename) &&
+         getstr(p, end, gmname);
+
+      if (result)
+      {
+         midipp::annotation an(value, keyname, valuename, gmname);
+         m.insert(std::make_pair(key, an));
+      }
+   }
+   return result;
+}
+
+/**
+ *    Reads a whole file and hashes it with midicvt_cache_key().
+ *
+ * \param filename
+ *    Provides the name of the file.
+ *
+ * \param key
+ *    Provides the destination for the hash, MIDICVT_CACHE_KEY_SIZE bytes.
+ *
+ * \return
+ *    Returns true if the file could be read.
+ */
+
+static bool
+hash_file (const std::string & filename, char * key)
+{
+   FILE * fp = fopen(filename.c_str(), "rb");
+   bool result = not_nullptr(fp);
+   if (result)
+   {
+      std::string text;
+      char buffer[4096];
+      size_t count;
+      while ((count = fread(buffer, 1, sizeof buffer, fp)) > 0)
+         text.append(buffer, count);
+
+      result = ! ferror(fp);
+      fclose(fp);
+      if (result)
+         midicvt_cache_key(text.data(), text.size(), nullptr, 0, key);
+   }
+   return result;
+}
+
+namespace midipp
+{
+
+/**
+ *    Reads an INI file in both directions, from a single parse, and
+ *    writes the maps to a compiled map file that the midimapper
+ *    constructor can load instead.
+ *    The file is first written under a temporary name, and then renamed,
+ *    so that a conversion running at the same time never sees a partly
+ *    written map.
+ *
+ * \param inifile
+ *    Provides the name of the INI file to compile.
+ *
+ * \param mapfile
+ *    Provides the name of the compiled map file to write.
+ *
+ * \return
+ *    Returns true if the INI file was valid and the map was written.
+ */
+
+bool
+midimapper::compile_map
+(
+   const std::string & inifile,
+   const std::string & mapfile
+)
+{
+   midimapper forward("", inifile, false, NOT_ACTIVE, false, "", "", true);
+   const midimapper & reversed = forward.direction(true);
+   struct stat st;
+   char key[MIDICVT_CACHE_KEY_SIZE];
+   char fullpath[PATH_MAX];
+   bool result = forward.valid() && reversed.valid();
+   if (result)
+   {
+      result =
+         stat(inifile.c_str(), &st) == 0 && hash_file(inifile, key) &&
+         not_nullptr(realpath(inifile.c_str(), fullpath));
+
+      if (! result)
+         errprintf("? could not read INI file '%s'\n", inifile.c_str());
+   }
+   if (result)
+   {
+      std::string buffer(MAP_MAGIC);
+      put32(buffer, MAP_VERSION);
+      put64(buffer, (unsigned long) st.st_mtime);
+      put64(buffer, (unsigned long) st.st_size);
+      buffer.append(key, MIDICVT_CACHE_KEY_SIZE - 1);
+      putstr(buffer, fullpath);
+      forward.put_state(buffer);
+      reversed.put_state(buffer);
+
+      char suffix[32];
+      (void) snprintf(suffix, sizeof suffix, ".tmp%ld", (long) getpid());
+      std::string temppath = mapfile + suffix;
+      FILE * fp = fopen(temppath.c_str(), "wb");
+      result = not_nullptr(fp);
+      if (result)
+      {
+         result = fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size();
+         if (fclose(fp) != 0)
+            result = false;
+
+         if (result)
+            result = rename(temppath.c_str(), mapfile.c_str()) == 0;
+
+         if (! result)
+            (void) unlink(temppath.c_str());
+      }
+      if (! result)
+         errprintf("? could not write compiled map '%s'\n", mapfile.c_str());
+   }
+   return result;
+}
+
+/**
+ *    Checks if a file is a compiled map, rather than an INI file, by
+ *    looking at its first bytes.
+ *
+ * \param filename
+ *    Provides the name of the file.
+ *
+ * \return
+ *    Returns true if the file starts with the magic number and version of
+ *    a compiled map.
+ */
+
+bool
+midimapper::is_compiled_map (const std::string & filename)
+{
+   bool result = false;
+   FILE * fp = fopen(filename.c_str(), "rb");
+   if (not_nullptr(fp))
+   {
+      unsigned char header[8];
+      if (fread(header, 1, sizeof header, fp) == sizeof header)
+      {
+         const unsigned char * p = &header[4];
+         unsigned long version;
+         result =
+            memcmp(header, MAP_MAGIC, 4) == 0 &&
+            get32(p, &header[8], version) && version == MAP_VERSION;
+      }
+      fclose(fp);
+   }
+   return result;
+}
+
+/**
+ *    Loads a compiled map file written by compile_map(), in place of
+ *    read_maps().  The file is mapped into memory, checked against its
+ *    INI file, and the maps for the direction of m_map_reversed are
+ *    read from it, along with the maps of the other direction if this
+ *    mapper was made for both.  Then the setup name and channel filter of
+ *    the INI file are applied on top of those of the constructor's
+ *    parameters.
+ *
+ * \param mapfile
+ *    Provides the name of the compiled map file.
+ *
+ * \return
+ *    Returns true if the maps were loaded.
+ */
+
+bool
+midimapper::read_compiled (const std::string & mapfile)
+{
+   bool result = false;
+   std::string inifile;
+   bool stale = false;
+   int fd = open(mapfile.c_str(), O_RDONLY);
+   if (fd >= 0)
+   {
+      struct stat st;
+      if (fstat(fd, &st) == 0 && st.st_size >= MAP_HEADER_SIZE)
+      {
+         size_t size = size_t(st.st_size);
+         void * base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (base != MAP_FAILED)
+         {
+            const unsigned char * start =
+               static_cast<const unsigned char *>(base);
+
+            const unsigned char * p = start + 8;
+            const unsigned char * end = start + size;
+            unsigned long initime;
+            unsigned long inisize;
+            std::string key
+            (
+               reinterpret_cast<const char *>(start + 24),
+               MIDICVT_CACHE_KEY_SIZE - 1
+            );
+            (void) get64(p, end, initime);
+            (void) get64(p, end, inisize);
+            p = start + MAP_HEADER_SIZE;
+            result = getstr(p, end, inifile);
+            if (result)
+            {
+               struct stat inist;
+               if
+               (
+                  stat(inifile.c_str(), &inist) == 0 &&
+                  (
+                     (unsigned long) inist.st_mtime != initime ||
+                     (unsigned long) inist.st_size != inisize
+                  )
+               )
+               {
+                  char inikey[MIDICVT_CACHE_KEY_SIZE];
+                  stale = ! hash_file(inifile, inikey) || key != inikey;
+               }
+            }
+            if (result && ! stale)
+            {
+               /*
+                * The forward maps come first.  Without a mapper for the
+                * other direction, they are skipped to get to the reversed
+                * maps.
+                */
+
+               midimapper skipped;
+               midimapper * other =
+                  not_nullptr(m_inverse) ? m_inverse : &skipped ;
+
+               int filter_channel = m_filter_channel;
+               bool extraction_on = m_extraction_on;
+               bool rejection_on = m_rejection_on;
+               std::string setup_name = m_setup_name;
+               if (m_map_reversed)
+                  result = other->get_state(p, end) && get_state(p, end);
+               else if (not_nullptr(m_inverse))
+                  result = get_state(p, end) && other->get_state(p, end);
+               else
+                  result = get_state(p, end);
+
+               /*
+                * Redo what read_unnamed_section() does with the values in
+                * the INI file on top of the constructor's values, which
+                * both directions share.
+                */
+
+               midimapper * mappers[2] = { this, m_inverse };
+               for (int m = 0; result && m < 2; ++m)
+               {
+                  midimapper * mm = mappers[m];
+                  if (is_nullptr(mm))
+                     continue;
+
+                  if (mm->m_setup_name.empty() || setup_name == GM_INI_TESTING)
+                     mm->m_setup_name = setup_name;
+
+                  if (mm->m_filter_channel == NOT_ACTIVE)
+                     mm->m_filter_channel = filter_channel;
+
+                  if (! mm->m_extraction_on && ! mm->m_rejection_on)
+                  {
+                     mm->m_extraction_on = extraction_on;
+                     mm->m_rejection_on = rejection_on;
+                  }
+               }
+            }
+            munmap(base, size);
+         }
+      }
+      close(fd);
+   }
+   if (stale)
+   {
+      fprintf
+      (
+         stderr, "! '%s' has changed, compiling '%s' again\n",
+         inifile.c_str(), mapfile.c_str()
+      );
+      if (compile_map(inifile, mapfile) && is_compiled_map(mapfile))
+         return read_compiled(mapfile);
+      else
+         return read_maps(inifile);
+   }
+   if (! result)
+      errprintf("? could not read compiled map '%s'\n", mapfile.c_str());
+   else if (midicvt_option_debug())
+      show_maps("read_compiled()", *this);
+
+   if (m_setup_name == GM_INI_TESTING)
+   {
+      infoprint("testing, so ending before file processing");
+      result = false;
+   }
+   return result;
+}
+
+/**
+ *    Appends the settings and maps read from the INI file to a compiled
+ *    map.
+ *
+ * \param buffer
+ *    Provides the compiled map being built.
+ */
+
+void
+midimapper::put_state (std::string & buffer) const
+{
+   putstr(buffer, m_file_style);
+   putstr(buffer, m_setup_name);
+   putstr(buffer, m_map_type);
+   put32(buffer, (unsigned long) m_record_count);
+   put32(buffer, (unsigned long) m_non_injective);
+   put32(buffer, (unsigned long) m_gm_channel);
+   put32(buffer, (unsigned long) m_device_channel);
+   put32(buffer, (unsigned long) m_filter_channel);
+   put32
+   (
+      buffer,
+      (m_extraction_on ? 1 : 0) | (m_rejection_on ? 2 : 0) |
+         (m_map_reversed ? 4 : 0)
+   );
+
+   putmap(buffer, m_drum_map);
+   putmap(buffer, m_patch_map);
+   putmap(buffer, m_control_map);
+   put32(buffer, (unsigned long) m_channel_map.size());
+   std::map<int, int>::const_iterator ci = m_channel_map.begin();
+   for ( ; ci != m_channel_map.end(); ++ci)
+   {
+      put32(buffer, (unsigned long) ci->first);
+      put32(buffer, (unsigned long) ci->second);
+   }
+
+   const channel_midimaps * maps[3] =
+   {
+      &m_channel_drum_maps, &m_channel_patch_maps, &m_channel_control_maps
+   };
+   for (int m = 0; m < 3; ++m)
+   {
+      put32(buffer, (unsigned long) maps[m]->size());
+      channel_midimaps::const_iterator cmi = maps[m]->begin();
+      for ( ; cmi != maps[m]->end(); ++cmi)
+      {
+         put32(buffer, (unsigned long) cmi->first);
+         putmap(buffer, cmi->second);
+      }
+   }
+
+   const curve_map * curvemaps[3] =
+   {
+      &m_control_curves, &m_velocity_curves, &m_bend_curves
+   };
+   for (int m = 0; m < 3; ++m)
+   {
+      put32(buffer, (unsigned long) curvemaps[m]->size());
+      curve_map::const_iterator ci = curvemaps[m]->begin();
+      for ( ; ci != curvemaps[m]->end(); ++ci)
+      {
+         put32(buffer, (unsigned long) ci->first);
+         put32(buffer, (unsigned long) ci->second.size());
+         curves::const_iterator si = ci->second.begin();
+         for ( ; si != ci->second.end(); ++si)
+         {
+            put32(buffer, (unsigned long) si->size());
+            for (curve::const_iterator pi = si->begin(); pi != si->end(); ++pi)
+            {
+               put32(buffer, (unsigned long) pi->first);
+               put32(buffer, (unsigned long) pi->second);
+            }
+         }
+      }
+   }
+}
+
+/**
+ *    Reads the settings and maps stored by put_state().  The setup name
+ *    and the channel filter are read as the INI file gave them, and so
+ *    replace those of the constructor, which read_compiled() restores.
+ *
+ * \param p [in/out]
+ *    Provides the position in the compiled map, and returns the position
+ *    after the maps.
+ *
+ * \param end
+ *    Provides the end of the compiled map.
+ *
+ * \return
+ *    Returns true if the maps were complete.
+ */
+
+bool
+midimapper::get_state (const unsigned char * & p, const unsigned char * end)
+{
+   int flags = 0;
+   bool result =
+      getstr(p, end, m_file_style) && getstr(p, end, m_setup_name) &&
+      getstr(p, end, m_map_type) && getint(p, end, m_record_count) &&
+      getint(p, end, m_non_injective) &&
+      getint(p, end, m_gm_channel) && getint(p, end, m_device_channel) &&
+      getint(p, end, m_filter_channel) && getint(p, end, flags);
+
+   if (result)
+   {
+      m_extraction_on = (flags & 1) != 0;
+      m_rejection_on = (flags & 2) != 0;
+      m_map_reversed = (flags & 4) != 0;
+   }
+
+   if (result)
+   {
+      result =
+         getmap(p, end, m_drum_map) && getmap(p, end, m_patch_map) &&
+         getmap(p, end, m_control_map);
+   }
+
+   if (result)
+   {
+      int count = 0;
+      m_channel_map.clear();
+      result = getint(p, end, count);
+      for (int i = 0; result && i < count; ++i)
+      {
+         int in;
+         int out;
+         result = getint(p, end, in) && getint(p, end, out);
+         if (result)
+            m_channel_map[in] = out;
+      }
+   }
+
+   channel_midimaps * maps[3] =
+   {
+      &m_channel_drum_maps, &m_channel_patch_maps, &m_channel_control_maps
+   };
+   for (int m = 0; result && m < 3; ++m)
+   {
+      int count = 0;
+      maps[m]->clear();
+      result = getint(p, end, count);
+      for (int i = 0; result && i < count; ++i)
+      {
+         int channel;
+         result = getint(p, end, channel) &&
+            channel >= 0 && channel < CHANNEL_COUNT &&
+            getmap(p, end, (*maps[m])[channel]);
+      }
+   }
+
+   curve_map * curvemaps[3] =
+   {
+      &m_control_curves, &m_velocity_curves, &m_bend_curves
+   };
+   for (int m = 0; result && m < 3; ++m)
+   {
+      int count = 0;
+      curvemaps[m]->clear();
+      result = getint(p, end, count);
+      for (int i = 0; result && i < count; ++i)
+      {
+         int key;
+         int stages = 0;
+         result = getint(p, end, key) && getint(p, end, stages);
+         if (result)
+         {
+            curves & c = (*curvemaps[m])[key];
+            for (int s = 0; result && s < stages; ++s)
+            {
+               int points = 0;
+               c.push_back(curve());
+               result = getint(p, end, points) && points > 0;
+               for (int n = 0; result && n < points; ++n)
+               {
+                  int x;
+                  int y;
+                  result = getint(p, end, x) && getint(p, end, y);
+                  if (result)
+                     c.back().push_back(std::make_pair(x, y));
+               }
+            }
+         }
+      }
+   }
+   return result;
+}
+
+}                 // namespace midipp
+
+/*
+ * midimapfile.cpp
+ *
+ * vim: sw=3 ts=3 wm=8 et ft=cpp
+ */
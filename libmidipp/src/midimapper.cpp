@@ -28,7 +28,7 @@
  * \library       libmidipp
  * \author        Chris Ahlstrom
  * \date          2014-04-24
- * \updates       2016-04-23
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
@@ -43,7 +43,11 @@
  *    mftransform().
  */
 
-#include <stdlib.h>                    /* atoi()                              */
+#include <stdio.h>                     /* fprintf(), snprintf()               */
+#include <stdlib.h>                    /* atoi(), strtol()                    */
+#include <string.h>                    /* memcpy()                            */
+
+#include <algorithm>                   /* std::sort(), std::equal()           */
 
 #include <ininames.hpp>                /* label/value names for the INI files */
 #include <initree.hpp>                 /* midimpp::initree                    */
@@ -53,6 +57,18 @@
 #include <midifilex.h>                 /* Mf_on and other callback pointers   */
 #include <midimapper.hpp>              /* this module's functions and stuff   */
 
+/*
+ *    midimapper::apply() remaps blocks of events with SSE2, which every
+ *    x86-64 processor has, or with AVX2 if the processor has it.  Other
+ *    compilers and processors use only the plain loop.
+ */
+
+#if defined __GNUC__ && defined __SSE2__ && \
+   (defined __x86_64__ || defined __i386__)
+#define MIDIMAPPER_SIMD 1
+#include <immintrin.h>                 /* SSE2 and AVX2 intrinsics            */
+#endif
+
 /*
  *    The following functions use the midimapper functions to modify
  *    the channel, note, or patch numbers.  These functions are registered
@@ -99,12 +115,61 @@ annotation::annotation
    m_value        (value),
    m_key_name     (keyname),
    m_value_name   (valuename),
-   m_gm_name      (gmname),
-   m_remap_count  (0)
+   m_gm_name      (gmname)
 {
    // no other code
 }
 
+/**
+ *    Creates a set of conversion counts, all zero.
+ */
+
+midicounts::midicounts ()
+{
+   clear();
+}
+
+/**
+ *    Sets all of the conversion counts to zero.
+ */
+
+void
+midicounts::clear ()
+{
+   for (int channel = 0; channel < CHANNEL_COUNT; ++channel)
+   {
+      for (int value = 0; value < VALUE_COUNT; ++value)
+      {
+         m_notes[channel][value] = 0;
+         m_patches[channel][value] = 0;
+         m_controls[channel][value] = 0;
+      }
+   }
+}
+
+/**
+ *    Adds another set of conversion counts to this one.  Each worker
+ *    thread of midipp::midibatch counts into its own midicounts, and the
+ *    counts of the threads are added together for the --summarize output.
+ *
+ * \param other
+ *    Provides the counts to be added.
+ */
+
+void
+midicounts::add (const midicounts & other)
+{
+   for (int channel = 0; channel < CHANNEL_COUNT; ++channel)
+   {
+      for (int value = 0; value < VALUE_COUNT; ++value)
+      {
+         m_notes[channel][value] += other.m_notes[channel][value];
+         m_patches[channel][value] += other.m_patches[channel][value];
+         m_controls[channel][value] += other.m_controls[channel][value];
+      }
+   }
+}
+
 /**
  *    This constructor creates an unnamed, no-change mapping object.
  *
@@ -129,9 +194,28 @@ midimapper::midimapper ()
    m_drum_map        (),
    m_patch_map       (),
    m_channel_map     (),
+   m_channel_drum_maps  (),
+   m_channel_patch_maps (),
+   m_control_map     (),
+   m_channel_control_maps (),
+   m_control_curves  (),
+   m_velocity_curves (),
+   m_bend_curves     (),
+   m_drum_table      (),
+   m_patch_table     (),
+   m_channel_table   (),
+   m_note_table      (),
+   m_program_table   (),
+   m_control_table   (),
+   m_value_tables    (),
+   m_velocity_table  (),
+   m_bend_table      (),
+   m_counts          (),
+   m_non_injective   (0),
+   m_inverse         (nullptr),
    m_is_valid        (false)
 {
-   // no code
+   build_tables();
 }
 
 /**
@@ -147,7 +231,7 @@ midimapper::midimapper ()
  * \param filespec
  *    Provides the full file-path specification of an INI-style file to be
  *    read.  See the example files in the <code>tests/inifiles</code>
- *    directory.
+ *    directory.  It can also name a map file written by compile_map().
  *
  * \param reverse_it
  *    Indicates if the numeric values are to be swapped.  Thus, applying
@@ -172,6 +256,12 @@ midimapper::midimapper ()
  *
  * \param outile
  *    The name of the outut MIDI file, for informational purposes only.
+ *
+ * \param both_ways
+ *    If true, the mapping for the other direction is built as well, from
+ *    the same parse of the INI file, so that direction() can select
+ *    either one for each conversion.  The default is false, since most
+ *    conversions need only one direction.
  */
 
 midimapper::midimapper
@@ -182,7 +272,8 @@ midimapper::midimapper
    int filter_channel,
    bool reject_it,
    const std::string & infile,
-   const std::string & outfile
+   const std::string & outfile,
+   bool both_ways
 ) :
    m_file_style      (),
    m_setup_name      (name),
@@ -207,13 +298,331 @@ midimapper::midimapper
    m_drum_map        (),
    m_patch_map       (),
    m_channel_map     (),
+   m_channel_drum_maps  (),
+   m_channel_patch_maps (),
+   m_control_map     (),
+   m_channel_control_maps (),
+   m_control_curves  (),
+   m_velocity_curves (),
+   m_bend_curves     (),
+   m_drum_table      (),
+   m_patch_table     (),
+   m_channel_table   (),
+   m_note_table      (),
+   m_program_table   (),
+   m_control_table   (),
+   m_value_tables    (),
+   m_velocity_table  (),
+   m_bend_table      (),
+   m_counts          (),
+   m_non_injective   (0),
+   m_inverse         (nullptr),
    m_is_valid        (true)
 {
-   if (! filespec.empty())
-      m_is_valid = read_maps(filespec);
+   if (both_ways && ! filespec.empty())
+   {
+      m_inverse = new (std::nothrow) midimapper
+      (
+         name, "", reverse_it, filter_channel, reject_it, infile, outfile
+      );
+      m_is_valid = not_nullptr(m_inverse);
+      if (m_is_valid)
+         m_inverse->m_ini_filespec = filespec;
+   }
+   if (m_is_valid && ! filespec.empty())
+   {
+      if (is_compiled_map(filespec))
+         m_is_valid = read_compiled(filespec);
+      else
+         m_is_valid = read_maps(filespec);
+   }
 
    if (m_rejection_on)
       m_extraction_on = false;
+
+   build_tables();
+   if (not_nullptr(m_inverse))
+   {
+      m_inverse->m_is_valid = m_is_valid;
+      m_inverse->build_tables();
+   }
+}
+
+/**
+ *    Deletes the mapper of the other direction, if there is one.
+ */
+
+midimapper::~midimapper ()
+{
+   delete m_inverse;
+}
+
+/**
+ *    Selects the mapping for one direction of the INI file, so that each
+ *    conversion can choose its own direction from a mapper built with
+ *    both directions.
+ *
+ * \param reversed
+ *    If true, selects the reversed mapping, as made by --reverse,
+ *    otherwise the forward mapping.
+ *
+ * \return
+ *    Returns this mapper, if its direction matches, otherwise the mapper
+ *    of the other direction.  If the other direction was not built, this
+ *    mapper is returned anyway.
+ */
+
+const midimapper &
+midimapper::direction (bool reversed) const
+{
+   if (reversed != m_map_reversed && not_nullptr(m_inverse))
+      return *m_inverse;
+   else
+      return *this;
+}
+
+/**
+ *    Selects the mapping for one direction, so that its conversion counts
+ *    can be used.  See the const version of this function.
+ *
+ * \param reversed
+ *    If true, selects the reversed mapping.
+ *
+ * \return
+ *    Returns the mapper of the selected direction.
+ */
+
+midimapper &
+midimapper::direction (bool reversed)
+{
+   if (reversed != m_map_reversed && not_nullptr(m_inverse))
+      return *m_inverse;
+   else
+      return *this;
+}
+
+/**
+ *    Compiles the drum, patch, and channel settings into the flat tables
+ *    used by repitch(), repatch(), and rechannel(), and then fuses them
+ *    into the tables used by remap_note() and remap_program().  This is
+ *    done once, after the INI file is read and the channel-filter flags
+ *    are settled, so that the work of checking the filter and the drum
+ *    channels, and of searching the maps, is not repeated for every
+ *    event.
+ *
+ *    Each channel gets its own drum and patch table.  The drum table of
+ *    the device channel is built from m_drum_map, and the patch table of
+ *    every channel from m_patch_map.  The maps of single channels are
+ *    then copied over the tables of their channels.
+ *
+ *    The controller, velocity, and pitch-bend maps are compiled the same
+ *    way, with the curves of single channels overriding the curve of all
+ *    channels.  Each controller curve becomes a value table in
+ *    m_value_tables, shared by all the entries that use the same table.
+ *
+ *    All counts start at zero, and any value that is not remapped maps to
+ *    itself.
+ */
+
+void
+midimapper::build_tables ()
+{
+   uint8_t drums [VALUE_COUNT];
+   uint8_t patches [VALUE_COUNT];
+   for (int v = 0; v < VALUE_COUNT; ++v)
+   {
+      drums[v] = uint8_t(v);
+      patches[v] = uint8_t(v);
+   }
+   build_table(m_drum_map, drums, "drum");
+   build_table(m_patch_map, patches, "patch");
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      bool isdevice = c == m_device_channel;
+      for (int v = 0; v < VALUE_COUNT; ++v)
+      {
+         m_drum_table[c][v] = isdevice ? drums[v] : uint8_t(v) ;
+         m_patch_table[c][v] = patches[v];
+      }
+   }
+
+   channel_midimaps::const_iterator cmi = m_channel_drum_maps.begin();
+   for ( ; cmi != m_channel_drum_maps.end(); ++cmi)
+      build_table(cmi->second, m_drum_table[cmi->first], "drum");
+
+   cmi = m_channel_patch_maps.begin();
+   for ( ; cmi != m_channel_patch_maps.end(); ++cmi)
+      build_table(cmi->second, m_patch_table[cmi->first], "patch");
+
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      int channel = c;
+      if (m_extraction_on && c != m_filter_channel)
+      {
+         channel = NOT_ACTIVE;
+      }
+      else if (m_rejection_on && c == m_filter_channel)
+      {
+         channel = NOT_ACTIVE;
+      }
+      else if (active(m_gm_channel, m_device_channel) && c == m_device_channel)
+      {
+         /**
+          * Only if m_gm_channel and m_device_channel have been set are
+          * they used to alter the channel number of the event.  If they
+          * aren't active, or if the channel isn't the drum channel to be
+          * remapped, then the "[Channels]" map is checked.
+          */
+
+         channel = m_gm_channel;
+      }
+      else
+      {
+         std::map<int, int>::const_iterator ci = m_channel_map.find(c);
+         if (ci != m_channel_map.end())
+            channel = ci->second;
+      }
+      if (channel < NOT_ACTIVE || channel >= CHANNEL_COUNT)
+      {
+         warnprintf("! channel %d out of range, ignored\n", channel + 1);
+         channel = c;
+      }
+      m_channel_table[c] = int8_t(channel);
+   }
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      unsigned packed = m_channel_table[c] == NOT_ACTIVE ?
+         REMAP_DROP : unsigned(m_channel_table[c]) << 8 ;
+
+      for (int v = 0; v < VALUE_COUNT; ++v)
+      {
+         m_note_table[c][v] = packed | m_drum_table[c][v];
+         m_program_table[c][v] = uint16_t(packed | m_patch_table[c][v]);
+      }
+   }
+
+   uint8_t controls [VALUE_COUNT];
+   for (int v = 0; v < VALUE_COUNT; ++v)
+      controls[v] = uint8_t(v);
+
+   build_table(m_control_map, controls, "control");
+   m_value_tables.clear();
+   m_counts.clear();
+
+   curves identity;
+   (void) value_table(identity);       /* table 0 maps each value to itself */
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      unsigned packed = m_channel_table[c] == NOT_ACTIVE ?
+         REMAP_DROP : unsigned(m_channel_table[c]) << 8 ;
+
+      uint8_t row [VALUE_COUNT];
+      for (int v = 0; v < VALUE_COUNT; ++v)
+         row[v] = controls[v];
+
+      cmi = m_channel_control_maps.find(c);
+      if (cmi != m_channel_control_maps.end())
+         build_table(cmi->second, row, "control");
+
+      const curves * vc = find_curves(m_velocity_curves, c);
+      const curves * bc = find_curves(m_bend_curves, c);
+      m_bend_table[c] = not_nullptr(bc) ? *bc : identity ;
+      for (int v = 0; v < VALUE_COUNT; ++v)
+      {
+         int velocity = not_nullptr(vc) ? apply_curves(*vc, v) : v ;
+         if (v == 0)
+            velocity = 0;              /* a Note Off stays a Note Off       */
+         else if (velocity == 0)
+            velocity = 1;              /* a Note On stays a Note On         */
+
+         const curves * cc = find_control_curves(c, v);
+         unsigned index = not_nullptr(cc) ? unsigned(value_table(*cc)) : 0 ;
+         m_velocity_table[c][v] = uint8_t(velocity);
+         m_control_table[c][v] = packed | row[v] | index << 16;
+      }
+   }
+   pack_velocities();
+}
+
+/**
+ *    Adds the velocity table of each channel to m_value_tables, and packs
+ *    its index into every m_note_table entry of the channel, so that a
+ *    Note On event is remapped with the one lookup of its note.  Called
+ *    whenever m_velocity_table or m_note_table is rebuilt.
+ */
+
+void
+midimapper::pack_velocities ()
+{
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      unsigned index = unsigned(value_table(m_velocity_table[c]));
+      for (int v = 0; v < VALUE_COUNT; ++v)
+         m_note_table[c][v] = (m_note_table[c][v] & 0xffff) | index << 16;
+   }
+}
+
+/**
+ *    Copies one drum or patch map into its flat table.  Pairs that do not
+ *    fit in the 0 to 127 range of MIDI data cannot be looked up by
+ *    repitch() or repatch(), and are reported and ignored.
+ *
+ * \param m
+ *    Provides the map to be copied.
+ *
+ * \param table
+ *    Provides the table, already set to map each value to itself.
+ *
+ * \param secname
+ *    Provides the kind of map, for the warning message.
+ */
+
+void
+midimapper::build_table
+(
+   const midimap & m,
+   uint8_t * table,
+   const std::string & secname
+)
+{
+   for (const_iterator mi = m.begin(); mi != m.end(); ++mi)
+   {
+      int key = mi->first;
+      int value = mi->second.value();
+      if (key >= 0 && key < VALUE_COUNT && value >= 0 && value < VALUE_COUNT)
+      {
+         table[key] = uint8_t(value);
+      }
+      else
+      {
+         char pair[80];
+         snprintf
+         (
+            pair, sizeof pair, "%s pair (%d, %d)", secname.c_str(), key, value
+         );
+         warnprintf("! %s out of range, ignored\n", pair);
+      }
+   }
+}
+
+/**
+ *    Determines if a section name starts with the given prefix, such as
+ *    "Control".
+ *
+ * \param name
+ *    Provides the name of the section.
+ *
+ * \param prefix
+ *    Provides the prefix of a type of section.
+ *
+ * \return
+ *    Returns true if the name starts with the prefix.
+ */
+
+static bool
+has_prefix (const inistring & name, const inistring & prefix)
+{
+   return name.compare(0, prefix.size(), prefix) == 0;
 }
 
 /**
@@ -223,6 +632,41 @@ midimapper::midimapper
  *    and provide the settings we need.  We don't need to use
  *    shared-pointers, since this function is written in a safe manner.
  *
+ *    The tree is read by read_tree(), for this mapper, and then again
+ *    for the mapper of the other direction, if there is one, so that the
+ *    file is parsed only once for both directions.
+ *
+ * \param filename
+ *    Provides the full path specification of the file to be read.
+ *
+ * \return
+ *    Returns true if the operation succeeded.
+ */
+
+bool
+midimapper::read_maps (const std::string & filename)
+{
+   initree * itree = new (std::nothrow) initree(m_setup_name, filename);
+   bool result = not_nullptr(itree);
+   if (result)
+   {
+      result = read_tree(*itree, false);
+      if (result && not_nullptr(m_inverse))
+         result = m_inverse->read_tree(*itree, true);
+
+      delete itree;
+   }
+   if (m_setup_name == GM_INI_TESTING)
+   {
+      infoprint("testing, so ending before file processing");
+      result = false;
+   }
+   return result;
+}
+
+/**
+ *    Reads the maps of this mapper from the tree of an INI file.
+ *
  *    This function iterates through the sections.  Note than an unnamed
  *    section is treated differently:  The "gm-channel" and
  *    "dev-channel" values are looked up and set.
@@ -238,185 +682,348 @@ midimapper::midimapper
  *    If the m_map_reversed flag is true, then we want to take a GM MIDI
  *    file and re-map it for the corresponding device note.
  *
+ *    A section with a "channel" value goes into the map for that channel,
+ *    in m_channel_drum_maps, m_channel_patch_maps, or
+ *    m_channel_control_maps.  When reversed, its events are found on the
+ *    channel that the forward mapping sends them to, so the map is kept
+ *    for that channel instead.
+ *
+ *    The curves of the control, velocity, and bend sections are inverted
+ *    when the map is reversed.  A curve that does not rise all the way
+ *    cannot be inverted, and is reported and ignored.
+ *
  *    std::map::insert<> returns a pair of values:  an iterator into the
  *    map, and a boolean value for success/failure.  If the insertion
  *    fails, the pair is already in the map.  We tell the user about this,
  *    but do not treat it as a fatal error.
  *
- * \param filename
- *    Provides the full path specification of the file to be read.
+ *    Each failed insertion is counted in m_non_injective, which
+ *    show_maps() reports.  In a reversed map, it means that two entries
+ *    of the forward map lead to the same value, so that the forward map
+ *    is not one-to-one, and the reversed map keeps only the first of
+ *    them.
+ *
+ * \param it
+ *    Provides the tree of INI name/value pairs to read.
+ *
+ * \param inverse
+ *    If true, the direction given by the constructor and the INI file is
+ *    reversed.  This is used for the other direction of a mapper made for
+ *    both directions.
  *
  * \return
  *    Returns true if the operation succeeded.
  */
 
 bool
-midimapper::read_maps (const std::string & filename)
+midimapper::read_tree (const initree & it, bool inverse)
 {
-   initree * itree = new (std::nothrow) initree(m_setup_name, filename);
-   bool result = not_nullptr(itree);
+   bool result = read_unnamed_section(it);
+   if (inverse)
+      m_map_reversed = ! m_map_reversed;
+
    if (result)
-   {
-      const initree & it = *itree;
-      result = read_unnamed_section(it);
-      if (result)
-         result = read_channel_section(it);
+      result = read_channel_section(it);
 
-      if (result)
+   m_non_injective = 0;
+   if (result)
+   {
+      m_drum_map.clear();
+      m_patch_map.clear();
+      m_channel_drum_maps.clear();
+      m_channel_patch_maps.clear();
+      m_control_map.clear();
+      m_channel_control_maps.clear();
+      m_control_curves.clear();
+      m_velocity_curves.clear();
+      m_bend_curves.clear();
+      for (initree::const_iterator ici = it.begin(); ici != it.end(); ++ici)
       {
-         m_drum_map.clear();
-         m_patch_map.clear();
-         for (initree::const_iterator ici = it.begin(); ici != it.end(); ++ici)
+         const initree::Section & section = ici->second;
+         if (! section.name().empty())       // if not the unnamed section
          {
-            const initree::Section & section = ici->second;
-            if (! section.name().empty())       // if not the unnamed section
+            std::string gmvaluename;
+            std::string devvaluename;
+            std::string gmname;
+            int gmvalue = NOT_ACTIVE;
+            int devvalue = NOT_ACTIVE;
+            curve values;
+            gm_ini_section_t sect = INI_SECTION_UNKNOWN;
+            int c = section.name().compare
+            (
+               0, DRUM_SECTION.size(), DRUM_SECTION
+            );
+            if (c == 0)
+            {
+               sect = INI_SECTION_DRUM;
+            }
+            else
             {
-               std::string gmvaluename;
-               std::string devvaluename;
-               std::string gmname;
-               int gmvalue = NOT_ACTIVE;
-               int devvalue = NOT_ACTIVE;
-               gm_ini_section_t sect = INI_SECTION_UNKNOWN;
-               int c = section.name().compare
+               c = section.name().compare
                (
-                  0, DRUM_SECTION.size(), DRUM_SECTION
+                  0, PATCH_SECTION.size(), PATCH_SECTION
                );
                if (c == 0)
-               {
-                  sect = INI_SECTION_DRUM;
-               }
+                  sect = INI_SECTION_PATCH;
+               else if (has_prefix(section.name(), CONTROL_SECTION))
+                  sect = INI_SECTION_CONTROL;
+               else if (has_prefix(section.name(), VELOCITY_SECTION))
+                  sect = INI_SECTION_VELOCITY;
+               else if (has_prefix(section.name(), BEND_SECTION))
+                  sect = INI_SECTION_BEND;
                else
                {
-                  c = section.name().compare
-                  (
-                     0, PATCH_SECTION.size(), PATCH_SECTION
-                  );
-                  if (c == 0)
-                     sect = INI_SECTION_PATCH;
-                  else
+                  if (section.name() != CHANNEL_SECTION)
                   {
-                     if (section.name() != CHANNEL_SECTION)
-                     {
-                        warnprintf
-                        (
-                           "! Unknown section name '%s'\n",
-                           section.name().c_str()
-                        );
-                     }
-                     continue;
+                     warnprintf
+                     (
+                        "! Unknown section name '%s'\n",
+                        section.name().c_str()
+                     );
                   }
+                  continue;
                }
-               initree::Section::const_iterator sci;
-               if (sect == INI_SECTION_DRUM)
-               {
-                  sci = section.find(DRUM_LABEL_GM_NOTE);
-                  if (sci != section.end())
-                     gmvalue = atoi(sci->second.c_str());
+            }
+            initree::Section::const_iterator sci;
+            if (sect == INI_SECTION_DRUM)
+            {
+               sci = section.find(DRUM_LABEL_GM_NOTE);
+               if (sci != section.end())
+                  gmvalue = atoi(sci->second.c_str());
 
-                  sci = section.find(DRUM_LABEL_DEV_NOTE);
-                  if (sci != section.end())
-                     devvalue = atoi(sci->second.c_str());
+               sci = section.find(DRUM_LABEL_DEV_NOTE);
+               if (sci != section.end())
+                  devvalue = atoi(sci->second.c_str());
 
-                  sci = section.find(DRUM_LABEL_GM_NAME);
-                  if (sci != section.end())
-                     gmvaluename = sci->second;
+               sci = section.find(DRUM_LABEL_GM_NAME);
+               if (sci != section.end())
+                  gmvaluename = sci->second;
 
-                  sci = section.find(DRUM_LABEL_DEV_NAME);
-                  if (sci != section.end())
-                     devvaluename = sci->second;
+               sci = section.find(DRUM_LABEL_DEV_NAME);
+               if (sci != section.end())
+                  devvaluename = sci->second;
 
-                  sci = section.find(DRUM_LABEL_GM_EQUIV);
-                  if (sci != section.end())
-                     gmname = sci->second;
-               }
-               else if (sect == INI_SECTION_PATCH)
-               {
-                  sci = section.find(PATCH_LABEL_GM_PATCH);
-                  if (sci != section.end())
-                     gmvalue = atoi(sci->second.c_str());
+               sci = section.find(DRUM_LABEL_GM_EQUIV);
+               if (sci != section.end())
+                  gmname = sci->second;
+            }
+            else if (sect == INI_SECTION_PATCH)
+            {
+               sci = section.find(PATCH_LABEL_GM_PATCH);
+               if (sci != section.end())
+                  gmvalue = atoi(sci->second.c_str());
 
-                  sci = section.find(PATCH_LABEL_DEV_PATCH);
-                  if (sci != section.end())
-                     devvalue = atoi(sci->second.c_str());
+               sci = section.find(PATCH_LABEL_DEV_PATCH);
+               if (sci != section.end())
+                  devvalue = atoi(sci->second.c_str());
 
-                  sci = section.find(PATCH_LABEL_GM_NAME);
-                  if (sci != section.end())
-                     gmvaluename = sci->second;
+               sci = section.find(PATCH_LABEL_GM_NAME);
+               if (sci != section.end())
+                  gmvaluename = sci->second;
 
-                  sci = section.find(PATCH_LABEL_DEV_NAME);
-                  if (sci != section.end())
-                     devvaluename = sci->second;
+               sci = section.find(PATCH_LABEL_DEV_NAME);
+               if (sci != section.end())
+                  devvaluename = sci->second;
 
-                  sci = section.find(PATCH_LABEL_GM_EQUIV);
-                  if (sci != section.end())
-                     gmname = sci->second;
-               }
-               result = active(gmvalue, devvalue);
-               if (result)
-               {
-                  if (m_map_reversed)
-                  {
-                     int temp = gmvalue;
-                     gmvalue = devvalue;
-                     devvalue = temp;
-                     std::string stemp = gmvaluename;
-                     gmvaluename = devvaluename;
-                     devvaluename = stemp;
-                     gmname = devvaluename;
-                  }
+               sci = section.find(PATCH_LABEL_GM_EQUIV);
+               if (sci != section.end())
+                  gmname = sci->second;
+            }
+            else if (sect == INI_SECTION_CONTROL)
+            {
+               sci = section.find(CONTROL_LABEL_GM_CONTROL);
+               if (sci != section.end())
+                  gmvalue = atoi(sci->second.c_str());
 
-                  std::string secname = "unknown";
-                  annotation an(devvalue, gmvaluename, devvaluename, gmname);
-                  midimap_pair p = std::make_pair(gmvalue, an);
-                  midimap_result resultpair;
-                  if (sect == INI_SECTION_DRUM)
-                  {
-                     resultpair = m_drum_map.insert(p);
-                     secname = DRUM_SECTION;
-                  }
-                  else if (sect == INI_SECTION_PATCH)
-                  {
-                     resultpair = m_patch_map.insert(p);
-                     secname = PATCH_SECTION;
-                  }
-                  result = resultpair.second;
-                  if (result)
+               devvalue = gmvalue;           /* only the values may change */
+               sci = section.find(CONTROL_LABEL_DEV_CONTROL);
+               if (sci != section.end())
+                  devvalue = atoi(sci->second.c_str());
+
+               sci = section.find(CONTROL_LABEL_GM_NAME);
+               if (sci != section.end())
+                  gmvaluename = sci->second;
+
+               sci = section.find(CONTROL_LABEL_DEV_NAME);
+               if (sci != section.end())
+                  devvaluename = sci->second;
+
+               sci = section.find(CONTROL_LABEL_GM_EQUIV);
+               if (sci != section.end())
+                  gmname = sci->second;
+
+               sci = section.find(CONTROL_LABEL_VALUES);
+               if (sci != section.end())
+               {
+                  result = parse_curve(sci->second, VALUE_COUNT - 1, values);
+                  if (! result)
                   {
-                     ++m_record_count;
+                     errprintf
+                     (
+                        "bad values in section '%s'\n",
+                        section.name().c_str()
+                     );
+                     break;
                   }
-                  else
+               }
+            }
+            else
+            {
+               sci = section.find(CURVE_LABEL);
+               result = sci != section.end();
+               if (result)
+               {
+                  int maximum = sect == INI_SECTION_BEND ?
+                     BEND_MAXIMUM : VALUE_COUNT - 1 ;
+
+                  result = parse_curve(sci->second, maximum, values);
+               }
+               if (! result)
+               {
+                  errprintf
+                  (
+                     "bad curve in section '%s'\n", section.name().c_str()
+                  );
+                  break;
+               }
+            }
+
+            int channel = NOT_ACTIVE;
+            sci = section.find(SECTION_LABEL_CHANNEL);
+            if (sci != section.end())
+            {
+               channel = atoi(sci->second.c_str()) - 1;
+               if (channel < 0 || channel >= CHANNEL_COUNT)
+               {
+                  errprintf
+                  (
+                     "channel of section '%s' out of range\n",
+                     section.name().c_str()
+                  );
+                  result = false;
+                  break;
+               }
+               if (m_map_reversed)
+                  channel = forward_channel(channel);
+            }
+            if (m_map_reversed && ! values.empty())
+            {
+               if (! reverse_curve(values))
+               {
+                  warnprintf
+                  (
+                     "! curve of section '%s' cannot be reversed, ignored\n",
+                     section.name().c_str()
+                  );
+                  values.clear();
+               }
+            }
+            if (sect == INI_SECTION_VELOCITY || sect == INI_SECTION_BEND)
+            {
+               curve_map & target = sect == INI_SECTION_BEND ?
+                  m_bend_curves : m_velocity_curves ;
+
+               if (values.empty())
+                  continue;
+
+               curves stages(1, values);
+               if (target.insert(std::make_pair(channel, stages)).second)
+                  ++m_record_count;
+               else
+               {
+                  warnprintf
+                  (
+                     "! curve of section '%s' not inserted\n",
+                     section.name().c_str()
+                  );
+               }
+               continue;
+            }
+            result = active(gmvalue, devvalue);
+            if (result)
+            {
+               if (m_map_reversed)
+               {
+                  int temp = gmvalue;
+                  gmvalue = devvalue;
+                  devvalue = temp;
+                  std::string stemp = gmvaluename;
+                  gmvaluename = devvaluename;
+                  devvaluename = stemp;
+                  gmname = devvaluename;
+               }
+
+               std::string secname = "unknown";
+               annotation an(devvalue, gmvaluename, devvaluename, gmname);
+               midimap_pair p = std::make_pair(gmvalue, an);
+               midimap * target = &m_drum_map;
+               if (sect == INI_SECTION_DRUM)
+               {
+                  if (active(channel))
+                     target = &m_channel_drum_maps[channel];
+
+                  secname = DRUM_SECTION;
+               }
+               else if (sect == INI_SECTION_PATCH)
+               {
+                  target = &m_patch_map;
+                  if (active(channel))
+                     target = &m_channel_patch_maps[channel];
+
+                  secname = PATCH_SECTION;
+               }
+               else if (sect == INI_SECTION_CONTROL)
+               {
+                  target = &m_control_map;
+                  if (active(channel))
+                     target = &m_channel_control_maps[channel];
+
+                  secname = CONTROL_SECTION;
+               }
+               midimap_result resultpair = target->insert(p);
+               result = resultpair.second;
+               if (result)
+               {
+                  ++m_record_count;
+                  if (! values.empty())
                   {
-                     fprintf
+                     m_control_curves.insert
                      (
-                        stderr, "%s value pair (%d, %d) not inserted\n",
-                        secname.c_str(), gmvalue, devvalue
+                        std::make_pair
+                        (
+                           control_key(channel, gmvalue), curves(1, values)
+                        )
                      );
-                     result = true;    /* failure to insert is not fatal      */
                   }
                }
                else
                {
-                  errprint("missing value value");
-                  break;
+                  fprintf
+                  (
+                     stderr, "%s value pair (%d, %d) not inserted\n",
+                     secname.c_str(), gmvalue, devvalue
+                  );
+                  ++m_non_injective;
+                  result = true;    /* failure to insert is not fatal      */
                }
             }
-         }
-         if (result && m_map_reversed)
-         {
-            int temp = m_gm_channel;
-            m_gm_channel = m_device_channel;
-            m_device_channel = temp;
+            else
+            {
+               errprint("missing value value");
+               break;
+            }
          }
       }
-      delete itree;
-      if (midicvt_option_debug())
-         show_maps("read_maps()", *this);
-   }
-   if (m_setup_name == GM_INI_TESTING)
-   {
-      infoprint("testing, so ending before file processing");
-      result = false;
+      if (result && m_map_reversed)
+      {
+         int temp = m_gm_channel;
+         m_gm_channel = m_device_channel;
+         m_device_channel = temp;
+      }
    }
+   if (midicvt_option_debug())
+      show_maps("read_maps()", *this);
+
    return result;
 }
 
@@ -627,6 +1234,35 @@ midimapper::read_channel_section (const initree & it)
    return result;
 }
 
+/**
+ *    Finds the channel to which the forward mapping of the INI file sends
+ *    the events of a channel, using the same rules as build_tables().  It
+ *    is used by read_maps() while reading a reversed mapping, after the
+ *    channel section is read, but before the GM and device channels are
+ *    swapped.
+ *
+ * \param channel
+ *    Provides the channel, on the 0-15 scale.
+ *
+ * \return
+ *    Returns the channel that the forward mapping yields.
+ */
+
+int
+midimapper::forward_channel (int channel) const
+{
+   if (active(m_gm_channel, m_device_channel) && channel == m_device_channel)
+      return m_gm_channel;
+
+   std::map<int, int>::const_iterator ci = m_channel_map.begin();
+   for ( ; ci != m_channel_map.end(); ++ci)
+   {
+      if (ci->second == channel)       /* the channel map is reversed here   */
+         return ci->first;
+   }
+   return channel;
+}
+
 /**
  *    Changes a note value based on the note-mapping that was provided.
  *
@@ -635,13 +1271,17 @@ midimapper::read_channel_section (const initree & it)
  *    need to be checked in this function.
  *
  * \param channel
- *    Provides the channel for the input note.  Only if the channel
- *    matches the one channel to be remapped, will repitching occur.
+ *    Provides the channel for the input note.  Only if the channel is the
+ *    device channel, or has a drum map of its own, will repitching occur.
  *
  * \param input
  *    Provides the value of the input note, as obtained from the input
  *    MIDI file.
  *
+ * \param counts
+ *    Provides the conversion counts of the calling thread, which count
+ *    the lookup.
+ *
  * \return
  *    Returns the output note value corresponding to the input note value.
  *    If the input note is not found in the map, it is returned unaltered.
@@ -650,20 +1290,113 @@ midimapper::read_channel_section (const initree & it)
  */
 
 int
-midimapper::repitch (int channel, int input)
+midimapper::repitch (int channel, int input, midicounts & counts) const
 {
-   if (channel == m_device_channel)
+   if
+   (
+      channel >= 0 && channel < CHANNEL_COUNT &&
+      input >= 0 && input < VALUE_COUNT
+   )
    {
-      iterator ni = m_drum_map.find(input);
-      if (ni != m_drum_map.end())
-      {
-         input = ni->second.value();
-         ni->second.increment_count();
-      }
+      ++counts.m_notes[channel][input];
+      input = m_drum_table[channel][input];
    }
    return input;
 }
 
+/**
+ *    Remaps both the channel and the note of a note or key-pressure
+ *    event, giving the same results as rechannel() and repitch(), but
+ *    with a single lookup in m_note_table.
+ *
+ * \param channel [in/out]
+ *    Provides the channel of the event, and returns the new channel.
+ *
+ * \param note [in/out]
+ *    Provides the note of the event, and returns the new note.
+ *
+ * \param counts
+ *    Provides the conversion counts of the calling thread, which count
+ *    the lookup.
+ *
+ * \return
+ *    Returns false if the event is to be dropped by the channel filter.
+ */
+
+bool
+midimapper::remap_note (int & channel, int & note, midicounts & counts) const
+{
+   if
+   (
+      channel >= 0 && channel < CHANNEL_COUNT &&
+      note >= 0 && note < VALUE_COUNT
+   )
+   {
+      unsigned packed = m_note_table[channel][note];
+      ++counts.m_notes[channel][note];
+      channel = int((packed >> 8) & 0x0f);
+      note = int(packed & 0x7f);
+      return (packed & REMAP_DROP) == 0;
+   }
+   else
+   {
+      channel = rechannel(channel);     /* a bad value from a bad file  */
+      return active(channel);
+   }
+}
+
+/**
+ *    Remaps the channel, the note, and the velocity of a Note On event,
+ *    giving the same results as remap_velocity() and remap_note(), but
+ *    with a single lookup in m_note_table, whose entry also selects the
+ *    velocity table of the channel.
+ *
+ * \param channel [in/out]
+ *    Provides the channel of the event, and returns the new channel.
+ *
+ * \param note [in/out]
+ *    Provides the note of the event, and returns the new note.
+ *
+ * \param velocity [in/out]
+ *    Provides the velocity of the event, and returns the new velocity.
+ *
+ * \param counts
+ *    Provides the conversion counts of the calling thread, which count
+ *    the lookup.
+ *
+ * \return
+ *    Returns false if the event is to be dropped by the channel filter.
+ */
+
+bool
+midimapper::remap_note_on
+(
+   int & channel, int & note, int & velocity, midicounts & counts
+) const
+{
+   if
+   (
+      channel >= 0 && channel < CHANNEL_COUNT &&
+      note >= 0 && note < VALUE_COUNT
+   )
+   {
+      unsigned packed = m_note_table[channel][note];
+      ++counts.m_notes[channel][note];
+      if (velocity >= 0 && velocity < VALUE_COUNT)
+         velocity = m_value_tables[(packed >> 16) * VALUE_COUNT + velocity];
+
+      channel = int((packed >> 8) & 0x0f);
+      note = int(packed & 0x7f);
+      return (packed & REMAP_DROP) == 0;
+   }
+   else
+   {
+      velocity = remap_velocity(channel, velocity);
+      channel = rechannel(channel);     /* a bad value from a bad file  */
+      return active(channel);
+   }
+}
+
 /**
  *    Changes a channel value based on the channel-mapping that was
  *    provided.
@@ -701,71 +1434,1815 @@ midimapper::repitch (int channel, int input)
  *       -  NOT_ACTIVE (-1) is returned if the input channel does match
  *          m_filter_channel and m_rejection_on is true. In other words,
  *          one channel is systematically rejected from the output.
+ *
+ *    All of these results are worked out ahead of time by build_tables(),
+ *    so only a lookup in m_channel_table is needed here.
+ */
+
+int
+midimapper::rechannel (int channel) const
+{
+   if (channel >= 0 && channel < CHANNEL_COUNT)
+      return m_channel_table[channel];
+   else
+      return channel;
+}
+
+/**
+ *    Changes a program/patch value based on the patch-mapping that was
+ *    provided.
+ *
+ *    Since the reversal option for note values is set up during the
+ *    construction of the note map, the m_map_reversed flag does not
+ *    need to be checked in this function.
+ *
+ * \param channel
+ *    Provides the channel of the program change, which selects the patch
+ *    map of that channel, if it has one.
+ *
+ * \param program
+ *    Provides the value of the input patch, as obtained from the input
+ *    MIDI file.
+ *
+ * \param counts
+ *    Provides the conversion counts of the calling thread, which count
+ *    the lookup.
+ *
+ * \return
+ *    Returns the output patch value corresponding to the input patch value.
+ *    If the input patch is not found in the map, it is returned unaltered.
+ *    The map is empty if an empty INI file-name was passed to the
+ *    constructor.
+ */
+
+int
+midimapper::repatch (int channel, int program, midicounts & counts) const
+{
+   if
+   (
+      channel >= 0 && channel < CHANNEL_COUNT &&
+      program >= 0 && program < VALUE_COUNT
+   )
+   {
+      ++counts.m_patches[channel][program];
+      program = m_patch_table[channel][program];
+   }
+   return program;
+}
+
+/**
+ *    Remaps both the channel and the program of a program-change event,
+ *    giving the same results as rechannel() and repatch(), but with a
+ *    single lookup in m_program_table.
+ *
+ * \param channel [in/out]
+ *    Provides the channel of the event, and returns the new channel.
+ *
+ * \param program [in/out]
+ *    Provides the program of the event, and returns the new program.
+ *
+ * \param counts
+ *    Provides the conversion counts of the calling thread, which count
+ *    the lookup.
+ *
+ * \return
+ *    Returns false if the event is to be dropped by the channel filter.
+ */
+
+bool
+midimapper::remap_program
+(
+   int & channel, int & program, midicounts & counts
+) const
+{
+   if
+   (
+      channel >= 0 && channel < CHANNEL_COUNT &&
+      program >= 0 && program < VALUE_COUNT
+   )
+   {
+      unsigned packed = m_program_table[channel][program];
+      ++counts.m_patches[channel][program];
+      channel = int((packed >> 8) & 0x0f);
+      program = int(packed & 0x7f);
+      return (packed & REMAP_DROP) == 0;
+   }
+   else
+   {
+      channel = rechannel(channel);
+      return active(channel);
+   }
+}
+
+/**
+ *    Remaps the channel, the controller number, and the value of a
+ *    Control Change event, with a single lookup in m_control_table, and
+ *    one in the value table that the entry selects.
+ *
+ * \param channel [in/out]
+ *    Provides the channel of the event, and returns the new channel.
+ *
+ * \param control [in/out]
+ *    Provides the controller number of the event, and returns the new
+ *    controller number.
+ *
+ * \param value [in/out]
+ *    Provides the value of the controller, and returns the new value.
+ *
+ * \param counts
+ *    Provides the conversion counts of the calling thread, which count
+ *    the lookup.
+ *
+ * \return
+ *    Returns false if the event is to be dropped by the channel filter.
+ */
+
+bool
+midimapper::remap_control
+(
+   int & channel, int & control, int & value, midicounts & counts
+) const
+{
+   if
+   (
+      channel >= 0 && channel < CHANNEL_COUNT &&
+      control >= 0 && control < VALUE_COUNT &&
+      value >= 0 && value < VALUE_COUNT
+   )
+   {
+      uint32_t packed = m_control_table[channel][control];
+      ++counts.m_controls[channel][control];
+      channel = int((packed >> 8) & 0x0f);
+      control = int(packed & 0x7f);
+      value = m_value_tables[(packed >> 16) * VALUE_COUNT + value];
+      return (packed & REMAP_DROP) == 0;
+   }
+   else
+   {
+      channel = rechannel(channel);
+      return active(channel);
+   }
+}
+
+/**
+ *    Remaps the velocity of a Note On event through the velocity curve of
+ *    its channel.  A velocity of 0, which means Note Off, is never
+ *    changed, and no other velocity is changed to 0.
+ *
+ * \param channel
+ *    Provides the channel of the event, before it is remapped.
+ *
+ * \param velocity
+ *    Provides the velocity of the event.
+ *
+ * \return
+ *    Returns the new velocity.
+ */
+
+int
+midimapper::remap_velocity (int channel, int velocity) const
+{
+   if
+   (
+      channel >= 0 && channel < CHANNEL_COUNT &&
+      velocity >= 0 && velocity < VALUE_COUNT
+   )
+   {
+      velocity = m_velocity_table[channel][velocity];
+   }
+   return velocity;
+}
+
+/**
+ *    Remaps the channel and the 14-bit value of a Pitch Bend event.  The
+ *    value is run through the bend curves of the channel, which are
+ *    evaluated directly rather than looked up.
+ *
+ * \param channel [in/out]
+ *    Provides the channel of the event, and returns the new channel.
+ *
+ * \param value [in/out]
+ *    Provides the pitch-bend value, 0 to 16383, and returns the new value.
+ *
+ * \return
+ *    Returns false if the event is to be dropped by the channel filter.
+ */
+
+bool
+midimapper::remap_bend (int & channel, int & value) const
+{
+   if (channel >= 0 && channel < CHANNEL_COUNT)
+   {
+      const curves & c = m_bend_table[channel];
+      if (! c.empty() && value >= 0 && value <= BEND_MAXIMUM)
+         value = apply_curves(c, value);
+
+      channel = m_channel_table[channel];
+   }
+   return active(channel);
+}
+
+/**
+ *    Holds the tables that the vector versions of apply() remap through.
  */
 
-int
-midimapper::rechannel (int channel)
-{
-   if (m_extraction_on && channel != m_filter_channel)
+typedef struct
+{
+   const uint32_t * notes;             /**< m_note_table, 128 per channel  */
+   const uint32_t * controls;          /**< m_control_table                */
+   const uint16_t * programs;          /**< m_program_table                */
+   const uint8_t * values;             /**< m_value_tables                 */
+   const unsigned * route;             /**< new channel << 8, or dropped   */
+   unsigned drop;                      /**< midimapper::REMAP_DROP         */
+
+} midimap_tables;
+
+#if defined MIDIMAPPER_SIMD
+
+/**
+ *    Remaps events eight at a time with AVX2, for apply().  Each kind of
+ *    table entry is fetched with a masked gather, so that no event needs a
+ *    branch on its kind, as the switch of apply_scalar() does.  The
+ *    program table holds 16-bit entries, so the aligned 32-bit word that
+ *    holds the entry is gathered and shifted, and the value tables are
+ *    read the same way, a byte at a time.
+ *
+ *    Neither the lookups nor the pitch-bend curves are handled here; see
+ *    apply().
+ *
+ * \param t
+ *    Provides the tables.
+ *
+ * \param events
+ *    Provides the status and data columns, which are updated in place.
+ *
+ * \param count
+ *    Provides the number of events to remap, a multiple of 8.
+ *
+ * \param keep
+ *    Provides the keep mask, as for apply().
+ *
+ * \return
+ *    Returns the number of the events that are kept.
+ */
+
+__attribute__((target("avx2")))
+static size_t
+remap_avx2
+(
+   const midimap_tables & t, const midievents & events,
+   size_t count, uint8_t * keep
+)
+{
+   const __m256i low7 = _mm256_set1_epi32(0x7f);
+   const __m256i low4 = _mm256_set1_epi32(0x0f);
+   const __m256i low2 = _mm256_set1_epi32(0x03);
+   const __m256i high = _mm256_set1_epi32(0xf0);
+   const __m256i drop = _mm256_set1_epi32(int(t.drop));
+   const __m256i one = _mm256_set1_epi32(1);
+   const __m256i bytes = _mm256_setr_epi8
+   (
+      0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+   );
+   const int * notes = (const int *) t.notes;
+   const int * controls = (const int *) t.controls;
+   const int * programs = (const int *) t.programs;
+   const int * values = (const int *) t.values;
+   const int * route = (const int *) t.route;
+   __m256i keptv = _mm256_setzero_si256();
+   for (size_t i = 0; i < count; i += 8)
+   {
+      __m256i s = _mm256_cvtepu8_epi32
+      (
+         _mm_loadl_epi64((const __m128i *) &events.status[i])
+      );
+      __m256i d1 = _mm256_cvtepu8_epi32
+      (
+         _mm_loadl_epi64((const __m128i *) &events.data1[i])
+      );
+      __m256i d2 = _mm256_cvtepu8_epi32
+      (
+         _mm_loadl_epi64((const __m128i *) &events.data2[i])
+      );
+      __m256i type = _mm256_srli_epi32(s, 4);
+      __m256i c = _mm256_and_si256(s, low4);
+      __m256i index = _mm256_or_si256
+      (
+         _mm256_slli_epi32(c, 7), _mm256_and_si256(d1, low7)
+      );
+      __m256i isnoteon = _mm256_cmpeq_epi32(type, _mm256_set1_epi32(0x9));
+      __m256i isnote = _mm256_or_si256
+      (
+         _mm256_or_si256
+         (
+            _mm256_cmpeq_epi32(type, _mm256_set1_epi32(0x8)), isnoteon
+         ),
+         _mm256_cmpeq_epi32(type, _mm256_set1_epi32(0xa))
+      );
+      __m256i iscontrol = _mm256_cmpeq_epi32(type, _mm256_set1_epi32(0xb));
+      __m256i isprogram = _mm256_cmpeq_epi32(type, _mm256_set1_epi32(0xc));
+      __m256i isroute = _mm256_or_si256
+      (
+         _mm256_cmpeq_epi32(type, _mm256_set1_epi32(0xd)),
+         _mm256_cmpeq_epi32(type, _mm256_set1_epi32(0xe))
+      );
+      __m256i islookup = _mm256_or_si256
+      (
+         _mm256_or_si256(isnote, iscontrol), isprogram
+      );
+      __m256i isvalue = _mm256_or_si256(isnoteon, iscontrol);
+
+      __m256i packed = _mm256_slli_epi32(c, 8);
+      packed = _mm256_mask_i32gather_epi32(packed, notes, index, isnote, 4);
+      packed = _mm256_mask_i32gather_epi32
+      (
+         packed, controls, index, iscontrol, 4
+      );
+      __m256i program = _mm256_mask_i32gather_epi32
+      (
+         _mm256_setzero_si256(), programs,
+         _mm256_andnot_si256(low2, _mm256_add_epi32(index, index)),
+         isprogram, 1
+      );
+      program = _mm256_srlv_epi32
+      (
+         program, _mm256_slli_epi32(_mm256_and_si256(index, one), 4)
+      );
+      packed = _mm256_blendv_epi8
+      (
+         packed, _mm256_and_si256(program, _mm256_set1_epi32(0xffff)),
+         isprogram
+      );
+      packed = _mm256_mask_i32gather_epi32(packed, route, c, isroute, 4);
+
+      __m256i vindex = _mm256_or_si256
+      (
+         _mm256_slli_epi32(_mm256_srli_epi32(packed, 16), 7),
+         _mm256_and_si256(d2, low7)
+      );
+      __m256i value = _mm256_mask_i32gather_epi32
+      (
+         _mm256_setzero_si256(), values,
+         _mm256_andnot_si256(low2, vindex), isvalue, 1
+      );
+      value = _mm256_and_si256
+      (
+         _mm256_srlv_epi32
+         (
+            value, _mm256_slli_epi32(_mm256_and_si256(vindex, low2), 3)
+         ),
+         _mm256_set1_epi32(0xff)
+      );
+
+      d1 = _mm256_blendv_epi8(d1, _mm256_and_si256(packed, low7), islookup);
+      d2 = _mm256_blendv_epi8(d2, value, isvalue);
+      s = _mm256_or_si256
+      (
+         _mm256_and_si256(s, high),
+         _mm256_and_si256(_mm256_srli_epi32(packed, 8), low4)
+      );
+      __m256i keepv = _mm256_xor_si256
+      (
+         _mm256_srli_epi32(_mm256_and_si256(packed, drop), 15), one
+      );
+      keptv = _mm256_add_epi32(keptv, keepv);
+
+      __m256i * outputs [4] = { &s, &d1, &d2, &keepv };
+      uint8_t * columns [4] =
+      {
+         &events.status[i], &events.data1[i], &events.data2[i], &keep[i]
+      };
+      for (int k = 0; k < 4; ++k)
+      {
+         __m256i packed8 = _mm256_shuffle_epi8(*outputs[k], bytes);
+         __m128i lanes = _mm_unpacklo_epi32
+         (
+            _mm256_castsi256_si128(packed8),
+            _mm256_extracti128_si256(packed8, 1)
+         );
+         _mm_storel_epi64((__m128i *) columns[k], lanes);
+      }
+   }
+
+   uint32_t sums [8];
+   _mm256_storeu_si256((__m256i *) sums, keptv);
+   size_t kept = 0;
+   for (int k = 0; k < 8; ++k)
+      kept += sums[k];
+
+   return kept;
+}
+
+/**
+ *    Remaps events four at a time with SSE2, for apply().  SSE2 has no
+ *    gather, so the table entries of each event are loaded one by one,
+ *    but every entry that any kind of event could need is loaded, and the
+ *    right one is then selected with masks, as remap_avx2() does.
+ *
+ * \param t
+ *    Provides the tables.
+ *
+ * \param events
+ *    Provides the status and data columns, which are updated in place.
+ *
+ * \param count
+ *    Provides the number of events to remap, a multiple of 4.
+ *
+ * \param keep
+ *    Provides the keep mask, as for apply().
+ *
+ * \return
+ *    Returns the number of the events that are kept.
+ */
+
+static size_t
+remap_sse2
+(
+   const midimap_tables & t, const midievents & events,
+   size_t count, uint8_t * keep
+)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i low7 = _mm_set1_epi32(0x7f);
+   const __m128i low4 = _mm_set1_epi32(0x0f);
+   const __m128i drop = _mm_set1_epi32(int(t.drop));
+   const __m128i one = _mm_set1_epi32(1);
+   __m128i keptv = zero;
+   for (size_t i = 0; i < count; i += 4)
+   {
+      uint32_t note [4];
+      uint32_t control [4];
+      uint32_t program [4];
+      uint32_t channel [4];
+      for (int k = 0; k < 4; ++k)
+      {
+         unsigned c = events.status[i + k] & 0x0f;
+         unsigned index = c << 7 | (events.data1[i + k] & 0x7f);
+         note[k] = t.notes[index];
+         control[k] = t.controls[index];
+         program[k] = t.programs[index];
+         channel[k] = t.route[c];
+      }
+
+      uint32_t word;
+      memcpy(&word, &events.status[i], 4);
+      __m128i s = _mm_unpacklo_epi16
+      (
+         _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(word)), zero), zero
+      );
+      memcpy(&word, &events.data1[i], 4);
+      __m128i d1 = _mm_unpacklo_epi16
+      (
+         _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(word)), zero), zero
+      );
+      memcpy(&word, &events.data2[i], 4);
+      __m128i d2 = _mm_unpacklo_epi16
+      (
+         _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(word)), zero), zero
+      );
+
+      __m128i type = _mm_srli_epi32(s, 4);
+      __m128i isnoteon = _mm_cmpeq_epi32(type, _mm_set1_epi32(0x9));
+      __m128i isnote = _mm_or_si128
+      (
+         _mm_or_si128(_mm_cmpeq_epi32(type, _mm_set1_epi32(0x8)), isnoteon),
+         _mm_cmpeq_epi32(type, _mm_set1_epi32(0xa))
+      );
+      __m128i iscontrol = _mm_cmpeq_epi32(type, _mm_set1_epi32(0xb));
+      __m128i isprogram = _mm_cmpeq_epi32(type, _mm_set1_epi32(0xc));
+      __m128i isroute = _mm_or_si128
+      (
+         _mm_cmpeq_epi32(type, _mm_set1_epi32(0xd)),
+         _mm_cmpeq_epi32(type, _mm_set1_epi32(0xe))
+      );
+      __m128i islookup = _mm_or_si128
+      (
+         _mm_or_si128(isnote, iscontrol), isprogram
+      );
+      __m128i isvalue = _mm_or_si128(isnoteon, iscontrol);
+
+      __m128i packed = _mm_or_si128
+      (
+         _mm_andnot_si128
+         (
+            _mm_or_si128(islookup, isroute),
+            _mm_slli_epi32(_mm_and_si128(s, low4), 8)
+         ),
+         _mm_or_si128
+         (
+            _mm_or_si128
+            (
+               _mm_and_si128(isnote, _mm_loadu_si128((__m128i *) note)),
+               _mm_and_si128(iscontrol, _mm_loadu_si128((__m128i *) control))
+            ),
+            _mm_or_si128
+            (
+               _mm_and_si128(isprogram, _mm_loadu_si128((__m128i *) program)),
+               _mm_and_si128(isroute, _mm_loadu_si128((__m128i *) channel))
+            )
+         )
+      );
+
+      uint32_t entry [4];
+      uint32_t value [4];
+      _mm_storeu_si128((__m128i *) entry, packed);
+      for (int k = 0; k < 4; ++k)
+      {
+         unsigned d = events.data2[i + k] & 0x7f;
+         value[k] = t.values[(entry[k] >> 16) * midimapper::VALUE_COUNT + d];
+      }
+
+      d1 = _mm_or_si128
+      (
+         _mm_andnot_si128(islookup, d1),
+         _mm_and_si128(islookup, _mm_and_si128(packed, low7))
+      );
+      d2 = _mm_or_si128
+      (
+         _mm_andnot_si128(isvalue, d2),
+         _mm_and_si128(isvalue, _mm_loadu_si128((__m128i *) value))
+      );
+      s = _mm_or_si128
+      (
+         _mm_and_si128(s, _mm_set1_epi32(0xf0)),
+         _mm_and_si128(_mm_srli_epi32(packed, 8), low4)
+      );
+      __m128i keepv = _mm_xor_si128
+      (
+         _mm_srli_epi32(_mm_and_si128(packed, drop), 15), one
+      );
+      keptv = _mm_add_epi32(keptv, keepv);
+
+      __m128i * outputs [4] = { &s, &d1, &d2, &keepv };
+      uint8_t * columns [4] =
+      {
+         &events.status[i], &events.data1[i], &events.data2[i], &keep[i]
+      };
+      for (int k = 0; k < 4; ++k)
+      {
+         __m128i packed16 = _mm_packs_epi32(*outputs[k], zero);
+         word = uint32_t(_mm_cvtsi128_si32(_mm_packus_epi16(packed16, zero)));
+         memcpy(columns[k], &word, 4);
+      }
+   }
+
+   uint32_t sums [4];
+   _mm_storeu_si128((__m128i *) sums, keptv);
+   return size_t(sums[0]) + sums[1] + sums[2] + sums[3];
+}
+
+/**
+ *    Determines if the processor can run remap_avx2().  The answer is
+ *    looked up only once.
+ *
+ * \return
+ *    Returns true if the processor has AVX2.
+ */
+
+static bool
+cpu_has_avx2 ()
+{
+   static const bool s_avx2 = __builtin_cpu_supports("avx2") != 0;
+   return s_avx2;
+}
+
+#endif   // MIDIMAPPER_SIMD
+
+/**
+ *    Remaps an array of decoded events in one pass, giving the same
+ *    results as the remap functions above, event by event.  Notes, key
+ *    pressure, programs, controllers, velocities, and pitch bends are
+ *    remapped through the same tables, and channel pressure is
+ *    rechanneled.  Other events are left alone.
+ *
+ *    Nothing is removed from the columns.  Instead, an event that the
+ *    channel filter of --extract or --reject drops gets a 0 in the keep
+ *    mask, taken straight from the REMAP_DROP bit of its table entry, so
+ *    that the caller can compact the events in one more pass.
+ *
+ *    On x86 processors, the events are remapped in blocks by
+ *    remap_avx2(), with gathers from the tables, if the processor has
+ *    AVX2, or else by remap_sse2(), which every x86-64 processor can run.
+ *    The lookups of those blocks are counted, and their pitch bends
+ *    curved, beforehand.  The events left over at the end, and every
+ *    event on other processors, are remapped by apply_scalar().  All of
+ *    them give the same results.
+ *
+ * \param events
+ *    Provides the status and data columns, which are updated in place.
+ *
+ * \param count
+ *    Provides the number of events in each column.
+ *
+ * \param keep
+ *    Provides an array of \a count bytes, which returns 1 for each event
+ *    to be kept, and 0 for each event to be dropped.
+ *
+ * \param counts
+ *    Provides the conversion counts of the calling thread, which count
+ *    the lookups.
+ *
+ * \return
+ *    Returns the number of events to be kept.
+ */
+
+size_t
+midimapper::apply
+(
+   const midievents & events, size_t count,
+   uint8_t * keep, midicounts & counts
+) const
+{
+   unsigned route [CHANNEL_COUNT];     /* new channel, or REMAP_DROP        */
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      route[c] = m_channel_table[c] == NOT_ACTIVE ?
+         REMAP_DROP : unsigned(m_channel_table[c]) << 8 ;
+   }
+
+   size_t kept = 0;
+   size_t done = 0;
+#if defined MIDIMAPPER_SIMD
+   bool avx2 = cpu_has_avx2();
+   done = avx2 ? count & ~size_t(7) : count & ~size_t(3) ;
+   if (done > 0)
+   {
+      midimap_tables t;
+      t.notes = &m_note_table[0][0];
+      t.controls = &m_control_table[0][0];
+      t.programs = &m_program_table[0][0];
+      t.values = &m_value_tables[0];
+      t.route = route;
+      t.drop = REMAP_DROP;
+      count_lookups(events, done, counts);
+      apply_bends(events, done);
+      kept = avx2 ?
+         remap_avx2(t, events, done, keep) :
+         remap_sse2(t, events, done, keep) ;
+   }
+#endif
+   return kept + apply_scalar(events, done, count, keep, counts, route);
+}
+
+/**
+ *    Remaps events one at a time, for apply().
+ *
+ * \param events
+ *    Provides the status and data columns, which are updated in place.
+ *
+ * \param first
+ *    Provides the index of the first event to remap.
+ *
+ * \param count
+ *    Provides the number of events in each column.
+ *
+ * \param keep
+ *    Provides the keep mask, as for apply().
+ *
+ * \param counts
+ *    Provides the conversion counts of the calling thread.
+ *
+ * \param route
+ *    Provides, for each channel, the new channel shifted left 8 bits, or
+ *    REMAP_DROP.
+ *
+ * \return
+ *    Returns the number of the events from \a first on that are kept.
+ */
+
+size_t
+midimapper::apply_scalar
+(
+   const midievents & events, size_t first, size_t count,
+   uint8_t * keep, midicounts & counts, const unsigned * route
+) const
+{
+   size_t kept = 0;
+   for (size_t i = first; i < count; ++i)
+   {
+      unsigned status = events.status[i];
+      unsigned c = status & 0x0f;
+      unsigned d1 = events.data1[i];
+      unsigned d2 = events.data2[i];
+      unsigned packed = c << 8;        /* not a channel event: no change    */
+      switch (status & 0xf0)
+      {
+      case 0x90:                       /* Note On                           */
+
+         d1 &= 0x7f;
+         packed = m_note_table[c][d1];
+         ++counts.m_notes[c][d1];
+         d1 = packed & 0x7f;
+         d2 = m_value_tables[(packed >> 16) * VALUE_COUNT + (d2 & 0x7f)];
+         break;
+
+      case 0x80:                       /* Note Off                          */
+      case 0xa0:                       /* Key Pressure                      */
+
+         d1 &= 0x7f;
+         packed = m_note_table[c][d1];
+         ++counts.m_notes[c][d1];
+         d1 = packed & 0x7f;
+         break;
+
+      case 0xb0:                       /* Control Change                    */
+
+         d1 &= 0x7f;
+         packed = m_control_table[c][d1];
+         ++counts.m_controls[c][d1];
+         d1 = packed & 0x7f;
+         d2 = m_value_tables[(packed >> 16) * VALUE_COUNT + (d2 & 0x7f)];
+         break;
+
+      case 0xc0:                       /* Program Change                    */
+
+         d1 &= 0x7f;
+         packed = m_program_table[c][d1];
+         ++counts.m_patches[c][d1];
+         d1 = packed & 0x7f;
+         break;
+
+      case 0xd0:                       /* Channel Pressure                  */
+
+         packed = route[c];
+         break;
+
+      case 0xe0:                       /* Pitch Bend, LSB in data byte 1    */
+
+         packed = route[c];
+         if (! m_bend_table[c].empty())
+         {
+            int value = int((d2 & 0x7f) << 7 | (d1 & 0x7f));
+            value = apply_curves(m_bend_table[c], value);
+            d1 = unsigned(value) & 0x7f;
+            d2 = (unsigned(value) >> 7) & 0x7f;
+         }
+         break;
+      }
+      events.status[i] = uint8_t((status & 0xf0) | ((packed >> 8) & 0x0f));
+      events.data1[i] = uint8_t(d1);
+      events.data2[i] = uint8_t(d2);
+      keep[i] = uint8_t(((packed & REMAP_DROP) >> 15) ^ 1);
+      kept += keep[i];
+   }
+   return kept;
+}
+
+/**
+ *    Counts the lookups of the events that apply() hands to the vector
+ *    functions.  To avoid a branch per event, each kind of event selects
+ *    its histogram from a small table, and the events that are not
+ *    counted all add to one spare counter.
+ *
+ * \param events
+ *    Provides the status and data columns.
+ *
+ * \param count
+ *    Provides the number of events to count.
+ *
+ * \param counts
+ *    Provides the conversion counts of the calling thread.
+ */
+
+void
+midimapper::count_lookups
+(
+   const midievents & events, size_t count, midicounts & counts
+)
+{
+   static const unsigned s_index_mask [16] =
+   {
+      0, 0, 0, 0, 0, 0, 0, 0, 0x7ff, 0x7ff, 0x7ff, 0x7ff, 0x7ff, 0, 0, 0
+   };
+   int spare = 0;
+   int * histograms [16] =
+   {
+      &spare, &spare, &spare, &spare, &spare, &spare, &spare, &spare,
+      &counts.m_notes[0][0], &counts.m_notes[0][0], &counts.m_notes[0][0],
+      &counts.m_controls[0][0], &counts.m_patches[0][0],
+      &spare, &spare, &spare
+   };
+   for (size_t i = 0; i < count; ++i)
+   {
+      unsigned status = events.status[i];
+      unsigned index = (status & 0x0f) << 7 | (events.data1[i] & 0x7f);
+      ++histograms[status >> 4][index & s_index_mask[status >> 4]];
+   }
+}
+
+/**
+ *    Remaps the pitch bends that have a bend curve, for the events that
+ *    apply() hands to the vector functions.  It is called before they
+ *    run, as they leave the data bytes of pitch bends alone.
+ *
+ * \param events
+ *    Provides the status and data columns.
+ *
+ * \param count
+ *    Provides the number of events to look at.
+ */
+
+void
+midimapper::apply_bends (const midievents & events, size_t count) const
+{
+   unsigned curved = 0;                /* a bit per channel with a curve    */
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      if (! m_bend_table[c].empty())
+         curved |= 1U << c;
+   }
+   if (curved == 0)
+      return;
+
+   for (size_t i = 0; i < count; ++i)
+   {
+      unsigned status = events.status[i];
+      unsigned c = status & 0x0f;
+      if ((status & 0xf0) == 0xe0 && ((curved >> c) & 1) != 0)
+      {
+         int value = int
+         (
+            (events.data2[i] & 0x7f) << 7 | (events.data1[i] & 0x7f)
+         );
+         value = apply_curves(m_bend_table[c], value);
+         events.data1[i] = uint8_t(unsigned(value) & 0x7f);
+         events.data2[i] = uint8_t((unsigned(value) >> 7) & 0x7f);
+      }
+   }
+}
+
+/**
+ *    Adds the conversion counts of a worker thread to those of this
+ *    midimapper.  Each worker thread of midipp::midibatch remaps with this
+ *    midimapper, which it only reads, and counts into a midicounts of its
+ *    own, which is added back here for the --summarize output.
+ *
+ * \param counts
+ *    Provides the counts of a thread that has done some remapping.
+ */
+
+void
+midimapper::add_counts (const midicounts & counts)
+{
+   m_counts.add(counts);
+}
+
+/**
+ *    Counts the times that the given patch was remapped by m_patch_map,
+ *    that is, on every channel that does not have its own mapping for the
+ *    patch.
+ *
+ * \param patch
+ *    Provides the patch (program) number, 0 to 127.
+ *
+ * \return
+ *    Returns the number of lookups of the patch.
+ */
+
+int
+midimapper::patch_count (int patch) const
+{
+   int result = 0;
+   for (int channel = 0; channel < CHANNEL_COUNT; ++channel)
+   {
+      if (! scoped(m_channel_patch_maps, channel, patch))
+         result += patch_count(channel, patch);
+   }
+   return result;
+}
+
+/**
+ *    Counts the times that the given controller was remapped by
+ *    m_control_map, in the same way as patch_count().
+ *
+ * \param control
+ *    Provides the controller number, 0 to 127.
+ *
+ * \return
+ *    Returns the number of lookups of the controller.
+ */
+
+int
+midimapper::control_count (int control) const
+{
+   int result = 0;
+   for (int channel = 0; channel < CHANNEL_COUNT; ++channel)
+   {
+      if (! scoped(m_channel_control_maps, channel, control))
+         result += control_count(channel, control);
+   }
+   return result;
+}
+
+/**
+ *    Shows the value curves of a controller entry, for show_maps().
+ *
+ * \param channel
+ *    Provides the channel of the entry, 0 to 15, or NOT_ACTIVE for an
+ *    entry of m_control_map.
+ *
+ * \param control
+ *    Provides the incoming controller number.
+ *
+ * \return
+ *    Returns the curves as text, or an empty string if the entry has none.
+ */
+
+std::string
+midimapper::control_values (int channel, int control) const
+{
+   int key = control_key(channel, control);
+   const curves * c = find_curves(m_control_curves, key);
+   return not_nullptr(c) ? curves_text(*c) : std::string() ;
+}
+
+/**
+ *    Looks up a key in a drum or patch map.
+ *
+ * \param m
+ *    Provides the map to be searched.
+ *
+ * \param key
+ *    Provides the note or patch to look up.
+ *
+ * \return
+ *    Returns a pointer to the annotation of the key, or a null pointer if
+ *    the map does not have the key.
+ */
+
+const annotation *
+midimapper::lookup (const midimap & m, int key)
+{
+   const_iterator mi = m.find(key);
+   return mi != m.end() ? &mi->second : nullptr ;
+}
+
+/**
+ *    Looks up a key in the drum or patch map of a single channel.
+ *
+ * \param m
+ *    Provides the maps of the single channels.
+ *
+ * \param channel
+ *    Provides the channel, 0 to 15.
+ *
+ * \param key
+ *    Provides the note or patch to look up.
+ *
+ * \return
+ *    Returns a pointer to the annotation of the key, or a null pointer if
+ *    the channel has no map, or its map does not have the key.
+ */
+
+const annotation *
+midimapper::lookup (const channel_midimaps & m, int channel, int key)
+{
+   channel_midimaps::const_iterator cmi = m.find(channel);
+   return cmi != m.end() ? lookup(cmi->second, key) : nullptr ;
+}
+
+/**
+ *    Determines if a channel has its own mapping for a note or patch.
+ *
+ * \param m
+ *    Provides the maps of the single channels.
+ *
+ * \param channel
+ *    Provides the channel, 0 to 15.
+ *
+ * \param key
+ *    Provides the note or patch to look up.
+ *
+ * \return
+ *    Returns true if the map of the channel has the key.
+ */
+
+bool
+midimapper::scoped (const channel_midimaps & m, int channel, int key)
+{
+   return not_nullptr(lookup(m, channel, key));
+}
+
+/**
+ *    Finds the drum-map entry that remaps a note on a channel, either from
+ *    the map of that channel or, on the device channel, from m_drum_map.
+ *
+ * \param channel
+ *    Provides the channel of the note, 0 to 15.
+ *
+ * \param note
+ *    Provides the note to look up.
+ *
+ * \return
+ *    Returns a pointer to the annotation, or a null pointer if the note is
+ *    not remapped on that channel.
+ */
+
+const annotation *
+midimapper::drum_annotation (int channel, int note) const
+{
+   const annotation * result = lookup(m_channel_drum_maps, channel, note);
+   if (is_nullptr(result) && channel == m_device_channel)
+      result = lookup(m_drum_map, note);
+
+   return result;
+}
+
+/**
+ *    Finds the value curves of a controller on a channel.  If the channel
+ *    has its own entry for the controller, only the curves of that entry
+ *    are used.
+ *
+ * \param channel
+ *    Provides the channel of the event, 0 to 15.
+ *
+ * \param control
+ *    Provides the incoming controller number.
+ *
+ * \return
+ *    Returns a pointer to the curves, or a null pointer if the values of
+ *    the controller are not remapped on that channel.
+ */
+
+const midimapper::curves *
+midimapper::find_control_curves (int channel, int control) const
+{
+   int key = scoped(m_channel_control_maps, channel, control) ?
+      control_key(channel, control) : control_key(NOT_ACTIVE, control) ;
+
+   curve_map::const_iterator ci = m_control_curves.find(key);
+   return ci != m_control_curves.end() ? &ci->second : nullptr ;
+}
+
+/**
+ *    Finds the velocity or bend curves of a channel, which are the curves
+ *    of the channel if it has its own, or else the curves of all channels.
+ *
+ * \param m
+ *    Provides the velocity or bend curves.
+ *
+ * \param channel
+ *    Provides the channel, 0 to 15.
+ *
+ * \return
+ *    Returns a pointer to the curves, or a null pointer if there are none.
+ */
+
+const midimapper::curves *
+midimapper::find_curves (const curve_map & m, int channel)
+{
+   curve_map::const_iterator ci = m.find(channel);
+   if (ci == m.end())
+      ci = m.find(int(NOT_ACTIVE));
+
+   return ci != m.end() ? &ci->second : nullptr ;
+}
+
+/**
+ *    Compiles controller curves into a value table, and finds it in
+ *    m_value_tables, adding it if it is not already there.
+ *
+ * \param c
+ *    Provides the curves.  An empty list makes the identity table.
+ *
+ * \return
+ *    Returns the index of the value table.
+ */
+
+int
+midimapper::value_table (const curves & c)
+{
+   uint8_t table [VALUE_COUNT];
+   for (int v = 0; v < VALUE_COUNT; ++v)
+      table[v] = uint8_t(apply_curves(c, v));
+
+   return value_table(table);
+}
+
+/**
+ *    Finds a value table in m_value_tables, adding it if it is not already
+ *    there.
+ *
+ * \param table
+ *    Provides the VALUE_COUNT values of the table.
+ *
+ * \return
+ *    Returns the index of the value table.
+ */
+
+int
+midimapper::value_table (const uint8_t * table)
+{
+   int count = int(m_value_tables.size()) / VALUE_COUNT;
+   for (int t = 0; t < count; ++t)
+   {
+      const uint8_t * existing = &m_value_tables[t * VALUE_COUNT];
+      if (std::equal(table, table + VALUE_COUNT, existing))
+         return t;
+   }
+   m_value_tables.insert(m_value_tables.end(), table, table + VALUE_COUNT);
+   return count;
+}
+
+/**
+ *    Reads a curve from an INI value, a list of "in:out" points separated
+ *    by spaces or commas, such as "0:0 64:90 127:127".  If the first or
+ *    last value of the range is missing, a point that maps it to itself is
+ *    added.
+ *
+ * \param text
+ *    Provides the value from the INI file.
+ *
+ * \param maximum
+ *    Provides the largest value allowed, 127 or BEND_MAXIMUM.
+ *
+ * \param c [out]
+ *    Returns the points, sorted by their input values.
+ *
+ * \return
+ *    Returns false if there are no points, a point is out of range or
+ *    badly formed, or two points have the same input value.
+ */
+
+bool
+midimapper::parse_curve (const std::string & text, int maximum, curve & c)
+{
+   bool result = true;
+   const char * p = text.c_str();
+   c.clear();
+   for (;;)
+   {
+      while (*p == ' ' || *p == '\t' || *p == ',')
+         ++p;
+
+      if (*p == 0)
+         break;
+
+      char * end;
+      long x = strtol(p, &end, 10);
+      long y = 0;
+      result = end != p && *end == ':';
+      if (result)
+      {
+         p = end + 1;
+         y = strtol(p, &end, 10);
+         result =
+            end != p && x >= 0 && x <= maximum && y >= 0 && y <= maximum;
+         p = end;
+      }
+      if (! result)
+         break;
+
+      c.push_back(std::make_pair(int(x), int(y)));
+   }
+   if (result)
+      result = ! c.empty();
+
+   if (result)
+   {
+      std::sort(c.begin(), c.end());
+      for (size_t i = 1; i < c.size(); ++i)
+      {
+         if (c[i].first == c[i - 1].first)
+         {
+            result = false;
+            break;
+         }
+      }
+   }
+   if (result)
+   {
+      if (c.front().first > 0)
+         c.insert(c.begin(), std::make_pair(0, 0));
+
+      if (c.back().first < maximum)
+         c.push_back(std::make_pair(maximum, maximum));
+   }
+   return result;
+}
+
+/**
+ *    Inverts a curve read by parse_curve(), for a reversed map.  Only a
+ *    curve whose outputs rise from each point to the next can be
+ *    inverted.  Inputs below the lowest output map to 0, and those above
+ *    the highest output map to the largest value.
+ *
+ * \param c [in/out]
+ *    Provides the curve, and returns the inverted curve.
+ *
+ * \return
+ *    Returns false, leaving the curve alone, if it cannot be inverted.
+ */
+
+bool
+midimapper::reverse_curve (curve & c)
+{
+   for (size_t i = 1; i < c.size(); ++i)
+   {
+      if (c[i].second <= c[i - 1].second)
+         return false;
+   }
+
+   int maximum = c.back().first;
+   for (size_t i = 0; i < c.size(); ++i)
+      std::swap(c[i].first, c[i].second);
+
+   if (c.front().first > 0)
+      c.insert(c.begin(), std::make_pair(0, 0));
+
+   if (c.back().first < maximum)
+      c.push_back(std::make_pair(maximum, maximum));
+
+   return true;
+}
+
+/**
+ *    Evaluates a curve, drawing a straight line between the points on each
+ *    side of the input value, and rounding to the nearest integer.
+ *
+ * \param c
+ *    Provides the curve.
+ *
+ * \param x
+ *    Provides the input value.
+ *
+ * \return
+ *    Returns the output value.
+ */
+
+int
+midimapper::curve_value (const curve & c, int x)
+{
+   curve::const_iterator hi = c.begin();
+   while (hi != c.end() && hi->first < x)
+      ++hi;
+
+   if (hi == c.end())
+      return c.back().second;
+   else if (hi->first == x || hi == c.begin())
+      return hi->second;
+
+   curve::const_iterator lo = hi - 1;
+   long dx = hi->first - lo->first;
+   long offset = long(x - lo->first) * (hi->second - lo->second);
+   long rounding = offset < 0 ? -dx : dx ;
+   return lo->second + int((2 * offset + rounding) / (2 * dx));
+}
+
+/**
+ *    Runs a value through a list of curves, one after the other.
+ *
+ * \param c
+ *    Provides the curves.
+ *
+ * \param x
+ *    Provides the input value.
+ *
+ * \return
+ *    Returns the output value of the last curve.
+ */
+
+int
+midimapper::apply_curves (const curves & c, int x)
+{
+   for (curves::const_iterator ci = c.begin(); ci != c.end(); ++ci)
+      x = curve_value(*ci, x);
+
+   return x;
+}
+
+/**
+ *    Adds curves to the end of a list of curves, as chain() does.
+ *
+ * \param c [in/out]
+ *    Provides the list of curves to be added to.
+ *
+ * \param more
+ *    Provides the curves to add, or a null pointer if there are none.
+ */
+
+void
+midimapper::append_curves (curves & c, const curves * more)
+{
+   if (not_nullptr(more))
+      c.insert(c.end(), more->begin(), more->end());
+}
+
+/**
+ *    Shows a list of curves as text, each as the "in:out" points it was
+ *    read from, with the points added by parse_curve(), and with the
+ *    curves joined by " then ".
+ *
+ * \param c
+ *    Provides the curves.
+ *
+ * \return
+ *    Returns the text.
+ */
+
+std::string
+midimapper::curves_text (const curves & c)
+{
+   std::string result;
+   for (curves::const_iterator ci = c.begin(); ci != c.end(); ++ci)
+   {
+      if (ci != c.begin())
+         result += " then ";
+
+      for (curve::const_iterator pi = ci->begin(); pi != ci->end(); ++pi)
+      {
+         char point[32];
+         (void) snprintf
+         (
+            point, sizeof point, "%s%d:%d",
+            pi == ci->begin() ? "" : " ", pi->first, pi->second
+         );
+         result += point;
+      }
+   }
+   return result;
+}
+
+/**
+ *    Gets the value of a map entry, as build_table() uses it.
+ *
+ * \param an
+ *    Provides the map entry, or a null pointer if the key has none.
+ *
+ * \param key
+ *    Provides the key of the entry.
+ *
+ * \return
+ *    Returns the value of the entry, or the key if the entry is missing or
+ *    its value is out of range.
+ */
+
+int
+midimapper::mapped (const annotation * an, int key)
+{
+   bool ok =
+      not_nullptr(an) && key >= 0 && key < VALUE_COUNT &&
+      an->value() >= 0 && an->value() < VALUE_COUNT;
+
+   return ok ? an->value() : key ;
+}
+
+/**
+ *    Makes the annotation of a chained mapping.  The key name comes from
+ *    the first map that remaps the key, and the value names come from the
+ *    last one.
+ *
+ * \param value
+ *    Provides the value that the chain of maps yields for the key.
+ *
+ * \param first
+ *    Provides the annotation of the key in the first map, or a null
+ *    pointer if the first map does not remap it.
+ *
+ * \param second
+ *    Provides the annotation in the second map, or a null pointer.  At
+ *    least one of the two pointers must be valid.
+ *
+ * \return
+ *    Returns the annotation for the fused map.
+ */
+
+static annotation
+chained_annotation
+(
+   int value,
+   const annotation * first,
+   const annotation * second
+)
+{
+   if (is_nullptr(second))
+   {
+      return annotation
+      (
+         value, first->key_name(), first->value_name(), first->gm_name()
+      );
+   }
+   else
+   {
+      return annotation
+      (
+         value, not_nullptr(first) ? first->key_name() : second->key_name(),
+         second->value_name(), second->gm_name()
+      );
+   }
+}
+
+/**
+ *    Appends another mapping to this one, so that every event remapped by
+ *    this mapper is then remapped by the next one, as if the output MIDI
+ *    file had been converted again.  Rather than make a second pass, the
+ *    flat tables of the next mapper are fused into the tables of this one,
+ *    so that remap_note() and remap_program() still need only one lookup.
+ *    Any channel filter of either mapper is kept, since a dropped event
+ *    stays dropped.
+ *
+ *    The drum and patch maps are replaced by the fused maps, indexed by
+ *    the values in the input MIDI file, so that show_maps() and the
+ *    conversion counts describe the whole chain.  The drum channel of the
+ *    chain is the device channel of this mapper, or, if it has none, the
+ *    input channel that this mapper sends to the device channel of the
+ *    next one.  Fused drum entries on any other channel, and fused patch
+ *    entries that come from the map of a single channel, go into the maps
+ *    of their input channels.  Controllers are fused like patches.  The
+ *    controller, velocity, and bend curves of the next mapper are added
+ *    after those of this one, and the fused value and velocity tables are
+ *    made directly from the tables of the two mappers.
+ *
+ *    This function must be called only before any remapping is done, as
+ *    the counts are not carried through the chain.  The INI file names
+ *    are joined for show_maps(), with each reversed file marked, and the
+ *    chain itself is not reported as reversed.  The other direction of a
+ *    mapper built for both directions is dropped, since it would have to
+ *    be chained in the opposite order.
+ *
+ * \param next
+ *    Provides the mapper to be applied after this one.
+ */
+
+void
+midimapper::chain (const midimapper & next)
+{
+   int drums = m_device_channel;
+   if (drums < 0 || drums >= CHANNEL_COUNT)
+   {
+      drums = NOT_ACTIVE;
+      int nextdrums = next.m_device_channel;
+      if (nextdrums >= 0 && nextdrums < CHANNEL_COUNT)
+      {
+         if (m_channel_table[nextdrums] == nextdrums)
+         {
+            drums = nextdrums;
+         }
+         else
+         {
+            for (int c = 0; c < CHANNEL_COUNT; ++c)
+            {
+               if (m_channel_table[c] == nextdrums)
+               {
+                  drums = c;
+                  break;
+               }
+            }
+         }
+      }
+   }
+
+   midimap drummap;
+   channel_midimaps channeldrums;
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      for (int v = 0; v < VALUE_COUNT; ++v)
+      {
+         unsigned packed = m_note_table[c][v];
+         if ((packed & REMAP_DROP) != 0)
+            continue;
+
+         int channel = int((packed >> 8) & 0x0f);
+         int note = int(packed & 0x7f);
+         const annotation * first = drum_annotation(c, v);
+         const annotation * second = next.drum_annotation(channel, note);
+         packed = next.m_note_table[channel][note];
+         if ((packed & REMAP_DROP) == 0)
+         {
+            if (not_nullptr(first) || not_nullptr(second))
+            {
+               annotation an = chained_annotation
+               (
+                  int(packed & 0x7f), first, second
+               );
+               midimap & target = c == drums ? drummap : channeldrums[c] ;
+               target.insert(std::make_pair(v, an));
+            }
+         }
+      }
+   }
+
+   midimap patchmap;
+   for (int v = 0; v < VALUE_COUNT; ++v)
+   {
+      const annotation * first = lookup(m_patch_map, v);
+      int program = mapped(first, v);
+      const annotation * second = lookup(next.m_patch_map, program);
+      if (not_nullptr(first) || not_nullptr(second))
+      {
+         annotation an = chained_annotation
+         (
+            mapped(second, program), first, second
+         );
+         patchmap.insert(std::make_pair(v, an));
+      }
+   }
+
+   channel_midimaps channelpatches;
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      int channel = m_channel_table[c];
+      for (int v = 0; v < VALUE_COUNT; ++v)
+      {
+         int program = m_patch_table[c][v];
+         const annotation * first = lookup(m_channel_patch_maps, c, v);
+         const annotation * second = active(channel) ?
+            lookup(next.m_channel_patch_maps, channel, program) : nullptr ;
+
+         if (active(channel))
+            m_patch_table[c][v] = next.m_patch_table[channel][program];
+
+         if (not_nullptr(first) || not_nullptr(second))
+         {
+            annotation an = chained_annotation
+            (
+               int(m_patch_table[c][v]),
+               not_nullptr(first) ? first : lookup(m_patch_map, v),
+               not_nullptr(second) || ! active(channel) ?
+                  second : lookup(next.m_patch_map, program)
+            );
+            channelpatches[c].insert(std::make_pair(v, an));
+         }
+      }
+   }
+
+   midimap controlmap;
+   curve_map controlcurves;
+   for (int v = 0; v < VALUE_COUNT; ++v)
    {
-      return NOT_ACTIVE;
+      const annotation * first = lookup(m_control_map, v);
+      int control = mapped(first, v);
+      const annotation * second = lookup(next.m_control_map, control);
+      if (not_nullptr(first) || not_nullptr(second))
+      {
+         annotation an = chained_annotation
+         (
+            mapped(second, control), first, second
+         );
+         controlmap.insert(std::make_pair(v, an));
+
+         curves stages;
+         int key = control_key(NOT_ACTIVE, v);
+         append_curves(stages, find_curves(m_control_curves, key));
+         key = control_key(NOT_ACTIVE, control);
+         append_curves(stages, find_curves(next.m_control_curves, key));
+         if (! stages.empty())
+            controlcurves[control_key(NOT_ACTIVE, v)] = stages;
+      }
    }
-   else if (m_rejection_on && channel == m_filter_channel)
+
+   channel_midimaps channelcontrols;
+   curve_map velocitycurves;
+   curve_map bendcurves;
+   m_value_tables.clear();
+   (void) value_table(curves());
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
    {
-      return NOT_ACTIVE;
+      int channel = m_channel_table[c];
+      for (int v = 0; v < VALUE_COUNT; ++v)
+      {
+         unsigned packed = m_control_table[c][v] & 0xffff;
+         int control = int(packed & 0x7f);
+         const annotation * first = lookup(m_channel_control_maps, c, v);
+         const annotation * second = nullptr;
+         curves stages;
+         append_curves(stages, find_control_curves(c, v));
+         if (active(channel))
+         {
+            second = lookup(next.m_channel_control_maps, channel, control);
+            append_curves(stages, next.find_control_curves(channel, control));
+            packed = next.m_control_table[channel][control] & 0xffff;
+         }
+         m_control_table[c][v] =
+            packed | unsigned(value_table(stages)) << 16;
+
+         if (not_nullptr(first) || not_nullptr(second))
+         {
+            annotation an = chained_annotation
+            (
+               int(packed & 0x7f),
+               not_nullptr(first) ? first : lookup(m_control_map, v),
+               not_nullptr(second) || ! active(channel) ?
+                  second : lookup(next.m_control_map, control)
+            );
+            channelcontrols[c].insert(std::make_pair(v, an));
+            if (! stages.empty())
+               controlcurves[control_key(c, v)] = stages;
+         }
+      }
+
+      curves velocities;
+      curves bends = m_bend_table[c];
+      append_curves(velocities, find_curves(m_velocity_curves, c));
+      if (active(channel))
+      {
+         const curve_map & nextcurves = next.m_velocity_curves;
+         append_curves(velocities, find_curves(nextcurves, channel));
+         append_curves(bends, &next.m_bend_table[channel]);
+         for (int v = 0; v < VALUE_COUNT; ++v)
+         {
+            m_velocity_table[c][v] =
+               next.m_velocity_table[channel][m_velocity_table[c][v]];
+         }
+      }
+      m_bend_table[c] = bends;
+      if (! velocities.empty())
+         velocitycurves[c] = velocities;
+
+      if (! bends.empty())
+         bendcurves[c] = bends;
    }
-   else
+
+   /*
+    * Curves that came out the same on every channel are shown once, as
+    * the curves of all channels.
+    */
+
+   curve_map * fused [2] = { &velocitycurves, &bendcurves };
+   for (int i = 0; i < 2; ++i)
    {
-      /**
-       * Only if m_gm_channel and m_device_channel have been set are they
-       * used to detect and alter the channel number of the event.  If
-       * they aren't active, or if the channel isn't the drum channel to
-       * be remapped, then the "[Channels]" map is checked.
-       */
+      curve_map & m = *fused[i];
+      bool same = int(m.size()) == CHANNEL_COUNT;
+      curve_map::const_iterator ci = m.begin();
+      for ( ; same && ci != m.end(); ++ci)
+         same = ci->second == m.begin()->second;
 
-      if (active(m_gm_channel, m_device_channel) && channel == m_device_channel)
+      if (same)
       {
-         channel = m_gm_channel;
+         curves all = m.begin()->second;
+         m.clear();
+         m[int(NOT_ACTIVE)] = all;
       }
-      else
+   }
+
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      int channel = m_channel_table[c];
+      if (active(channel))
+         m_channel_table[c] = next.m_channel_table[channel];
+
+      for (int v = 0; v < VALUE_COUNT; ++v)
       {
-         std::map<int, int>::const_iterator ci = m_channel_map.find(channel);
-         if (ci != m_channel_map.end())
-            channel = ci->second;
+         unsigned packed = m_note_table[c][v];
+         if ((packed & REMAP_DROP) == 0)
+         {
+            m_note_table[c][v] =
+               next.m_note_table[(packed >> 8) & 0x0f][packed & 0x7f];
+         }
+         m_drum_table[c][v] = uint8_t(m_note_table[c][v] & 0x7f);
+         packed = m_program_table[c][v];
+         if ((packed & REMAP_DROP) == 0)
+         {
+            m_program_table[c][v] =
+               next.m_program_table[(packed >> 8) & 0x0f][packed & 0x7f];
+         }
       }
-      return channel;
    }
+   pack_velocities();                  /* the fused velocity tables        */
+   m_device_channel = drums;
+   m_gm_channel = active(drums) ? m_channel_table[drums] : NOT_ACTIVE ;
+   m_channel_map.clear();
+   for (int c = 0; c < CHANNEL_COUNT; ++c)
+   {
+      int channel = m_channel_table[c];
+      if (active(channel) && channel != c && c != m_device_channel)
+         m_channel_map.insert(std::make_pair(c, channel));
+   }
+   m_drum_map.swap(drummap);
+   m_patch_map.swap(patchmap);
+   m_channel_drum_maps.swap(channeldrums);
+   m_channel_patch_maps.swap(channelpatches);
+   m_control_map.swap(controlmap);
+   m_channel_control_maps.swap(channelcontrols);
+   m_control_curves.swap(controlcurves);
+   m_velocity_curves.swap(velocitycurves);
+   m_bend_curves.swap(bendcurves);
+   m_record_count = int
+   (
+      m_drum_map.size() + m_patch_map.size() + m_control_map.size() +
+      m_velocity_curves.size() + m_bend_curves.size()
+   );
+   channel_midimaps::const_iterator cmi = m_channel_drum_maps.begin();
+   for ( ; cmi != m_channel_drum_maps.end(); ++cmi)
+      m_record_count += int(cmi->second.size());
+
+   cmi = m_channel_patch_maps.begin();
+   for ( ; cmi != m_channel_patch_maps.end(); ++cmi)
+      m_record_count += int(cmi->second.size());
+
+   cmi = m_channel_control_maps.begin();
+   for ( ; cmi != m_channel_control_maps.end(); ++cmi)
+      m_record_count += int(cmi->second.size());
+
+   if (m_map_type != next.m_map_type)
+      m_map_type = "multi";
+
+   if (m_map_reversed)                 /* each file is marked, not the chain */
+   {
+      m_ini_filespec += " (reversed)";
+      m_map_reversed = false;
+   }
+   m_ini_filespec += " -> " + next.m_ini_filespec;
+   if (next.m_map_reversed)
+      m_ini_filespec += " (reversed)";
+
+   m_non_injective += next.m_non_injective;
+   m_is_valid = m_is_valid && next.m_is_valid;
+   delete m_inverse;                   /* the chain runs one way only       */
+   m_inverse = nullptr;
+   if (midicvt_option_debug())
+      show_maps("chain()", *this);
 }
 
 /**
- *    Changes a program/patch value based on the patch-mapping that was
- *    provided.
+ *    Writes out the entries of one drum, patch, or controller map to
+ *    stderr, for show_maps().  Patches are shown on the 1-128 scale, and
+ *    the value curves of a controller on a line of their own.
  *
- *    Since the reversal option for note values is set up during the
- *    construction of the note map, the m_map_reversed flag does not
- *    need to be checked in this function.
+ * \param container
+ *    The midimapper that holds the map, and the conversion counts.
  *
- * \param program
- *    Provides the value of the input patch, as obtained from the input
- *    MIDI file.
+ * \param m
+ *    The map to be shown.
+ *
+ * \param channel
+ *    The channel of the map, 0 to 15, or NOT_ACTIVE for the main drum,
+ *    patch, or controller map.
+ *
+ * \param sect
+ *    The kind of map, INI_SECTION_DRUM, INI_SECTION_PATCH, or
+ *    INI_SECTION_CONTROL.
+ *
+ * \param full_output
+ *    If false, map entries not used in the conversion are not shown.
  *
  * \return
- *    Returns the output patch value corresponding to the input patch value.
- *    If the input patch is not found in the map, it is returned unaltered.
- *    The map is empty if an empty INI file-name was passed to the
- *    constructor.
+ *    Returns the number of entries shown.
  */
 
-int
-midimapper::repatch (int program)
+static int
+show_map
+(
+   const midipp::midimapper & container,
+   const std::map<int, annotation> & m,
+   int channel,
+   gm_ini_section_t sect,
+   bool full_output
+)
 {
-   iterator ni = m_patch_map.find(program);
-   if (ni != m_patch_map.end())
+   const char * fpformat = "%4d: Note  #%2d  %-24s ---> #%2d  %-24s (%s)\n" ;
+   if (sect == INI_SECTION_PATCH)
+      fpformat = "%4d: Patch #%3d %-24s ---> #%3d %-24s (%s)\n" ;
+   else if (sect == INI_SECTION_CONTROL)
+      fpformat = "%4d: Control #%3d %-24s ---> #%3d %-24s (%s)\n" ;
+
+   int offset = sect == INI_SECTION_PATCH ? 1 : 0 ;   /* patches to human */
+   int testcounter = 0;
+   std::map<int, annotation>::const_iterator mi = m.begin();
+   for ( ; mi != m.end(); ++mi)
    {
-      program = ni->second.value();
-      ni->second.increment_count();
+      int count;
+      bool scoped = midimapper::active(channel);
+      if (sect == INI_SECTION_PATCH)
+      {
+         count = scoped ?
+            container.patch_count(channel, mi->first) :
+            container.patch_count(mi->first) ;
+      }
+      else if (sect == INI_SECTION_CONTROL)
+      {
+         count = scoped ?
+            container.control_count(channel, mi->first) :
+            container.control_count(mi->first) ;
+      }
+      else
+      {
+         count = scoped ?
+            container.drum_count(channel, mi->first) :
+            container.drum_count(mi->first) ;
+      }
+      if (full_output || count > 0)
+      {
+         fprintf
+         (
+            stderr, fpformat, count,
+            mi->first + offset, mi->second.key_name().c_str(),
+            mi->second.value() + offset, mi->second.value_name().c_str(),
+            mi->second.gm_name().c_str()
+         );
+         if (sect == INI_SECTION_CONTROL)
+         {
+            std::string values =
+               container.control_values(channel, mi->first);
+
+            if (! values.empty())
+               fprintf(stderr, "      Values: %s\n", values.c_str());
+         }
+         ++testcounter;
+      }
    }
-   return program;
+   return testcounter;
 }
 
 /**
@@ -816,8 +3293,6 @@ show_maps
       "   Extract channel:          %s\n"
       "   Reject channel:           %s\n"
       "   Reverse map:              %s\n"
-      "Drum/note map:\n"
-      "   Size:                     %d\n"
       ,
       tag.c_str(),
       container.file_style().c_str(),
@@ -829,43 +3304,52 @@ show_maps
       container.filter_channel(),         // tritto, unless NOT_ACTIVE
       bool_to_cstr(container.extract()),
       bool_to_cstr(container.reject()),
-      bool_to_cstr(container.map_reversed()),
+      bool_to_cstr(container.map_reversed())
+   );
+   if (container.non_injective() > 0)
+   {
+      fprintf
+      (
+         stderr, "   Non-injective pairs:      %d\n",
+         container.non_injective()
+      );
+   }
+   fprintf
+   (
+      stderr,
+      "Drum/note map:\n"
+      "   Size:                     %d\n"
+      ,
       int(container.drum_map().size())
    );
    if (! container.drum_map().empty())
    {
-      const char * fpformat = 
-         "%4d: Note  #%2d  %-24s ---> #%2d  %-24s (%s)\n";
-
-      int testcounter = 0;
-      midipp::midimapper::const_iterator mi = container.drum_map().begin();
-      for ( ; mi != container.drum_map().end(); ++mi)
-      {
-         std::string gmname;
-         std::string devname;
-         std::string equivname;
-         int gm;
-         int dev;
-         bool show_it = full_output;
-         if (! full_output)
-            show_it = mi->second.count() > 0;
-
-         if (show_it)
-         {
-            gm = mi->first;
-            dev = mi->second.value();
-            gmname = mi->second.key_name();
-            devname = mi->second.value_name();
-            equivname = mi->second.gm_name();
-            fprintf
-            (
-               stderr, fpformat,
-               mi->second.count(), gm, gmname.c_str(),
-               dev, devname.c_str(), equivname.c_str()
-            );
-            ++testcounter;
-         }
-      }
+      int testcounter = show_map
+      (
+         container, container.drum_map(), midimapper::NOT_ACTIVE,
+         INI_SECTION_DRUM, full_output
+      );
+      fprintf(stderr, "   %d drum records dumped\n", testcounter);
+   }
+   midipp::midimapper::channel_midimaps::const_iterator cmi;
+   for
+   (
+      cmi = container.channel_drum_maps().begin();
+      cmi != container.channel_drum_maps().end(); ++cmi
+   )
+   {
+      fprintf
+      (
+         stderr,
+         "Drum/note map, channel %d:\n"
+         "   Size:                     %d\n"
+         ,
+         cmi->first + 1, int(cmi->second.size())
+      );
+      int testcounter = show_map
+      (
+         container, cmi->second, cmi->first, INI_SECTION_DRUM, full_output
+      );
       fprintf(stderr, "   %d drum records dumped\n", testcounter);
    }
    fprintf
@@ -878,40 +3362,101 @@ show_maps
    );
    if (! container.patch_map().empty())
    {
-      const char * fpformat = 
-         "%4d: Patch #%3d %-24s ---> #%3d %-24s (%s)\n";
+      int testcounter = show_map
+      (
+         container, container.patch_map(), midimapper::NOT_ACTIVE,
+         INI_SECTION_PATCH, full_output
+      );
+      fprintf(stderr, "   %d patch records dumped\n", testcounter);
+   }
+   for
+   (
+      cmi = container.channel_patch_maps().begin();
+      cmi != container.channel_patch_maps().end(); ++cmi
+   )
+   {
+      fprintf
+      (
+         stderr,
+         "Patch/program map, channel %d:\n"
+         "   Size:                     %d\n"
+         ,
+         cmi->first + 1, int(cmi->second.size())
+      );
+      int testcounter = show_map
+      (
+         container, cmi->second, cmi->first, INI_SECTION_PATCH, full_output
+      );
+      fprintf(stderr, "   %d patch records dumped\n", testcounter);
+   }
+   if (! container.control_map().empty())
+   {
+      fprintf
+      (
+         stderr,
+         "Controller map:\n"
+         "   Size:                     %d\n"
+         ,
+         int(container.control_map().size())
+      );
+      int testcounter = show_map
+      (
+         container, container.control_map(), midimapper::NOT_ACTIVE,
+         INI_SECTION_CONTROL, full_output
+      );
+      fprintf(stderr, "   %d controller records dumped\n", testcounter);
+   }
+   for
+   (
+      cmi = container.channel_control_maps().begin();
+      cmi != container.channel_control_maps().end(); ++cmi
+   )
+   {
+      fprintf
+      (
+         stderr,
+         "Controller map, channel %d:\n"
+         "   Size:                     %d\n"
+         ,
+         cmi->first + 1, int(cmi->second.size())
+      );
+      int testcounter = show_map
+      (
+         container, cmi->second, cmi->first, INI_SECTION_CONTROL, full_output
+      );
+      fprintf(stderr, "   %d controller records dumped\n", testcounter);
+   }
+
+   /*
+    * The velocity and bend curves have no counts, so they are shown
+    * whenever they are present.
+    */
+
+   const char * curvenames [2] = { "Velocity", "Pitch-bend" };
+   const midipp::midimapper::curve_map * curvemaps [2] =
+   {
+      &container.velocity_curves(), &container.bend_curves()
+   };
+   for (int i = 0; i < 2; ++i)
+   {
+      if (curvemaps[i]->empty())
+         continue;
 
-      int testcounter = 0;
-      midipp::midimapper::const_iterator mi = container.patch_map().begin();
-      for ( ; mi != container.patch_map().end(); ++mi)
+      fprintf(stderr, "%s curves:\n", curvenames[i]);
+      midipp::midimapper::curve_map::const_iterator ci;
+      for (ci = curvemaps[i]->begin(); ci != curvemaps[i]->end(); ++ci)
       {
-         std::string gmname;
-         std::string devname;
-         std::string equivname;
-         int gm;
-         int dev;
-         bool show_it = full_output;
-         if (! full_output)
-            show_it = mi->second.count() > 0;
-
-         if (show_it)
+         std::string text = midimapper::curves_text(ci->second);
+         if (midimapper::active(ci->first))
          {
-            gm = mi->first + 1;                 /* adjust to human terms   */
-            dev = mi->second.value() + 1;       /* ditto                   */
-            gmname = mi->second.key_name();
-            devname = mi->second.value_name();
-            equivname = mi->second.gm_name();
             fprintf
             (
-               stderr, fpformat,
-               mi->second.count(), gm, gmname.c_str(),
-               dev, devname.c_str(),
-               equivname.c_str()
+               stderr, "   Channel %2d: %s\n", ci->first + 1, text.c_str()
             );
-            ++testcounter;
          }
+         else
+            fprintf(stderr, "   All channels: %s\n", text.c_str());
       }
-      fprintf(stderr, "   %d patch records dumped\n", testcounter);
    }
    if (full_output)
    {
@@ -952,17 +3497,65 @@ show_maps
 }                 // namespace midipp
 
 /**
- *    Holds the single pointer to the midipp::midimapper object the caller
- *    created.  Since we're integrating with C code, we can't really use
- *    more than one object at a time anyway.
+ *    Holds what the callbacks of a thread need to remap an event: the
+ *    midipp::midimapper bound by midimap_init(), which is only read, and
+ *    the midicounts in which that thread counts its conversions.
+ */
+
+typedef struct
+{
+   const midipp::midimapper * mapper;
+   midipp::midicounts * counts;
+
+} midimap_context;
+
+/**
+ *    Provides the context of the current thread, to which Mf_userdata
+ *    points once midimap_init() has been called.  The Mf_* callbacks, and
+ *    Mf_userdata, are thread-local, so each thread can convert a file
+ *    with the same mapper while counting the conversions in its own
+ *    midicounts.
+ */
+
+static MIDICVT_THREAD_LOCAL midimap_context s_context = { nullptr, nullptr };
+
+/**
+ *    Gets the context bound to the callbacks of the current thread by
+ *    midimap_init().
+ *
+ * \return
+ *    Returns the context, or a null pointer if no mapper has been bound.
+ */
+
+static inline const midimap_context *
+current_context ()
+{
+   return static_cast<const midimap_context *>(Mf_userdata);
+}
+
+/**
+ *    Binds the midipp::midimapper object provided to the parser/writer
+ *    context of the current thread, to allow the C routines to be able to
+ *    use the features of the MIDI mapper.  The conversions are counted in
+ *    the mapper's own midicounts.  The object must outlive the conversion
+ *    done by mftransform() in this thread.
+ *
+ * \param mm
+ *    Provides the MIDI mapper object to be used.
  */
 
-static midipp::midimapper * gs_singleton_midimapper = nullptr;
+void
+midimap_init (midipp::midimapper & mm)
+{
+   midimap_init(mm, mm.counts());
+}
 
 /**
- *    Hooks the midipp::midimapper object provided to the global pointer
- *    for such objects, to allow the C routines to be able to use the
- *    features of the MIDI mapper.
+ *    Binds a midipp::midimapper object, and the conversion counts of the
+ *    calling thread, to the parser/writer context of the current thread.
+ *    Several threads can share the mapper, as long as each has its own
+ *    counts.  Both objects must outlive the conversion done by
+ *    mftransform() in this thread.
  *
  *    This function calls midicvt_initfuncs_m2m() to set up the
  *    MIDI-to-MIDI callbacks, but then overrides some of them with the
@@ -970,12 +3563,17 @@ static midipp::midimapper * gs_singleton_midimapper = nullptr;
  *
  * \param mm
  *    Provides the MIDI mapper object to be used.
+ *
+ * \param counts
+ *    Provides the conversion counts of the calling thread.
  */
 
 void
-midimap_init (midipp::midimapper & mm)
+midimap_init (const midipp::midimapper & mm, midipp::midicounts & counts)
 {
-   gs_singleton_midimapper = &mm;
+   s_context.mapper = &mm;
+   s_context.counts = &counts;
+   Mf_userdata = &s_context;
    midicvt_initfuncs_m2m();
    Mf_on             = midimap_non;
    Mf_off            = midimap_noff;
@@ -987,7 +3585,7 @@ midimap_init (midipp::midimapper & mm)
 }
 
 /**
- *    This static C function uses the singleton midipp::midimapper object
+ *    This static C function uses the thread's midipp::midimapper object
  *    to remap the channel and pitch values, and passes them to the
  *    corresponding callback function defined in the midicvt_m2m.c module.
  *
@@ -1016,29 +3614,21 @@ midimap_init (midipp::midimapper & mm)
 static int
 midimap_non (int chan, int pitch, int vol)
 {
-   int result = not_nullptr(gs_singleton_midimapper);
-   int chan_2;
-   int pitch_2;
-   if (result)
+   const midimap_context * mc = current_context();
+   int result = 0;
+   bool keep = true;
+   if (not_nullptr(mc))
    {
-      chan_2 = gs_singleton_midimapper->rechannel(chan);
-      pitch_2 = gs_singleton_midimapper->repitch(chan, pitch);
+      keep = mc->mapper->remap_note_on(chan, pitch, vol, *mc->counts);
    }
-   else
-   {
-      chan_2 = chan;
-      pitch_2 = pitch;
-   }
-   if (midipp::midimapper::active(chan_2, pitch_2))
-      result = m2m_non(chan_2, pitch_2, vol);
-   else
-      result = 0;
+   if (keep)
+      result = m2m_non(chan, pitch, vol);
 
    return result;
 }
 
 /**
- *    This static C function uses the singleton midipp::midimapper object
+ *    This static C function uses the thread's midipp::midimapper object
  *    to remap the channel and pitch values, and passes them to the
  *    corresponding callback function defined in the midicvt_m2m.c module.
  *
@@ -1062,29 +3652,20 @@ midimap_non (int chan, int pitch, int vol)
 static int
 midimap_noff (int chan, int pitch, int vol)
 {
-   int result = not_nullptr(gs_singleton_midimapper);
-   int chan_2;
-   int pitch_2;
-   if (result)
-   {
-      chan_2 = gs_singleton_midimapper->rechannel(chan);
-      pitch_2 = gs_singleton_midimapper->repitch(chan, pitch);
-   }
-   else
-   {
-      chan_2 = chan;
-      pitch_2 = pitch;
-   }
-   if (midipp::midimapper::active(chan_2, pitch_2))
-      result = m2m_noff(chan_2, pitch_2, vol);
-   else
-      result = 0;
+   const midimap_context * mc = current_context();
+   int result = 0;
+   bool keep = true;
+   if (not_nullptr(mc))
+      keep = mc->mapper->remap_note(chan, pitch, *mc->counts);
+
+   if (keep)
+      result = m2m_noff(chan, pitch, vol);
 
    return result;
 }
 
 /**
- *    This static C function uses the singleton midipp::midimapper object
+ *    This static C function uses the thread's midipp::midimapper object
  *    to remap the channel and pitch values, and passes them to the
  *    corresponding callback function defined in the midicvt_m2m.c module.
  *
@@ -1108,23 +3689,14 @@ midimap_noff (int chan, int pitch, int vol)
 static int
 midimap_pressure (int chan, int pitch, int pressure)
 {
-   int result = not_nullptr(gs_singleton_midimapper);
-   int chan_2;
-   int pitch_2;
-   if (result)
-   {
-      chan_2 = gs_singleton_midimapper->rechannel(chan);
-      pitch_2 = gs_singleton_midimapper->repitch(chan, pitch);
-   }
-   else
-   {
-      chan_2 = chan;
-      pitch_2 = pitch;
-   }
-   if (midipp::midimapper::active(chan_2, pitch_2))
-      result = m2m_pressure(chan_2, pitch_2, pressure);
-   else
-      result = 0;
+   const midimap_context * mc = current_context();
+   int result = 0;
+   bool keep = true;
+   if (not_nullptr(mc))
+      keep = mc->mapper->remap_note(chan, pitch, *mc->counts);
+
+   if (keep)
+      result = m2m_pressure(chan, pitch, pressure);
 
    return result;
 }
@@ -1151,29 +3723,21 @@ midimap_pressure (int chan, int pitch, int pressure)
 static int
 midimap_patch (int chan, int patch)
 {
-   int result = not_nullptr(gs_singleton_midimapper);
-   int chan_2;
-   int patch_2;
-   if (result)
-   {
-      chan_2 = gs_singleton_midimapper->rechannel(chan);
-      patch_2 = gs_singleton_midimapper->repatch(patch);
-   }
-   else
-   {
-      chan_2 = chan;
-      patch_2 = patch;
-   }
-   if (midipp::midimapper::active(chan_2, patch_2))
-      result = m2m_program(chan_2, patch_2);
-   else
-      result = 0;
+   const midimap_context * mc = current_context();
+   int result = 0;
+   bool keep = true;
+   if (not_nullptr(mc))
+      keep = mc->mapper->remap_program(chan, patch, *mc->counts);
+
+   if (keep)
+      result = m2m_program(chan, patch);
 
    return result;
 }
 
 /**
- *    For filtering parameter/control messages.
+ *    Remaps the channel, the controller number, and the value of
+ *    parameter/control messages, and filters them by channel.
  *
  * \param chan
  *    Provides the channel number to write.
@@ -1192,23 +3756,21 @@ midimap_patch (int chan, int patch)
 static int
 midimap_parameter (int chan, int control, int value)
 {
-   int result = not_nullptr(gs_singleton_midimapper);
-   int chan_2;
-   if (result)
-      chan_2 = gs_singleton_midimapper->rechannel(chan);
-   else
-      chan_2 = chan;
+   const midimap_context * mc = current_context();
+   int result = 0;
+   bool keep = true;
+   if (not_nullptr(mc))
+      keep = mc->mapper->remap_control(chan, control, value, *mc->counts);
 
-   if (midipp::midimapper::active(chan_2))
-      result = m2m_parameter(chan_2, control, value);
-   else
-      result = 0;
+   if (keep)
+      result = m2m_parameter(chan, control, value);
 
    return result;
 }
 
 /**
- *    For filtering pitchbend messages.
+ *    Remaps the channel and the 14-bit value of pitchbend messages, and
+ *    filters them by channel.
  *
  * \param chan
  *    Provides the channel number to write.
@@ -1229,17 +3791,18 @@ midimap_parameter (int chan, int control, int value)
 static int
 midimap_pitchbend (int chan, int lsb, int msb)
 {
-   int result = not_nullptr(gs_singleton_midimapper);
-   int chan_2;
-   if (result)
-      chan_2 = gs_singleton_midimapper->rechannel(chan);
-   else
-      chan_2 = chan;
-
-   if (midipp::midimapper::active(chan_2))
-      result = m2m_pitchbend(chan_2, lsb, msb);
-   else
-      result = 0;
+   const midimap_context * mc = current_context();
+   int result = 0;
+   bool keep = true;
+   if (not_nullptr(mc))
+   {
+      int value = (msb << 7) | lsb;
+      keep = mc->mapper->remap_bend(chan, value);
+      lsb = value & 0x7f;
+      msb = (value >> 7) & 0x7f;
+   }
+   if (keep)
+      result = m2m_pitchbend(chan, lsb, msb);
 
    return result;
 }
@@ -1261,10 +3824,11 @@ midimap_pitchbend (int chan, int lsb, int msb)
 static int
 midimap_chanpressure (int chan, int pressure)
 {
-   int result = not_nullptr(gs_singleton_midimapper);
+   const midimap_context * mc = current_context();
+   int result = not_nullptr(mc);
    int chan_2;
    if (result)
-      chan_2 = gs_singleton_midimapper->rechannel(chan);
+      chan_2 = mc->mapper->rechannel(chan);
    else
       chan_2 = chan;
 
@@ -29,7 +29,7 @@
  * \library       midicvt application
  * \author        Major modifications by Chris Ahlstrom
  * \date          2014-04-09
- * \updates       2016-04-15
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
@@ -56,6 +56,9 @@
  */
 
 #include <midicvt_base.h>              /* provides default midifile callbacks */
+#include <midicvt_bin.h>               /* provides --binary conversions       */
+#include <midicvt_csv.h>               /* provides --csv/--tsv callbacks      */
+#include <midicvt_json.h>              /* provides --json callbacks           */
 #include <midicvt_helpers.h>           /* provides flex and help-text support */
 #include <midicvt_globals.h>           /* encapsulates global variables       */
 #include <midicvt_m2m.h>               /* provides alternate callbacks        */
@@ -94,9 +97,17 @@ main (int argc, char * argv [])
    {
       if (midicvt_setup_compile())
       {
-         midicvt_initfuncs_t2mf();
-         midicvt_compile();
+         cbool_t ok = true;
+         if (midicvt_option_binary())  /* convert "x.mcvb" to "y.mid"         */
+            ok = midicvt_compile_bin();
+         else
+         {
+            midicvt_initfuncs_t2mf();
+            ok = midicvt_compile() || ! midicvt_option_validate();
+         }
          midicvt_close_compile();
+         if (! ok)
+            return 1;
       }
       else
          return 1;
@@ -112,6 +123,51 @@ main (int argc, char * argv [])
       else
          return 1;
    }
+   else if (midicvt_option_binary())   /* convert "x.mid" to "y.mcvb"         */
+   {
+      if (midicvt_setup_mfread())
+      {
+         cbool_t ok;
+         midicvt_initfuncs_bin();
+         mfread();
+         ok = midicvt_close_bin();
+         midicvt_close_mfread();
+         if (! ok)
+            return 1;
+      }
+      else
+         return 1;
+   }
+   else if (midicvt_option_json())     /* convert "x.mid" to JSON             */
+   {
+      if (midicvt_setup_mfread())
+      {
+         cbool_t ok;
+         midicvt_initfuncs_json();
+         mfread();
+         ok = midicvt_close_json();
+         midicvt_close_mfread();
+         if (! ok)
+            return 1;
+      }
+      else
+         return 1;
+   }
+   else if (midicvt_option_csv())      /* convert "x.mid" to CSV/TSV rows     */
+   {
+      if (midicvt_setup_mfread())
+      {
+         cbool_t ok;
+         midicvt_initfuncs_csv();
+         mfread();
+         ok = midicvt_close_csv();
+         midicvt_close_mfread();
+         if (! ok)
+            return 1;
+      }
+      else
+         return 1;
+   }
    else
    {
       if (midicvt_setup_mfread())
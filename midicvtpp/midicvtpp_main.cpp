@@ -29,7 +29,7 @@
  * \library       midicvtpp application
  * \author        Chris Ahlstrom
  * \date          2014-04-19
- * \updates       2016-04-24
+ * \updates       2026-10-18
  * \version       $Revision$
  * \license       GNU GPL
  *
@@ -40,10 +40,16 @@
  *    to do some common remapping operations.
  */
 
+#include <vector>
+
 #include <csvarray.hpp>                /* class midipp::csvarray              */
 #include <initree.hpp>                 /* class midipp::initree               */
 #include <iniwriting.hpp>              /* free functions to write INI's       */
+#include <midibatch.hpp>               /* class midipp::midibatch             */
 #include <midicvt_base.h>              /* provides default midifile callbacks */
+#include <midicvt_bin.h>               /* provides --binary conversions       */
+#include <midicvt_csv.h>               /* provides --csv/--tsv callbacks      */
+#include <midicvt_json.h>              /* provides --json callbacks           */
 #include <midicvt_helpers.h>           /* provides flex and help-text support */
 #include <midicvt_globals.h>           /* encapsulates global variables       */
 #include <midicvt_m2m.h>               /* provides alternate callbacks        */
@@ -77,15 +83,32 @@ static const char * const gs_help_usage_1 =
    "                 Option -o/--output specifies the output name.  Default is\n"
    "                 'out.ini', not stdout.\n"
    " --m2m f         Employ the given INI mapping file to convert MIDI to MIDI.\n"
+   "                 It can also be a map compiled by --compile-map.  Give\n"
+   "                 --m2m more than once to apply several maps in order;\n"
+   "                 they are fused, so the MIDI file is converted once.\n"
+   "                 With --binary, write remapped binary event records.\n"
+   " --compile-map f Compile the --m2m INI file, in both directions, into the\n"
+   "                 binary map file f, which --m2m loads much faster.  If the\n"
+   "                 INI file changes, the map is compiled again when used.\n"
    "\n"
    "The following options also require the --m2m option:\n"
    "\n"
    " --reverse       Reverse the mapping specified by --m2m. Not all mappings\n"
    "                 can be fully reversed; unique key values are required in\n"
-   "                 both directions.\n"
+   "                 both directions.  With several --m2m files, it reverses\n"
+   "                 only the one just before it.\n"
+   " --round-trip f  Also convert the output back, with the reverse of the\n"
+   "                 --m2m map, into the MIDI file f.  Both directions come\n"
+   "                 from one reading of the INI file.  With --batch, f is a\n"
+   "                 name template, like -o.  Takes only one --m2m file.\n"
    " --extract n     Write only channel events from channel n, n = 1 to 16.\n"
    " --reject n      Write only channel events not from channel n.\n"
    " --summarize     Show a summary count of the conversions that occurred.\n"
+   " --batch f       Convert every MIDI file listed in file f, one name per\n"
+   "                 line, or every .mid file in directory f.  The -o option\n"
+   "                 gives the output names, with %s for the base name of\n"
+   "                 each input file, e.g. -o out/%s-pss.mid.  Use --jobs\n"
+   "                 to convert several files at the same time.\n"
    " --testing       Only the programmer knows what this one does. :-D\n"
    ;
 
@@ -148,6 +171,19 @@ static std::string s_ini_in_filename = "";
 
 static bool s_m2m_reversal = false;
 
+/**
+ *    For a chain of --m2m options, holds the names of the INI files after
+ *    the first one, in the order they are to be applied.
+ */
+
+static std::vector<std::string> s_ini_chain;
+
+/**
+ *    Holds the --reverse setting of each file in s_ini_chain.
+ */
+
+static std::vector<bool> s_chain_reversal;
+
 /**
  *    Provides the name of the MIDI remapping process.  This name is just
  *    a tag name for output, and defaults to "midicvtpp". However, the
@@ -180,6 +216,28 @@ static bool s_rejection_on = false;
 
 static bool s_summarize_conversion = false;
 
+/**
+ *    For the --batch option, holds the name of the directory, or of the
+ *    file listing the MIDI files, to convert with the --m2m mapping.
+ */
+
+static std::string s_batch_source;
+
+/**
+ *    For the --round-trip option, holds the name of the file, or with
+ *    --batch the template of the names, into which the output is converted
+ *    back with the other direction of the --m2m map.
+ */
+
+static std::string s_round_trip;
+
+/**
+ *    For the --compile-map option, holds the name of the compiled map
+ *    file to write from the --m2m INI file.
+ */
+
+static std::string s_map_out_filename;
+
 /**
  *    Parses midicvtpp the command-line for options.
  *
@@ -235,12 +293,45 @@ midicvtpp_parse (int argc, char * argv [])
          }
          else if (check_option(argv[option_index], "", "--reverse"))
          {
-            s_m2m_reversal = true;
+            if (s_ini_chain.empty())
+               s_m2m_reversal = true;
+            else
+               s_chain_reversal.back() = true;
          }
          else if (check_option(argv[option_index], "", "--summarize"))
          {
             s_summarize_conversion = true;
          }
+         else if (check_option(argv[option_index], "", "--compile-map"))
+         {
+            if ((option_index + 1) < argc)
+            {
+               option_index++;
+               s_map_out_filename = argv[option_index];
+            }
+            else
+               errprint("Output map filename required for --compile-map");
+         }
+         else if (check_option(argv[option_index], "", "--round-trip"))
+         {
+            if ((option_index + 1) < argc)
+            {
+               option_index++;
+               s_round_trip = argv[option_index];
+            }
+            else
+               errprint("Output filename required for --round-trip");
+         }
+         else if (check_option(argv[option_index], "", "--batch"))
+         {
+            if ((option_index + 1) < argc)
+            {
+               option_index++;
+               s_batch_source = argv[option_index];
+            }
+            else
+               errprint("File list or directory required for --batch");
+         }
          else if (check_option(argv[option_index], "", "--extract"))
          {
             s_rejection_on = false;
@@ -326,7 +417,15 @@ midicvtpp_parse (int argc, char * argv [])
                if (argv[option_index+1][0] != '-')
                {
                   option_index++;
-                  s_ini_in_filename = argv[option_index];
+                  if (s_ini_in_filename.empty())
+                  {
+                     s_ini_in_filename = argv[option_index];
+                  }
+                  else
+                  {
+                     s_ini_chain.push_back(argv[option_index]);
+                     s_chain_reversal.push_back(false);
+                  }
                }
             }
             else
@@ -344,6 +443,102 @@ midicvtpp_parse (int argc, char * argv [])
    return result;
 }
 
+/**
+ *    Reads each --m2m file after the first one, and chains its mapping to
+ *    the mapping of the first file, so that the whole chain is applied in
+ *    one pass.
+ *
+ * \param m
+ *    Provides the mapper made from the first --m2m file.
+ *
+ * \return
+ *    Returns true if every file in the chain could be read.
+ */
+
+static bool
+midicvtpp_chain (midipp::midimapper & m)
+{
+   for (size_t i = 0; i < s_ini_chain.size(); ++i)
+   {
+      midipp::midimapper next
+      (
+         s_mapping_name, s_ini_chain[i], s_chain_reversal[i]
+      );
+      if (! next.valid())
+         return false;
+
+      m.chain(next);
+   }
+   return true;
+}
+
+/**
+ *    Checks that the --round-trip option, if given, can be honored.  The
+ *    round trip needs the other direction of the --m2m map, which a chain
+ *    of maps does not have, and it needs a MIDI output file to read back.
+ *
+ * \return
+ *    Returns true if there is no --round-trip option, or if it is usable.
+ */
+
+static bool
+midicvtpp_round_trip_ok ()
+{
+   bool result = true;
+   if (! s_round_trip.empty())
+   {
+      if (! s_ini_chain.empty())
+      {
+         errprint("--round-trip takes only one --m2m file");
+         result = false;
+      }
+      else if (midicvt_option_binary())
+      {
+         errprint("--round-trip cannot be used with --binary");
+         result = false;
+      }
+      else if (! midicvt_have_output_file())
+      {
+         errprint("--round-trip requires an output file given by -o");
+         result = false;
+      }
+   }
+   return result;
+}
+
+/**
+ *    Remaps the events read into binary event records, for --m2m with
+ *    --binary.  Rather than remapping each event in a callback while the
+ *    MIDI file is parsed, the records are remapped all at once, as
+ *    columns, by midipp::midimapper::apply(), and the events dropped by
+ *    --extract or --reject are then removed.  Must be called after
+ *    mfread() and before midicvt_close_bin().
+ *
+ * \param m
+ *    Provides the mapper, which counts the conversions.
+ */
+
+static void
+midicvtpp_remap_bin (midipp::midimapper & m)
+{
+   size_t count = size_t(midicvt_bin_record_count());
+   if (count > 0)
+   {
+      std::vector<uint8_t> columns(4 * count);
+      midipp::midievents events;
+      events.status = &columns[0];
+      events.data1 = &columns[count];
+      events.data2 = &columns[2 * count];
+      uint8_t * keep = &columns[3 * count];
+      midicvt_bin_get_columns(events.status, events.data1, events.data2);
+      (void) m.apply(events, count, keep, m.counts());
+      midicvt_bin_put_columns
+      (
+         events.status, events.data1, events.data2, keep
+      );
+   }
+}
+
 /**
  *    Provides the entry-point for the midicvtpp program.
  *
@@ -391,6 +586,25 @@ main (int argc, char * argv [])
       else
          return 1;
    }
+   else if (! s_map_out_filename.empty())
+   {
+      if (s_ini_in_filename.empty())
+      {
+         errprint("--compile-map requires an INI file given by --m2m");
+         return 1;
+      }
+      if (! s_ini_chain.empty())
+      {
+         errprint("--compile-map takes only one --m2m file");
+         return 1;
+      }
+      bool ok = midipp::midimapper::compile_map
+      (
+         s_ini_in_filename, s_map_out_filename
+      );
+      if (! ok)
+         return 1;
+   }
    else
    {
       /*
@@ -403,9 +617,17 @@ main (int argc, char * argv [])
          {
             if (midicvt_setup_compile())
             {
-               midicvt_initfuncs_t2mf();
-               midicvt_compile();
+               bool ok = true;
+               if (midicvt_option_binary())
+                  ok = midicvt_compile_bin();
+               else
+               {
+                  midicvt_initfuncs_t2mf();
+                  ok = midicvt_compile() || ! midicvt_option_validate();
+               }
                midicvt_close_compile();
+               if (! ok)
+                  return 1;
             }
             else
                return 1;
@@ -416,25 +638,148 @@ main (int argc, char * argv [])
             return 1;
          }
       }
+      else if (midicvt_option_m2m() && ! s_batch_source.empty())
+      {
+         if (! midicvt_have_output_file())
+         {
+            errprint("--batch requires an output name such as -o out/%s.mid");
+            return 1;
+         }
+
+         if (! midicvtpp_round_trip_ok())
+            return 1;
+
+         midipp::midimapper m
+         (
+            s_mapping_name, s_ini_in_filename, s_m2m_reversal,
+            s_filter_channel, s_rejection_on, std::string(), std::string(),
+            ! s_round_trip.empty()
+         );
+         if (! m.valid() || ! midicvtpp_chain(m))
+            return 1;
+
+         midipp::midibatch batch
+         (
+            m, std::string(midicvt_output_file()), midicvt_option_jobs()
+         );
+         if (! s_round_trip.empty())
+            batch.round_trip(s_round_trip);
+
+         if (! batch.add_files(s_batch_source))
+            return 1;
+
+         bool ok = batch.run();
+         if (s_summarize_conversion)
+         {
+            show_maps("Conversions", m, false);
+            if (! s_round_trip.empty())
+            {
+               show_maps
+               (
+                  "Round-trip conversions",
+                  m.direction(! m.map_reversed()), false
+               );
+            }
+         }
+
+         if (! ok)
+            return 1;
+      }
       else if (midicvt_option_m2m())
       {
+         if (! midicvtpp_round_trip_ok())
+            return 1;
+
          if (midicvt_setup_mfread())
          {
+            std::string outfile(midicvt_output_file());
             midipp::midimapper m
             (
                s_mapping_name, s_ini_in_filename, s_m2m_reversal,
                s_filter_channel, s_rejection_on,
-               std::string(midicvt_input_file()),
-               std::string(midicvt_output_file())
+               std::string(midicvt_input_file()), outfile,
+               ! s_round_trip.empty()
             );
-            if (m.valid())
+            bool ok = true;
+            bool mapped = m.valid() && midicvtpp_chain(m);
+            if (mapped)
             {
-               midimap_init(m);        /* hook it in and set it all up        */
-               mftransform();          /* a new version of mfread()           */
-               if (s_summarize_conversion)
-                  show_maps("Conversions", m, false);
+               if (midicvt_option_binary())
+               {
+                  midicvt_initfuncs_bin();
+                  mfread();
+                  midicvtpp_remap_bin(m);
+                  ok = midicvt_close_bin();
+               }
+               else
+               {
+                  midimap_init(m);     /* hook it in and set it all up        */
+                  mftransform();       /* a new version of mfread()           */
+               }
+            }
+            midicvt_close_mfread();
+
+            /*
+             * The round trip reads the output file back, so it can start
+             * only after midicvt_close_mfread() has closed it.
+             */
+
+            midipp::midimapper & back = m.direction(! m.map_reversed());
+            if (mapped && ok && ! s_round_trip.empty())
+            {
+               midimap_init(back);
+               ok = midipp::midibatch::convert(outfile, s_round_trip);
+            }
+            if (mapped && s_summarize_conversion)
+            {
+               show_maps("Conversions", m, false);
+               if (! s_round_trip.empty())
+                  show_maps("Round-trip conversions", back, false);
             }
+            if (! ok)
+               return 1;
+         }
+         else
+            return 1;
+      }
+      else if (midicvt_option_binary())
+      {
+         if (midicvt_setup_mfread())
+         {
+            midicvt_initfuncs_bin();
+            mfread();
+            bool ok = midicvt_close_bin();
+            midicvt_close_mfread();
+            if (! ok)
+               return 1;
+         }
+         else
+            return 1;
+      }
+      else if (midicvt_option_json())
+      {
+         if (midicvt_setup_mfread())
+         {
+            midicvt_initfuncs_json();
+            mfread();
+            bool ok = midicvt_close_json();
             midicvt_close_mfread();
+            if (! ok)
+               return 1;
+         }
+         else
+            return 1;
+      }
+      else if (midicvt_option_csv())
+      {
+         if (midicvt_setup_mfread())
+         {
+            midicvt_initfuncs_csv();
+            mfread();
+            bool ok = midicvt_close_csv();
+            midicvt_close_mfread();
+            if (! ok)
+               return 1;
          }
          else
             return 1;